@@ -642,6 +642,18 @@ bool command_show_osd_msg(command_t *cmd, const char* arg)
     return true;
 }
 
+#ifdef HAVE_BSV_MOVIE
+bool command_bsv_seek(command_t *cmd, const char *arg)
+{
+   char reply[64];
+   bool ret = bsv_movie_seek(input_state_get_ptr(),
+         (uint32_t)strtoul(arg, NULL, 0));
+   snprintf(reply, sizeof(reply), "BSV_SEEK %s\n", ret ? "OK" : "-1");
+   cmd->replier(cmd, reply, strlen(reply));
+   return ret;
+}
+#endif
+
 #if defined(HAVE_CHEEVOS)
 bool command_read_ram(command_t *cmd, const char *arg)
 {
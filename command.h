@@ -300,15 +300,27 @@ struct bsv_state
    char movie_path[PATH_MAX_LENGTH];
    /* Immediate playback/recording. */
    char movie_start_path[PATH_MAX_LENGTH];
+   /* Keyframe to start immediate playback from. */
+   unsigned movie_start_frame;
 
    bool movie_start_recording;
    bool movie_start_playback;
    bool movie_playback;
+   /* Compare the core state against keyframes during playback. */
+   bool movie_verify;
    bool eof_exit;
    bool movie_end;
 
 };
 
+/* Savestate embedded in a BSV2 movie */
+struct bsv_keyframe
+{
+   uint64_t offset;
+   uint32_t frame;
+   uint32_t crc;
+};
+
 struct bsv_movie
 {
    intfstream_t *file;
@@ -316,10 +328,32 @@ struct bsv_movie
    /* A ring buffer keeping track of positions
     * in the file for each frame. */
    size_t *frame_pos;
+   /* Keyframes, by frame number. Read from the index
+    * on playback, collected while recording. */
+   struct bsv_keyframe *keyframes;
+   /* Keyframe state, and the same compressed */
+   uint8_t *key_state;
+   uint8_t *key_packed;
+   void *key_stream;
    size_t frame_mask;
    size_t frame_ptr;
    size_t min_file_pos;
    size_t state_size;
+   size_t header_size;
+   size_t keyframes_count;
+   size_t keyframes_cap;
+   size_t key_state_size;
+   size_t key_packed_size;
+   /* Where the inputs end, 0 if unknown. */
+   int64_t end_pos;
+   uint32_t frame_count;
+   /* Frame at min_file_pos, not 0 after seeking */
+   uint32_t first_frame;
+   /* 0 for BSV1 movies, which have no keyframes */
+   uint32_t keyframe_interval;
+   /* Keyframes checked with movie_verify */
+   uint32_t keyframes_matched;
+   uint32_t keyframes_differed;
 
    bool playback;
    bool first_rewind;
@@ -406,6 +440,9 @@ bool command_version(command_t *cmd, const char* arg);
 bool command_get_status(command_t *cmd, const char* arg);
 bool command_get_config_param(command_t *cmd, const char* arg);
 bool command_show_osd_msg(command_t *cmd, const char* arg);
+#ifdef HAVE_BSV_MOVIE
+bool command_bsv_seek(command_t *cmd, const char *arg);
+#endif
 #ifdef HAVE_CHEEVOS
 bool command_read_ram(command_t *cmd, const char *arg);
 bool command_write_ram(command_t *cmd, const char *arg);
@@ -428,6 +465,9 @@ static const struct cmd_action_map action_map[] = {
    { "GET_STATUS",       command_get_status,       "No argument" },
    { "GET_CONFIG_PARAM", command_get_config_param, "<param name>" },
    { "SHOW_MSG",         command_show_osd_msg,     "No argument" },
+#ifdef HAVE_BSV_MOVIE
+   { "BSV_SEEK",         command_bsv_seek,         "<frame>" },
+#endif
 #if defined(HAVE_CHEEVOS)
    /* These functions use achievement addresses and only work if a game with achievements is
     * loaded. READ_CORE_MEMORY and WRITE_CORE_MEMORY are preferred and use system addresses. */
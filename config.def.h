@@ -1299,6 +1299,16 @@ static const bool savestate_thumbnail_enable = false;
 #define DEFAULT_SAVESTATE_FILE_COMPRESSION true
 #endif
 
+/* When compressing save state files, use LZ4
+ * instead of zlib (faster, larger files that
+ * older versions cannot read) */
+#define DEFAULT_SAVESTATE_FILE_COMPRESSION_LZ4 false
+
+/* Store a savestate in recorded input replays every
+ * this many frames, so playback can seek.
+ * 0 keeps replays compatible with older versions. */
+#define DEFAULT_REPLAY_KEYFRAME_INTERVAL 0
+
 /* Slowmotion ratio. */
 #define DEFAULT_SLOWMOTION_RATIO 3.0
 
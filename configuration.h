@@ -189,6 +189,8 @@ typedef struct settings
       unsigned netplay_chat_color_msg;
       unsigned netplay_input_latency_frames_min;
       unsigned netplay_input_latency_frames_range;
+      unsigned netplay_replay_max_frames;
+      unsigned netplay_udp_input_frames;
       unsigned netplay_share_digital;
       unsigned netplay_share_analog;
       unsigned bundle_assets_extract_version_current;
@@ -200,6 +202,7 @@ typedef struct settings
       unsigned rewind_buffer_size_step;
       unsigned autosave_interval;
       unsigned savestate_max_keep;
+      unsigned replay_keyframe_interval;
       unsigned network_cmd_port;
       unsigned network_remote_base_port;
       unsigned keymapper_port;
@@ -874,6 +877,7 @@ typedef struct settings
       bool savestate_thumbnail_enable;
       bool save_file_compression;
       bool savestate_file_compression;
+      bool savestate_file_compression_lz4;
       bool network_cmd_enable;
       bool stdin_cmd_enable;
       bool keymapper_enable;
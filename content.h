@@ -72,9 +72,22 @@ bool content_serialize_state(void* buffer, size_t buffer_size);
 /* Deserializes the current state. */
 bool content_deserialize_state(const void* serialized_data, size_t serialized_size);
 
+struct texture_image;
+
+/* Loads the thumbnail stored in the state at path without
+ * reading the rest of the state. image may be NULL to only
+ * check that the state has one. */
+bool content_load_state_thumbnail(const char *path,
+      struct texture_image *image, bool supports_rgba);
+
 /* Waits for any in-progress save state tasks to finish */
 void content_wait_for_save_state_task(void);
 
+/* Creates and frees the buffers savestates
+ * are written from, see content_save_state() */
+void content_save_state_init(void);
+void content_save_state_deinit(void);
+
 /* Copy a save state. */
 bool content_rename_state(const char *origin, const char *dest);
 
@@ -32,6 +32,7 @@
 #include <glsym/glsym.h>
 #include <formats/image.h>
 
+#include "gl_common.h"
 #include "../video_coord_array.h"
 #include "../../retroarch.h"
 #include "../drivers_shader/shader_gl3.h"
@@ -42,6 +43,14 @@ RETRO_BEGIN_DECLS
 #define GL_CORE_NUM_PBOS 4
 #define GL_CORE_NUM_VBOS 256
 #define GL_CORE_NUM_FENCES 8
+
+/* Frontend-provided software framebuffers
+ * (RETRO_ENVIRONMENT_GET_CURRENT_SOFTWARE_FRAMEBUFFER) are backed by
+ * persistently mapped PBOs, which need glBufferStorage. */
+#if !defined(HAVE_OPENGLES) && defined(GL_MAP_PERSISTENT_BIT)
+#define GL_CORE_HAVE_SW_FRAMEBUFFER
+#endif
+
 struct gl3_streamed_texture
 {
    GLuint tex;
@@ -59,6 +68,9 @@ typedef struct gl3
    float *overlay_tex_coord;
    float *overlay_color_coord;
    GLsync fences[GL_CORE_NUM_FENCES];
+#ifdef GL_CORE_HAVE_SW_FRAMEBUFFER
+   gl_sw_framebuffer_t sw_fb;
+#endif
    void *readback_buffer_screenshot;
    struct scaler_ctx pbo_readback_scaler;
 
@@ -117,6 +129,9 @@ typedef struct gl3
 
    bool pbo_readback_valid[GL_CORE_NUM_PBOS];
    bool pbo_readback_enable;
+#ifdef GL_CORE_HAVE_SW_FRAMEBUFFER
+   bool sw_fb_enable;
+#endif
    bool hw_render_bottom_left;
    bool hw_render_enable;
    bool use_shared_context;
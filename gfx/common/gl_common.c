@@ -19,8 +19,13 @@
 #include "../../config.h"
 #endif
 
+#include <stdint.h>
+#include <string.h>
+
 #include <glsym/glsym.h>
 
+#include "gl_common.h"
+
 void gl_flush(void)
 {
    glFlush();
@@ -47,3 +52,133 @@ void gl_finish(void)
 {
    glFinish();
 }
+
+#if (defined(HAVE_OPENGL) || defined(HAVE_OPENGL_CORE)) && !defined(HAVE_OPENGLES)
+#ifdef GL_MAP_PERSISTENT_BIT
+void gl_sw_framebuffer_deinit(gl_sw_framebuffer_t *fb)
+{
+   unsigned i;
+
+   for (i = 0; i < GL_SW_FRAMEBUFFER_COUNT; i++)
+   {
+      if (fb->fences[i])
+         glDeleteSync((GLsync)fb->fences[i]);
+      if (fb->pbo[i])
+      {
+         GLuint pbo = fb->pbo[i];
+         glBindBuffer(GL_PIXEL_UNPACK_BUFFER, pbo);
+         glUnmapBuffer(GL_PIXEL_UNPACK_BUFFER);
+         glDeleteBuffers(1, &pbo);
+      }
+   }
+   glBindBuffer(GL_PIXEL_UNPACK_BUFFER, 0);
+
+   memset(fb, 0, sizeof(*fb));
+}
+
+bool gl_sw_framebuffer_init(gl_sw_framebuffer_t *fb,
+      unsigned width, unsigned height, unsigned bpp)
+{
+   unsigned i;
+   /* Keep rows 64-byte aligned, GL_UNPACK_ROW_LENGTH
+    * takes care of the padding on upload. */
+   unsigned pitch  = ((width * bpp + 63) & ~63u);
+   GLsizeiptr size = (GLsizeiptr)pitch * height;
+
+   gl_sw_framebuffer_deinit(fb);
+
+   for (i = 0; i < GL_SW_FRAMEBUFFER_COUNT; i++)
+   {
+      GLuint pbo = 0;
+
+      glGenBuffers(1, &pbo);
+      fb->pbo[i] = pbo;
+      glBindBuffer(GL_PIXEL_UNPACK_BUFFER, pbo);
+      glBufferStorage(GL_PIXEL_UNPACK_BUFFER, size, NULL,
+            GL_MAP_READ_BIT | GL_MAP_WRITE_BIT
+            | GL_MAP_PERSISTENT_BIT | GL_MAP_COHERENT_BIT);
+      fb->mapped[i] = glMapBufferRange(GL_PIXEL_UNPACK_BUFFER,
+            0, size,
+            GL_MAP_READ_BIT | GL_MAP_WRITE_BIT
+            | GL_MAP_PERSISTENT_BIT | GL_MAP_COHERENT_BIT);
+
+      if (!fb->mapped[i])
+      {
+         gl_sw_framebuffer_deinit(fb);
+         return false;
+      }
+   }
+   glBindBuffer(GL_PIXEL_UNPACK_BUFFER, 0);
+
+   fb->width  = width;
+   fb->height = height;
+   fb->pitch  = pitch;
+   return true;
+}
+
+void *gl_sw_framebuffer_acquire(gl_sw_framebuffer_t *fb)
+{
+   unsigned index = (fb->index + 1) % GL_SW_FRAMEBUFFER_COUNT;
+
+   fb->index      = index;
+   if (fb->fences[index])
+   {
+      glClientWaitSync((GLsync)fb->fences[index],
+            GL_SYNC_FLUSH_COMMANDS_BIT, 1000000000);
+      glDeleteSync((GLsync)fb->fences[index]);
+      fb->fences[index] = NULL;
+   }
+
+   return fb->mapped[index];
+}
+
+int gl_sw_framebuffer_index(const gl_sw_framebuffer_t *fb,
+      const void *frame)
+{
+   unsigned i;
+   size_t size = (size_t)fb->pitch * fb->height;
+
+   for (i = 0; i < GL_SW_FRAMEBUFFER_COUNT; i++)
+   {
+      const uint8_t *base = (const uint8_t*)fb->mapped[i];
+      if (     base
+            && (const uint8_t*)frame >= base
+            && (const uint8_t*)frame <  base + size)
+         return (int)i;
+   }
+
+   return -1;
+}
+
+void gl_sw_framebuffer_fence(gl_sw_framebuffer_t *fb, int index)
+{
+   if (fb->fences[index])
+      glDeleteSync((GLsync)fb->fences[index]);
+   fb->fences[index] = (void*)glFenceSync(
+         GL_SYNC_GPU_COMMANDS_COMPLETE, 0);
+}
+#else
+/* GL headers without glBufferStorage, the ring can never be mapped */
+void gl_sw_framebuffer_deinit(gl_sw_framebuffer_t *fb)
+{
+   memset(fb, 0, sizeof(*fb));
+}
+
+bool gl_sw_framebuffer_init(gl_sw_framebuffer_t *fb,
+      unsigned width, unsigned height, unsigned bpp)
+{
+   gl_sw_framebuffer_deinit(fb);
+   return false;
+}
+
+void *gl_sw_framebuffer_acquire(gl_sw_framebuffer_t *fb) { return NULL; }
+
+int gl_sw_framebuffer_index(const gl_sw_framebuffer_t *fb,
+      const void *frame)
+{
+   return -1;
+}
+
+void gl_sw_framebuffer_fence(gl_sw_framebuffer_t *fb, int index) { }
+#endif
+#endif
@@ -17,6 +17,28 @@
 #ifndef __GL_COMMON_H
 #define __GL_COMMON_H
 
+#include <boolean.h>
+
+#define GL_SW_FRAMEBUFFER_COUNT 3
+
+/* Ring of persistently mapped PBOs backing the frontend-provided
+ * software framebuffers (RETRO_ENVIRONMENT_GET_CURRENT_SOFTWARE_FRAMEBUFFER).
+ * Like the helpers above this header stays free of GL types,
+ * 'fences' hold GLsync objects and 'pbo' GLuint names.
+ *
+ * Only available on desktop GL builds. Without glBufferStorage
+ * (GL_MAP_PERSISTENT_BIT) in the GL headers, init always fails. */
+typedef struct gl_sw_framebuffer
+{
+   void *fences[GL_SW_FRAMEBUFFER_COUNT];
+   void *mapped[GL_SW_FRAMEBUFFER_COUNT];
+   unsigned pbo[GL_SW_FRAMEBUFFER_COUNT];
+   unsigned width;
+   unsigned height;
+   unsigned pitch;
+   unsigned index;
+} gl_sw_framebuffer_t;
+
 void gl_clear(void);
 
 void gl_enable(unsigned cap);
@@ -27,4 +49,27 @@ void gl_finish(void);
 
 void gl_flush(void);
 
+#if (defined(HAVE_OPENGL) || defined(HAVE_OPENGL_CORE)) && !defined(HAVE_OPENGLES)
+void gl_sw_framebuffer_deinit(gl_sw_framebuffer_t *fb);
+
+/* (Re)allocates the ring for width x height frames of
+ * 'bpp' bytes per pixel. Returns false if the buffers could
+ * not be mapped, in which case the ring is left empty. */
+bool gl_sw_framebuffer_init(gl_sw_framebuffer_t *fb,
+      unsigned width, unsigned height, unsigned bpp);
+
+/* Advances to the oldest buffer of the ring and returns it,
+ * waiting for the GPU if it is still uploading from it. */
+void *gl_sw_framebuffer_acquire(gl_sw_framebuffer_t *fb);
+
+/* Returns the buffer 'frame' points into,
+ * or -1 if it is memory owned by the core. */
+int gl_sw_framebuffer_index(const gl_sw_framebuffer_t *fb,
+      const void *frame);
+
+/* Call after the upload from buffer 'index' has been issued,
+ * it is not handed out again until the GPU is done with it. */
+void gl_sw_framebuffer_fence(gl_sw_framebuffer_t *fb, int index);
+#endif
+
 #endif
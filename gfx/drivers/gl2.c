@@ -58,6 +58,7 @@
 #include "../../record/record_driver.h"
 #include "../../verbosity.h"
 #include "../common/gl2_common.h"
+#include "../common/gl_common.h"
 
 #ifdef HAVE_THREADS
 #include "../video_thread_wrapper.h"
@@ -152,6 +153,13 @@ static const GLfloat white_color[] = {
 
 #endif
 
+/* Frontend-provided software framebuffers
+ * (RETRO_ENVIRONMENT_GET_CURRENT_SOFTWARE_FRAMEBUFFER) are backed by
+ * persistently mapped PBOs, which need glBufferStorage. */
+#if defined(HAVE_GL_SYNC) && !defined(HAVE_OPENGLES) && defined(GL_MAP_PERSISTENT_BIT)
+#define HAVE_GL_SW_FRAMEBUFFER
+#endif
+
 #ifdef HAVE_GL_SYNC
 #if defined(HAVE_OPENGLES2)
 typedef struct __GLsync *GLsync;
@@ -165,6 +173,9 @@ typedef struct gl2_renderchain_data
 #ifdef HAVE_GL_SYNC
    GLsync fences[MAX_FENCES];
 #endif
+#ifdef HAVE_GL_SW_FRAMEBUFFER
+   gl_sw_framebuffer_t sw_fb;
+#endif
 
    GLuint vao;
    GLuint fbo[GFX_MAX_SHADERS];
@@ -176,6 +187,9 @@ typedef struct gl2_renderchain_data
    struct gfx_fbo_scale fbo_scale[GFX_MAX_SHADERS];
 
    bool egl_images;
+#ifdef HAVE_GL_SW_FRAMEBUFFER
+   bool sw_fb_enable;
+#endif
    bool has_fp_fbo;
    bool has_srgb_fbo_gles3;
    bool has_srgb_fbo;
@@ -1413,6 +1427,44 @@ error:
    glDisable(GL_DITHER)
 #endif
 
+#ifdef HAVE_GL_SW_FRAMEBUFFER
+static bool gl2_get_current_sw_framebuffer(void *data,
+      struct retro_framebuffer *framebuffer)
+{
+   gl2_t *gl                     = (gl2_t*)data;
+   gl2_renderchain_data_t *chain = gl
+      ? (gl2_renderchain_data_t*)gl->renderchain_data : NULL;
+
+   if (!chain || !chain->sw_fb_enable || gl->hw_render_use)
+      return false;
+
+   /* Must fit the streamed textures. */
+   if (framebuffer->width > gl->tex_w || framebuffer->height > gl->tex_h)
+      return false;
+
+   if (     framebuffer->width  != chain->sw_fb.width
+         || framebuffer->height != chain->sw_fb.height)
+   {
+      if (!gl_sw_framebuffer_init(&chain->sw_fb,
+               framebuffer->width, framebuffer->height, gl->base_size))
+      {
+         RARCH_WARN("[GL]: Failed to map software framebuffer,"
+               " falling back to copies.\n");
+         chain->sw_fb_enable = false;
+         return false;
+      }
+   }
+
+   framebuffer->data         = gl_sw_framebuffer_acquire(&chain->sw_fb);
+   framebuffer->pitch        = chain->sw_fb.pitch;
+   framebuffer->format       = (gl->base_size == 4)
+      ? RETRO_PIXEL_FORMAT_XRGB8888 : RETRO_PIXEL_FORMAT_RGB565;
+   framebuffer->memory_flags = 0;
+
+   return true;
+}
+#endif
+
 static void gl2_renderchain_copy_frame(
       gl2_t *gl,
       gl2_renderchain_data_t *chain,
@@ -1516,8 +1568,34 @@ static void gl2_renderchain_copy_frame(
 #else
    {
       const GLvoid *data_buf = frame;
+#ifdef HAVE_GL_SW_FRAMEBUFFER
+      int sw_fb_index        = gl_sw_framebuffer_index(
+            &chain->sw_fb, frame);
+#endif
       glPixelStorei(GL_UNPACK_ALIGNMENT, gl2_get_alignment(pitch));
 
+#ifdef HAVE_GL_SW_FRAMEBUFFER
+      if (sw_fb_index >= 0)
+      {
+         /* Frame was written straight into one of our PBOs,
+          * upload from there instead of from client memory. */
+         glBindBuffer(GL_PIXEL_UNPACK_BUFFER,
+               chain->sw_fb.pbo[sw_fb_index]);
+         glPixelStorei(GL_UNPACK_ROW_LENGTH, pitch / gl->base_size);
+         glTexSubImage2D(GL_TEXTURE_2D,
+               0, 0, 0, width, height, gl->texture_type,
+               gl->texture_fmt, (const GLvoid*)((const uint8_t*)frame
+                  - (const uint8_t*)chain->sw_fb.mapped[sw_fb_index]));
+         glPixelStorei(GL_UNPACK_ROW_LENGTH, 0);
+
+         /* The core may not write into this buffer
+          * again until the upload has completed. */
+         gl_sw_framebuffer_fence(&chain->sw_fb, sw_fb_index);
+         glBindBuffer(GL_PIXEL_UNPACK_BUFFER, 0);
+         return;
+      }
+#endif
+
       if (gl->base_size == 2 && !gl->have_es2_compat)
       {
          /* Convert to 32-bit textures on desktop GL.
@@ -3215,6 +3293,11 @@ static void gl2_free(void *data)
             (gl2_renderchain_data_t*)
             gl->renderchain_data);
 
+#ifdef HAVE_GL_SW_FRAMEBUFFER
+   gl_sw_framebuffer_deinit(
+         &((gl2_renderchain_data_t*)gl->renderchain_data)->sw_fb);
+#endif
+
    font_driver_free_osd();
 
    gl->shader->deinit(gl->shader_data);
@@ -3996,6 +4079,21 @@ static void *gl2_init(const video_info_t *video,
       RARCH_LOG("[GL]: Async PBO readback enabled.\n");
    }
 
+#ifdef HAVE_GL_SW_FRAMEBUFFER
+   /* 16-bit frames get converted on the CPU unless
+    * GL_RGB565 is supported, nothing to gain there. */
+   {
+      gl2_renderchain_data_t *chain = (gl2_renderchain_data_t*)
+         gl->renderchain_data;
+      chain->sw_fb_enable           = !gl->hw_render_use
+         && gl->have_sync
+         && (gl->base_size == 4 || gl->have_es2_compat)
+         && gl_check_capability(GL_CAPS_BUFFER_STORAGE);
+      if (chain->sw_fb_enable)
+         RARCH_LOG("[GL]: Software framebuffers backed by persistent PBOs.\n");
+   }
+#endif
+
    if (!gl_check_error(&error_string))
    {
       RARCH_ERR("[GL]: %s\n", error_string);
@@ -4627,7 +4725,11 @@ static const video_poke_interface_t gl2_poke_interface = {
    gl2_show_mouse,
    NULL,
    gl2_get_current_shader,
+#ifdef HAVE_GL_SW_FRAMEBUFFER
+   gl2_get_current_sw_framebuffer,
+#else
    NULL,                      /* get_current_software_framebuffer */
+#endif
    NULL,                      /* get_hw_render_interface */
    NULL,                      /* set_hdr_max_nits */
    NULL,                      /* set_hdr_paper_white_nits */
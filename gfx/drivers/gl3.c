@@ -262,6 +262,46 @@ static void gl3_pbo_async_readback(gl3_t *gl)
    glBindBuffer(GL_PIXEL_PACK_BUFFER, 0);
 }
 
+#ifdef GL_CORE_HAVE_SW_FRAMEBUFFER
+static bool gl3_get_current_sw_framebuffer(void *data,
+      struct retro_framebuffer *framebuffer)
+{
+   unsigned max_size;
+   gl3_t *gl = (gl3_t*)data;
+
+   if (!gl || !gl->sw_fb_enable || gl->hw_render_enable)
+      return false;
+
+   /* Same bound as the maximum geometry the core announced,
+    * anything larger goes through the regular upload path. */
+   max_size = RARCH_SCALE_BASE * gl->video_info.input_scale;
+   if (framebuffer->width > max_size || framebuffer->height > max_size)
+      return false;
+
+   if (     framebuffer->width  != gl->sw_fb.width
+         || framebuffer->height != gl->sw_fb.height)
+   {
+      if (!gl_sw_framebuffer_init(&gl->sw_fb,
+               framebuffer->width, framebuffer->height,
+               gl->video_info.rgb32 ? 4 : 2))
+      {
+         RARCH_WARN("[GLCore]: Failed to map software framebuffer,"
+               " falling back to copies.\n");
+         gl->sw_fb_enable = false;
+         return false;
+      }
+   }
+
+   framebuffer->data         = gl_sw_framebuffer_acquire(&gl->sw_fb);
+   framebuffer->pitch        = gl->sw_fb.pitch;
+   framebuffer->format       = gl->video_info.rgb32
+      ? RETRO_PIXEL_FORMAT_XRGB8888 : RETRO_PIXEL_FORMAT_RGB565;
+   framebuffer->memory_flags = 0;
+
+   return true;
+}
+#endif
+
 static void gl3_fence_iterate(gl3_t *gl, unsigned hard_sync_frames)
 {
    if (gl->fence_count < GL_CORE_NUM_FENCES)
@@ -583,6 +623,9 @@ static void gl3_destroy_resources(gl3_t *gl)
 #endif
    gl3_deinit_fences(gl);
    gl3_deinit_pbo_readback(gl);
+#ifdef GL_CORE_HAVE_SW_FRAMEBUFFER
+   gl_sw_framebuffer_deinit(&gl->sw_fb);
+#endif
    gl3_deinit_hw_render(gl);
 }
 
@@ -1339,6 +1382,14 @@ static void *gl3_init(const video_info_t *video,
       RARCH_LOG("[GLCore]: Async PBO readback enabled.\n");
    }
 
+#ifdef GL_CORE_HAVE_SW_FRAMEBUFFER
+   gl->sw_fb_enable = !gl->hw_render_enable
+      && gl_check_capability(GL_CAPS_BUFFER_STORAGE)
+      && gl_check_capability(GL_CAPS_SYNC);
+   if (gl->sw_fb_enable)
+      RARCH_LOG("[GLCore]: Software framebuffers backed by persistent PBOs.\n");
+#endif
+
    if (!gl_check_error(&error_string))
    {
       RARCH_ERR("%s\n", error_string);
@@ -1762,6 +1813,10 @@ static void gl3_update_cpu_texture(gl3_t *gl,
                                        struct gl3_streamed_texture *streamed,
                                        const void *frame, unsigned width, unsigned height, unsigned pitch)
 {
+#ifdef GL_CORE_HAVE_SW_FRAMEBUFFER
+   int sw_fb_index;
+#endif
+
    if (width != streamed->width || height != streamed->height)
    {
       if (streamed->tex != 0)
@@ -1782,7 +1837,20 @@ static void gl3_update_cpu_texture(gl3_t *gl,
    else
       glBindTexture(GL_TEXTURE_2D, streamed->tex);
 
+#ifdef GL_CORE_HAVE_SW_FRAMEBUFFER
+   /* Frame was written straight into one of our PBOs,
+    * upload from there instead of from client memory. */
+   sw_fb_index = gl_sw_framebuffer_index(&gl->sw_fb, frame);
+   if (sw_fb_index >= 0)
+   {
+      glBindBuffer(GL_PIXEL_UNPACK_BUFFER, gl->sw_fb.pbo[sw_fb_index]);
+      frame = (const void*)((const uint8_t*)frame
+            - (const uint8_t*)gl->sw_fb.mapped[sw_fb_index]);
+   }
+   else
+#endif
    glBindBuffer(GL_PIXEL_UNPACK_BUFFER, 0);
+
    if (gl->video_info.rgb32)
    {
       glPixelStorei(GL_UNPACK_ROW_LENGTH, pitch >> 2);
@@ -1797,6 +1865,16 @@ static void gl3_update_cpu_texture(gl3_t *gl,
       glTexSubImage2D(GL_TEXTURE_2D, 0, 0, 0,
                       width, height, GL_RGB, GL_UNSIGNED_SHORT_5_6_5, frame);
    }
+
+#ifdef GL_CORE_HAVE_SW_FRAMEBUFFER
+   if (sw_fb_index >= 0)
+   {
+      /* The core may not write into this buffer
+       * again until the upload has completed. */
+      gl_sw_framebuffer_fence(&gl->sw_fb, sw_fb_index);
+      glBindBuffer(GL_PIXEL_UNPACK_BUFFER, 0);
+   }
+#endif
 }
 
 #if defined(HAVE_MENU)
@@ -2300,7 +2378,11 @@ static const video_poke_interface_t gl3_poke_interface = {
    gl3_show_mouse,
    NULL,                               /* grab_mouse_toggle */
    gl3_get_current_shader,
-   NULL,
+#ifdef GL_CORE_HAVE_SW_FRAMEBUFFER
+   gl3_get_current_sw_framebuffer,
+#else
+   NULL, /* get_current_software_framebuffer */
+#endif
    NULL,
    NULL, /* set_hdr_max_nits */
    NULL, /* set_hdr_paper_white_nits */
@@ -378,7 +378,17 @@ void gfx_thumbnail_request_file(
 
    /* Would like to cancel any existing image load tasks
     * here, but can't see how to do it... */
-   if (task_push_image_load(
+   if (image_texture_get_type(file_path) == IMAGE_TYPE_NONE)
+   {
+      /* Not an image: the thumbnail stored in a savestate */
+      if (task_push_load_state_thumbnail(
+            file_path, video_driver_supports_rgba(),
+            gfx_thumbnail_handle_upload, thumbnail_tag))
+         thumbnail->status = GFX_THUMBNAIL_STATUS_PENDING;
+      else
+         free(thumbnail_tag);
+   }
+   else if (task_push_image_load(
          file_path, video_driver_supports_rgba(),
          gfx_thumbnail_upscale_threshold,
          gfx_thumbnail_handle_upload, thumbnail_tag))
@@ -4285,6 +4285,47 @@ void video_driver_frame(const void *data, unsigned width,
             av_info->timing.fps,
             av_info->timing.sample_rate);
 
+#ifdef HAVE_THREADS
+      if (VIDEO_DRIVER_IS_THREADED_INTERNAL(video_st))
+      {
+         video_thread_frame_stats_t thr_stats;
+
+         if (video_thread_get_frame_stats(video_st->data, &thr_stats))
+         {
+            size_t _len = strlen(video_info.stat_text);
+            snprintf(video_info.stat_text + _len,
+                  sizeof(video_info.stat_text) - _len,
+                  "Threaded Video:\n -Frame age (last/avg/max): %.2f/%.2f/%.2f ms\n -Frames pushed/dropped: %u/%u\n",
+                  thr_stats.age_last / 1000.0f,
+                  thr_stats.age_avg  / 1000.0f,
+                  thr_stats.age_max  / 1000.0f,
+                  thr_stats.pushed,
+                  thr_stats.dropped);
+         }
+      }
+#endif
+
+      {
+         struct record_stats rec_stats;
+
+         if (recording_driver_get_stats(&rec_stats))
+         {
+            size_t _len = strlen(video_info.stat_text);
+            snprintf(video_info.stat_text + _len,
+                  sizeof(video_info.stat_text) - _len,
+                  "Recording:\n -Queued frames: %u/%u\n -Frames encoded/dropped: %u/%u\n -Stalls: %u (%.1f ms)\n -Encode time: %.2f ms/frame\n",
+                  rec_stats.queued,
+                  rec_stats.queue_size,
+                  rec_stats.frames_encoded,
+                  rec_stats.frames_dropped,
+                  rec_stats.stalls,
+                  rec_stats.stall_usec / 1000.0f,
+                  rec_stats.frames_encoded
+                  ? rec_stats.encode_usec / 1000.0f / rec_stats.frames_encoded
+                  : 0.0f);
+         }
+      }
+
       /* TODO/FIXME - add OSD chat text here */
    }
 
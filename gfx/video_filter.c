@@ -60,48 +60,155 @@ struct rarch_softfilter
    unsigned threads;
 
 #ifdef HAVE_THREADS
-   struct filter_thread_data *thread_data;
+   struct filter_thread_pool *pool;
 #endif
 };
 
+/* Filters are asked for several row tiles per worker so that
+ * uneven tiles (e.g. busy rows in 2xSaI) get balanced out by
+ * whichever worker runs out of work first. */
+#define SOFTFILTER_TILES_PER_THREAD 4
+#define SOFTFILTER_MAX_TILES        64
+
 #ifdef HAVE_THREADS
 #include <rthreads/rthreads.h>
 
-struct filter_thread_data
+/* One pool shared by all packets of a frame. The packets are not
+ * bound to a thread; every worker (and the thread calling
+ * rarch_softfilter_process) keeps claiming the next unprocessed
+ * packet until none are left. */
+struct filter_thread_pool
 {
-   sthread_t *thread;
-   const struct softfilter_work_packet *packet;
-   scond_t *cond;
    slock_t *lock;
+   scond_t *cond_work;
+   scond_t *cond_done;
+   sthread_t **threads;
+   const struct softfilter_work_packet *packets;
    void *userdata;
+   unsigned num_threads;
+   unsigned generation;
+   unsigned count;
+   unsigned next;
+   unsigned pending;
    bool die;
-   bool done;
 };
 
+/* Called with pool->lock held, returns with it held. */
+static void filter_thread_pool_drain(struct filter_thread_pool *pool)
+{
+   while (pool->next < pool->count)
+   {
+      const struct softfilter_work_packet *packet =
+         &pool->packets[pool->next++];
+
+      slock_unlock(pool->lock);
+      if (packet->work)
+         packet->work(pool->userdata, packet->thread_data);
+      slock_lock(pool->lock);
+
+      if (--pool->pending == 0)
+         scond_signal(pool->cond_done);
+   }
+}
+
 static void filter_thread_loop(void *data)
 {
-   struct filter_thread_data *thr = (struct filter_thread_data*)data;
+   struct filter_thread_pool *pool = (struct filter_thread_pool*)data;
+   unsigned generation             = 0;
 
+   slock_lock(pool->lock);
    for (;;)
    {
-      bool die;
-      slock_lock(thr->lock);
-      while (thr->done && !thr->die)
-         scond_wait(thr->cond, thr->lock);
-      die = thr->die;
-      slock_unlock(thr->lock);
-
-      if (die)
+      while (!pool->die && generation == pool->generation)
+         scond_wait(pool->cond_work, pool->lock);
+      if (pool->die)
          break;
 
-      if (thr->packet && thr->packet->work)
-         thr->packet->work(thr->userdata, thr->packet->thread_data);
+      generation = pool->generation;
+      filter_thread_pool_drain(pool);
+   }
+   slock_unlock(pool->lock);
+}
+
+static void filter_thread_pool_free(struct filter_thread_pool *pool)
+{
+   unsigned i;
+
+   if (!pool)
+      return;
 
-      slock_lock(thr->lock);
-      thr->done = true;
-      scond_signal(thr->cond);
-      slock_unlock(thr->lock);
+   if (pool->num_threads)
+   {
+      slock_lock(pool->lock);
+      pool->die = true;
+      scond_broadcast(pool->cond_work);
+      slock_unlock(pool->lock);
+
+      for (i = 0; i < pool->num_threads; i++)
+         sthread_join(pool->threads[i]);
    }
+   free(pool->threads);
+
+   if (pool->cond_done)
+      scond_free(pool->cond_done);
+   if (pool->cond_work)
+      scond_free(pool->cond_work);
+   if (pool->lock)
+      slock_free(pool->lock);
+   free(pool);
+}
+
+static struct filter_thread_pool *filter_thread_pool_new(
+      void *userdata, unsigned num_threads)
+{
+   unsigned i;
+   struct filter_thread_pool *pool = (struct filter_thread_pool*)
+      calloc(1, sizeof(*pool));
+
+   if (!pool)
+      return NULL;
+
+   pool->userdata  = userdata;
+   pool->lock      = slock_new();
+   pool->cond_work = scond_new();
+   pool->cond_done = scond_new();
+   pool->threads   = (sthread_t**)calloc(num_threads, sizeof(*pool->threads));
+
+   if (!pool->lock || !pool->cond_work || !pool->cond_done || !pool->threads)
+      goto error;
+
+   for (i = 0; i < num_threads; i++)
+   {
+      pool->threads[i] = sthread_create(filter_thread_loop, pool);
+      if (!pool->threads[i])
+         goto error;
+      pool->num_threads++;
+   }
+
+   return pool;
+
+error:
+   filter_thread_pool_free(pool);
+   return NULL;
+}
+
+static void filter_thread_pool_run(struct filter_thread_pool *pool,
+      const struct softfilter_work_packet *packets, unsigned count)
+{
+   slock_lock(pool->lock);
+   pool->packets = packets;
+   pool->count   = count;
+   pool->next    = 0;
+   pool->pending = count;
+   pool->generation++;
+   scond_broadcast(pool->cond_work);
+
+   /* Help out instead of idling until the workers are done. */
+   filter_thread_pool_drain(pool);
+
+   while (pool->pending)
+      scond_wait(pool->cond_done, pool->lock);
+   slock_unlock(pool->lock);
 }
 #endif
 
@@ -135,7 +242,7 @@ static bool create_softfilter_graph(rarch_softfilter_t *filt,
       softfilter_simd_mask_t cpu_features,
       unsigned threads)
 {
-   unsigned input_fmts, input_fmt, output_fmts, i = 0;
+   unsigned input_fmts, input_fmt, output_fmts, workers, i = 0;
    struct config_file_userdata userdata;
    char key[64], name[64];
 
@@ -208,11 +315,21 @@ static bool create_softfilter_graph(rarch_softfilter_t *filt,
    filt->max_width = max_width;
    filt->max_height = max_height;
 
+   if (threads == RARCH_SOFTFILTER_THREADS_AUTO)
+      threads = cpu_features_get_core_amount();
+   if (threads < 1)
+      threads = 1;
+   workers = threads;
+
+   /* Filters which support slicing get several row tiles per worker;
+    * the rest ignore this and keep using a single packet. */
+   if (workers > 1)
+      threads = MIN(workers * SOFTFILTER_TILES_PER_THREAD,
+            SOFTFILTER_MAX_TILES);
+
    filt->impl_data = filt->impl->create(
          &softfilter_config, input_fmt, input_fmt, max_width, max_height,
-         threads != RARCH_SOFTFILTER_THREADS_AUTO ? threads :
-         cpu_features_get_core_amount(), cpu_features,
-         &userdata);
+         threads, cpu_features, &userdata);
    if (!filt->impl_data)
    {
       RARCH_ERR("Failed to create softfilter state.\n");
@@ -227,7 +344,6 @@ static bool create_softfilter_graph(rarch_softfilter_t *filt,
    }
 
    filt->threads = threads;
-   RARCH_LOG("Using %u threads for softfilter.\n", threads);
 
    filt->packets = (struct softfilter_work_packet*)
       calloc(threads, sizeof(*filt->packets));
@@ -238,32 +354,21 @@ static bool create_softfilter_graph(rarch_softfilter_t *filt,
    }
 
 #ifdef HAVE_THREADS
-   if (filt->threads > 1)
+   workers = MIN(workers, threads);
+   if (workers > 1)
    {
-      filt->thread_data = (struct filter_thread_data*)
-         calloc(threads, sizeof(*filt->thread_data));
-      if (!filt->thread_data)
+      /* The calling thread works through packets as well. */
+      filt->pool = filter_thread_pool_new(filt->impl_data, workers - 1);
+      if (!filt->pool)
          return false;
-
-      for (i = 0; i < threads; i++)
-      {
-         filt->thread_data[i].userdata = filt->impl_data;
-         filt->thread_data[i].done     = true;
-
-         filt->thread_data[i].lock     = slock_new();
-         if (!filt->thread_data[i].lock)
-            return false;
-         filt->thread_data[i].cond     = scond_new();
-         if (!filt->thread_data[i].cond)
-            return false;
-         filt->thread_data[i].thread   = sthread_create(
-               filter_thread_loop, &filt->thread_data[i]);
-         if (!filt->thread_data[i].thread)
-            return false;
-      }
    }
+#else
+   workers = 1;
 #endif
 
+   RARCH_LOG("Using %u threads and %u tiles for softfilter.\n",
+         workers, threads);
+
    return true;
 }
 
@@ -491,6 +596,10 @@ void rarch_softfilter_free(rarch_softfilter_t *filt)
    if (!filt)
       return;
 
+#ifdef HAVE_THREADS
+   filter_thread_pool_free(filt->pool);
+#endif
+
    free(filt->packets);
    if (filt->impl && filt->impl_data)
       filt->impl->destroy(filt->impl_data);
@@ -504,25 +613,6 @@ void rarch_softfilter_free(rarch_softfilter_t *filt)
    free(filt->plugs);
 #endif
 
-#ifdef HAVE_THREADS
-   if (filt->threads > 1)
-   {
-      for (i = 0; i < filt->threads; i++)
-      {
-         if (!filt->thread_data[i].thread)
-            continue;
-         slock_lock(filt->thread_data[i].lock);
-         filt->thread_data[i].die = true;
-         scond_signal(filt->thread_data[i].cond);
-         slock_unlock(filt->thread_data[i].lock);
-         sthread_join(filt->thread_data[i].thread);
-         slock_free(filt->thread_data[i].lock);
-         scond_free(filt->thread_data[i].cond);
-      }
-      free(filt->thread_data);
-   }
-#endif
-
    if (filt->conf)
       config_file_free(filt->conf);
 
@@ -566,32 +656,9 @@ void rarch_softfilter_process(rarch_softfilter_t *filt,
             output, output_stride, input, width, height, input_stride);
 
 #ifdef HAVE_THREADS
-   if (filt->threads > 1)
+   if (filt->pool)
    {
-      /* Fire off workers */
-      for (i = 0; i < filt->threads; i++)
-      {
-#if 0
-         RARCH_LOG("Firing off filter thread %u ...\n", i);
-#endif
-         filt->thread_data[i].packet = &filt->packets[i];
-         slock_lock(filt->thread_data[i].lock);
-         filt->thread_data[i].done = false;
-         scond_signal(filt->thread_data[i].cond);
-         slock_unlock(filt->thread_data[i].lock);
-      }
-
-      /* Wait for workers */
-      for (i = 0; i < filt->threads; i++)
-      {
-#if 0
-         RARCH_LOG("Waiting for filter thread %u ...\n", i);
-#endif
-         slock_lock(filt->thread_data[i].lock);
-         while (!filt->thread_data[i].done)
-            scond_wait(filt->thread_data[i].cond, filt->thread_data[i].lock);
-         slock_unlock(filt->thread_data[i].lock);
-      }
+      filter_thread_pool_run(filt->pool, filt->packets, filt->threads);
       return;
    }
 #endif
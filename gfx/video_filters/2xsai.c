@@ -15,6 +15,7 @@
  */
 
 #include "softfilter.h"
+#include "softfilter_simd.h"
 #include <stdlib.h>
 #include <string.h>
 
@@ -44,6 +45,12 @@ struct filter_data
    unsigned threads;
    struct softfilter_thread_data *workers;
    unsigned in_fmt;
+   unsigned (*interior_rgb565)(const uint16_t *src,
+         unsigned nextline, unsigned width,
+         uint16_t *out0, uint16_t *out1);
+   unsigned (*interior_xrgb8888)(const uint32_t *src,
+         unsigned nextline, unsigned width,
+         uint32_t *out0, uint32_t *out1);
 };
 
 static unsigned twoxsai_generic_input_fmts(void)
@@ -62,30 +69,6 @@ static unsigned twoxsai_generic_threads(void *data)
    return filt->threads;
 }
 
-static void *twoxsai_generic_create(const struct softfilter_config *config,
-      unsigned in_fmt, unsigned out_fmt,
-      unsigned max_width, unsigned max_height,
-      unsigned threads, softfilter_simd_mask_t simd, void *userdata)
-{
-   struct filter_data *filt = (struct filter_data*)calloc(1, sizeof(*filt));
-
-   (void)simd;
-   (void)config;
-   (void)userdata;
-   if (!filt)
-      return NULL;
-   filt->workers = (struct softfilter_thread_data*)
-      calloc(threads, sizeof(struct softfilter_thread_data));
-   filt->threads = 1;
-   filt->in_fmt  = in_fmt;
-   if (!filt->workers)
-   {
-      free(filt);
-      return NULL;
-   }
-   return filt;
-}
-
 static void twoxsai_generic_output(void *data,
       unsigned *out_width, unsigned *out_height,
       unsigned width, unsigned height)
@@ -224,70 +207,247 @@ static void twoxsai_generic_destroy(void *data)
          out += 2
 #endif
 
-static void twoxsai_generic_xrgb8888(unsigned width, unsigned height,
+#ifdef SFV_SIMD_MASK
+/* Vector form of twoxsai_function() for the lanes starting at 'in'.
+ * Every branch of the scalar code is computed and the results are
+ * picked per lane with the branch conditions as masks. */
+#define twoxsai_vector_function(W, in, nextline, interpolate_cb, interpolate2_cb) \
+         const sfv_vec##W##_t colorI = sfv_load##W(in - nextline - 1); \
+         const sfv_vec##W##_t colorE = sfv_load##W(in - nextline + 0); \
+         const sfv_vec##W##_t colorF = sfv_load##W(in - nextline + 1); \
+         const sfv_vec##W##_t colorJ = sfv_load##W(in - nextline + 2); \
+         const sfv_vec##W##_t colorG = sfv_load##W(in - 1); \
+         const sfv_vec##W##_t colorA = sfv_load##W(in + 0); \
+         const sfv_vec##W##_t colorB = sfv_load##W(in + 1); \
+         const sfv_vec##W##_t colorK = sfv_load##W(in + 2); \
+         const sfv_vec##W##_t colorH = sfv_load##W(in + nextline - 1); \
+         const sfv_vec##W##_t colorC = sfv_load##W(in + nextline + 0); \
+         const sfv_vec##W##_t colorD = sfv_load##W(in + nextline + 1); \
+         const sfv_vec##W##_t colorL = sfv_load##W(in + nextline + 2); \
+         const sfv_vec##W##_t colorM = sfv_load##W(in + nextline + nextline - 1); \
+         const sfv_vec##W##_t colorN = sfv_load##W(in + nextline + nextline + 0); \
+         const sfv_vec##W##_t colorO = sfv_load##W(in + nextline + nextline + 1); \
+         /* Branches: A == D only, B == C only, both, neither */ \
+         const sfv_vec##W##_t eqAD   = sfv_eq##W(colorA, colorD); \
+         const sfv_vec##W##_t eqBC   = sfv_eq##W(colorB, colorC); \
+         const sfv_vec##W##_t either = sfv_or##W(eqAD, eqBC); \
+         const sfv_vec##W##_t case1  = sfv_andnot##W(eqBC, eqAD); \
+         const sfv_vec##W##_t case2  = sfv_andnot##W(eqAD, eqBC); \
+         const sfv_vec##W##_t case3  = sfv_and##W(eqAD, eqBC); \
+         const sfv_vec##W##_t pa     = sfv_andnot##W(sfv_eq##W(colorB, colorE), \
+               sfv_and##W(sfv_and##W(sfv_eq##W(colorA, colorC), \
+                     sfv_eq##W(colorA, colorF)), sfv_eq##W(colorB, colorJ))); \
+         const sfv_vec##W##_t pb     = sfv_andnot##W(sfv_eq##W(colorA, colorF), \
+               sfv_and##W(sfv_and##W(sfv_eq##W(colorB, colorE), \
+                     sfv_eq##W(colorB, colorD)), sfv_eq##W(colorA, colorI))); \
+         const sfv_vec##W##_t qa     = sfv_andnot##W(sfv_eq##W(colorG, colorC), \
+               sfv_and##W(sfv_and##W(sfv_eq##W(colorA, colorB), \
+                     sfv_eq##W(colorA, colorH)), sfv_eq##W(colorC, colorM))); \
+         const sfv_vec##W##_t qb     = sfv_andnot##W(sfv_eq##W(colorA, colorH), \
+               sfv_and##W(sfv_and##W(sfv_eq##W(colorC, colorG), \
+                     sfv_eq##W(colorC, colorD)), sfv_eq##W(colorA, colorI))); \
+         const sfv_vec##W##_t pickA  = sfv_or##W( \
+               sfv_and##W(case1, sfv_or##W(pa, sfv_and##W( \
+                     sfv_eq##W(colorA, colorE), sfv_eq##W(colorB, colorL)))), \
+               sfv_andnot##W(either, pa)); \
+         const sfv_vec##W##_t pickB  = sfv_or##W( \
+               sfv_and##W(case2, sfv_or##W(pb, sfv_and##W( \
+                     sfv_eq##W(colorB, colorF), sfv_eq##W(colorA, colorH)))), \
+               sfv_andnot##W(sfv_or##W(either, pa), pb)); \
+         const sfv_vec##W##_t pick1A = sfv_or##W( \
+               sfv_and##W(case1, sfv_or##W(qa, sfv_and##W( \
+                     sfv_eq##W(colorA, colorG), sfv_eq##W(colorC, colorO)))), \
+               sfv_andnot##W(either, qa)); \
+         const sfv_vec##W##_t pick1C = sfv_or##W( \
+               sfv_and##W(case2, sfv_or##W(qb, sfv_and##W( \
+                     sfv_eq##W(colorC, colorH), sfv_eq##W(colorA, colorF)))), \
+               sfv_andnot##W(sfv_or##W(either, qa), qb)); \
+         const sfv_vec##W##_t r      = sfv_add##W( \
+               sfv_add##W(sfv_result##W(colorA, colorB, colorG, colorE), \
+                  sfv_result##W(colorB, colorA, colorK, colorF)), \
+               sfv_add##W(sfv_result##W(colorB, colorA, colorH, colorN), \
+                  sfv_result##W(colorA, colorB, colorL, colorO))); \
+         const sfv_vec##W##_t pick2A = sfv_or##W(case1, \
+               sfv_and##W(case3, sfv_gtz##W(r))); \
+         const sfv_vec##W##_t pick2B = sfv_or##W(case2, \
+               sfv_and##W(case3, sfv_ltz##W(r))); \
+         const sfv_vec##W##_t product  = sfv_sel##W(pickA, colorA, \
+               sfv_sel##W(pickB, colorB, interpolate_cb(colorA, colorB))); \
+         const sfv_vec##W##_t product1 = sfv_sel##W(pick1A, colorA, \
+               sfv_sel##W(pick1C, colorC, interpolate_cb(colorA, colorC))); \
+         const sfv_vec##W##_t product2 = sfv_sel##W(pick2A, colorA, \
+               sfv_sel##W(pick2B, colorB, \
+                  interpolate2_cb(colorA, colorB, colorC, colorD)))
+
+/* The vector paths only handle pixels whose row neighbours
+ * (x - 1 to x + 2) lie inside the row, and return the first
+ * pixel they did not process. */
+static unsigned twoxsai_interior_rgb565_simd(const uint16_t *src,
+      unsigned nextline, unsigned width,
+      uint16_t *out0, uint16_t *out1)
+{
+   unsigned x;
+
+   for (x = 1; x + SFV_LANES16 + 2 <= width; x += SFV_LANES16)
+   {
+      const uint16_t *in = src + x;
+      twoxsai_vector_function(16, in, nextline,
+            sfv_interpolate_rgb565, sfv_interpolate2_rgb565);
+
+      sfv_store2_16(out0 + (x << 1), colorA, product);
+      sfv_store2_16(out1 + (x << 1), product1, product2);
+   }
+
+   return x;
+}
+
+static unsigned twoxsai_interior_xrgb8888_simd(const uint32_t *src,
+      unsigned nextline, unsigned width,
+      uint32_t *out0, uint32_t *out1)
+{
+   unsigned x;
+
+   for (x = 1; x + SFV_LANES32 + 2 <= width; x += SFV_LANES32)
+   {
+      const uint32_t *in = src + x;
+      twoxsai_vector_function(32, in, nextline,
+            sfv_interpolate_xrgb8888, sfv_interpolate2_xrgb8888);
+
+      sfv_store2_32(out0 + (x << 1), colorA, product);
+      sfv_store2_32(out1 + (x << 1), product1, product2);
+   }
+
+   return x;
+}
+#endif
+
+static void twoxsai_span_xrgb8888(const uint32_t *src,
+      unsigned nextline, unsigned x, unsigned end,
+      uint32_t *dst, unsigned dst_stride)
+{
+   const uint32_t *in = src + x;
+   uint32_t *out      = dst + (x << 1);
+
+   for (; x < end; x++)
+   {
+      twoxsai_declare_variables(uint32_t, in, nextline);
+
+      /*
+       * Map of the pixels:           I|E F|J
+       *                              G|A B|K
+       *                              H|C D|L
+       *                              M|N O|P
+       */
+
+      twoxsai_function(twoxsai_result, twoxsai_interpolate_xrgb8888,
+            twoxsai_interpolate2_xrgb8888);
+   }
+}
+
+static void twoxsai_span_rgb565(const uint16_t *src,
+      unsigned nextline, unsigned x, unsigned end,
+      uint16_t *dst, unsigned dst_stride)
+{
+   const uint16_t *in = src + x;
+   uint16_t *out      = dst + (x << 1);
+
+   for (; x < end; x++)
+   {
+      twoxsai_declare_variables(uint16_t, in, nextline);
+
+      /*
+       * Map of the pixels:           I|E F|J
+       *                              G|A B|K
+       *                              H|C D|L
+       *                              M|N O|P
+       */
+
+      twoxsai_function(twoxsai_result, twoxsai_interpolate_rgb565,
+            twoxsai_interpolate2_rgb565);
+   }
+}
+
+static void twoxsai_generic_xrgb8888(struct filter_data *filt,
+      unsigned width, unsigned height,
       int first, int last, uint32_t *src,
       unsigned src_stride, uint32_t *dst, unsigned dst_stride)
 {
-   unsigned finish;
    unsigned nextline = (last) ? 0 : src_stride;
 
    for (; height; height--)
    {
-      uint32_t *in  = (uint32_t*)src;
-      uint32_t *out = (uint32_t*)dst;
+      unsigned x = 0;
 
-      for (finish = width; finish; finish -= 1)
+      if (filt->interior_xrgb8888 && width > 1)
       {
-         twoxsai_declare_variables(uint32_t, in, nextline);
-
-         /*
-          * Map of the pixels:           I|E F|J
-          *                              G|A B|K
-          *                              H|C D|L
-          *                              M|N O|P
-          */
-
-         twoxsai_function(twoxsai_result, twoxsai_interpolate_xrgb8888,
-               twoxsai_interpolate2_xrgb8888);
+         twoxsai_span_xrgb8888(src, nextline, 0, 1, dst, dst_stride);
+         x = filt->interior_xrgb8888(src, nextline, width,
+               dst, dst + dst_stride);
       }
+      twoxsai_span_xrgb8888(src, nextline, x, width, dst, dst_stride);
 
       src += src_stride;
       dst += 2 * dst_stride;
    }
 }
 
-static void twoxsai_generic_rgb565(unsigned width, unsigned height,
+static void twoxsai_generic_rgb565(struct filter_data *filt,
+      unsigned width, unsigned height,
       int first, int last, uint16_t *src,
       unsigned src_stride, uint16_t *dst, unsigned dst_stride)
 {
-   unsigned finish;
    unsigned nextline = (last) ? 0 : src_stride;
 
    for (; height; height--)
    {
-      uint16_t *in  = (uint16_t*)src;
-      uint16_t *out = (uint16_t*)dst;
+      unsigned x = 0;
 
-      for (finish = width; finish; finish -= 1)
+      if (filt->interior_rgb565 && width > 1)
       {
-         twoxsai_declare_variables(uint16_t, in, nextline);
-
-         /*
-          * Map of the pixels:           I|E F|J
-          *                              G|A B|K
-          *                              H|C D|L
-          *                              M|N O|P
-          */
-
-         twoxsai_function(twoxsai_result, twoxsai_interpolate_rgb565,
-               twoxsai_interpolate2_rgb565);
+         twoxsai_span_rgb565(src, nextline, 0, 1, dst, dst_stride);
+         x = filt->interior_rgb565(src, nextline, width,
+               dst, dst + dst_stride);
       }
+      twoxsai_span_rgb565(src, nextline, x, width, dst, dst_stride);
 
       src += src_stride;
       dst += 2 * dst_stride;
    }
 }
 
+static void *twoxsai_generic_create(const struct softfilter_config *config,
+      unsigned in_fmt, unsigned out_fmt,
+      unsigned max_width, unsigned max_height,
+      unsigned threads, softfilter_simd_mask_t simd, void *userdata)
+{
+   struct filter_data *filt = (struct filter_data*)calloc(1, sizeof(*filt));
+
+   (void)config;
+   (void)userdata;
+   if (!filt)
+      return NULL;
+   filt->workers = (struct softfilter_thread_data*)
+      calloc(threads, sizeof(struct softfilter_thread_data));
+   filt->threads = threads;
+   filt->in_fmt  = in_fmt;
+   if (!filt->workers)
+   {
+      free(filt);
+      return NULL;
+   }
+
+#ifdef SFV_SIMD_MASK
+   if (simd & SFV_SIMD_MASK)
+   {
+      filt->interior_rgb565   = twoxsai_interior_rgb565_simd;
+      filt->interior_xrgb8888 = twoxsai_interior_xrgb8888_simd;
+   }
+#endif
+   (void)simd;
+
+   return filt;
+}
+
 static void twoxsai_work_cb_rgb565(void *data, void *thread_data)
 {
    struct softfilter_thread_data *thr =
@@ -297,7 +457,7 @@ static void twoxsai_work_cb_rgb565(void *data, void *thread_data)
    unsigned width = thr->width;
    unsigned height = thr->height;
 
-   twoxsai_generic_rgb565(width, height,
+   twoxsai_generic_rgb565((struct filter_data*)data, width, height,
          thr->first, thr->last, input,
          (unsigned)(thr->in_pitch / SOFTFILTER_BPP_RGB565),
          output,
@@ -313,7 +473,7 @@ static void twoxsai_work_cb_xrgb8888(void *data, void *thread_data)
    unsigned width = thr->width;
    unsigned height = thr->height;
 
-   twoxsai_generic_xrgb8888(width, height,
+   twoxsai_generic_xrgb8888((struct filter_data*)data, width, height,
          thr->first, thr->last, input,
          (unsigned)(thr->in_pitch / SOFTFILTER_BPP_XRGB8888),
          output,
@@ -348,7 +508,12 @@ static void twoxsai_generic_packets(void *data,
        * outside their given buffer.
        */
       thr->first = y_start;
-      thr->last = y_end == height;
+
+      /* The kernels clamp every row of the last slice to itself
+       * (nextline == 0), which is the output a single slice has
+       * always produced. Treat each row tile the same way so the
+       * result does not depend on how the frame was split. */
+      thr->last = 1;
 
       if (filt->in_fmt == SOFTFILTER_FMT_RGB565)
          packets[i].work = twoxsai_work_cb_rgb565;
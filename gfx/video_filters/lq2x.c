@@ -15,8 +15,15 @@
  */
 
 #include "softfilter.h"
+#include <stdint.h>
 #include <stdlib.h>
 
+#if defined(__SSE2__)
+#include <emmintrin.h>
+#elif (defined(__ARM_NEON__) || defined(HAVE_NEON))
+#include <arm_neon.h>
+#endif
+
 #ifdef RARCH_INTERNAL
 #define softfilter_get_implementation lq2x_get_implementation
 #define softfilter_thread_data lq2x_softfilter_thread_data
@@ -43,6 +50,12 @@ struct filter_data
    unsigned threads;
    struct softfilter_thread_data *workers;
    unsigned in_fmt;
+   unsigned (*interior_rgb565)(const uint16_t *src,
+         int prevline, int nextline, unsigned width,
+         uint16_t *out0, uint16_t *out1);
+   unsigned (*interior_xrgb8888)(const uint32_t *src,
+         int prevline, int nextline, unsigned width,
+         uint32_t *out0, uint32_t *out1);
 };
 
 static unsigned lq2x_generic_input_fmts(void)
@@ -61,29 +74,6 @@ static unsigned lq2x_generic_threads(void *data)
    return filt->threads;
 }
 
-static void *lq2x_generic_create(const struct softfilter_config *config,
-      unsigned in_fmt, unsigned out_fmt,
-      unsigned max_width, unsigned max_height,
-      unsigned threads, softfilter_simd_mask_t simd, void *userdata)
-{
-   struct filter_data *filt = (struct filter_data*)calloc(1, sizeof(*filt));
-   (void)simd;
-   (void)config;
-   (void)userdata;
-   if (!filt)
-      return NULL;
-   filt->workers = (struct softfilter_thread_data*)
-      calloc(threads, sizeof(struct softfilter_thread_data));
-   filt->threads = 1;
-   filt->in_fmt  = in_fmt;
-   if (!filt->workers)
-   {
-      free(filt);
-      return NULL;
-   }
-   return filt;
-}
-
 static void lq2x_generic_output(void *data,
       unsigned *out_width, unsigned *out_height,
       unsigned width, unsigned height)
@@ -103,92 +93,334 @@ static void lq2x_generic_destroy(void *data)
    free(filt);
 }
 
-static void lq2x_generic_rgb565(unsigned width, unsigned height,
+/* Blend used for the diagonal edges. For RGB565 the operands
+ * are promoted to int in the scalar path, so the vector paths use
+ * the equivalent carry-free form (C & A) + (((C ^ A) & ~m) >> 1)
+ * which cannot overflow a 16-bit lane. */
+#define LQ2X_BLEND_RGB565(C, A) ((uint16_t)(((C) + (A) - (((C) ^ (A)) & 0x0821)) >> 1))
+#define LQ2X_BLEND_XRGB8888(C, A) ((uint32_t)((C) + (A) - (((C) ^ (A)) & 0x0421)) >> 1)
+
+static void lq2x_span_rgb565(const uint16_t *src,
+      int prevline, int nextline, unsigned width,
+      unsigned x, unsigned end, uint16_t *out0, uint16_t *out1)
+{
+   for (; x < end; x++)
+   {
+      uint16_t A = *(src + x - prevline);
+      uint16_t B = (x > 0) ? src[x - 1] : src[x];
+      uint16_t C = src[x];
+      uint16_t D = (x < width - 1) ? src[x + 1] : src[x];
+      uint16_t E = *(src + x + nextline);
+      uint16_t c = C;
+
+      if (A != E && B != D)
+      {
+         out0[(x << 1) + 0] = (A == B ? LQ2X_BLEND_RGB565(C, A) : c);
+         out0[(x << 1) + 1] = (A == D ? LQ2X_BLEND_RGB565(C, A) : c);
+         out1[(x << 1) + 0] = (E == B ? LQ2X_BLEND_RGB565(C, E) : c);
+         out1[(x << 1) + 1] = (E == D ? LQ2X_BLEND_RGB565(C, E) : c);
+      }
+      else
+      {
+         out0[(x << 1) + 0] = c;
+         out0[(x << 1) + 1] = c;
+         out1[(x << 1) + 0] = c;
+         out1[(x << 1) + 1] = c;
+      }
+   }
+}
+
+static void lq2x_span_xrgb8888(const uint32_t *src,
+      int prevline, int nextline, unsigned width,
+      unsigned x, unsigned end, uint32_t *out0, uint32_t *out1)
+{
+   for (; x < end; x++)
+   {
+      uint32_t A = *(src + x - prevline);
+      uint32_t B = (x > 0) ? src[x - 1] : src[x];
+      uint32_t C = src[x];
+      uint32_t D = (x < width - 1) ? src[x + 1] : src[x];
+      uint32_t E = *(src + x + nextline);
+      uint32_t c = C;
+
+      if (A != E && B != D)
+      {
+         out0[(x << 1) + 0] = (A == B ? LQ2X_BLEND_XRGB8888(C, A) : c);
+         out0[(x << 1) + 1] = (A == D ? LQ2X_BLEND_XRGB8888(C, A) : c);
+         out1[(x << 1) + 0] = (E == B ? LQ2X_BLEND_XRGB8888(C, E) : c);
+         out1[(x << 1) + 1] = (E == D ? LQ2X_BLEND_XRGB8888(C, E) : c);
+      }
+      else
+      {
+         out0[(x << 1) + 0] = c;
+         out0[(x << 1) + 1] = c;
+         out1[(x << 1) + 0] = c;
+         out1[(x << 1) + 1] = c;
+      }
+   }
+}
+
+/* The vector paths only handle interior pixels (1 <= x < width - 1)
+ * where B and D need no clamping, and return the first pixel they
+ * did not process. */
+#if defined(__SSE2__)
+static unsigned lq2x_interior_rgb565_sse2(const uint16_t *src,
+      int prevline, int nextline, unsigned width,
+      uint16_t *out0, uint16_t *out1)
+{
+   unsigned x;
+   const __m128i mask = _mm_set1_epi16((short)~0x0821);
+
+   for (x = 1; x + 8 < width; x += 8)
+   {
+      __m128i A     = _mm_loadu_si128((const __m128i*)(src + x - prevline));
+      __m128i B     = _mm_loadu_si128((const __m128i*)(src + x - 1));
+      __m128i C     = _mm_loadu_si128((const __m128i*)(src + x));
+      __m128i D     = _mm_loadu_si128((const __m128i*)(src + x + 1));
+      __m128i E     = _mm_loadu_si128((const __m128i*)(src + x + nextline));
+      __m128i blend = _mm_or_si128(
+            _mm_cmpeq_epi16(A, E), _mm_cmpeq_epi16(B, D));
+      __m128i CA    = _mm_add_epi16(_mm_and_si128(C, A),
+            _mm_srli_epi16(_mm_and_si128(_mm_xor_si128(C, A), mask), 1));
+      __m128i CE    = _mm_add_epi16(_mm_and_si128(C, E),
+            _mm_srli_epi16(_mm_and_si128(_mm_xor_si128(C, E), mask), 1));
+      __m128i m00   = _mm_andnot_si128(blend, _mm_cmpeq_epi16(A, B));
+      __m128i m01   = _mm_andnot_si128(blend, _mm_cmpeq_epi16(A, D));
+      __m128i m10   = _mm_andnot_si128(blend, _mm_cmpeq_epi16(E, B));
+      __m128i m11   = _mm_andnot_si128(blend, _mm_cmpeq_epi16(E, D));
+      __m128i r00   = _mm_or_si128(_mm_and_si128(m00, CA),
+            _mm_andnot_si128(m00, C));
+      __m128i r01   = _mm_or_si128(_mm_and_si128(m01, CA),
+            _mm_andnot_si128(m01, C));
+      __m128i r10   = _mm_or_si128(_mm_and_si128(m10, CE),
+            _mm_andnot_si128(m10, C));
+      __m128i r11   = _mm_or_si128(_mm_and_si128(m11, CE),
+            _mm_andnot_si128(m11, C));
+
+      _mm_storeu_si128((__m128i*)(out0 + (x << 1) + 0),
+            _mm_unpacklo_epi16(r00, r01));
+      _mm_storeu_si128((__m128i*)(out0 + (x << 1) + 8),
+            _mm_unpackhi_epi16(r00, r01));
+      _mm_storeu_si128((__m128i*)(out1 + (x << 1) + 0),
+            _mm_unpacklo_epi16(r10, r11));
+      _mm_storeu_si128((__m128i*)(out1 + (x << 1) + 8),
+            _mm_unpackhi_epi16(r10, r11));
+   }
+
+   return x;
+}
+
+static unsigned lq2x_interior_xrgb8888_sse2(const uint32_t *src,
+      int prevline, int nextline, unsigned width,
+      uint32_t *out0, uint32_t *out1)
+{
+   unsigned x;
+   const __m128i mask = _mm_set1_epi32(0x0421);
+
+   for (x = 1; x + 4 < width; x += 4)
+   {
+      __m128i A     = _mm_loadu_si128((const __m128i*)(src + x - prevline));
+      __m128i B     = _mm_loadu_si128((const __m128i*)(src + x - 1));
+      __m128i C     = _mm_loadu_si128((const __m128i*)(src + x));
+      __m128i D     = _mm_loadu_si128((const __m128i*)(src + x + 1));
+      __m128i E     = _mm_loadu_si128((const __m128i*)(src + x + nextline));
+      __m128i blend = _mm_or_si128(
+            _mm_cmpeq_epi32(A, E), _mm_cmpeq_epi32(B, D));
+      __m128i CA    = _mm_srli_epi32(_mm_sub_epi32(_mm_add_epi32(C, A),
+               _mm_and_si128(_mm_xor_si128(C, A), mask)), 1);
+      __m128i CE    = _mm_srli_epi32(_mm_sub_epi32(_mm_add_epi32(C, E),
+               _mm_and_si128(_mm_xor_si128(C, E), mask)), 1);
+      __m128i m00   = _mm_andnot_si128(blend, _mm_cmpeq_epi32(A, B));
+      __m128i m01   = _mm_andnot_si128(blend, _mm_cmpeq_epi32(A, D));
+      __m128i m10   = _mm_andnot_si128(blend, _mm_cmpeq_epi32(E, B));
+      __m128i m11   = _mm_andnot_si128(blend, _mm_cmpeq_epi32(E, D));
+      __m128i r00   = _mm_or_si128(_mm_and_si128(m00, CA),
+            _mm_andnot_si128(m00, C));
+      __m128i r01   = _mm_or_si128(_mm_and_si128(m01, CA),
+            _mm_andnot_si128(m01, C));
+      __m128i r10   = _mm_or_si128(_mm_and_si128(m10, CE),
+            _mm_andnot_si128(m10, C));
+      __m128i r11   = _mm_or_si128(_mm_and_si128(m11, CE),
+            _mm_andnot_si128(m11, C));
+
+      _mm_storeu_si128((__m128i*)(out0 + (x << 1) + 0),
+            _mm_unpacklo_epi32(r00, r01));
+      _mm_storeu_si128((__m128i*)(out0 + (x << 1) + 4),
+            _mm_unpackhi_epi32(r00, r01));
+      _mm_storeu_si128((__m128i*)(out1 + (x << 1) + 0),
+            _mm_unpacklo_epi32(r10, r11));
+      _mm_storeu_si128((__m128i*)(out1 + (x << 1) + 4),
+            _mm_unpackhi_epi32(r10, r11));
+   }
+
+   return x;
+}
+#endif
+
+#if (defined(__ARM_NEON__) || defined(HAVE_NEON))
+static unsigned lq2x_interior_rgb565_neon(const uint16_t *src,
+      int prevline, int nextline, unsigned width,
+      uint16_t *out0, uint16_t *out1)
+{
+   unsigned x;
+   const uint16x8_t mask = vdupq_n_u16((uint16_t)~0x0821);
+
+   for (x = 1; x + 8 < width; x += 8)
+   {
+      uint16x8x2_t r0, r1;
+      uint16x8_t A     = vld1q_u16(src + x - prevline);
+      uint16x8_t B     = vld1q_u16(src + x - 1);
+      uint16x8_t C     = vld1q_u16(src + x);
+      uint16x8_t D     = vld1q_u16(src + x + 1);
+      uint16x8_t E     = vld1q_u16(src + x + nextline);
+      uint16x8_t blend = vorrq_u16(vceqq_u16(A, E), vceqq_u16(B, D));
+      uint16x8_t CA    = vaddq_u16(vandq_u16(C, A),
+            vshrq_n_u16(vandq_u16(veorq_u16(C, A), mask), 1));
+      uint16x8_t CE    = vaddq_u16(vandq_u16(C, E),
+            vshrq_n_u16(vandq_u16(veorq_u16(C, E), mask), 1));
+
+      r0.val[0] = vbslq_u16(vbicq_u16(vceqq_u16(A, B), blend), CA, C);
+      r0.val[1] = vbslq_u16(vbicq_u16(vceqq_u16(A, D), blend), CA, C);
+      r1.val[0] = vbslq_u16(vbicq_u16(vceqq_u16(E, B), blend), CE, C);
+      r1.val[1] = vbslq_u16(vbicq_u16(vceqq_u16(E, D), blend), CE, C);
+
+      vst2q_u16(out0 + (x << 1), r0);
+      vst2q_u16(out1 + (x << 1), r1);
+   }
+
+   return x;
+}
+
+static unsigned lq2x_interior_xrgb8888_neon(const uint32_t *src,
+      int prevline, int nextline, unsigned width,
+      uint32_t *out0, uint32_t *out1)
+{
+   unsigned x;
+   const uint32x4_t mask = vdupq_n_u32(0x0421);
+
+   for (x = 1; x + 4 < width; x += 4)
+   {
+      uint32x4x2_t r0, r1;
+      uint32x4_t A     = vld1q_u32(src + x - prevline);
+      uint32x4_t B     = vld1q_u32(src + x - 1);
+      uint32x4_t C     = vld1q_u32(src + x);
+      uint32x4_t D     = vld1q_u32(src + x + 1);
+      uint32x4_t E     = vld1q_u32(src + x + nextline);
+      uint32x4_t blend = vorrq_u32(vceqq_u32(A, E), vceqq_u32(B, D));
+      uint32x4_t CA    = vshrq_n_u32(vsubq_u32(vaddq_u32(C, A),
+               vandq_u32(veorq_u32(C, A), mask)), 1);
+      uint32x4_t CE    = vshrq_n_u32(vsubq_u32(vaddq_u32(C, E),
+               vandq_u32(veorq_u32(C, E), mask)), 1);
+
+      r0.val[0] = vbslq_u32(vbicq_u32(vceqq_u32(A, B), blend), CA, C);
+      r0.val[1] = vbslq_u32(vbicq_u32(vceqq_u32(A, D), blend), CA, C);
+      r1.val[0] = vbslq_u32(vbicq_u32(vceqq_u32(E, B), blend), CE, C);
+      r1.val[1] = vbslq_u32(vbicq_u32(vceqq_u32(E, D), blend), CE, C);
+
+      vst2q_u32(out0 + (x << 1), r0);
+      vst2q_u32(out1 + (x << 1), r1);
+   }
+
+   return x;
+}
+#endif
+
+static void lq2x_generic_rgb565(struct filter_data *filt,
+      unsigned width, unsigned height,
       int first, int last, uint16_t *src,
       unsigned src_stride, uint16_t *dst, unsigned dst_stride)
 {
-   unsigned x, y;
+   unsigned y;
    uint16_t *out0 = (uint16_t*)dst;
    uint16_t *out1 = (uint16_t*)(dst + dst_stride);
 
    for (y = 0; y < height; y++)
    {
-      int prevline = (y == 0 ? 0 : src_stride);
+      unsigned x   = 0;
+      /* Rows above the tile belong to the frame unless this
+       * is the topmost tile. */
+      int prevline = (y == 0 && first == 0) ? 0 : src_stride;
       int nextline = (y == height - 1 || last) ? 0 : src_stride;
 
-      for (x = 0; x < width; x++)
+      if (filt->interior_rgb565 && width > 1)
       {
-         uint16_t A = *(src - prevline);
-         uint16_t B = (x > 0) ? *(src - 1) : *src;
-         uint16_t C = *src;
-         uint16_t D = (x < width - 1) ? *(src + 1) : *src;
-         uint16_t E = *(src++ + nextline);
-         uint16_t c = C;
-
-         if (A != E && B != D)
-         {
-            *out0++ = (A == B ? ((C + A - ((C ^ A) & 0x0821)) >> 1) : c);
-            *out0++ = (A == D ? ((C + A - ((C ^ A) & 0x0821)) >> 1) : c);
-            *out1++ = (E == B ? ((C + E - ((C ^ E) & 0x0821)) >> 1) : c);
-            *out1++ = (E == D ? ((C + E - ((C ^ E) & 0x0821)) >> 1) : c);
-         }
-         else
-         {
-            *out0++ = c;
-            *out0++ = c;
-            *out1++ = c;
-            *out1++ = c;
-         }
+         lq2x_span_rgb565(src, prevline, nextline, width, 0, 1, out0, out1);
+         x = filt->interior_rgb565(src, prevline, nextline, width,
+               out0, out1);
       }
+      lq2x_span_rgb565(src, prevline, nextline, width, x, width, out0, out1);
 
-      src  += src_stride - width;
-      out0 += dst_stride + dst_stride - (width << 1);
-      out1 += dst_stride + dst_stride - (width << 1);
+      src  += src_stride;
+      out0 += dst_stride << 1;
+      out1 += dst_stride << 1;
    }
 }
 
-static void lq2x_generic_xrgb8888(unsigned width, unsigned height,
+static void lq2x_generic_xrgb8888(struct filter_data *filt,
+      unsigned width, unsigned height,
       int first, int last, uint32_t *src,
       unsigned src_stride, uint32_t *dst, unsigned dst_stride)
 {
-   unsigned x, y;
+   unsigned y;
    uint32_t *out0 = (uint32_t*)dst;
    uint32_t *out1 = (uint32_t*)(dst + dst_stride);
 
    for (y = 0; y < height; y++)
    {
-      int prevline = (y == 0 ? 0 : src_stride);
+      unsigned x   = 0;
+      int prevline = (y == 0 && first == 0) ? 0 : src_stride;
       int nextline = (y == height - 1 || last) ? 0 : src_stride;
 
-      for (x = 0; x < width; x++)
+      if (filt->interior_xrgb8888 && width > 1)
       {
-         uint32_t A = *(src - prevline);
-         uint32_t B = (x > 0) ? *(src - 1) : *src;
-         uint32_t C = *src;
-         uint32_t D = (x < width - 1) ? *(src + 1) : *src;
-         uint32_t E = *(src++ + nextline);
-         uint32_t c = C;
-
-         if (A != E && B != D)
-         {
-            *out0++ = (A == B ? (C + A - ((C ^ A) & 0x0421)) >> 1 : c);
-            *out0++ = (A == D ? (C + A - ((C ^ A) & 0x0421)) >> 1 : c);
-            *out1++ = (E == B ? (C + E - ((C ^ E) & 0x0421)) >> 1 : c);
-            *out1++ = (E == D ? (C + E - ((C ^ E) & 0x0421)) >> 1 : c);
-         }
-         else
-         {
-            *out0++ = c;
-            *out0++ = c;
-            *out1++ = c;
-            *out1++ = c;
-         }
+         lq2x_span_xrgb8888(src, prevline, nextline, width, 0, 1, out0, out1);
+         x = filt->interior_xrgb8888(src, prevline, nextline, width,
+               out0, out1);
       }
+      lq2x_span_xrgb8888(src, prevline, nextline, width, x, width, out0, out1);
+
+      src  += src_stride;
+      out0 += dst_stride << 1;
+      out1 += dst_stride << 1;
+   }
+}
+
+static void *lq2x_generic_create(const struct softfilter_config *config,
+      unsigned in_fmt, unsigned out_fmt,
+      unsigned max_width, unsigned max_height,
+      unsigned threads, softfilter_simd_mask_t simd, void *userdata)
+{
+   struct filter_data *filt = (struct filter_data*)calloc(1, sizeof(*filt));
+   (void)config;
+   (void)userdata;
+   if (!filt)
+      return NULL;
+   filt->workers = (struct softfilter_thread_data*)
+      calloc(threads, sizeof(struct softfilter_thread_data));
+   filt->threads = threads;
+   filt->in_fmt  = in_fmt;
+   if (!filt->workers)
+   {
+      free(filt);
+      return NULL;
+   }
 
-      src += src_stride - width;
-      out0 += dst_stride + dst_stride - (width << 1);
-      out1 += dst_stride + dst_stride - (width << 1);
+#if defined(__SSE2__)
+   if (simd & SOFTFILTER_SIMD_SSE2)
+   {
+      filt->interior_rgb565   = lq2x_interior_rgb565_sse2;
+      filt->interior_xrgb8888 = lq2x_interior_xrgb8888_sse2;
+   }
+#elif (defined(__ARM_NEON__) || defined(HAVE_NEON))
+   if (simd & SOFTFILTER_SIMD_NEON)
+   {
+      filt->interior_rgb565   = lq2x_interior_rgb565_neon;
+      filt->interior_xrgb8888 = lq2x_interior_xrgb8888_neon;
    }
+#endif
+   (void)simd;
+
+   return filt;
 }
 
 static void lq2x_work_cb_rgb565(void *data, void *thread_data)
@@ -200,7 +432,7 @@ static void lq2x_work_cb_rgb565(void *data, void *thread_data)
    unsigned width = thr->width;
    unsigned height = thr->height;
 
-   lq2x_generic_rgb565(width, height,
+   lq2x_generic_rgb565((struct filter_data*)data, width, height,
          thr->first, thr->last, input,
          (unsigned)(thr->in_pitch / SOFTFILTER_BPP_RGB565),
          output,
@@ -216,9 +448,7 @@ static void lq2x_work_cb_xrgb8888(void *data, void *thread_data)
    unsigned width = thr->width;
    unsigned height = thr->height;
 
-   (void)data;
-
-   lq2x_generic_xrgb8888(width, height,
+   lq2x_generic_xrgb8888((struct filter_data*)data, width, height,
          thr->first, thr->last, input,
          (unsigned)(thr->in_pitch / SOFTFILTER_BPP_XRGB8888),
          output,
@@ -250,7 +480,11 @@ static void lq2x_generic_packets(void *data,
       /* Workers need to know if they can access pixels
        * outside their given buffer. */
       thr->first = y_start;
-      thr->last = y_end == height;
+
+      /* A single slice has always clamped the row below to the
+       * current one (nextline == 0); keep that for every row tile
+       * so the result does not depend on how the frame was split. */
+      thr->last = 1;
 
       if (filt->in_fmt == SOFTFILTER_FMT_RGB565)
          packets[i].work = lq2x_work_cb_rgb565;
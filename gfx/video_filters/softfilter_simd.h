@@ -0,0 +1,179 @@
+/*  RetroArch - A frontend for libretro.
+ *  Copyright (C) 2010-2014 - Hans-Kristian Arntzen
+ *  Copyright (C) 2011-2017 - Daniel De Matteis
+ *
+ *  RetroArch is free software: you can redistribute it and/or modify it under the terms
+ *  of the GNU General Public License as published by the Free Software Found-
+ *  ation, either version 3 of the License, or (at your option) any later version.
+ *
+ *  RetroArch is distributed in the hope that it will be useful, but WITHOUT ANY WARRANTY;
+ *  without even the implied warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR
+ *  PURPOSE.  See the GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License along with RetroArch.
+ *  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef SOFTFILTER_SIMD_H__
+#define SOFTFILTER_SIMD_H__
+
+#include "softfilter.h"
+
+/* Lane-wise helpers for filters whose vector kernels are written
+ * once for SSE2 and NEON. The 16-bit variants carry RGB565 pixels,
+ * the 32-bit ones XRGB8888. Comparisons produce all-ones lanes for
+ * true, so they can be fed straight into sfv_sel*().
+ *
+ * SFV_SIMD_MASK is the create() SIMD bit the kernels need; it is
+ * left undefined when no vector instruction set is available. */
+
+#if defined(__SSE2__)
+#include <emmintrin.h>
+
+#define SFV_SIMD_MASK SOFTFILTER_SIMD_SSE2
+
+typedef __m128i sfv_vec16_t;
+typedef __m128i sfv_vec32_t;
+
+#define sfv_load16(p)        _mm_loadu_si128((const __m128i*)(p))
+#define sfv_set16(c)         _mm_set1_epi16((short)(c))
+#define sfv_eq16(a, b)       _mm_cmpeq_epi16(a, b)
+#define sfv_and16(a, b)      _mm_and_si128(a, b)
+#define sfv_or16(a, b)       _mm_or_si128(a, b)
+#define sfv_andnot16(m, a)   _mm_andnot_si128(m, a)
+#define sfv_sel16(m, a, b)   _mm_or_si128(_mm_and_si128(m, a), _mm_andnot_si128(m, b))
+#define sfv_add16(a, b)      _mm_add_epi16(a, b)
+#define sfv_sub16(a, b)      _mm_sub_epi16(a, b)
+#define sfv_srli16(a, n)     _mm_srli_epi16(a, n)
+#define sfv_gtz16(a)         _mm_cmpgt_epi16(a, _mm_setzero_si128())
+#define sfv_ltz16(a)         _mm_cmplt_epi16(a, _mm_setzero_si128())
+#define sfv_store2_16(p, a, b) \
+   { \
+      _mm_storeu_si128((__m128i*)(p),     _mm_unpacklo_epi16(a, b)); \
+      _mm_storeu_si128((__m128i*)(p) + 1, _mm_unpackhi_epi16(a, b)); \
+   }
+
+#define sfv_load32(p)        _mm_loadu_si128((const __m128i*)(p))
+#define sfv_set32(c)         _mm_set1_epi32((int)(c))
+#define sfv_eq32(a, b)       _mm_cmpeq_epi32(a, b)
+#define sfv_and32(a, b)      _mm_and_si128(a, b)
+#define sfv_or32(a, b)       _mm_or_si128(a, b)
+#define sfv_andnot32(m, a)   _mm_andnot_si128(m, a)
+#define sfv_sel32(m, a, b)   _mm_or_si128(_mm_and_si128(m, a), _mm_andnot_si128(m, b))
+#define sfv_add32(a, b)      _mm_add_epi32(a, b)
+#define sfv_sub32(a, b)      _mm_sub_epi32(a, b)
+#define sfv_srli32(a, n)     _mm_srli_epi32(a, n)
+#define sfv_gtz32(a)         _mm_cmpgt_epi32(a, _mm_setzero_si128())
+#define sfv_ltz32(a)         _mm_cmplt_epi32(a, _mm_setzero_si128())
+#define sfv_store2_32(p, a, b) \
+   { \
+      _mm_storeu_si128((__m128i*)(p),     _mm_unpacklo_epi32(a, b)); \
+      _mm_storeu_si128((__m128i*)(p) + 1, _mm_unpackhi_epi32(a, b)); \
+   }
+
+#elif (defined(__ARM_NEON__) || defined(HAVE_NEON))
+#include <arm_neon.h>
+
+#define SFV_SIMD_MASK SOFTFILTER_SIMD_NEON
+
+typedef uint16x8_t sfv_vec16_t;
+typedef uint32x4_t sfv_vec32_t;
+
+#define sfv_load16(p)        vld1q_u16(p)
+#define sfv_set16(c)         vdupq_n_u16((uint16_t)(c))
+#define sfv_eq16(a, b)       vceqq_u16(a, b)
+#define sfv_and16(a, b)      vandq_u16(a, b)
+#define sfv_or16(a, b)       vorrq_u16(a, b)
+#define sfv_andnot16(m, a)   vbicq_u16(a, m)
+#define sfv_sel16(m, a, b)   vbslq_u16(m, a, b)
+#define sfv_add16(a, b)      vaddq_u16(a, b)
+#define sfv_sub16(a, b)      vsubq_u16(a, b)
+#define sfv_srli16(a, n)     vshrq_n_u16(a, n)
+#define sfv_gtz16(a)         vcgtq_s16(vreinterpretq_s16_u16(a), vdupq_n_s16(0))
+#define sfv_ltz16(a)         vcltq_s16(vreinterpretq_s16_u16(a), vdupq_n_s16(0))
+#define sfv_store2_16(p, a, b) \
+   { \
+      uint16x8x2_t sfv_pair_; \
+      sfv_pair_.val[0] = (a); \
+      sfv_pair_.val[1] = (b); \
+      vst2q_u16(p, sfv_pair_); \
+   }
+
+#define sfv_load32(p)        vld1q_u32(p)
+#define sfv_set32(c)         vdupq_n_u32((uint32_t)(c))
+#define sfv_eq32(a, b)       vceqq_u32(a, b)
+#define sfv_and32(a, b)      vandq_u32(a, b)
+#define sfv_or32(a, b)       vorrq_u32(a, b)
+#define sfv_andnot32(m, a)   vbicq_u32(a, m)
+#define sfv_sel32(m, a, b)   vbslq_u32(m, a, b)
+#define sfv_add32(a, b)      vaddq_u32(a, b)
+#define sfv_sub32(a, b)      vsubq_u32(a, b)
+#define sfv_srli32(a, n)     vshrq_n_u32(a, n)
+#define sfv_gtz32(a)         vcgtq_s32(vreinterpretq_s32_u32(a), vdupq_n_s32(0))
+#define sfv_ltz32(a)         vcltq_s32(vreinterpretq_s32_u32(a), vdupq_n_s32(0))
+#define sfv_store2_32(p, a, b) \
+   { \
+      uint32x4x2_t sfv_pair_; \
+      sfv_pair_.val[0] = (a); \
+      sfv_pair_.val[1] = (b); \
+      vst2q_u32(p, sfv_pair_); \
+   }
+#endif
+
+#ifdef SFV_SIMD_MASK
+/* Pixels per vector */
+#define SFV_LANES16 8
+#define SFV_LANES32 4
+
+/* Averages shared by the 2xSaI family. They match the scalar
+ * interpolate/interpolate2 macros of those filters bit for bit;
+ * no intermediate sum leaves its lane. */
+#define sfv_interpolate_rgb565(A, B) \
+   sfv_add16(sfv_add16( \
+         sfv_srli16(sfv_and16(A, sfv_set16(0xF7DE)), 1), \
+         sfv_srli16(sfv_and16(B, sfv_set16(0xF7DE)), 1)), \
+      sfv_and16(sfv_and16(A, B), sfv_set16(0x0821)))
+
+#define sfv_interpolate2_rgb565(A, B, C, D) \
+   sfv_add16(sfv_add16( \
+         sfv_add16(sfv_srli16(sfv_and16(A, sfv_set16(0xE79C)), 2), \
+            sfv_srli16(sfv_and16(B, sfv_set16(0xE79C)), 2)), \
+         sfv_add16(sfv_srli16(sfv_and16(C, sfv_set16(0xE79C)), 2), \
+            sfv_srli16(sfv_and16(D, sfv_set16(0xE79C)), 2))), \
+      sfv_and16(sfv_srli16(sfv_add16( \
+         sfv_add16(sfv_and16(A, sfv_set16(0x1863)), \
+            sfv_and16(B, sfv_set16(0x1863))), \
+         sfv_add16(sfv_and16(C, sfv_set16(0x1863)), \
+            sfv_and16(D, sfv_set16(0x1863)))), 2), sfv_set16(0x1863)))
+
+#define sfv_interpolate_xrgb8888(A, B) \
+   sfv_add32(sfv_add32( \
+         sfv_srli32(sfv_and32(A, sfv_set32(0xFEFEFEFE)), 1), \
+         sfv_srli32(sfv_and32(B, sfv_set32(0xFEFEFEFE)), 1)), \
+      sfv_and32(sfv_and32(A, B), sfv_set32(0x01010101)))
+
+#define sfv_interpolate2_xrgb8888(A, B, C, D) \
+   sfv_add32(sfv_add32( \
+         sfv_add32(sfv_srli32(sfv_and32(A, sfv_set32(0xFCFCFCFC)), 2), \
+            sfv_srli32(sfv_and32(B, sfv_set32(0xFCFCFCFC)), 2)), \
+         sfv_add32(sfv_srli32(sfv_and32(C, sfv_set32(0xFCFCFCFC)), 2), \
+            sfv_srli32(sfv_and32(D, sfv_set32(0xFCFCFCFC)), 2))), \
+      sfv_and32(sfv_srli32(sfv_add32( \
+         sfv_add32(sfv_and32(A, sfv_set32(0x03030303)), \
+            sfv_and32(B, sfv_set32(0x03030303))), \
+         sfv_add32(sfv_and32(C, sfv_set32(0x03030303)), \
+            sfv_and32(D, sfv_set32(0x03030303)))), 2), sfv_set32(0x03030303)))
+
+/* The 2xSaI 'result' vote, (A != C || A != D) - (B != C || B != D),
+ * as a signed lane count. Each comparison mask is 0 or -1, which
+ * turns the difference into the same -1/0/1. */
+#define sfv_result16(A, B, C, D) \
+   sfv_sub16(sfv_and16(sfv_eq16(A, C), sfv_eq16(A, D)), \
+         sfv_and16(sfv_eq16(B, C), sfv_eq16(B, D)))
+
+#define sfv_result32(A, B, C, D) \
+   sfv_sub32(sfv_and32(sfv_eq32(A, C), sfv_eq32(A, D)), \
+         sfv_and32(sfv_eq32(B, C), sfv_eq32(B, D)))
+#endif
+
+#endif
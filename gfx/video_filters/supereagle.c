@@ -17,6 +17,7 @@
 /* Compile: gcc -o supereagle.so -shared supereagle.c -std=c99 -O3 -Wall -pedantic -fPIC */
 
 #include "softfilter.h"
+#include "softfilter_simd.h"
 #include <stdlib.h>
 
 #ifdef RARCH_INTERNAL
@@ -45,6 +46,12 @@ struct filter_data
    unsigned threads;
    struct softfilter_thread_data *workers;
    unsigned in_fmt;
+   unsigned (*interior_rgb565)(const uint16_t *src,
+         unsigned nextline, unsigned width,
+         uint16_t *out0, uint16_t *out1);
+   unsigned (*interior_xrgb8888)(const uint32_t *src,
+         unsigned nextline, unsigned width,
+         uint32_t *out0, uint32_t *out1);
 };
 
 static unsigned supereagle_generic_input_fmts(void)
@@ -63,28 +70,6 @@ static unsigned supereagle_generic_threads(void *data)
    return filt->threads;
 }
 
-static void *supereagle_generic_create(const struct softfilter_config *config,
-      unsigned in_fmt, unsigned out_fmt,
-      unsigned max_width, unsigned max_height,
-      unsigned threads, softfilter_simd_mask_t simd, void *userdata)
-{
-   struct filter_data *filt = (struct filter_data*)calloc(1, sizeof(*filt));
-   (void)simd;
-   (void)config;
-   (void)userdata;
-   if (!filt)
-      return NULL;
-   filt->workers = (struct softfilter_thread_data*)calloc(threads, sizeof(struct softfilter_thread_data));
-   filt->threads = 1;
-   filt->in_fmt  = in_fmt;
-   if (!filt->workers)
-   {
-      free(filt);
-      return NULL;
-   }
-   return filt;
-}
-
 static void supereagle_generic_output(void *data, unsigned *out_width, unsigned *out_height,
       unsigned width, unsigned height)
 {
@@ -214,54 +199,217 @@ static void supereagle_generic_destroy(void *data)
          out += 2
 #endif
 
-static void supereagle_generic_xrgb8888(unsigned width, unsigned height,
+#ifdef SFV_SIMD_MASK
+/* Vector form of supereagle_function() for the lanes starting
+ * at 'in'. Every branch of the scalar code is computed and the
+ * results are picked per lane with the branch conditions as masks. */
+#define supereagle_vector_function(W, in, nextline, interpolate_cb, interpolate2_cb) \
+         const sfv_vec##W##_t colorB1 = sfv_load##W(in - nextline + 0); \
+         const sfv_vec##W##_t colorB2 = sfv_load##W(in - nextline + 1); \
+         const sfv_vec##W##_t color4  = sfv_load##W(in - 1); \
+         const sfv_vec##W##_t color5  = sfv_load##W(in + 0); \
+         const sfv_vec##W##_t color6  = sfv_load##W(in + 1); \
+         const sfv_vec##W##_t colorS2 = sfv_load##W(in + 2); \
+         const sfv_vec##W##_t color1  = sfv_load##W(in + nextline - 1); \
+         const sfv_vec##W##_t color2  = sfv_load##W(in + nextline + 0); \
+         const sfv_vec##W##_t color3  = sfv_load##W(in + nextline + 1); \
+         const sfv_vec##W##_t colorS1 = sfv_load##W(in + nextline + 2); \
+         const sfv_vec##W##_t colorA1 = sfv_load##W(in + nextline + nextline + 0); \
+         const sfv_vec##W##_t colorA2 = sfv_load##W(in + nextline + nextline + 1); \
+         const sfv_vec##W##_t eq26    = sfv_eq##W(color2, color6); \
+         const sfv_vec##W##_t eq53    = sfv_eq##W(color5, color3); \
+         const sfv_vec##W##_t i56     = interpolate_cb(color5, color6); \
+         const sfv_vec##W##_t i23     = interpolate_cb(color2, color3); \
+         const sfv_vec##W##_t i25     = interpolate_cb(color2, color5); \
+         const sfv_vec##W##_t i26     = interpolate_cb(color2, color6); \
+         const sfv_vec##W##_t i53     = interpolate_cb(color5, color3); \
+         /* Branches: 2 == 6 only, 5 == 3 only, both, neither */ \
+         const sfv_vec##W##_t case1   = sfv_andnot##W(eq53, eq26); \
+         const sfv_vec##W##_t case2   = sfv_andnot##W(eq26, eq53); \
+         const sfv_vec##W##_t case3   = sfv_and##W(eq26, eq53); \
+         const sfv_vec##W##_t r       = sfv_add##W( \
+               sfv_add##W(sfv_result##W(color6, color5, color1, colorA1), \
+                  sfv_result##W(color6, color5, color4, colorB1)), \
+               sfv_add##W(sfv_result##W(color6, color5, colorA2, colorS1), \
+                  sfv_result##W(color6, color5, colorB2, colorS2))); \
+         const sfv_vec##W##_t vote1a  = sfv_sel##W(sfv_gtz##W(r), i56, color5); \
+         const sfv_vec##W##_t vote1b  = sfv_sel##W(sfv_ltz##W(r), i56, color2); \
+         const sfv_vec##W##_t case1_1a = sfv_sel##W( \
+               sfv_or##W(sfv_eq##W(color1, color2), sfv_eq##W(color6, colorB2)), \
+               interpolate_cb(color2, i25), i56); \
+         const sfv_vec##W##_t case1_2b = sfv_sel##W( \
+               sfv_or##W(sfv_eq##W(color6, colorS2), sfv_eq##W(color2, colorA1)), \
+               interpolate_cb(color2, i23), i23); \
+         const sfv_vec##W##_t case2_1b = sfv_sel##W( \
+               sfv_or##W(sfv_eq##W(colorB1, color5), sfv_eq##W(color3, colorS1)), \
+               interpolate_cb(color5, i56), i56); \
+         const sfv_vec##W##_t case2_2a = sfv_sel##W( \
+               sfv_or##W(sfv_eq##W(color3, colorA2), sfv_eq##W(color4, color5)), \
+               interpolate_cb(color5, i25), i23); \
+         const sfv_vec##W##_t product1a = sfv_sel##W(case1, case1_1a, \
+               sfv_sel##W(case2, color5, sfv_sel##W(case3, vote1a, \
+                     interpolate2_cb(color5, color5, color5, i26)))); \
+         const sfv_vec##W##_t product1b = sfv_sel##W(case1, color2, \
+               sfv_sel##W(case2, case2_1b, sfv_sel##W(case3, vote1b, \
+                     interpolate2_cb(color6, color6, color6, i53)))); \
+         const sfv_vec##W##_t product2a = sfv_sel##W(case1, color2, \
+               sfv_sel##W(case2, case2_2a, sfv_sel##W(case3, vote1b, \
+                     interpolate2_cb(color2, color2, color2, i53)))); \
+         const sfv_vec##W##_t product2b = sfv_sel##W(case1, case1_2b, \
+               sfv_sel##W(case2, color5, sfv_sel##W(case3, vote1a, \
+                     interpolate2_cb(color3, color3, color3, i26))))
+
+/* The vector paths only handle pixels whose row neighbours
+ * (x - 1 to x + 2) lie inside the row, and return the first
+ * pixel they did not process. */
+static unsigned supereagle_interior_rgb565_simd(const uint16_t *src,
+      unsigned nextline, unsigned width,
+      uint16_t *out0, uint16_t *out1)
+{
+   unsigned x;
+
+   for (x = 1; x + SFV_LANES16 + 2 <= width; x += SFV_LANES16)
+   {
+      const uint16_t *in = src + x;
+      supereagle_vector_function(16, in, nextline,
+            sfv_interpolate_rgb565, sfv_interpolate2_rgb565);
+
+      sfv_store2_16(out0 + (x << 1), product1a, product1b);
+      sfv_store2_16(out1 + (x << 1), product2a, product2b);
+   }
+
+   return x;
+}
+
+static unsigned supereagle_interior_xrgb8888_simd(const uint32_t *src,
+      unsigned nextline, unsigned width,
+      uint32_t *out0, uint32_t *out1)
+{
+   unsigned x;
+
+   for (x = 1; x + SFV_LANES32 + 2 <= width; x += SFV_LANES32)
+   {
+      const uint32_t *in = src + x;
+      supereagle_vector_function(32, in, nextline,
+            sfv_interpolate_xrgb8888, sfv_interpolate2_xrgb8888);
+
+      sfv_store2_32(out0 + (x << 1), product1a, product1b);
+      sfv_store2_32(out1 + (x << 1), product2a, product2b);
+   }
+
+   return x;
+}
+#endif
+
+static void supereagle_span_xrgb8888(const uint32_t *src,
+      unsigned nextline, unsigned x, unsigned end,
+      uint32_t *dst, unsigned dst_stride)
+{
+   const uint32_t *in = src + x;
+   uint32_t *out      = dst + (x << 1);
+
+   for (; x < end; x++)
+   {
+      supereagle_declare_variables(uint32_t, in, nextline);
+
+      supereagle_function(supereagle_result, supereagle_interpolate_xrgb8888, supereagle_interpolate2_xrgb8888);
+   }
+}
+
+static void supereagle_span_rgb565(const uint16_t *src,
+      unsigned nextline, unsigned x, unsigned end,
+      uint16_t *dst, unsigned dst_stride)
+{
+   const uint16_t *in = src + x;
+   uint16_t *out      = dst + (x << 1);
+
+   for (; x < end; x++)
+   {
+      supereagle_declare_variables(uint16_t, in, nextline);
+
+      supereagle_function(supereagle_result, supereagle_interpolate_rgb565, supereagle_interpolate2_rgb565);
+   }
+}
+
+static void supereagle_generic_xrgb8888(struct filter_data *filt,
+      unsigned width, unsigned height,
       int first, int last, uint32_t *src,
       unsigned src_stride, uint32_t *dst, unsigned dst_stride)
 {
-   unsigned finish;
    unsigned nextline = (last) ? 0 : src_stride;
 
    for (; height; height--)
    {
-      uint32_t *in  = (uint32_t*)src;
-      uint32_t *out = (uint32_t*)dst;
+      unsigned x = 0;
 
-      for (finish = width; finish; finish -= 1)
+      if (filt->interior_xrgb8888 && width > 1)
       {
-         supereagle_declare_variables(uint32_t, in, nextline);
-
-         supereagle_function(supereagle_result, supereagle_interpolate_xrgb8888, supereagle_interpolate2_xrgb8888);
+         supereagle_span_xrgb8888(src, nextline, 0, 1, dst, dst_stride);
+         x = filt->interior_xrgb8888(src, nextline, width,
+               dst, dst + dst_stride);
       }
+      supereagle_span_xrgb8888(src, nextline, x, width, dst, dst_stride);
 
       src += src_stride;
       dst += 2 * dst_stride;
    }
 }
 
-static void supereagle_generic_rgb565(unsigned width, unsigned height,
+static void supereagle_generic_rgb565(struct filter_data *filt,
+      unsigned width, unsigned height,
       int first, int last, uint16_t *src,
       unsigned src_stride, uint16_t *dst, unsigned dst_stride)
 {
-   unsigned finish;
    unsigned nextline = (last) ? 0 : src_stride;
 
    for (; height; height--)
    {
-      uint16_t *in  = (uint16_t*)src;
-      uint16_t *out = (uint16_t*)dst;
+      unsigned x = 0;
 
-      for (finish = width; finish; finish -= 1)
+      if (filt->interior_rgb565 && width > 1)
       {
-         supereagle_declare_variables(uint16_t, in, nextline);
-
-         supereagle_function(supereagle_result, supereagle_interpolate_rgb565, supereagle_interpolate2_rgb565);
+         supereagle_span_rgb565(src, nextline, 0, 1, dst, dst_stride);
+         x = filt->interior_rgb565(src, nextline, width,
+               dst, dst + dst_stride);
       }
+      supereagle_span_rgb565(src, nextline, x, width, dst, dst_stride);
 
       src += src_stride;
       dst += 2 * dst_stride;
    }
 }
 
+static void *supereagle_generic_create(const struct softfilter_config *config,
+      unsigned in_fmt, unsigned out_fmt,
+      unsigned max_width, unsigned max_height,
+      unsigned threads, softfilter_simd_mask_t simd, void *userdata)
+{
+   struct filter_data *filt = (struct filter_data*)calloc(1, sizeof(*filt));
+   (void)config;
+   (void)userdata;
+   if (!filt)
+      return NULL;
+   filt->workers = (struct softfilter_thread_data*)calloc(threads, sizeof(struct softfilter_thread_data));
+   filt->threads = threads;
+   filt->in_fmt  = in_fmt;
+   if (!filt->workers)
+   {
+      free(filt);
+      return NULL;
+   }
+
+#ifdef SFV_SIMD_MASK
+   if (simd & SFV_SIMD_MASK)
+   {
+      filt->interior_rgb565   = supereagle_interior_rgb565_simd;
+      filt->interior_xrgb8888 = supereagle_interior_xrgb8888_simd;
+   }
+#endif
+   (void)simd;
+
+   return filt;
+}
+
 static void supereagle_work_cb_rgb565(void *data, void *thread_data)
 {
    struct softfilter_thread_data *thr = (struct softfilter_thread_data*)thread_data;
@@ -270,7 +418,7 @@ static void supereagle_work_cb_rgb565(void *data, void *thread_data)
    unsigned width = thr->width;
    unsigned height = thr->height;
 
-   supereagle_generic_rgb565(width, height,
+   supereagle_generic_rgb565((struct filter_data*)data, width, height,
          thr->first, thr->last, input,
             (unsigned)(thr->in_pitch / SOFTFILTER_BPP_RGB565),
             output,
@@ -285,7 +433,7 @@ static void supereagle_work_cb_xrgb8888(void *data, void *thread_data)
    unsigned width = thr->width;
    unsigned height = thr->height;
 
-   supereagle_generic_xrgb8888(width, height,
+   supereagle_generic_xrgb8888((struct filter_data*)data, width, height,
          thr->first, thr->last, input,
         (unsigned)(thr->in_pitch / SOFTFILTER_BPP_XRGB8888),
         output,
@@ -315,7 +463,12 @@ static void supereagle_generic_packets(void *data,
 
       /* Workers need to know if they can access pixels outside their given buffer. */
       thr->first = y_start;
-      thr->last = y_end == height;
+
+      /* The kernels clamp every row of the last slice to itself
+       * (nextline == 0), which is the output a single slice has
+       * always produced. Treat each row tile the same way so the
+       * result does not depend on how the frame was split. */
+      thr->last = 1;
 
       if (filt->in_fmt == SOFTFILTER_FMT_RGB565)
          packets[i].work = supereagle_work_cb_rgb565;
@@ -30,6 +30,26 @@
 #include "../retroarch.h"
 #include "../verbosity.h"
 
+/* The frame mailbox only needs an atomic exchange and
+ * sequentially consistent loads/stores on a long. Without
+ * them, every mailbox access goes through thr->lock. */
+#if defined(__clang__) || (defined(__GNUC__) && \
+      (__GNUC__ > 4 || (__GNUC__ == 4 && __GNUC_MINOR__ >= 7)))
+#define VIDEO_THREAD_HAVE_ATOMICS
+#define VIDEO_THREAD_XCHG(ptr, val)  __atomic_exchange_n((ptr), (val), __ATOMIC_SEQ_CST)
+#define VIDEO_THREAD_LOAD(ptr)       __atomic_load_n((ptr), __ATOMIC_SEQ_CST)
+#define VIDEO_THREAD_STORE(ptr, val) __atomic_store_n((ptr), (val), __ATOMIC_SEQ_CST)
+#elif defined(_MSC_VER) && _MSC_VER >= 1400 && !defined(_XBOX)
+#include <intrin.h>
+#define VIDEO_THREAD_HAVE_ATOMICS
+#define VIDEO_THREAD_XCHG(ptr, val)  _InterlockedExchange((volatile long*)(ptr), (val))
+#define VIDEO_THREAD_LOAD(ptr)       _InterlockedCompareExchange((volatile long*)(ptr), 0, 0)
+#define VIDEO_THREAD_STORE(ptr, val) _InterlockedExchange((volatile long*)(ptr), (val))
+#else
+#define VIDEO_THREAD_LOAD(ptr)       (*(volatile long*)(ptr))
+#define VIDEO_THREAD_STORE(ptr, val) (*(volatile long*)(ptr) = (val))
+#endif
+
 static void *video_thread_init_never_call(const video_info_t *video,
       input_driver_t **input, void **input_data)
 {
@@ -405,6 +425,79 @@ static bool video_thread_handle_packet(
    return false;
 }
 
+/* Called by the render thread with thr->lock held.
+ * Swaps the slot it just rendered for the pending frame,
+ * if there is one. */
+static bool video_thread_mailbox_consume(thread_video_t *thr)
+{
+   long prev;
+
+   if (!(VIDEO_THREAD_LOAD(&thr->frame.mailbox) & VIDEO_THREAD_FRAME_FRESH))
+      return false;
+
+   /* Only this thread ever clears the fresh bit, so whatever
+    * we swap out here is still a fresh frame. */
+#ifdef VIDEO_THREAD_HAVE_ATOMICS
+   prev               = VIDEO_THREAD_XCHG(&thr->frame.mailbox,
+         (long)thr->frame.read);
+#else
+   prev               = thr->frame.mailbox;
+   thr->frame.mailbox = (long)thr->frame.read;
+#endif
+   thr->frame.read    = (unsigned)(prev & VIDEO_THREAD_FRAME_INDEX);
+
+   return true;
+}
+
+/* Called by the core thread. Hands slot 'next' over to the
+ * render thread and returns what the mailbox held before. */
+static long video_thread_mailbox_publish(thread_video_t *thr, long next)
+{
+   long prev;
+
+#ifdef VIDEO_THREAD_HAVE_ATOMICS
+   prev = VIDEO_THREAD_XCHG(&thr->frame.mailbox, next);
+
+   /* The render thread marks itself as sleeping before it
+    * checks the mailbox, so either it sees the new frame or
+    * we see it asleep and need to wake it up. */
+   if (VIDEO_THREAD_LOAD(&thr->frame.sleeping))
+   {
+      slock_lock(thr->lock);
+      scond_signal(thr->cond_thread);
+      slock_unlock(thr->lock);
+   }
+#else
+   slock_lock(thr->lock);
+   prev               = thr->frame.mailbox;
+   thr->frame.mailbox = next;
+   scond_signal(thr->cond_thread);
+   slock_unlock(thr->lock);
+#endif
+
+   return prev;
+}
+
+/* Called by the render thread with thr->lock held. */
+static void video_thread_update_frame_age(thread_video_t *thr,
+      retro_time_t age)
+{
+   thr->frame.age_last   = age;
+   thr->frame.age_accum += age;
+   if (age > thr->frame.age_peak)
+      thr->frame.age_peak = age;
+
+   if (++thr->frame.age_samples >= VIDEO_THREAD_AGE_WINDOW)
+   {
+      thr->frame.age_avg     = thr->frame.age_accum
+         / thr->frame.age_samples;
+      thr->frame.age_max     = thr->frame.age_peak;
+      thr->frame.age_accum   = 0;
+      thr->frame.age_peak    = 0;
+      thr->frame.age_samples = 0;
+   }
+}
+
 static void video_thread_loop(void *data)
 {
    thread_packet_t pkt;
@@ -414,10 +507,17 @@ static void video_thread_loop(void *data)
    for (;;)
    {
       slock_lock(thr->lock);
-      while (thr->send_cmd == CMD_VIDEO_NONE && !thr->frame.updated)
+      VIDEO_THREAD_STORE(&thr->frame.sleeping, 1);
+      while (thr->send_cmd == CMD_VIDEO_NONE
+            && !(VIDEO_THREAD_LOAD(&thr->frame.mailbox)
+               & VIDEO_THREAD_FRAME_FRESH))
          scond_wait(thr->cond_thread, thr->lock);
+      VIDEO_THREAD_STORE(&thr->frame.sleeping, 0);
 
-      updated = thr->frame.updated;
+      /* Picking the frame up frees the mailbox, so let a core
+       * thread pacing itself against it carry on right away. */
+      if ((updated = video_thread_mailbox_consume(thr)))
+         scond_signal(thr->cond_cmd);
 
       /* To avoid race condition where send_cmd is updated
        * right after the switch is checked. */
@@ -434,6 +534,8 @@ static void video_thread_loop(void *data)
          bool               focus = false;
          bool        has_windowed = false;
          struct video_viewport vp = {0};
+         const video_thread_frame_slot_t *slot =
+            &thr->frame.slots[thr->frame.read];
 
          slock_lock(thr->frame.lock);
 
@@ -449,11 +551,15 @@ static void video_thread_loop(void *data)
                /* TODO/FIXME - not thread-safe - should get 
                 * rid of this */
                video_driver_build_info(&video_info);
+               if (video_info.statistics_show)
+                  strlcpy(video_info.stat_text, slot->stat_text,
+                        sizeof(video_info.stat_text));
 
                ret = thr->driver->frame(thr->driver_data,
-                  thr->frame.buffer, thr->frame.width, thr->frame.height,
-                  thr->frame.count, thr->frame.pitch,
-                  *thr->frame.msg ? thr->frame.msg : NULL,
+                  slot->has_data ? thr->frame.buffers[thr->frame.read] : NULL,
+                  slot->width, slot->height,
+                  slot->count, slot->pitch,
+                  *slot->msg ? slot->msg : NULL,
                   &video_info);
 
                slock_unlock(thr->frame.lock);
@@ -478,11 +584,13 @@ static void video_thread_loop(void *data)
             slock_unlock(thr->frame.lock);
 
          slock_lock(thr->lock);
-         thr->alive         = alive;
-         thr->focus         = focus;
-         thr->has_windowed  = has_windowed;
-         thr->vp            = vp;
-         thr->frame.updated = false;
+         thr->alive          = alive;
+         thr->focus          = focus;
+         thr->has_windowed   = has_windowed;
+         thr->vp             = vp;
+         thr->frame.rendered = slot->seq;
+         video_thread_update_frame_age(thr,
+               cpu_features_get_time_usec() - slot->time);
          scond_signal(thr->cond_cmd);
          slock_unlock(thr->lock);
       }
@@ -581,16 +689,20 @@ static bool video_thread_frame(void *data, const void *frame_,
       return false;
    }
 
-   slock_lock(thr->lock);
-
-   if (!thr->nonblock)
+   /* Give the render thread until the next refresh to pick up
+    * the previous frame; past that, the new one replaces it. */
+   if (     !thr->nonblock
+         && (VIDEO_THREAD_LOAD(&thr->frame.mailbox)
+            & VIDEO_THREAD_FRAME_FRESH))
    {
       retro_time_t target_frame_time =
          (retro_time_t)roundf(1000000 / video_info->refresh_rate);
       retro_time_t target = thr->last_time + target_frame_time;
 
+      slock_lock(thr->lock);
       /* Ideally, use absolute time, but that is only a good idea on POSIX. */
-      while (thr->frame.updated)
+      while (VIDEO_THREAD_LOAD(&thr->frame.mailbox)
+            & VIDEO_THREAD_FRAME_FRESH)
       {
          retro_time_t current = cpu_features_get_time_usec();
          retro_time_t delta   = target - current;
@@ -601,52 +713,66 @@ static bool video_thread_frame(void *data, const void *frame_,
          if (!scond_wait_timeout(thr->cond_cmd, thr->lock, delta))
             break;
       }
+      slock_unlock(thr->lock);
    }
 
-   /* Drop frame if updated flag is still set, as thread is
-    * still working on last frame. */
-   if (!thr->frame.updated)
    {
-      const uint8_t *src   = (const uint8_t*)frame_;
-      uint8_t       *dst   = thr->frame.buffer;
-      unsigned copy_stride = width *
+      long prev;
+      const uint8_t *src              = (const uint8_t*)frame_;
+      uint8_t       *dst              = thr->frame.buffers[thr->frame.write];
+      video_thread_frame_slot_t *slot = &thr->frame.slots[thr->frame.write];
+      unsigned copy_stride            = width *
          (thr->info.rgb32 ? sizeof(uint32_t) : sizeof(uint16_t));
 
-      if (src)
+      /* Nothing but this thread touches the write slot, so the
+       * copy happens without holding any lock. If the core
+       * rendered straight into it, there is nothing to copy. */
+      if (src == dst)
+         copy_stride = pitch;
+      else if (src)
       {
          unsigned h;
          for (h = 0; h < height; h++, src += pitch, dst += copy_stride)
             memcpy(dst, src, copy_stride);
       }
 
-      thr->frame.updated = true;
-      thr->frame.width   = width;
-      thr->frame.height  = height;
-      thr->frame.count   = frame_count;
-      thr->frame.pitch   = copy_stride;
+      slot->has_data = (frame_ != NULL);
+      slot->width    = width;
+      slot->height   = height;
+      slot->count    = frame_count;
+      slot->pitch    = copy_stride;
+      slot->seq      = ++thr->frame.published;
 
       if (msg)
-         strlcpy(thr->frame.msg, msg, sizeof(thr->frame.msg));
+         strlcpy(slot->msg, msg, sizeof(slot->msg));
       else
-         *thr->frame.msg = '\0';
+         *slot->msg = '\0';
 
-      scond_signal(thr->cond_thread);
+      if (video_info->statistics_show)
+         strlcpy(slot->stat_text, video_info->stat_text,
+               sizeof(slot->stat_text));
+
+      slot->time       = cpu_features_get_time_usec();
+
+      prev             = video_thread_mailbox_publish(thr,
+            (long)thr->frame.write | VIDEO_THREAD_FRAME_FRESH);
+      thr->frame.write = (unsigned)(prev & VIDEO_THREAD_FRAME_INDEX);
+
+      thr->hit_count++;
+      /* The render thread never saw the frame we just replaced. */
+      if (prev & VIDEO_THREAD_FRAME_FRESH)
+         thr->miss_count++;
 
 #ifdef HAVE_MENU
       if (thr->texture.enable)
       {
-         do
-         {
+         slock_lock(thr->lock);
+         while (thr->frame.rendered < slot->seq)
             scond_wait(thr->cond_cmd, thr->lock);
-         } while (thr->frame.updated);
+         slock_unlock(thr->lock);
       }
 #endif
-      thr->hit_count++;
    }
-   else
-      thr->miss_count++;
-
-   slock_unlock(thr->lock);
 
    thr->last_time = cpu_features_get_time_usec();
 
@@ -686,20 +812,29 @@ static bool video_thread_init(thread_video_t *thr,
       return false;
 
    {
+      unsigned i;
       size_t max_size        = info.input_scale * RARCH_SCALE_BASE;
       max_size              *= max_size;
       max_size              *= info.rgb32 ?
          sizeof(uint32_t) : sizeof(uint16_t);
 
+      for (i = 0; i < VIDEO_THREAD_NUM_FRAMES; i++)
+      {
 #ifdef _3DS
-      thr->frame.buffer      = linearMemAlign(max_size, 0x80);
+         thr->frame.buffers[i] = linearMemAlign(max_size, 0x80);
 #else
-      thr->frame.buffer      = (uint8_t*)malloc(max_size);
+         thr->frame.buffers[i] = (uint8_t*)malloc(max_size);
 #endif
-      if (!thr->frame.buffer)
-         return false;
+         if (!thr->frame.buffers[i])
+            return false;
+         memset(thr->frame.buffers[i], 0x80, max_size);
+      }
 
-      memset(thr->frame.buffer, 0x80, max_size);
+      thr->frame.write       = 0;
+      thr->frame.mailbox     = 1;
+      thr->frame.read        = 2;
+      thr->frame.max_width   = info.input_scale * RARCH_SCALE_BASE;
+      thr->frame.max_height  = info.input_scale * RARCH_SCALE_BASE;
    }
 
    thr->input                = input;
@@ -810,6 +945,7 @@ static bool video_thread_read_viewport(void *data,
 
 static void video_thread_free(void *data)
 {
+   unsigned i;
    thread_video_t *thr = (thread_video_t*)data;
 
    if (thr)
@@ -832,11 +968,14 @@ static void video_thread_free(void *data)
       }
 
       free(thr->texture.frame);
+      for (i = 0; i < VIDEO_THREAD_NUM_FRAMES; i++)
+      {
 #ifdef _3DS
-      linearFree(thr->frame.buffer);
+         linearFree(thr->frame.buffers[i]);
 #else
-      free(thr->frame.buffer);
+         free(thr->frame.buffers[i]);
 #endif
+      }
       free(thr->alpha_mod);
 
       slock_free(thr->frame.lock);
@@ -1240,6 +1379,33 @@ static struct video_shader *thread_get_current_shader(void *data)
    return NULL;
 }
 
+/* The driver's own software framebuffer lives on the render
+ * thread, so hand out the mailbox slot the next frame will be
+ * written to instead.
+ * Only ever touched from the thread calling video_thread_frame(). */
+static bool thread_get_current_software_framebuffer(void *data,
+      struct retro_framebuffer *framebuffer)
+{
+   thread_video_t *thr = (thread_video_t*)data;
+   unsigned bpp;
+
+   if (!thr || !thr->frame.buffers[thr->frame.write])
+      return false;
+   if (     framebuffer->width  > thr->frame.max_width
+         || framebuffer->height > thr->frame.max_height)
+      return false;
+
+   bpp                       = thr->info.rgb32
+      ? sizeof(uint32_t) : sizeof(uint16_t);
+   framebuffer->data         = thr->frame.buffers[thr->frame.write];
+   framebuffer->pitch        = framebuffer->width * bpp;
+   framebuffer->format       = thr->info.rgb32
+      ? RETRO_PIXEL_FORMAT_XRGB8888 : RETRO_PIXEL_FORMAT_RGB565;
+   framebuffer->memory_flags = RETRO_MEMORY_TYPE_CACHED;
+
+   return true;
+}
+
 static uint32_t thread_get_flags(void *data)
 {
    thread_video_t *thr = (thread_video_t*)data;
@@ -1270,7 +1436,7 @@ static const video_poke_interface_t thread_poke = {
    thread_show_mouse,
    thread_grab_mouse_toggle,
    thread_get_current_shader,
-   NULL, /* get_current_software_framebuffer */
+   thread_get_current_software_framebuffer,
    NULL, /* get_hw_render_interface */
    thread_set_hdr_max_nits,
    thread_set_hdr_paper_white_nits,
@@ -1448,3 +1614,33 @@ unsigned video_thread_texture_load(void *data, custom_command_method_t func)
 
    return pkt.data.custom_command.return_value;
 }
+
+bool video_thread_get_frame_stats(void *data,
+      video_thread_frame_stats_t *stats)
+{
+   thread_video_t *thr = (thread_video_t*)data;
+
+   if (!thr || !stats)
+      return false;
+
+   slock_lock(thr->lock);
+   stats->age_last = thr->frame.age_last;
+   /* Until the first window completes, report what we have so far. */
+   if (thr->frame.age_avg || !thr->frame.age_samples)
+   {
+      stats->age_avg = thr->frame.age_avg;
+      stats->age_max = thr->frame.age_max;
+   }
+   else
+   {
+      stats->age_avg = thr->frame.age_accum / thr->frame.age_samples;
+      stats->age_max = thr->frame.age_peak;
+   }
+   slock_unlock(thr->lock);
+
+   /* Owned by the core thread, which is the one asking. */
+   stats->pushed   = thr->hit_count;
+   stats->dropped  = thr->miss_count;
+
+   return true;
+}
@@ -166,6 +166,38 @@ typedef struct thread_packet
    enum thread_cmd type;
 } thread_packet_t;
 
+#define VIDEO_THREAD_NUM_FRAMES  3
+#define VIDEO_THREAD_FRAME_FRESH 0x4
+#define VIDEO_THREAD_FRAME_INDEX 0x3
+
+/* Number of rendered frames the average/peak frame age
+ * is computed over. */
+#define VIDEO_THREAD_AGE_WINDOW  64
+
+typedef struct video_thread_frame_slot
+{
+   retro_time_t time; /* When the core thread published it. */
+   uint64_t count;
+   uint64_t seq;
+   unsigned width;
+   unsigned height;
+   unsigned pitch;
+   char msg[NAME_MAX_LENGTH];
+   /* The render thread builds its own video_frame_info_t,
+    * so the statistics text has to travel with the frame. */
+   char stat_text[sizeof(((video_frame_info_t*)0)->stat_text)];
+   bool has_data;
+} video_thread_frame_slot_t;
+
+typedef struct video_thread_frame_stats
+{
+   retro_time_t age_last;
+   retro_time_t age_avg;
+   retro_time_t age_max;
+   unsigned pushed;
+   unsigned dropped;
+} video_thread_frame_stats_t;
+
 typedef struct thread_video
 {
    retro_time_t last_time;
@@ -220,14 +252,31 @@ typedef struct thread_video
 
    struct
    {
-      uint64_t count;
       slock_t *lock;
-      uint8_t *buffer;
-      unsigned width;
-      unsigned height;
-      unsigned pitch;
-      char msg[NAME_MAX_LENGTH];
-      bool updated;
+      /* Triple-buffered mailbox between the core thread and the
+       * render thread. The core owns buffers[write], the render
+       * thread owns buffers[read], and the remaining slot sits in
+       * 'mailbox' together with VIDEO_THREAD_FRAME_FRESH when it
+       * holds a frame the render thread has not picked up yet.
+       * A new frame simply replaces an unread one. */
+      uint8_t *buffers[VIDEO_THREAD_NUM_FRAMES];
+      video_thread_frame_slot_t slots[VIDEO_THREAD_NUM_FRAMES];
+      /* Frame age statistics, written by the render thread
+       * under thr->lock. */
+      retro_time_t age_last;
+      retro_time_t age_avg;
+      retro_time_t age_max;
+      retro_time_t age_accum;
+      retro_time_t age_peak;
+      uint64_t published;
+      uint64_t rendered;
+      long mailbox;
+      long sleeping;
+      unsigned write;
+      unsigned read;
+      unsigned age_samples;
+      unsigned max_width;
+      unsigned max_height;
       bool within_thread;
    } frame;
 
@@ -273,6 +322,22 @@ bool video_thread_font_init(
 unsigned video_thread_texture_load(void *data,
       custom_command_method_t func);
 
+/**
+ * video_thread_get_frame_stats:
+ * @data                      : Threaded video driver data.
+ * @stats                     : Output statistics.
+ *
+ * Frame age is the time between the core thread handing a
+ * frame over and the render thread finishing it, averaged
+ * over the last VIDEO_THREAD_AGE_WINDOW rendered frames.
+ * Dropped frames are the ones replaced by a newer frame
+ * before the render thread got to them.
+ *
+ * Returns: true (1) if successful, otherwise false (0).
+ **/
+bool video_thread_get_frame_stats(void *data,
+      video_thread_frame_stats_t *stats);
+
 RETRO_END_DECLS
 
 #endif
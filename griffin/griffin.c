@@ -142,6 +142,7 @@ COMPRESSION
 #include "../libretro-common/streams/stdin_stream.c"
 #include "../libretro-common/streams/trans_stream.c"
 #include "../libretro-common/streams/trans_stream_pipe.c"
+#include "../libretro-common/streams/trans_stream_lz4.c"
 
 #ifdef HAVE_ZLIB
 #include "../libretro-common/streams/trans_stream_zlib.c"
@@ -1130,6 +1131,9 @@ FILE
 #if defined(__linux__)
 #include "../libretro-common/file/nbio/nbio_linux.c"
 #endif
+#if defined(__linux__) && defined(HAVE_IO_URING)
+#include "../libretro-common/file/nbio/nbio_uring.c"
+#endif
 #if defined(HAVE_MMAP) && defined(BSD)
 #include "../libretro-common/file/nbio/nbio_unixmmap.c"
 #endif
@@ -1305,6 +1309,7 @@ WIFI
 RECORDING
 ============================================================ */
 #include "../record/record_driver.c"
+#include "../record/drivers/record_rcap.c"
 #ifdef HAVE_FFMPEG
 #include "../record/drivers/record_ffmpeg.c"
 #endif
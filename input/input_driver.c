@@ -20,7 +20,9 @@
 
 #include <math.h>
 #include <string/stdstring.h>
+#include <encodings/crc32.h>
 #include <encodings/utf.h>
+#include <streams/trans_stream.h>
 #include <clamping.h>
 #include <retro_assert.h>
 
@@ -4480,14 +4482,68 @@ void input_driver_poll(void)
 #define SERIALIZER_INDEX   1
 #define CRC_INDEX          2
 #define STATE_SIZE_INDEX   3
+/* BSV2 only */
+#define KEY_INTERVAL_INDEX 4
+#define FRAME_COUNT_INDEX  5
+#define INDEX_OFFSET_INDEX 6 /* and 7, low word first */
 
 #define BSV_MAGIC          0x42535631
+/* BSV1 with a keyframe every 'keyframe interval' frames, written
+ * at the start of the frame, and an index at the end:
+ *
+ * Keyframe: "BSVK", frame, state size, compressed size,
+ *           CRC32 of the state, LZ4 compressed state.
+ * Index:    "BSVI", count, then per keyframe
+ *           frame, CRC32 of the state, 64-bit file offset.
+ *
+ * A keyframe with no state (both sizes 0) marks a frame the
+ * core failed to serialize. */
+#define BSV2_MAGIC         0x42535632
+#define BSV_KEYFRAME_MAGIC 0x4253564B
+#define BSV_INDEX_MAGIC    0x42535649
+
+#define BSV1_HEADER_SIZE   (4 * sizeof(uint32_t))
+#define BSV2_HEADER_SIZE   (8 * sizeof(uint32_t))
+
+static bool bsv_movie_read_index(bsv_movie_t *handle, int64_t offset)
+{
+   uint32_t header[2];
+   uint32_t i, count;
+
+   if (     intfstream_seek(handle->file, offset, SEEK_SET) < 0
+         || intfstream_read(handle->file, header,
+            sizeof(header)) != sizeof(header)
+         || swap_if_little32(header[0]) != BSV_INDEX_MAGIC)
+      return false;
+
+   count = swap_if_big32(header[1]);
+   if (!(handle->keyframes = (struct bsv_keyframe*)
+            calloc(count + 1, sizeof(*handle->keyframes))))
+      return false;
+
+   for (i = 0; i < count; i++)
+   {
+      uint32_t entry[4];
+      if (intfstream_read(handle->file, entry,
+               sizeof(entry)) != sizeof(entry))
+         break;
+      handle->keyframes[i].frame  = swap_if_big32(entry[0]);
+      handle->keyframes[i].crc    = swap_if_big32(entry[1]);
+      handle->keyframes[i].offset = swap_if_big32(entry[2])
+         | ((uint64_t)swap_if_big32(entry[3]) << 32);
+   }
+
+   handle->keyframes_count = i;
+   handle->keyframes_cap   = count + 1;
+   return true;
+}
 
 static bool bsv_movie_init_playback(
       bsv_movie_t *handle, const char *path)
 {
    uint32_t state_size       = 0;
-   uint32_t header[4]        = {0};
+   uint32_t magic            = 0;
+   uint32_t header[8]        = {0};
    intfstream_t *file        = intfstream_open_file(path,
          RETRO_VFS_FILE_ACCESS_READ,
          RETRO_VFS_FILE_ACCESS_HINT_NONE);
@@ -4500,11 +4556,42 @@ static bool bsv_movie_init_playback(
 
    handle->file              = file;
    handle->playback          = true;
+   handle->header_size       = BSV1_HEADER_SIZE;
+
+   intfstream_read(handle->file, header, BSV1_HEADER_SIZE);
+   magic                     = swap_if_little32(header[MAGIC_INDEX]);
+
+   if (magic == BSV2_MAGIC)
+   {
+      uint64_t index_offset;
+
+      handle->header_size    = BSV2_HEADER_SIZE;
+      if (intfstream_read(handle->file, header + 4,
+               BSV2_HEADER_SIZE - BSV1_HEADER_SIZE)
+            != BSV2_HEADER_SIZE - BSV1_HEADER_SIZE)
+      {
+         RARCH_ERR("%s\n", msg_hash_to_str(MSG_MOVIE_FILE_IS_NOT_A_VALID_BSV1_FILE));
+         return false;
+      }
+
+      handle->keyframe_interval = swap_if_big32(header[KEY_INTERVAL_INDEX]);
+      index_offset              = swap_if_big32(header[INDEX_OFFSET_INDEX])
+         | ((uint64_t)swap_if_big32(header[INDEX_OFFSET_INDEX + 1]) << 32);
 
-   intfstream_read(handle->file, header, sizeof(uint32_t) * 4);
+      /* Without an index (the recording was cut short), the
+       * movie still plays, but cannot seek */
+      if (index_offset)
+      {
+         if (bsv_movie_read_index(handle, (int64_t)index_offset))
+            handle->end_pos = (int64_t)index_offset;
+         else
+            RARCH_WARN("[BSV]: Movie index is damaged, seeking is disabled.\n");
+         intfstream_seek(handle->file, BSV2_HEADER_SIZE, SEEK_SET);
+      }
+   }
    /* Compatibility with old implementation that
     * used incorrect documentation. */
-   if (swap_if_little32(header[MAGIC_INDEX]) != BSV_MAGIC
+   else if (magic != BSV_MAGIC
          && swap_if_big32(header[MAGIC_INDEX]) != BSV_MAGIC)
    {
       RARCH_ERR("%s\n", msg_hash_to_str(MSG_MOVIE_FILE_IS_NOT_A_VALID_BSV1_FILE));
@@ -4551,7 +4638,7 @@ static bool bsv_movie_init_playback(
                msg_hash_to_str(MSG_MOVIE_FORMAT_DIFFERENT_SERIALIZER_VERSION));
    }
 
-   handle->min_file_pos = sizeof(header) + state_size;
+   handle->min_file_pos = handle->header_size + state_size;
 
    return true;
 }
@@ -4562,7 +4649,8 @@ static bool bsv_movie_init_record(
    retro_ctx_size_info_t info;
    uint32_t state_size       = 0;
    uint32_t content_crc      = 0;
-   uint32_t header[4]        = {0};
+   uint32_t header[8]        = {0};
+   settings_t *settings      = config_get_ptr();
    intfstream_t *file        = intfstream_open_file(path,
          RETRO_VFS_FILE_ACCESS_WRITE,
          RETRO_VFS_FILE_ACCESS_HINT_NONE);
@@ -4573,14 +4661,19 @@ static bool bsv_movie_init_record(
       return false;
    }
 
-   handle->file             = file;
+   handle->file              = file;
+   handle->keyframe_interval = settings->uints.replay_keyframe_interval;
+   handle->header_size       = handle->keyframe_interval
+      ? BSV2_HEADER_SIZE : BSV1_HEADER_SIZE;
 
    content_crc              = content_get_crc();
 
    /* This value is supposed to show up as
     * BSV1 in a HEX editor, big-endian. */
-   header[MAGIC_INDEX]      = swap_if_little32(BSV_MAGIC);
+   header[MAGIC_INDEX]      = swap_if_little32(handle->keyframe_interval
+         ? BSV2_MAGIC : BSV_MAGIC);
    header[CRC_INDEX]        = swap_if_big32(content_crc);
+   header[KEY_INTERVAL_INDEX] = swap_if_big32(handle->keyframe_interval);
 
    core_serialize_size(&info);
 
@@ -4588,9 +4681,9 @@ static bool bsv_movie_init_record(
 
    header[STATE_SIZE_INDEX] = swap_if_big32(state_size);
 
-   intfstream_write(handle->file, header, 4 * sizeof(uint32_t));
+   intfstream_write(handle->file, header, handle->header_size);
 
-   handle->min_file_pos     = sizeof(header) + state_size;
+   handle->min_file_pos     = handle->header_size + state_size;
    handle->state_size       = state_size;
 
    if (state_size)
@@ -4615,13 +4708,232 @@ static bool bsv_movie_init_record(
    return true;
 }
 
+static const struct trans_stream_backend *bsv_movie_key_backend(
+      bsv_movie_t *handle)
+{
+   return handle->playback
+      ? trans_stream_get_lz4_decompress_backend()
+      : trans_stream_get_lz4_compress_backend();
+}
+
+static bool bsv_movie_key_buffers(bsv_movie_t *handle, size_t state_size)
+{
+   /* LZ4 worst case, plus block headers */
+   size_t packed_size = state_size + state_size / 255
+      + (state_size / (256 * 1024) + 2) * 32;
+
+   if (!handle->key_stream && !(handle->key_stream =
+            bsv_movie_key_backend(handle)->stream_new()))
+      return false;
+
+   if (state_size > handle->key_state_size)
+   {
+      uint8_t *buf = (uint8_t*)realloc(handle->key_state, state_size);
+      if (!buf)
+         return false;
+      handle->key_state      = buf;
+      handle->key_state_size = state_size;
+   }
+
+   if (packed_size > handle->key_packed_size)
+   {
+      uint8_t *buf = (uint8_t*)realloc(handle->key_packed, packed_size);
+      if (!buf)
+         return false;
+      handle->key_packed      = buf;
+      handle->key_packed_size = packed_size;
+   }
+
+   return true;
+}
+
+static void bsv_movie_write_keyframe(bsv_movie_t *handle)
+{
+   retro_ctx_size_info_t info;
+   retro_ctx_serialize_info_t serial_info;
+   uint32_t header[5];
+   uint32_t rd                                = 0;
+   uint32_t wn                                = 0;
+   uint32_t crc                               = 0;
+   int64_t offset                             = intfstream_tell(handle->file);
+   const struct trans_stream_backend *backend = bsv_movie_key_backend(handle);
+
+   core_serialize_size(&info);
+   serial_info.data = NULL;
+   serial_info.size = info.size;
+
+   if (     info.size
+         && bsv_movie_key_buffers(handle, info.size))
+   {
+      serial_info.data = handle->key_state;
+      if (core_serialize(&serial_info))
+      {
+         backend->set_in(handle->key_stream,
+               handle->key_state, (uint32_t)info.size);
+         backend->set_out(handle->key_stream,
+               handle->key_packed, (uint32_t)handle->key_packed_size);
+         if (     !backend->trans(handle->key_stream, true, &rd, &wn, NULL)
+               || rd != info.size)
+            wn = 0;
+      }
+   }
+
+   /* Playback expects a keyframe here either way */
+   if (!wn)
+   {
+      RARCH_WARN("[BSV]: Failed to store keyframe %u.\n",
+            handle->frame_count);
+      info.size = 0;
+   }
+   else
+      crc = encoding_crc32(0, handle->key_state, info.size);
+
+   header[0] = swap_if_little32(BSV_KEYFRAME_MAGIC);
+   header[1] = swap_if_big32(handle->frame_count);
+   header[2] = swap_if_big32((uint32_t)info.size);
+   header[3] = swap_if_big32(wn);
+   header[4] = swap_if_big32(crc);
+   intfstream_write(handle->file, header, sizeof(header));
+   if (wn)
+      intfstream_write(handle->file, handle->key_packed, wn);
+
+   /* Rewinding may have gone back past the last keyframes */
+   while (     handle->keyframes_count
+         && handle->keyframes[handle->keyframes_count - 1].frame
+            >= handle->frame_count)
+      handle->keyframes_count--;
+
+   if (!wn)
+      return;
+
+   if (handle->keyframes_count == handle->keyframes_cap)
+   {
+      size_t cap = handle->keyframes_cap ? handle->keyframes_cap * 2 : 64;
+      struct bsv_keyframe *keyframes = (struct bsv_keyframe*)
+         realloc(handle->keyframes, cap * sizeof(*keyframes));
+      if (!keyframes)
+         return;
+      handle->keyframes     = keyframes;
+      handle->keyframes_cap = cap;
+   }
+
+   handle->keyframes[handle->keyframes_count].offset = (uint64_t)offset;
+   handle->keyframes[handle->keyframes_count].frame  = handle->frame_count;
+   handle->keyframes[handle->keyframes_count].crc    = crc;
+   handle->keyframes_count++;
+}
+
+/* Reads and checks the header of the keyframe
+ * at the current position */
+static bool bsv_movie_read_keyframe_header(bsv_movie_t *handle,
+      uint32_t frame, uint32_t *state_size, uint32_t *packed_size,
+      uint32_t *crc)
+{
+   uint32_t header[5];
+
+   if (     intfstream_read(handle->file, header,
+            sizeof(header)) != sizeof(header)
+         || swap_if_little32(header[0]) != BSV_KEYFRAME_MAGIC
+         || swap_if_big32(header[1])    != frame)
+   {
+      RARCH_ERR("[BSV]: Keyframe %u is missing, movie is damaged.\n",
+            frame);
+      return false;
+   }
+
+   *state_size  = swap_if_big32(header[2]);
+   *packed_size = swap_if_big32(header[3]);
+   *crc         = swap_if_big32(header[4]);
+   return true;
+}
+
+/* Checks the core state against the keyframe about to be
+ * skipped, to find out whether the replay still matches the
+ * recording, e.g. with a newer build of the core */
+static void bsv_movie_verify_keyframe(bsv_movie_t *handle,
+      uint32_t state_size, uint32_t crc)
+{
+   retro_ctx_size_info_t info;
+   bool match = false;
+
+   core_serialize_size(&info);
+   if (     info.size == state_size
+         && bsv_movie_key_buffers(handle, state_size))
+   {
+      retro_ctx_serialize_info_t serial_info;
+      serial_info.data = handle->key_state;
+      serial_info.size = state_size;
+      match            = core_serialize(&serial_info)
+         && encoding_crc32(0, handle->key_state, state_size) == crc;
+   }
+
+   if (match)
+   {
+      handle->keyframes_matched++;
+      RARCH_LOG("[BSV]: Keyframe %u matches.\n", handle->frame_count);
+   }
+   else if (!handle->keyframes_differed++)
+      RARCH_ERR("[BSV]: Keyframe %u differs, replay diverged after frame %u.\n",
+            handle->frame_count,
+            handle->frame_count - handle->keyframe_interval);
+   else
+      RARCH_ERR("[BSV]: Keyframe %u differs.\n", handle->frame_count);
+}
+
 static void bsv_movie_free(bsv_movie_t *handle)
 {
+   if (handle->keyframes_matched || handle->keyframes_differed)
+      RARCH_LOG("[BSV]: %u keyframes matched, %u differed.\n",
+            handle->keyframes_matched, handle->keyframes_differed);
+
+   /* Finish the recording with the keyframe index */
+   if (     handle->file
+         && !handle->playback
+         && handle->keyframe_interval)
+   {
+      size_t i;
+      uint32_t header[4];
+      int64_t offset = intfstream_tell(handle->file);
+
+      /* Rewinding since the last keyframe may have ended the movie
+       * before it, the index must only point at frames that exist */
+      while (     handle->keyframes_count
+            && handle->keyframes[handle->keyframes_count - 1].frame
+               >= handle->frame_count)
+         handle->keyframes_count--;
+
+      header[0] = swap_if_little32(BSV_INDEX_MAGIC);
+      header[1] = swap_if_big32((uint32_t)handle->keyframes_count);
+      intfstream_write(handle->file, header, 2 * sizeof(uint32_t));
+
+      for (i = 0; i < handle->keyframes_count; i++)
+      {
+         header[0] = swap_if_big32(handle->keyframes[i].frame);
+         header[1] = swap_if_big32(handle->keyframes[i].crc);
+         header[2] = swap_if_big32((uint32_t)handle->keyframes[i].offset);
+         header[3] = swap_if_big32((uint32_t)(handle->keyframes[i].offset >> 32));
+         intfstream_write(handle->file, header, sizeof(header));
+      }
+
+      header[0] = swap_if_big32(handle->frame_count);
+      header[1] = swap_if_big32((uint32_t)offset);
+      header[2] = swap_if_big32((uint32_t)((uint64_t)offset >> 32));
+      intfstream_seek(handle->file,
+            FRAME_COUNT_INDEX * sizeof(uint32_t), SEEK_SET);
+      intfstream_write(handle->file, header, 3 * sizeof(uint32_t));
+   }
+
    intfstream_close(handle->file);
    free(handle->file);
 
+   if (handle->key_stream)
+      bsv_movie_key_backend(handle)->stream_free(handle->key_stream);
+
    free(handle->state);
    free(handle->frame_pos);
+   free(handle->keyframes);
+   free(handle->key_state);
+   free(handle->key_packed);
    free(handle);
 }
 
@@ -4716,19 +5028,23 @@ void bsv_movie_frame_rewind(void)
          && (handle->frame_pos[0] == handle->min_file_pos))
    {
       /* If we're at the beginning... */
-      handle->frame_ptr = 0;
+      handle->frame_ptr   = 0;
+      handle->frame_count = handle->first_frame;
       intfstream_seek(handle->file, (int)handle->min_file_pos, SEEK_SET);
    }
    else
    {
+      unsigned frames = handle->first_rewind ? 1 : 2;
+
       /* First time rewind is performed, the old frame is simply replayed.
        * However, playing back that frame caused us to read data, and push
        * data to the ring buffer.
        *
        * Sucessively rewinding frames, we need to rewind past the read data,
        * plus another. */
-      handle->frame_ptr = (handle->frame_ptr -
-            (handle->first_rewind ? 1 : 2)) & handle->frame_mask;
+      handle->frame_ptr = (handle->frame_ptr - frames) & handle->frame_mask;
+      handle->frame_count = (handle->frame_count > handle->first_frame + frames)
+         ? handle->frame_count - frames : handle->first_frame;
       intfstream_seek(handle->file,
             (int)handle->frame_pos[handle->frame_ptr], SEEK_SET);
    }
@@ -4736,6 +5052,7 @@ void bsv_movie_frame_rewind(void)
    if (intfstream_tell(handle->file) <= (long)handle->min_file_pos)
    {
       /* We rewound past the beginning. */
+      handle->frame_count = handle->first_frame;
 
       if (!handle->playback)
       {
@@ -4744,7 +5061,7 @@ void bsv_movie_frame_rewind(void)
          /* If recording, we simply reset
           * the starting point. Nice and easy. */
 
-         intfstream_seek(handle->file, 4 * sizeof(uint32_t), SEEK_SET);
+         intfstream_seek(handle->file, handle->header_size, SEEK_SET);
 
          serial_info.data = handle->state;
          serial_info.size = handle->state_size;
@@ -4758,6 +5075,153 @@ void bsv_movie_frame_rewind(void)
    }
 }
 
+void bsv_movie_frame_start(input_driver_state_t *input_st)
+{
+   bsv_movie_t *handle = input_st->bsv_movie_state_handle;
+   int64_t pos;
+
+   if (!handle)
+      return;
+
+   /* Used for rewinding while playback/record. */
+   pos = intfstream_tell(handle->file);
+   handle->frame_pos[handle->frame_ptr] = (size_t)pos;
+
+   if (handle->playback)
+   {
+      uint32_t state_size, packed_size, crc;
+
+      /* Don't read the index as input */
+      if (handle->end_pos && pos >= handle->end_pos)
+      {
+         input_st->bsv_movie_state.movie_end = true;
+         return;
+      }
+
+      if (     !handle->keyframe_interval
+            || !handle->frame_count
+            || handle->frame_count % handle->keyframe_interval)
+         return;
+
+      if (!bsv_movie_read_keyframe_header(handle, handle->frame_count,
+               &state_size, &packed_size, &crc))
+      {
+         input_st->bsv_movie_state.movie_end = true;
+         return;
+      }
+
+      /* After a seek the core was just restored from this very
+       * keyframe, comparing against it would always match */
+      if (     input_st->bsv_movie_state.movie_verify
+            && state_size
+            && handle->frame_count != handle->first_frame)
+         bsv_movie_verify_keyframe(handle, state_size, crc);
+
+      /* The state itself is only needed when seeking */
+      if (intfstream_seek(handle->file, packed_size, SEEK_CUR) < 0)
+         input_st->bsv_movie_state.movie_end = true;
+   }
+   else if (handle->keyframe_interval
+         && handle->frame_count
+         && !(handle->frame_count % handle->keyframe_interval))
+      bsv_movie_write_keyframe(handle);
+}
+
+bool bsv_movie_seek(input_driver_state_t *input_st, uint32_t frame)
+{
+   retro_ctx_serialize_info_t serial_info;
+   size_t i;
+   int64_t pos, old_pos;
+   uint32_t key_frame                         = 0;
+   const struct trans_stream_backend *backend = NULL;
+   bsv_movie_t *handle                        = input_st->bsv_movie_state_handle;
+
+   if (!handle || !handle->playback)
+      return false;
+
+   /* Without the index, frame 0 is the only place to start from.
+    * Leave the movie where it is rather than pretend. */
+   if (!handle->keyframe_interval || !handle->keyframes_count)
+   {
+      RARCH_ERR("[BSV]: Movie has no keyframe index, cannot seek.\n");
+      return false;
+   }
+
+   old_pos = intfstream_tell(handle->file);
+
+   for (i = handle->keyframes_count; i > 0; i--)
+      if (handle->keyframes[i - 1].frame <= frame)
+         break;
+
+   if (i)
+   {
+      uint32_t state_size, packed_size, crc;
+      uint32_t rd                    = 0;
+      uint32_t wn                    = 0;
+      const struct bsv_keyframe *key = &handle->keyframes[i - 1];
+
+      backend   = bsv_movie_key_backend(handle);
+      key_frame = key->frame;
+      pos       = (int64_t)key->offset;
+
+      if (     intfstream_seek(handle->file, pos, SEEK_SET) < 0
+            || !bsv_movie_read_keyframe_header(handle, key_frame,
+               &state_size, &packed_size, &crc)
+            || !state_size
+            || !bsv_movie_key_buffers(handle, state_size)
+            || packed_size > handle->key_packed_size
+            || intfstream_read(handle->file, handle->key_packed,
+               packed_size) != packed_size)
+         goto error;
+
+      backend->set_in(handle->key_stream, handle->key_packed, packed_size);
+      backend->set_out(handle->key_stream, handle->key_state, state_size);
+      if (     !backend->trans(handle->key_stream, true, &rd, &wn, NULL)
+            || wn != state_size
+            || encoding_crc32(0, handle->key_state, state_size) != crc)
+      {
+         RARCH_ERR("[BSV]: Keyframe %u is damaged.\n", key_frame);
+         goto error;
+      }
+
+      serial_info.data_const = handle->key_state;
+      serial_info.size       = state_size;
+   }
+   else
+   {
+      /* Before the first keyframe, start over */
+      pos                    = (int64_t)(handle->header_size
+            + handle->state_size);
+      serial_info.data_const = handle->state;
+      serial_info.size       = handle->state_size;
+   }
+
+   if (serial_info.size && !core_unserialize(&serial_info))
+      goto error;
+
+   /* The keyframe is skipped again by bsv_movie_frame_start,
+    * and rewinding stops here */
+   intfstream_seek(handle->file, pos, SEEK_SET);
+   handle->min_file_pos                = (size_t)pos;
+   handle->frame_count                 = key_frame;
+   handle->first_frame                 = key_frame;
+   handle->frame_ptr                   = 0;
+   handle->frame_pos[0]                = (size_t)pos;
+   input_st->bsv_movie_state.movie_end = false;
+
+   /* States saved before the seek are useless now */
+   command_event(CMD_EVENT_REWIND_DEINIT, NULL);
+   command_event(CMD_EVENT_REWIND_INIT, NULL);
+
+   RARCH_LOG("[BSV]: Seeked to frame %u.\n", key_frame);
+   return true;
+
+error:
+   /* Playback carries on from where it was */
+   intfstream_seek(handle->file, old_pos, SEEK_SET);
+   return false;
+}
+
 bool bsv_movie_init(input_driver_state_t *input_st)
 {
    bsv_movie_t *state = NULL;
@@ -4776,6 +5240,12 @@ bool bsv_movie_init(input_driver_state_t *input_st)
 
       input_st->bsv_movie_state_handle         = state;
       input_st->bsv_movie_state.movie_playback = true;
+      input_st->bsv_movie_state.movie_end      = false;
+
+      if (     input_st->bsv_movie_state.movie_start_frame
+            && !bsv_movie_seek(input_st,
+               input_st->bsv_movie_state.movie_start_frame))
+         RARCH_WARN("[BSV]: Cannot seek, playing from the start.\n");
       starting_movie_str                       =
          msg_hash_to_str(MSG_STARTING_MOVIE_PLAYBACK);
 
@@ -5062,16 +5532,8 @@ int16_t input_state_internal(unsigned port, unsigned device,
          result |= port_result;
    }
 
-#ifdef HAVE_BSV_MOVIE
-   /* Save input to BSV record, if enabled */
-   if (BSV_MOVIE_IS_PLAYBACK_OFF())
-   {
-      result = swap_if_big16(result);
-      intfstream_write(
-            input_st->bsv_movie_state_handle->file, &result, 2);
-   }
-#endif
-
+   /* Recorded to BSV movies by input_driver_state_wrapper(),
+    * which is also the only place that plays them back */
    return result;
 }
 
@@ -5083,7 +5545,8 @@ int16_t input_driver_state_wrapper(unsigned port, unsigned device,
    int16_t result              = 0;
 #ifdef HAVE_BSV_MOVIE
    /* Load input from BSV record, if enabled */
-   if (BSV_MOVIE_IS_PLAYBACK_ON())
+   if (     BSV_MOVIE_IS_PLAYBACK_ON()
+         && !input_st->bsv_movie_state.movie_end)
    {
       int16_t bsv_result = 0;
       if (intfstream_read(
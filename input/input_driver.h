@@ -1044,6 +1044,26 @@ void bsv_movie_deinit(input_driver_state_t *input_st);
 
 bool bsv_movie_check(input_driver_state_t *input_st,
       settings_t *settings);
+
+/**
+ * bsv_movie_frame_start:
+ *
+ * Called before running each frame of a movie. Writes or skips
+ * the keyframe due at this frame, and detects the end of playback.
+ **/
+void bsv_movie_frame_start(input_driver_state_t *input_st);
+
+/**
+ * bsv_movie_seek:
+ * @frame : Frame to seek to.
+ *
+ * Continues playback from the last keyframe at or before @frame.
+ *
+ * Returns: true if the movie has a keyframe index and the
+ * keyframe state could be loaded, otherwise false, in which
+ * case playback is unchanged.
+ **/
+bool bsv_movie_seek(input_driver_state_t *input_st, uint32_t frame);
 #endif
 
 /**
@@ -2042,6 +2042,14 @@ MSG_HASH(
    MENU_ENUM_LABEL_NETPLAY_INPUT_LATENCY_FRAMES_RANGE,
    "netplay_input_latency_frames_range"
    )
+MSG_HASH(
+   MENU_ENUM_LABEL_NETPLAY_REPLAY_MAX_FRAMES,
+   "netplay_replay_max_frames"
+   )
+MSG_HASH(
+   MENU_ENUM_LABEL_NETPLAY_UDP_INPUT_FRAMES,
+   "netplay_udp_input_frames"
+   )
 MSG_HASH(
    MENU_ENUM_LABEL_NETPLAY_DISCONNECT,
    "menu_netplay_disconnect"
@@ -3038,6 +3046,14 @@ MSG_HASH(
    MENU_ENUM_LABEL_SAVESTATE_FILE_COMPRESSION,
    "savestate_file_compression"
    )
+MSG_HASH(
+   MENU_ENUM_LABEL_SAVESTATE_FILE_COMPRESSION_LZ4,
+   "savestate_file_compression_lz4"
+   )
+MSG_HASH(
+   MENU_ENUM_LABEL_REPLAY_KEYFRAME_INTERVAL,
+   "replay_keyframe_interval"
+   )
 MSG_HASH(
    MENU_ENUM_LABEL_SAVESTATE_AUTO_SAVE,
    "savestate_auto_save"
@@ -3627,6 +3627,22 @@ MSG_HASH(
    MENU_ENUM_SUBLABEL_SAVESTATE_FILE_COMPRESSION,
    "Write save state files in an archived format. Dramatically reduces file size at the expense of increased saving/loading times."
    )
+MSG_HASH(
+   MENU_ENUM_LABEL_VALUE_SAVESTATE_FILE_COMPRESSION_LZ4,
+   "Fast Save State Compression"
+   )
+MSG_HASH(
+   MENU_ENUM_SUBLABEL_SAVESTATE_FILE_COMPRESSION_LZ4,
+   "Compress save state files with LZ4 instead of zlib. Saving and loading are several times faster, but files are larger and cannot be loaded by older versions of RetroArch."
+   )
+MSG_HASH(
+   MENU_ENUM_LABEL_VALUE_REPLAY_KEYFRAME_INTERVAL,
+   "Input Replay Keyframe Interval"
+   )
+MSG_HASH(
+   MENU_ENUM_SUBLABEL_REPLAY_KEYFRAME_INTERVAL,
+   "Store a save state in recorded input replays every this many frames, so playback can jump ahead instead of running the whole replay. 0 records replays that older versions can play."
+   )
 MSG_HASH(
    MENU_ENUM_LABEL_VALUE_SORT_SCREENSHOTS_BY_CONTENT_ENABLE,
    "Sort Screenshots into Folders by Content Directory"
@@ -5818,6 +5834,22 @@ MSG_HASH(
    MENU_ENUM_SUBLABEL_NETPLAY_INPUT_LATENCY_FRAMES_RANGE,
    "The range of frames of input latency that may be used to hide network latency. Reduces jitter and makes netplay less CPU-intensive, at the expense of unpredictable input lag."
    )
+MSG_HASH(
+   MENU_ENUM_LABEL_VALUE_NETPLAY_REPLAY_MAX_FRAMES,
+   "Max Rollback Frames Per Frame"
+   )
+MSG_HASH(
+   MENU_ENUM_SUBLABEL_NETPLAY_REPLAY_MAX_FRAMES,
+   "The most frames a rollback may replay within a single frame. Deeper rollbacks are caught up over the following frames instead of slowing the game down. 0 means no limit."
+   )
+MSG_HASH(
+   MENU_ENUM_LABEL_VALUE_NETPLAY_UDP_INPUT_FRAMES,
+   "UDP Input Redundancy"
+   )
+MSG_HASH(
+   MENU_ENUM_SUBLABEL_NETPLAY_UDP_INPUT_FRAMES,
+   "Also send input over UDP, repeating this many past frames in every packet, so a lost packet does not stall the game. Input still goes over TCP as a fallback. Not used with relay servers. 0 disables it."
+   )
 MSG_HASH(
    MENU_ENUM_LABEL_VALUE_NETPLAY_NAT_TRAVERSAL,
    "Netplay NAT Traversal"
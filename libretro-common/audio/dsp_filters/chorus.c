@@ -24,6 +24,14 @@
 #include <stdlib.h>
 #include <string.h>
 
+#if defined(__SSE__)
+#include <xmmintrin.h>
+#endif
+
+#if (defined(__ARM_NEON__) || defined(HAVE_NEON))
+#include <arm_neon.h>
+#endif
+
 #include <retro_miscellaneous.h>
 #include <libretro_dspfilter.h>
 
@@ -32,7 +40,9 @@
 
 struct chorus_data
 {
-   float old[2][CHORUS_MAX_DELAY];
+   /* Interleaved stereo history, so both channels of a tap
+    * can be fetched with a single load. */
+   float old[CHORUS_MAX_DELAY][2];
    unsigned old_ptr;
 
    float delay;
@@ -80,13 +90,13 @@ static void chorus_process(void *data, struct dspfilter_output *output,
 
       delay_frac = delay - delay_int;
 
-      ch->old[0][ch->old_ptr] = in[0];
-      ch->old[1][ch->old_ptr] = in[1];
+      ch->old[ch->old_ptr][0] = in[0];
+      ch->old[ch->old_ptr][1] = in[1];
 
-      l_a         = ch->old[0][(ch->old_ptr - delay_int - 0) & CHORUS_DELAY_MASK];
-      l_b         = ch->old[0][(ch->old_ptr - delay_int - 1) & CHORUS_DELAY_MASK];
-      r_a         = ch->old[1][(ch->old_ptr - delay_int - 0) & CHORUS_DELAY_MASK];
-      r_b         = ch->old[1][(ch->old_ptr - delay_int - 1) & CHORUS_DELAY_MASK];
+      l_a         = ch->old[(ch->old_ptr - delay_int - 0) & CHORUS_DELAY_MASK][0];
+      l_b         = ch->old[(ch->old_ptr - delay_int - 1) & CHORUS_DELAY_MASK][0];
+      r_a         = ch->old[(ch->old_ptr - delay_int - 0) & CHORUS_DELAY_MASK][1];
+      r_b         = ch->old[(ch->old_ptr - delay_int - 1) & CHORUS_DELAY_MASK][1];
 
       /* Lerp introduces aliasing of the chorus component,
        * but doing full polyphase here is probably overkill. */
@@ -100,6 +110,144 @@ static void chorus_process(void *data, struct dspfilter_output *output,
    }
 }
 
+#if defined(__SSE__) || defined(__ARM_NEON__) || defined(HAVE_NEON)
+/* Tracks sin(2 * pi * lfo_ptr / lfo_period) with a rotating phasor
+ * so the SIMD paths don't pay for a sin() per frame. The phasor is
+ * re-seeded on every call and on every period wrap, which keeps the
+ * accumulated rounding error negligible. */
+struct chorus_lfo
+{
+   float s, c;
+   float step_s, step_c;
+};
+
+static void chorus_lfo_seed(struct chorus_lfo *lfo,
+      const struct chorus_data *ch)
+{
+   double omega = (2.0 * M_PI) / ch->lfo_period;
+   lfo->s       = (float)sin(omega * ch->lfo_ptr);
+   lfo->c       = (float)cos(omega * ch->lfo_ptr);
+   lfo->step_s  = (float)sin(omega);
+   lfo->step_c  = (float)cos(omega);
+}
+
+static float chorus_lfo_next(struct chorus_lfo *lfo,
+      struct chorus_data *ch)
+{
+   float ret = lfo->s;
+
+   if (++ch->lfo_ptr >= ch->lfo_period)
+   {
+      ch->lfo_ptr = 0;
+      lfo->s      = 0.0f;
+      lfo->c      = 1.0f;
+   }
+   else
+   {
+      float s     = lfo->s * lfo->step_c + lfo->c * lfo->step_s;
+      lfo->c      = lfo->c * lfo->step_c - lfo->s * lfo->step_s;
+      lfo->s      = s;
+   }
+
+   return ret;
+}
+
+static unsigned chorus_delay_taps(struct chorus_data *ch,
+      struct chorus_lfo *lfo, float *delay_frac)
+{
+   unsigned delay_int;
+   float delay = (ch->delay + ch->depth * chorus_lfo_next(lfo, ch))
+      * ch->input_rate;
+
+   delay_int   = (unsigned)delay;
+   if (delay_int >= CHORUS_MAX_DELAY - 1)
+      delay_int = CHORUS_MAX_DELAY - 2;
+
+   *delay_frac = delay - delay_int;
+   return delay_int;
+}
+#endif
+
+#if defined(__SSE__)
+static void chorus_process_sse(void *data, struct dspfilter_output *output,
+      const struct dspfilter_input *input)
+{
+   unsigned i;
+   struct chorus_lfo lfo;
+   struct chorus_data *ch = (struct chorus_data*)data;
+   float *out             = input->samples;
+   __m128 dry             = _mm_set1_ps(ch->mix_dry);
+   __m128 wet             = _mm_set1_ps(ch->mix_wet);
+
+   output->samples        = input->samples;
+   output->frames         = input->frames;
+
+   chorus_lfo_seed(&lfo, ch);
+
+   for (i = 0; i < input->frames; i++, out += 2)
+   {
+      float delay_frac;
+      __m128 in, a, b, chorus;
+      unsigned delay_int = chorus_delay_taps(ch, &lfo, &delay_frac);
+
+      ch->old[ch->old_ptr][0] = out[0];
+      ch->old[ch->old_ptr][1] = out[1];
+
+      in     = _mm_loadl_pi(_mm_setzero_ps(), (const __m64*)out);
+      a      = _mm_loadl_pi(_mm_setzero_ps(), (const __m64*)
+            ch->old[(ch->old_ptr - delay_int - 0) & CHORUS_DELAY_MASK]);
+      b      = _mm_loadl_pi(_mm_setzero_ps(), (const __m64*)
+            ch->old[(ch->old_ptr - delay_int - 1) & CHORUS_DELAY_MASK]);
+
+      chorus = _mm_add_ps(
+            _mm_mul_ps(a, _mm_set1_ps(1.0f - delay_frac)),
+            _mm_mul_ps(b, _mm_set1_ps(delay_frac)));
+
+      _mm_storel_pi((__m64*)out, _mm_add_ps(
+               _mm_mul_ps(dry, in), _mm_mul_ps(wet, chorus)));
+
+      ch->old_ptr = (ch->old_ptr + 1) & CHORUS_DELAY_MASK;
+   }
+}
+#endif
+
+#if (defined(__ARM_NEON__) || defined(HAVE_NEON))
+static void chorus_process_neon(void *data, struct dspfilter_output *output,
+      const struct dspfilter_input *input)
+{
+   unsigned i;
+   struct chorus_lfo lfo;
+   struct chorus_data *ch = (struct chorus_data*)data;
+   float *out             = input->samples;
+
+   output->samples        = input->samples;
+   output->frames         = input->frames;
+
+   chorus_lfo_seed(&lfo, ch);
+
+   for (i = 0; i < input->frames; i++, out += 2)
+   {
+      float delay_frac;
+      float32x2_t in, a, b, chorus;
+      unsigned delay_int = chorus_delay_taps(ch, &lfo, &delay_frac);
+
+      ch->old[ch->old_ptr][0] = out[0];
+      ch->old[ch->old_ptr][1] = out[1];
+
+      in     = vld1_f32(out);
+      a      = vld1_f32(ch->old[(ch->old_ptr - delay_int - 0) & CHORUS_DELAY_MASK]);
+      b      = vld1_f32(ch->old[(ch->old_ptr - delay_int - 1) & CHORUS_DELAY_MASK]);
+
+      chorus = vmla_n_f32(vmul_n_f32(a, 1.0f - delay_frac), b, delay_frac);
+
+      vst1_f32(out, vmla_n_f32(vmul_n_f32(in, ch->mix_dry),
+               chorus, ch->mix_wet));
+
+      ch->old_ptr = (ch->old_ptr + 1) & CHORUS_DELAY_MASK;
+   }
+}
+#endif
+
 static void *chorus_init(const struct dspfilter_info *info,
       const struct dspfilter_config *config, void *userdata)
 {
@@ -146,6 +294,30 @@ static const struct dspfilter_implementation chorus_plug = {
    "chorus",
 };
 
+#if defined(__SSE__)
+static const struct dspfilter_implementation chorus_plug_sse = {
+   chorus_init,
+   chorus_process_sse,
+   chorus_free,
+
+   DSPFILTER_API_VERSION,
+   "Chorus",
+   "chorus",
+};
+#endif
+
+#if (defined(__ARM_NEON__) || defined(HAVE_NEON))
+static const struct dspfilter_implementation chorus_plug_neon = {
+   chorus_init,
+   chorus_process_neon,
+   chorus_free,
+
+   DSPFILTER_API_VERSION,
+   "Chorus",
+   "chorus",
+};
+#endif
+
 #ifdef HAVE_FILTERS_BUILTIN
 #define dspfilter_get_implementation chorus_dspfilter_get_implementation
 #endif
@@ -153,6 +325,14 @@ static const struct dspfilter_implementation chorus_plug = {
 const struct dspfilter_implementation *
 dspfilter_get_implementation(dspfilter_simd_mask_t mask)
 {
+#if defined(__SSE__)
+   if (mask & DSPFILTER_SIMD_SSE)
+      return &chorus_plug_sse;
+#endif
+#if (defined(__ARM_NEON__) || defined(HAVE_NEON))
+   if (mask & DSPFILTER_SIMD_NEON)
+      return &chorus_plug_neon;
+#endif
    (void)mask;
    return &chorus_plug;
 }
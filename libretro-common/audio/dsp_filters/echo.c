@@ -22,6 +22,14 @@
 
 #include <stdlib.h>
 
+#if defined(__SSE__)
+#include <xmmintrin.h>
+#endif
+
+#if (defined(__ARM_NEON__) || defined(HAVE_NEON))
+#include <arm_neon.h>
+#endif
+
 #include <retro_miscellaneous.h>
 #include <libretro_dspfilter.h>
 
@@ -51,51 +59,187 @@ static void echo_free(void *data)
    free(echo);
 }
 
+/* Number of frames that can be processed before any delay line
+ * wraps around. A run never exceeds the length of a delay line, so
+ * no sample read inside the run was written inside it and the
+ * frames of a run can be processed in parallel. */
+static unsigned echo_run_length(const struct echo_data *echo,
+      unsigned frames)
+{
+   unsigned c;
+   for (c = 0; c < echo->num_channels; c++)
+   {
+      unsigned avail = echo->channels[c].frames - echo->channels[c].ptr;
+      if (avail < frames)
+         frames = avail;
+   }
+   return frames;
+}
+
+static void echo_advance(struct echo_data *echo, unsigned frames)
+{
+   unsigned c;
+   for (c = 0; c < echo->num_channels; c++)
+   {
+      echo->channels[c].ptr += frames;
+      if (echo->channels[c].ptr >= echo->channels[c].frames)
+         echo->channels[c].ptr = 0;
+   }
+}
+
+/* Processes a single stereo frame at offset 'i' of the current run. */
+static void echo_process_frame(struct echo_data *echo,
+      float *out, unsigned i)
+{
+   unsigned c;
+   float echo_left  = 0.0f;
+   float echo_right = 0.0f;
+
+   for (c = 0; c < echo->num_channels; c++)
+   {
+      float *buf  = echo->channels[c].buffer
+         + ((echo->channels[c].ptr + i) << 1);
+      echo_left  += buf[0];
+      echo_right += buf[1];
+   }
+
+   echo_left  *= echo->amp;
+   echo_right *= echo->amp;
+
+   for (c = 0; c < echo->num_channels; c++)
+   {
+      float *buf  = echo->channels[c].buffer
+         + ((echo->channels[c].ptr + i) << 1);
+      buf[0]      = out[0] + echo->channels[c].feedback * echo_left;
+      buf[1]      = out[1] + echo->channels[c].feedback * echo_right;
+   }
+
+   out[0] += echo_left;
+   out[1] += echo_right;
+}
+
 static void echo_process(void *data, struct dspfilter_output *output,
       const struct dspfilter_input *input)
 {
-   unsigned i, c;
-   float *out             = NULL;
    struct echo_data *echo = (struct echo_data*)data;
+   float *out             = input->samples;
+   unsigned frames        = input->frames;
 
    output->samples        = input->samples;
    output->frames         = input->frames;
 
-   out                    = output->samples;
+   while (frames)
+   {
+      unsigned i;
+      unsigned run = echo_run_length(echo, frames);
+
+      for (i = 0; i < run; i++, out += 2)
+         echo_process_frame(echo, out, i);
+
+      echo_advance(echo, run);
+      frames -= run;
+   }
+}
+
+#if defined(__SSE__)
+static void echo_process_sse(void *data, struct dspfilter_output *output,
+      const struct dspfilter_input *input)
+{
+   unsigned c;
+   struct echo_data *echo = (struct echo_data*)data;
+   float *out             = input->samples;
+   unsigned frames        = input->frames;
+   __m128 amp             = _mm_set1_ps(echo->amp);
+
+   output->samples        = input->samples;
+   output->frames         = input->frames;
 
-   for (i = 0; i < input->frames; i++, out += 2)
+   while (frames)
    {
-      float left, right;
-      float echo_left  = 0.0f;
-      float echo_right = 0.0f;
+      unsigned i;
+      unsigned run = echo_run_length(echo, frames);
 
-      for (c = 0; c < echo->num_channels; c++)
+      /* Two stereo frames per vector. */
+      for (i = 0; i + 2 <= run; i += 2, out += 4)
       {
-         echo_left  += echo->channels[c].buffer[(echo->channels[c].ptr << 1) + 0];
-         echo_right += echo->channels[c].buffer[(echo->channels[c].ptr << 1) + 1];
+         __m128 in  = _mm_loadu_ps(out);
+         __m128 sum = _mm_setzero_ps();
+
+         for (c = 0; c < echo->num_channels; c++)
+            sum = _mm_add_ps(sum, _mm_loadu_ps(echo->channels[c].buffer
+                     + ((echo->channels[c].ptr + i) << 1)));
+
+         sum = _mm_mul_ps(sum, amp);
+
+         for (c = 0; c < echo->num_channels; c++)
+            _mm_storeu_ps(echo->channels[c].buffer
+                  + ((echo->channels[c].ptr + i) << 1),
+                  _mm_add_ps(in, _mm_mul_ps(
+                        _mm_set1_ps(echo->channels[c].feedback), sum)));
+
+         _mm_storeu_ps(out, _mm_add_ps(in, sum));
       }
 
-      echo_left  *= echo->amp;
-      echo_right *= echo->amp;
+      if (i < run)
+      {
+         echo_process_frame(echo, out, i);
+         out += 2;
+      }
+
+      echo_advance(echo, run);
+      frames -= run;
+   }
+}
+#endif
+
+#if (defined(__ARM_NEON__) || defined(HAVE_NEON))
+static void echo_process_neon(void *data, struct dspfilter_output *output,
+      const struct dspfilter_input *input)
+{
+   unsigned c;
+   struct echo_data *echo = (struct echo_data*)data;
+   float *out             = input->samples;
+   unsigned frames        = input->frames;
 
-      left        = out[0] + echo_left;
-      right       = out[1] + echo_right;
+   output->samples        = input->samples;
+   output->frames         = input->frames;
 
-      for (c = 0; c < echo->num_channels; c++)
+   while (frames)
+   {
+      unsigned i;
+      unsigned run = echo_run_length(echo, frames);
+
+      /* Two stereo frames per vector. */
+      for (i = 0; i + 2 <= run; i += 2, out += 4)
       {
-         float feedback_left  = out[0] + echo->channels[c].feedback * echo_left;
-         float feedback_right = out[1] + echo->channels[c].feedback * echo_right;
+         float32x4_t in  = vld1q_f32(out);
+         float32x4_t sum = vdupq_n_f32(0.0f);
+
+         for (c = 0; c < echo->num_channels; c++)
+            sum = vaddq_f32(sum, vld1q_f32(echo->channels[c].buffer
+                     + ((echo->channels[c].ptr + i) << 1)));
 
-         echo->channels[c].buffer[(echo->channels[c].ptr << 1) + 0] = feedback_left;
-         echo->channels[c].buffer[(echo->channels[c].ptr << 1) + 1] = feedback_right;
+         sum = vmulq_n_f32(sum, echo->amp);
 
-         echo->channels[c].ptr = (echo->channels[c].ptr + 1) % echo->channels[c].frames;
+         for (c = 0; c < echo->num_channels; c++)
+            vst1q_f32(echo->channels[c].buffer
+                  + ((echo->channels[c].ptr + i) << 1),
+                  vmlaq_n_f32(in, sum, echo->channels[c].feedback));
+
+         vst1q_f32(out, vaddq_f32(in, sum));
       }
 
-      out[0] = left;
-      out[1] = right;
+      if (i < run)
+      {
+         echo_process_frame(echo, out, i);
+         out += 2;
+      }
+
+      echo_advance(echo, run);
+      frames -= run;
    }
 }
+#endif
 
 static void *echo_init(const struct dspfilter_info *info,
       const struct dspfilter_config *config, void *userdata)
@@ -167,12 +311,44 @@ static const struct dspfilter_implementation echo_plug = {
    "echo",
 };
 
+#if defined(__SSE__)
+static const struct dspfilter_implementation echo_plug_sse = {
+   echo_init,
+   echo_process_sse,
+   echo_free,
+
+   DSPFILTER_API_VERSION,
+   "Multi-Echo",
+   "echo",
+};
+#endif
+
+#if (defined(__ARM_NEON__) || defined(HAVE_NEON))
+static const struct dspfilter_implementation echo_plug_neon = {
+   echo_init,
+   echo_process_neon,
+   echo_free,
+
+   DSPFILTER_API_VERSION,
+   "Multi-Echo",
+   "echo",
+};
+#endif
+
 #ifdef HAVE_FILTERS_BUILTIN
 #define dspfilter_get_implementation echo_dspfilter_get_implementation
 #endif
 
 const struct dspfilter_implementation *dspfilter_get_implementation(dspfilter_simd_mask_t mask)
 {
+#if defined(__SSE__)
+   if (mask & DSPFILTER_SIMD_SSE)
+      return &echo_plug_sse;
+#endif
+#if (defined(__ARM_NEON__) || defined(HAVE_NEON))
+   if (mask & DSPFILTER_SIMD_NEON)
+      return &echo_plug_neon;
+#endif
    (void)mask;
    return &echo_plug;
 }
@@ -24,6 +24,14 @@
 #include <stdlib.h>
 #include <string.h>
 
+#if defined(__SSE__)
+#include <xmmintrin.h>
+#endif
+
+#if (defined(__ARM_NEON__) || defined(HAVE_NEON))
+#include <arm_neon.h>
+#endif
+
 #include <retro_miscellaneous.h>
 #include <libretro_dspfilter.h>
 
@@ -37,7 +45,9 @@ struct phaser_data
    float fb;
    float depth;
    float drywet;
-   float old[2][24];
+   /* Interleaved per stage so the SIMD paths can run
+    * both channels of a stage with one operation. */
+   float old[24][2];
    float gain;
    float fbout[2];
    float lfoskip;
@@ -82,9 +92,9 @@ static void phaser_process(void *data, struct dspfilter_output *output,
       {
          for (c = 0; c < 2; c++)
          {
-            tmp[c] = ph->old[c][s];
-            ph->old[c][s] = ph->gain * tmp[c] + m[c];
-            m[c] = tmp[c] - ph->gain * ph->old[c][s];
+            tmp[c] = ph->old[s][c];
+            ph->old[s][c] = ph->gain * tmp[c] + m[c];
+            m[c] = tmp[c] - ph->gain * ph->old[s][c];
          }
       }
 
@@ -96,6 +106,100 @@ static void phaser_process(void *data, struct dspfilter_output *output,
    }
 }
 
+#if defined(__SSE__) || defined(__ARM_NEON__) || defined(HAVE_NEON)
+static void phaser_update_gain(struct phaser_data *ph)
+{
+   if ((ph->skipcount++ % phaserlfoskipsamples) == 0)
+   {
+      ph->gain = 0.5 * (1.0 + cos(ph->skipcount * ph->lfoskip + ph->phase));
+      ph->gain = (exp(ph->gain * phaserlfoshape) - 1.0) / (exp(phaserlfoshape) - 1);
+      ph->gain = 1.0 - ph->gain * ph->depth;
+   }
+}
+#endif
+
+#if defined(__SSE__)
+static void phaser_process_sse(void *data, struct dspfilter_output *output,
+      const struct dspfilter_input *input)
+{
+   unsigned i;
+   int s;
+   struct phaser_data *ph = (struct phaser_data*)data;
+   float *out             = input->samples;
+   __m128 fb              = _mm_set1_ps(ph->fb * 0.01f);
+   __m128 wet             = _mm_set1_ps(ph->drywet);
+   __m128 dry             = _mm_set1_ps(1.0f - ph->drywet);
+   __m128 fbout           = _mm_loadl_pi(_mm_setzero_ps(),
+         (const __m64*)ph->fbout);
+
+   output->samples        = input->samples;
+   output->frames         = input->frames;
+
+   for (i = 0; i < input->frames; i++, out += 2)
+   {
+      __m128 gain;
+      __m128 in = _mm_loadl_pi(_mm_setzero_ps(), (const __m64*)out);
+      __m128 m  = _mm_add_ps(in, _mm_mul_ps(fbout, fb));
+
+      phaser_update_gain(ph);
+      gain      = _mm_set1_ps(ph->gain);
+
+      for (s = 0; s < ph->stages; s++)
+      {
+         __m128 tmp = _mm_loadl_pi(_mm_setzero_ps(),
+               (const __m64*)ph->old[s]);
+         __m128 cur = _mm_add_ps(_mm_mul_ps(gain, tmp), m);
+         _mm_storel_pi((__m64*)ph->old[s], cur);
+         m          = _mm_sub_ps(tmp, _mm_mul_ps(gain, cur));
+      }
+
+      fbout     = m;
+      _mm_storel_pi((__m64*)out, _mm_add_ps(
+               _mm_mul_ps(m, wet), _mm_mul_ps(in, dry)));
+   }
+
+   _mm_storel_pi((__m64*)ph->fbout, fbout);
+}
+#endif
+
+#if (defined(__ARM_NEON__) || defined(HAVE_NEON))
+static void phaser_process_neon(void *data, struct dspfilter_output *output,
+      const struct dspfilter_input *input)
+{
+   unsigned i;
+   int s;
+   struct phaser_data *ph = (struct phaser_data*)data;
+   float *out             = input->samples;
+   float fb               = ph->fb * 0.01f;
+   float32x2_t fbout      = vld1_f32(ph->fbout);
+
+   output->samples        = input->samples;
+   output->frames         = input->frames;
+
+   for (i = 0; i < input->frames; i++, out += 2)
+   {
+      float32x2_t in = vld1_f32(out);
+      float32x2_t m  = vmla_n_f32(in, fbout, fb);
+
+      phaser_update_gain(ph);
+
+      for (s = 0; s < ph->stages; s++)
+      {
+         float32x2_t tmp = vld1_f32(ph->old[s]);
+         float32x2_t cur = vmla_n_f32(m, tmp, ph->gain);
+         vst1_f32(ph->old[s], cur);
+         m               = vmls_n_f32(tmp, cur, ph->gain);
+      }
+
+      fbout          = m;
+      vst1_f32(out, vmla_n_f32(vmul_n_f32(m, ph->drywet),
+               in, 1.0f - ph->drywet));
+   }
+
+   vst1_f32(ph->fbout, fbout);
+}
+#endif
+
 static void *phaser_init(const struct dspfilter_info *info,
       const struct dspfilter_config *config, void *userdata)
 {
@@ -132,12 +236,44 @@ static const struct dspfilter_implementation phaser_plug = {
    "phaser",
 };
 
+#if defined(__SSE__)
+static const struct dspfilter_implementation phaser_plug_sse = {
+   phaser_init,
+   phaser_process_sse,
+   phaser_free,
+
+   DSPFILTER_API_VERSION,
+   "Phaser",
+   "phaser",
+};
+#endif
+
+#if (defined(__ARM_NEON__) || defined(HAVE_NEON))
+static const struct dspfilter_implementation phaser_plug_neon = {
+   phaser_init,
+   phaser_process_neon,
+   phaser_free,
+
+   DSPFILTER_API_VERSION,
+   "Phaser",
+   "phaser",
+};
+#endif
+
 #ifdef HAVE_FILTERS_BUILTIN
 #define dspfilter_get_implementation phaser_dspfilter_get_implementation
 #endif
 
 const struct dspfilter_implementation *dspfilter_get_implementation(dspfilter_simd_mask_t mask)
 {
+#if defined(__SSE__)
+   if (mask & DSPFILTER_SIMD_SSE)
+      return &phaser_plug_sse;
+#endif
+#if (defined(__ARM_NEON__) || defined(HAVE_NEON))
+   if (mask & DSPFILTER_SIMD_NEON)
+      return &phaser_plug_neon;
+#endif
    (void)mask;
    return &phaser_plug;
 }
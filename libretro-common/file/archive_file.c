@@ -31,6 +31,11 @@
 #include <retro_miscellaneous.h>
 #include <lists/string_list.h>
 #include <string/stdstring.h>
+#include <encodings/crc32.h>
+
+#ifdef HAVE_THREADS
+#include <rthreads/rthreads.h>
+#endif
 
 #ifdef HAVE_MMAP
 #include <fcntl.h>
@@ -40,6 +45,42 @@
 #include <sys/stat.h>
 #endif
 
+/* Number of archives whose entry index is kept */
+#define FILE_ARCHIVE_INDEX_CACHE 4
+
+/* Bytes at the start and end of an archive that make up its
+ * fingerprint. The tail is large enough to hold a ZIP end of
+ * central directory record with a short comment. */
+#define FILE_ARCHIVE_FINGERPRINT_HEAD 64
+#define FILE_ARCHIVE_FINGERPRINT_TAIL 256
+
+#define FILE_ARCHIVE_ZIP_EOCD_SIGNATURE 0x06054b50
+#define FILE_ARCHIVE_ZIP_EOCD_SIZE      22
+
+typedef struct
+{
+   char *name;
+   uint32_t crc;
+} file_archive_index_entry_t;
+
+typedef struct
+{
+   char *path;
+   file_archive_index_entry_t *entries;
+   size_t count;
+   size_t capacity;
+   int64_t size;
+   uint32_t fingerprint;
+   unsigned last_used;
+} file_archive_index_t;
+
+static file_archive_index_t file_archive_index[FILE_ARCHIVE_INDEX_CACHE];
+static unsigned file_archive_index_clock = 0;
+static bool file_archive_cache_enabled   = false;
+#ifdef HAVE_THREADS
+static slock_t *file_archive_cache_mutex = NULL;
+#endif
+
 static int file_archive_get_file_list_cb(
       const char *path,
       const char *valid_exts,
@@ -661,6 +702,166 @@ const struct file_archive_file_backend* file_archive_get_file_backend(const char
    return NULL;
 }
 
+static void file_archive_index_free(file_archive_index_t *index)
+{
+   size_t i;
+
+   for (i = 0; i < index->count; i++)
+      free(index->entries[i].name);
+   free(index->entries);
+   free(index->path);
+   memset(index, 0, sizeof(*index));
+}
+
+static int file_archive_index_cb(const char *name, const char *valid_exts,
+      const uint8_t *cdata, unsigned cmode, uint32_t csize, uint32_t size,
+      uint32_t checksum, struct archive_extract_userdata *userdata)
+{
+   file_archive_index_t *index = (file_archive_index_t*)userdata->cb_data;
+
+   /* Directory entries of 7z archives have no name */
+   if (string_is_empty(name))
+      return 1;
+
+   if (index->count == index->capacity)
+   {
+      size_t capacity = index->capacity ? index->capacity * 2 : 64;
+      file_archive_index_entry_t *entries = (file_archive_index_entry_t*)
+         realloc(index->entries, capacity * sizeof(*entries));
+
+      if (!entries)
+         return 0;
+
+      index->entries  = entries;
+      index->capacity = capacity;
+   }
+
+   if (!(index->entries[index->count].name = strdup(name)))
+      return 0;
+   index->entries[index->count].crc = checksum;
+   index->count++;
+
+   return 1;
+}
+
+static file_archive_index_t *file_archive_index_find(const char *path,
+      int64_t size, uint32_t fingerprint)
+{
+   unsigned i;
+
+   for (i = 0; i < FILE_ARCHIVE_INDEX_CACHE; i++)
+   {
+      file_archive_index_t *index = &file_archive_index[i];
+      if (     index->path
+            && index->size        == size
+            && index->fingerprint == fingerprint
+            && string_is_equal(index->path, path))
+      {
+         index->last_used = ++file_archive_index_clock;
+         return index;
+      }
+   }
+
+   return NULL;
+}
+
+/* Takes ownership of the index, replacing the least recently used one */
+static file_archive_index_t *file_archive_index_insert(
+      file_archive_index_t *index)
+{
+   unsigned i;
+   file_archive_index_t *slot = &file_archive_index[0];
+
+   for (i = 1; i < FILE_ARCHIVE_INDEX_CACHE; i++)
+      if (file_archive_index[i].last_used < slot->last_used)
+         slot = &file_archive_index[i];
+
+   file_archive_index_free(slot);
+   *slot           = *index;
+   slot->last_used = ++file_archive_index_clock;
+   return slot;
+}
+
+static bool file_archive_index_lookup(const file_archive_index_t *index,
+      const char *name, uint32_t *crc)
+{
+   size_t i;
+
+   /* If no path within the archive is given, use the first file */
+   if (!name)
+   {
+      if (!index->count)
+         return false;
+      *crc = index->entries[0].crc;
+      return true;
+   }
+
+   for (i = 0; i < index->count; i++)
+   {
+      if (string_is_equal(index->entries[i].name, name))
+      {
+         *crc = index->entries[i].crc;
+         return true;
+      }
+   }
+
+   return false;
+}
+
+/* Returns true if the archive was indexed, the CRC is 0 if
+ * the requested file is not part of it */
+static bool file_archive_get_file_crc32_cached(const char *archive,
+      const char *name, uint32_t *crc)
+{
+   file_archive_index_t index;
+   struct archive_extract_userdata userdata = {0};
+   file_archive_index_t *cached             = NULL;
+   int64_t size                             = 0;
+   uint32_t fingerprint                     = 0;
+
+   /* The fingerprint is only needed to look up or store an index */
+   if (     !file_archive_cache_enabled
+         || !file_archive_get_fingerprint(archive, &size, &fingerprint))
+      return false;
+
+   *crc = 0;
+
+   if (!file_archive_cache_lock())
+      return false;
+   if ((cached = file_archive_index_find(archive, size, fingerprint)))
+      file_archive_index_lookup(cached, name, crc);
+   file_archive_cache_unlock();
+
+   if (cached)
+      return true;
+
+   /* Parse the archive once without holding the lock,
+    * every later lookup is served from the index */
+   memset(&index, 0, sizeof(index));
+   userdata.cb_data = &index;
+
+   if (     !file_archive_walk(archive, NULL, file_archive_index_cb, &userdata)
+         || !(index.path = strdup(archive)))
+   {
+      file_archive_index_free(&index);
+      return false;
+   }
+
+   index.size        = size;
+   index.fingerprint = fingerprint;
+
+   if (!file_archive_cache_lock())
+   {
+      file_archive_index_free(&index);
+      return false;
+   }
+   cached = file_archive_index_insert(&index);
+   file_archive_index_lookup(cached, name, crc);
+   file_archive_cache_unlock();
+
+   return true;
+}
+
 /**
  * file_archive_get_file_crc32:
  * @path                         : filename path of archive
@@ -676,6 +877,10 @@ uint32_t file_archive_get_file_crc32(const char *path)
    bool returnerr                                  = false;
    const char *archive_path                        = NULL;
    bool contains_compressed = path_contains_compressed_file(path);
+   char archive[PATH_MAX_LENGTH];
+   uint32_t crc;
+
+   strlcpy(archive, path, sizeof(archive));
 
    if (contains_compressed)
    {
@@ -683,9 +888,15 @@ uint32_t file_archive_get_file_crc32(const char *path)
 
       /* move pointer right after the delimiter to give us the path */
       if (archive_path)
+      {
+         archive[archive_path - path] = '\0';
          archive_path += 1;
+      }
    }
 
+   if (file_archive_get_file_crc32_cached(archive, archive_path, &crc))
+      return crc;
+
    state.type              = ARCHIVE_TRANSFER_INIT;
    state.archive_file      = NULL;
 #ifdef HAVE_MMAP
@@ -707,10 +918,15 @@ uint32_t file_archive_get_file_crc32(const char *path)
    for (;;)
    {
       /* Now find the first file in the archive. */
-      if (state.type == ARCHIVE_TRANSFER_ITERATE)
-         file_archive_parse_file_iterate(&state,
-                  &returnerr, path, NULL, NULL,
-                  &userdata);
+      if (state.type != ARCHIVE_TRANSFER_ITERATE)
+      {
+         userdata.crc = 0;
+         break;
+      }
+
+      file_archive_parse_file_iterate(&state,
+               &returnerr, path, NULL, NULL,
+               &userdata);
 
       /* If no path specified within archive, stop after
        * finding the first file.
@@ -732,3 +948,149 @@ uint32_t file_archive_get_file_crc32(const char *path)
 
    return userdata.crc;
 }
+
+void file_archive_cache_init(void)
+{
+   file_archive_cache_deinit();
+#ifdef HAVE_THREADS
+   if (!(file_archive_cache_mutex = slock_new()))
+      return;
+#endif
+   file_archive_cache_enabled = true;
+}
+
+void file_archive_cache_deinit(void)
+{
+   unsigned i;
+   const struct file_archive_file_backend *backend = NULL;
+
+   if (!file_archive_cache_enabled)
+      return;
+
+   for (i = 0; i < FILE_ARCHIVE_INDEX_CACHE; i++)
+      file_archive_index_free(&file_archive_index[i]);
+   file_archive_index_clock = 0;
+
+   if ((backend = file_archive_get_7z_file_backend()) && backend->cache_free)
+      backend->cache_free();
+   if ((backend = file_archive_get_zlib_file_backend()) && backend->cache_free)
+      backend->cache_free();
+
+   file_archive_cache_enabled = false;
+#ifdef HAVE_THREADS
+   slock_free(file_archive_cache_mutex);
+   file_archive_cache_mutex   = NULL;
+#endif
+}
+
+bool file_archive_cache_is_enabled(void)
+{
+   return file_archive_cache_enabled;
+}
+
+bool file_archive_cache_lock(void)
+{
+   if (!file_archive_cache_enabled)
+      return false;
+#ifdef HAVE_THREADS
+   slock_lock(file_archive_cache_mutex);
+#endif
+   return true;
+}
+
+void file_archive_cache_unlock(void)
+{
+#ifdef HAVE_THREADS
+   slock_unlock(file_archive_cache_mutex);
+#endif
+}
+
+static uint32_t file_archive_read_le(const uint8_t *data, unsigned size)
+{
+   unsigned i;
+   uint32_t val = 0;
+
+   for (i = 0; i < size; i++)
+      val |= (uint32_t)data[i] << (i * 8);
+
+   return val;
+}
+
+/* ZIP keeps no checksum of its central directory, the end of
+ * central directory record only says where it is. Hash the
+ * directory itself, it holds the CRC32 of every entry. */
+static bool file_archive_fingerprint_zip_directory(RFILE *file,
+      const uint8_t *tail, int64_t tail_size, uint32_t *fingerprint)
+{
+   uint8_t buf[4096];
+   int64_t pos;
+   uint32_t directory_size   = 0;
+   uint32_t directory_offset = 0;
+
+   for (pos = tail_size - FILE_ARCHIVE_ZIP_EOCD_SIZE; pos >= 0; pos--)
+   {
+      const uint8_t *eocd = tail + pos;
+      if (     file_archive_read_le(eocd, 4)
+               == FILE_ARCHIVE_ZIP_EOCD_SIGNATURE
+            && pos + FILE_ARCHIVE_ZIP_EOCD_SIZE
+               + file_archive_read_le(eocd + 20, 2) == tail_size)
+      {
+         directory_size   = file_archive_read_le(eocd + 12, 4);
+         directory_offset = file_archive_read_le(eocd + 16, 4);
+         break;
+      }
+   }
+
+   /* Not a ZIP, or a ZIP64 one whose directory is located elsewhere */
+   if (pos < 0 || directory_offset == 0xFFFFFFFF)
+      return true;
+
+   if (filestream_seek(file, directory_offset,
+            RETRO_VFS_SEEK_POSITION_START) != 0)
+      return false;
+
+   while (directory_size > 0)
+   {
+      int64_t read_size = filestream_read(file, buf,
+            MIN(directory_size, sizeof(buf)));
+      if (read_size <= 0)
+         return false;
+      *fingerprint    = encoding_crc32(*fingerprint, buf, (size_t)read_size);
+      directory_size -= (uint32_t)read_size;
+   }
+
+   return true;
+}
+
+bool file_archive_get_fingerprint(const char *path,
+      int64_t *size, uint32_t *fingerprint)
+{
+   uint8_t head[FILE_ARCHIVE_FINGERPRINT_HEAD];
+   uint8_t tail[FILE_ARCHIVE_FINGERPRINT_TAIL];
+   bool ret          = false;
+   int64_t head_size = 0;
+   int64_t tail_size = 0;
+   RFILE *file       = filestream_open(path,
+         RETRO_VFS_FILE_ACCESS_READ,
+         RETRO_VFS_FILE_ACCESS_HINT_NONE);
+
+   if (!file)
+      return false;
+
+   *size     = filestream_get_size(file);
+   head_size = filestream_read(file, head, sizeof(head));
+   if (filestream_seek(file, MAX(*size - (int64_t)sizeof(tail), 0),
+            RETRO_VFS_SEEK_POSITION_START) == 0)
+      tail_size = filestream_read(file, tail, sizeof(tail));
+
+   if (head_size >= 0 && tail_size >= 0)
+   {
+      *fingerprint = encoding_crc32(0, head, (size_t)head_size);
+      *fingerprint = encoding_crc32(*fingerprint, tail, (size_t)tail_size);
+      ret          = file_archive_fingerprint_zip_directory(file,
+            tail, tail_size, fingerprint);
+   }
+
+   filestream_close(file);
+   return ret;
+}
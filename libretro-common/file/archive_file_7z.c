@@ -39,6 +39,8 @@
 #define SEVENZIP_MAGIC "7z\xBC\xAF\x27\x1C"
 #define SEVENZIP_MAGIC_LEN 6
 #define SEVENZIP_LOOKTOREAD_BUF_SIZE (1 << 14)
+/* Largest decompressed block kept between reads */
+#define SEVENZIP_CACHE_MAX_SIZE (64 * 1024 * 1024)
 
 /* Assume W-functions do not work below Win2K and Xbox platforms */
 #if defined(_WIN32_WINNT) && _WIN32_WINNT < 0x0500 || defined(_XBOX)
@@ -55,6 +57,7 @@ struct sevenzip_context_t
    ISzAlloc allocImp;
    ISzAlloc allocTempImp;
    CSzArEx db;
+   size_t output_size;
    size_t temp_size;
    uint32_t parse_index;
    uint32_t decompress_index;
@@ -90,6 +93,9 @@ static void* sevenzip_stream_new(void)
    struct sevenzip_context_t *sevenzip_context =
          (struct sevenzip_context_t*)calloc(1, sizeof(struct sevenzip_context_t));
 
+   if (!sevenzip_context)
+      return NULL;
+
    /* These are the allocation routines - currently using
     * the non-standard 7zip choices. */
    sevenzip_context->allocImp.Alloc     = sevenzip_stream_alloc_impl;
@@ -130,178 +136,250 @@ static void sevenzip_parse_file_free(void *context)
    free(sevenzip_context);
 }
 
-/* Extract the relative path (needle) from a 7z archive
- * (path) and allocate a buf for it to write it in.
- * If optional_outfile is set, extract to that instead
- * and don't allocate buffer.
- */
-static int64_t sevenzip_file_read(
-      const char *path,
+/* Opens the archive file, also used to reopen it for a cached
+ * context. Returns false if the archive could not be opened. */
+static bool sevenzip_context_open_file(
+      struct sevenzip_context_t *sevenzip_context, const char *path)
+{
+#if defined(_WIN32) && defined(USE_WINDOWS_FILE) && !defined(LEGACY_WIN32)
+   wchar_t *pathW = NULL;
+
+   if (string_is_empty(path) || !(pathW = utf8_to_utf16_string_alloc(path)))
+      return false;
+
+   if (InFile_OpenW(&sevenzip_context->archiveStream.file, pathW))
+   {
+      free(pathW);
+      return false;
+   }
+
+   free(pathW);
+#else
+   if (InFile_Open(&sevenzip_context->archiveStream.file, path))
+      return false;
+#endif
+
+   FileInStream_CreateVTable(&sevenzip_context->archiveStream);
+   LookToRead2_CreateVTable(&sevenzip_context->lookStream, false);
+   sevenzip_context->lookStream.realStream = &sevenzip_context->archiveStream.vt;
+   LookToRead2_Init(&sevenzip_context->lookStream);
+
+   return true;
+}
+
+/* Opens the archive and parses its headers into db */
+static bool sevenzip_context_open(
+      struct sevenzip_context_t *sevenzip_context, const char *path)
+{
+   if (!sevenzip_context_open_file(sevenzip_context, path))
+      return false;
+
+   CrcGenerateTable();
+   SzArEx_Init(&sevenzip_context->db);
+
+   return SzArEx_Open(&sevenzip_context->db, &sevenzip_context->lookStream.vt,
+         &sevenzip_context->allocImp, &sevenzip_context->allocTempImp) == SZ_OK;
+}
+
+/* Extracts needle from an opened archive, see sevenzip_file_read.
+ * The decompressed block is left in the context, so files of a
+ * solid archive which share a block are only decompressed once. */
+static int64_t sevenzip_context_extract(
+      struct sevenzip_context_t *sevenzip_context,
       const char *needle, void **buf,
       const char *optional_outfile)
 {
-   CFileInStream archiveStream;
-   CLookToRead2 lookStream;
-   ISzAlloc allocImp;
-   ISzAlloc allocTempImp;
-   CSzArEx db;
-   uint8_t *output      = 0;
+   uint32_t i;
+   CSzArEx *db          = &sevenzip_context->db;
+   uint16_t *temp       = NULL;
+   size_t temp_size     = 0;
    int64_t outsize      = -1;
 
-   /*These are the allocation routines.
-    * Currently using the non-standard 7zip choices. */
-   allocImp.Alloc       = sevenzip_stream_alloc_impl;
-   allocImp.Free        = sevenzip_stream_free_impl;
-   allocTempImp.Alloc   = sevenzip_stream_alloc_tmp_impl;
-   allocTempImp.Free    = sevenzip_stream_free_impl;
+   for (i = 0; i < db->NumFiles; i++)
+   {
+      size_t len;
+      char infile[PATH_MAX_LENGTH];
+      size_t offset           = 0;
+      size_t outSizeProcessed = 0;
 
-   lookStream.bufSize   = SEVENZIP_LOOKTOREAD_BUF_SIZE * sizeof(Byte);
-   lookStream.buf       = (Byte*)malloc(lookStream.bufSize);
+      if (SzArEx_IsDir(db, i))
+         continue;
 
-   if (!lookStream.buf)
-      lookStream.bufSize = 0;
+      len = SzArEx_GetFileNameUtf16(db, i, NULL);
 
-#if defined(_WIN32) && defined(USE_WINDOWS_FILE) && !defined(LEGACY_WIN32)
-   if (!string_is_empty(path))
-   {
-      wchar_t *pathW = utf8_to_utf16_string_alloc(path);
+      if (len > temp_size)
+      {
+         if (temp)
+            free(temp);
+         temp_size = len;
+         if (!(temp = (uint16_t *)malloc(temp_size * sizeof(temp[0]))))
+            break;
+      }
 
-      if (pathW)
+      SzArEx_GetFileNameUtf16(db, i, temp);
+      if (     !utf16_to_char_string(temp, infile, sizeof(infile))
+            || !string_is_equal(infile, needle))
+         continue;
+
+      /* C LZMA SDK does not support chunked extraction - see here:
+       * sourceforge.net/p/sevenzip/discussion/45798/thread/6fb59aaf/
+       * */
+      if (SzArEx_Extract(db, &sevenzip_context->lookStream.vt, i,
+               &sevenzip_context->block_index, &sevenzip_context->output,
+               &sevenzip_context->output_size, &offset, &outSizeProcessed,
+               &sevenzip_context->allocImp,
+               &sevenzip_context->allocTempImp) != SZ_OK)
       {
-         /* Could not open 7zip archive? */
-         if (InFile_OpenW(&archiveStream.file, pathW))
-         {
-            free(pathW);
-            return -1;
-         }
+         /* Do not keep a partially decoded block */
+         IAlloc_Free(&sevenzip_context->allocImp, sevenzip_context->output);
+         sevenzip_context->output      = NULL;
+         sevenzip_context->output_size = 0;
+         sevenzip_context->block_index = 0xFFFFFFFF;
+         break;
+      }
 
-         free(pathW);
+      outsize = (int64_t)outSizeProcessed;
+
+      if (optional_outfile)
+      {
+         const void *ptr = (const void*)(sevenzip_context->output + offset);
+
+         if (!filestream_write_file(optional_outfile, ptr, outsize))
+            outsize = -1;
+      }
+      /*We could either use the 7Zip allocated buffer,
+       * or create our own and use it.
+       * We would however need to realloc anyways, because RetroArch
+       * expects a \0 at the end, therefore we allocate new,
+       * copy and free the old one. */
+      else if ((*buf = malloc((size_t)(outsize + 1))))
+      {
+         ((char*)(*buf))[outsize] = '\0';
+         if (outsize)
+            memcpy(*buf, sevenzip_context->output + offset, (size_t)outsize);
       }
+      else
+         outsize = -1;
+      break;
    }
-#else
-   /* Could not open 7zip archive? */
-   if (InFile_Open(&archiveStream.file, path))
-      return -1;
-#endif
 
-   FileInStream_CreateVTable(&archiveStream);
-   LookToRead2_CreateVTable(&lookStream, false);
-   lookStream.realStream = &archiveStream.vt;
-   LookToRead2_Init(&lookStream);
-   CrcGenerateTable();
+   if (temp)
+      free(temp);
 
-   memset(&db, 0, sizeof(db));
+   return outsize;
+}
 
-   SzArEx_Init(&db);
+/* The context of the last archive read, with its parsed headers
+ * and last decompressed block. It is taken out while in use, so
+ * the cache lock is not held during decompression. */
+static struct sevenzip_context_t *sevenzip_cache = NULL;
+static char *sevenzip_cache_path                 = NULL;
+static int64_t sevenzip_cache_size               = 0;
+static uint32_t sevenzip_cache_fingerprint       = 0;
+
+/* Must be called with the cache lock held */
+static struct sevenzip_context_t *sevenzip_cache_take(const char *path,
+      int64_t size, uint32_t fingerprint)
+{
+   struct sevenzip_context_t *sevenzip_context = sevenzip_cache;
 
-   if (SzArEx_Open(&db, &lookStream.vt, &allocImp, &allocTempImp) == SZ_OK)
+   if (     sevenzip_context
+         && sevenzip_cache_size        == size
+         && sevenzip_cache_fingerprint == fingerprint
+         && string_is_equal(sevenzip_cache_path, path))
    {
-      uint32_t i;
-      bool file_found      = false;
-      uint16_t *temp       = NULL;
-      size_t temp_size     = 0;
-      uint32_t block_index   = 0xFFFFFFFF;
-      SRes res             = SZ_OK;
-
-      for (i = 0; i < db.NumFiles; i++)
-      {
-         size_t len;
-         char infile[PATH_MAX_LENGTH];
-         size_t offset                = 0;
-         size_t outSizeProcessed      = 0;
+      sevenzip_cache = NULL;
+      return sevenzip_context;
+   }
 
-         /* We skip over everything which is not a directory.
-          * FIXME: Why continue then if IsDir is true?*/
-         if (SzArEx_IsDir(&db, i))
-            continue;
+   return NULL;
+}
 
-         len = SzArEx_GetFileNameUtf16(&db, i, NULL);
+/* Must be called with the cache lock held, or on deinit */
+static void sevenzip_cache_free(void)
+{
+   sevenzip_parse_file_free(sevenzip_cache);
+   free(sevenzip_cache_path);
+   sevenzip_cache      = NULL;
+   sevenzip_cache_path = NULL;
+}
 
-         if (len > temp_size)
-         {
-            if (temp)
-               free(temp);
-            temp_size = len;
-            temp = (uint16_t *)malloc(temp_size * sizeof(temp[0]));
-
-            if (temp == 0)
-            {
-               res = SZ_ERROR_MEM;
-               break;
-            }
-         }
+/* Extract the relative path (needle) from a 7z archive
+ * (path) and allocate a buf for it to write it in.
+ * If optional_outfile is set, extract to that instead
+ * and don't allocate buffer.
+ */
+static int64_t sevenzip_file_read(
+      const char *path,
+      const char *needle, void **buf,
+      const char *optional_outfile)
+{
+   struct sevenzip_context_t *sevenzip_context = NULL;
+   int64_t size                                = 0;
+   uint32_t fingerprint                        = 0;
+   int64_t outsize                             = -1;
+   bool cache                                  =
+         file_archive_cache_is_enabled()
+      && file_archive_get_fingerprint(path, &size, &fingerprint);
+
+   if (cache && (cache = file_archive_cache_lock()))
+   {
+      sevenzip_context = sevenzip_cache_take(path, size, fingerprint);
+      file_archive_cache_unlock();
+   }
 
-         SzArEx_GetFileNameUtf16(&db, i, temp);
-         res       = SZ_ERROR_FAIL;
-         infile[0] = '\0';
+   /* The cached context already has the headers parsed,
+    * only the file itself has to be reopened */
+   if (sevenzip_context
+         && !sevenzip_context_open_file(sevenzip_context, path))
+   {
+      sevenzip_parse_file_free(sevenzip_context);
+      return -1;
+   }
 
-         if (temp)
-            res = utf16_to_char_string(temp, infile, sizeof(infile))
-               ? SZ_OK : SZ_ERROR_FAIL;
+   if (!sevenzip_context)
+   {
+      if (!(sevenzip_context = (struct sevenzip_context_t*)
+               sevenzip_stream_new()))
+         return -1;
 
-         if (string_is_equal(infile, needle))
-         {
-            size_t output_size   = 0;
-
-            /* C LZMA SDK does not support chunked extraction - see here:
-             * sourceforge.net/p/sevenzip/discussion/45798/thread/6fb59aaf/
-             * */
-            file_found = true;
-            res = SzArEx_Extract(&db, &lookStream.vt, i, &block_index,
-                  &output, &output_size, &offset, &outSizeProcessed,
-                  &allocImp, &allocTempImp);
-
-            if (res != SZ_OK)
-               break; /* This goes to the error section. */
-
-            outsize = (int64_t)outSizeProcessed;
-
-            if (optional_outfile)
-            {
-               const void *ptr = (const void*)(output + offset);
-
-               if (!filestream_write_file(optional_outfile, ptr, outsize))
-               {
-                  res        = SZ_OK;
-                  file_found = true;
-                  outsize    = -1;
-               }
-            }
-            else
-            {
-               /*We could either use the 7Zip allocated buffer,
-                * or create our own and use it.
-                * We would however need to realloc anyways, because RetroArch
-                * expects a \0 at the end, therefore we allocate new,
-                * copy and free the old one. */
-               *buf = malloc((size_t)(outsize + 1));
-               ((char*)(*buf))[outsize] = '\0';
-               memcpy(*buf,output + offset,outsize);
-            }
-            break;
-         }
+      if (!sevenzip_context_open(sevenzip_context, path))
+      {
+         sevenzip_parse_file_free(sevenzip_context);
+         return -1;
       }
+   }
 
-      if (temp)
-         free(temp);
-      IAlloc_Free(&allocImp, output);
+   outsize = sevenzip_context_extract(sevenzip_context,
+         needle, buf, optional_outfile);
 
-      if (!(file_found && res == SZ_OK))
-      {
-         /* Error handling
-          *
-          * Failed to open compressed file inside 7zip archive.
-          */
+   /* Do not keep the archive open between reads */
+   File_Close(&sevenzip_context->archiveStream.file);
 
-         outsize    = -1;
-      }
+   if (!cache || !file_archive_cache_lock())
+   {
+      sevenzip_parse_file_free(sevenzip_context);
+      return outsize;
    }
 
-   SzArEx_Free(&db, &allocImp);
-   File_Close(&archiveStream.file);
+   if (sevenzip_context->output_size > SEVENZIP_CACHE_MAX_SIZE)
+   {
+      IAlloc_Free(&sevenzip_context->allocImp, sevenzip_context->output);
+      sevenzip_context->output      = NULL;
+      sevenzip_context->output_size = 0;
+      sevenzip_context->block_index = 0xFFFFFFFF;
+   }
 
-   if (lookStream.buf)
-      free(lookStream.buf);
+   sevenzip_cache_free();
+   if ((sevenzip_cache_path = strdup(path)))
+   {
+      sevenzip_cache             = sevenzip_context;
+      sevenzip_cache_size        = size;
+      sevenzip_cache_fingerprint = fingerprint;
+   }
+   else
+      sevenzip_parse_file_free(sevenzip_context);
+   file_archive_cache_unlock();
 
    return outsize;
 }
@@ -328,14 +406,13 @@ static int sevenzip_stream_decompress_data_to_file_iterate(
          (struct sevenzip_context_t*)context;
 
    SRes res                = SZ_ERROR_FAIL;
-   size_t output_size      = 0;
    size_t offset           = 0;
    size_t outSizeProcessed = 0;
 
    res = SzArEx_Extract(&sevenzip_context->db,
          &sevenzip_context->lookStream.vt, sevenzip_context->decompress_index,
          &sevenzip_context->block_index, &sevenzip_context->output,
-         &output_size, &offset, &outSizeProcessed,
+         &sevenzip_context->output_size, &offset, &outSizeProcessed,
          &sevenzip_context->allocImp, &sevenzip_context->allocTempImp);
 
    if (res != SZ_OK)
@@ -364,42 +441,12 @@ static int sevenzip_parse_file_init(file_archive_transfer_t *state,
       goto error;
 
    sevenzip_context = (struct sevenzip_context_t*)sevenzip_stream_new();
-   state->context = sevenzip_context;
 
-#if defined(_WIN32) && defined(USE_WINDOWS_FILE) && !defined(LEGACY_WIN32)
-   if (!string_is_empty(file))
-   {
-      wchar_t *fileW = utf8_to_utf16_string_alloc(file);
-
-      if (fileW)
-      {
-         /* could not open 7zip archive? */
-         if (InFile_OpenW(&sevenzip_context->archiveStream.file, fileW))
-         {
-            free(fileW);
-            goto error;
-         }
-
-         free(fileW);
-      }
-   }
-#else
    /* could not open 7zip archive? */
-   if (InFile_Open(&sevenzip_context->archiveStream.file, file))
-      goto error;
-#endif
-
-   FileInStream_CreateVTable(&sevenzip_context->archiveStream);
-   LookToRead2_CreateVTable(&sevenzip_context->lookStream, false);
-   sevenzip_context->lookStream.realStream = &sevenzip_context->archiveStream.vt;
-   LookToRead2_Init(&sevenzip_context->lookStream);
-   CrcGenerateTable();
-   SzArEx_Init(&sevenzip_context->db);
-
-   if (SzArEx_Open(&sevenzip_context->db, &sevenzip_context->lookStream.vt,
-         &sevenzip_context->allocImp, &sevenzip_context->allocTempImp) != SZ_OK)
+   if (!sevenzip_context || !sevenzip_context_open(sevenzip_context, file))
       goto error;
 
+   state->context    = sevenzip_context;
    state->step_total = sevenzip_context->db.NumFiles;
 
    return 0;
@@ -522,5 +569,6 @@ const struct file_archive_file_backend sevenzip_backend = {
    sevenzip_stream_decompress_data_to_file_iterate,
    sevenzip_stream_crc32_calculate,
    sevenzip_file_read,
+   sevenzip_cache_free,
    "7z"
 };
@@ -567,5 +567,6 @@ const struct file_archive_file_backend zlib_backend = {
    zlib_stream_decompress_data_to_file_iterate,
    zlib_stream_crc32_calculate,
    zip_file_read,
+   NULL,
    "zlib"
 };
@@ -0,0 +1,542 @@
+/* Copyright  (C) 2010-2020 The RetroArch team
+ *
+ * ---------------------------------------------------------------------------------------
+ * The following license statement only applies to this file (nbio_uring.c).
+ * ---------------------------------------------------------------------------------------
+ *
+ * Permission is hereby granted, free of charge,
+ * to any person obtaining a copy of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction, including without limitation the rights to
+ * use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies of the Software,
+ * and to permit persons to whom the Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR IMPLIED,
+ * INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.
+ * IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY,
+ * WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ */
+
+#include <file/nbio.h>
+
+#if defined(__linux__) && defined(HAVE_IO_URING)
+
+#ifndef _GNU_SOURCE
+#define _GNU_SOURCE
+#endif
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdint.h>
+#include <string.h>
+#include <errno.h>
+
+#include <unistd.h>
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/syscall.h>
+#include <sys/uio.h>
+#include <linux/io_uring.h>
+
+/* Older libcs do not know the syscalls yet, the
+ * numbers are the same on all architectures */
+#ifndef __NR_io_uring_setup
+#define __NR_io_uring_setup    425
+#endif
+#ifndef __NR_io_uring_enter
+#define __NR_io_uring_enter    426
+#endif
+#ifndef __NR_io_uring_register
+#define __NR_io_uring_register 427
+#endif
+
+/* Requests in flight per file */
+#define NBIO_URING_ENTRIES     16
+/* Files are read and written in requests of this size */
+#define NBIO_URING_CHUNK       (1024 * 1024)
+
+/* Used if the kernel does not support io_uring (before 5.1)
+ * or it is disabled, e.g. by a seccomp filter */
+extern nbio_intf_t nbio_stdio;
+
+struct nbio_uring_req
+{
+   struct iovec iov;
+   size_t offset;
+   size_t len;
+   bool busy;
+};
+
+struct nbio_uring_t
+{
+   struct nbio_uring_req reqs[NBIO_URING_ENTRIES];
+   void* ptr;
+   void* fallback;
+   void* sq_ring;
+   void* cq_ring;
+   struct io_uring_sqe *sqes;
+   struct io_uring_cqe *cqes;
+   unsigned *sq_tail;
+   unsigned *sq_mask;
+   unsigned *sq_array;
+   unsigned *cq_head;
+   unsigned *cq_tail;
+   unsigned *cq_mask;
+   size_t sq_ring_size;
+   size_t cq_ring_size;
+   size_t sqes_size;
+   size_t len;
+   size_t next;        /* offset of the next chunk to request */
+   unsigned inflight;
+   unsigned pending;   /* queued, but not yet submitted */
+   unsigned mode;
+   int fd;
+   int ring_fd;
+   uint8_t op;
+   bool busy;
+   bool registered;
+};
+
+/* liburing is not used, to avoid the dependency */
+
+static int io_uring_setup(unsigned entries, struct io_uring_params *p)
+{
+   return (int)syscall(__NR_io_uring_setup, entries, p);
+}
+
+static int io_uring_enter(int fd, unsigned to_submit,
+      unsigned min_complete, unsigned flags)
+{
+   return (int)syscall(__NR_io_uring_enter, fd, to_submit,
+         min_complete, flags, NULL, 0);
+}
+
+static int io_uring_register(int fd, unsigned opcode,
+      const void *arg, unsigned nr_args)
+{
+   return (int)syscall(__NR_io_uring_register, fd, opcode, arg, nr_args);
+}
+
+static void nbio_uring_deinit_ring(struct nbio_uring_t *handle)
+{
+   if (handle->sqes)
+      munmap(handle->sqes, handle->sqes_size);
+   if (handle->cq_ring && handle->cq_ring != handle->sq_ring)
+      munmap(handle->cq_ring, handle->cq_ring_size);
+   if (handle->sq_ring)
+      munmap(handle->sq_ring, handle->sq_ring_size);
+   if (handle->ring_fd >= 0)
+      close(handle->ring_fd);
+
+   handle->sqes    = NULL;
+   handle->cq_ring = NULL;
+   handle->sq_ring = NULL;
+   handle->ring_fd = -1;
+}
+
+static bool nbio_uring_init_ring(struct nbio_uring_t *handle)
+{
+   void *ptr;
+   struct io_uring_params p;
+
+   memset(&p, 0, sizeof(p));
+
+   if ((handle->ring_fd = io_uring_setup(NBIO_URING_ENTRIES, &p)) < 0)
+      return false;
+
+   handle->sq_ring_size = p.sq_off.array + p.sq_entries * sizeof(unsigned);
+   handle->cq_ring_size = p.cq_off.cqes
+      + p.cq_entries * sizeof(struct io_uring_cqe);
+   handle->sqes_size    = p.sq_entries * sizeof(struct io_uring_sqe);
+
+#ifdef IORING_FEAT_SINGLE_MMAP
+   /* Both rings share one mapping since Linux 5.4 */
+   if (p.features & IORING_FEAT_SINGLE_MMAP)
+   {
+      if (handle->cq_ring_size > handle->sq_ring_size)
+         handle->sq_ring_size = handle->cq_ring_size;
+      handle->cq_ring_size    = handle->sq_ring_size;
+   }
+#endif
+
+   if ((ptr = mmap(NULL, handle->sq_ring_size, PROT_READ | PROT_WRITE,
+         MAP_SHARED | MAP_POPULATE, handle->ring_fd,
+         IORING_OFF_SQ_RING)) == MAP_FAILED)
+      return false;
+   handle->sq_ring = ptr;
+
+#ifdef IORING_FEAT_SINGLE_MMAP
+   if (p.features & IORING_FEAT_SINGLE_MMAP)
+      handle->cq_ring = handle->sq_ring;
+   else
+#endif
+   {
+      if ((ptr = mmap(NULL, handle->cq_ring_size, PROT_READ | PROT_WRITE,
+            MAP_SHARED | MAP_POPULATE, handle->ring_fd,
+            IORING_OFF_CQ_RING)) == MAP_FAILED)
+         return false;
+      handle->cq_ring = ptr;
+   }
+
+   if ((ptr = mmap(NULL, handle->sqes_size, PROT_READ | PROT_WRITE,
+         MAP_SHARED | MAP_POPULATE, handle->ring_fd,
+         IORING_OFF_SQES)) == MAP_FAILED)
+      return false;
+   handle->sqes     = (struct io_uring_sqe*)ptr;
+
+   handle->sq_tail  = (unsigned*)((uint8_t*)handle->sq_ring + p.sq_off.tail);
+   handle->sq_mask  = (unsigned*)((uint8_t*)handle->sq_ring + p.sq_off.ring_mask);
+   handle->sq_array = (unsigned*)((uint8_t*)handle->sq_ring + p.sq_off.array);
+   handle->cq_head  = (unsigned*)((uint8_t*)handle->cq_ring + p.cq_off.head);
+   handle->cq_tail  = (unsigned*)((uint8_t*)handle->cq_ring + p.cq_off.tail);
+   handle->cq_mask  = (unsigned*)((uint8_t*)handle->cq_ring + p.cq_off.ring_mask);
+   handle->cqes     = (struct io_uring_cqe*)
+      ((uint8_t*)handle->cq_ring + p.cq_off.cqes);
+
+   return true;
+}
+
+static void nbio_uring_queue(struct nbio_uring_t *handle, unsigned i)
+{
+   struct nbio_uring_req *req = &handle->reqs[i];
+   unsigned tail              = *handle->sq_tail;
+   unsigned index             = tail & *handle->sq_mask;
+   struct io_uring_sqe *sqe   = &handle->sqes[index];
+
+   memset(sqe, 0, sizeof(*sqe));
+   sqe->opcode    = handle->op;
+   sqe->fd        = handle->fd;
+   sqe->off       = req->offset;
+   sqe->user_data = i;
+
+   if (handle->registered)
+   {
+      sqe->addr      = (uint64_t)(uintptr_t)handle->ptr + req->offset;
+      sqe->len       = (uint32_t)req->len;
+      sqe->buf_index = 0;
+   }
+   else
+   {
+      req->iov.iov_base = (uint8_t*)handle->ptr + req->offset;
+      req->iov.iov_len  = req->len;
+      sqe->addr         = (uint64_t)(uintptr_t)&req->iov;
+      sqe->len          = 1;
+   }
+
+   handle->sq_array[index] = index;
+   __atomic_store_n(handle->sq_tail, tail + 1, __ATOMIC_RELEASE);
+   handle->pending++;
+}
+
+/* Requests the next chunks and submits them all with one syscall */
+static void nbio_uring_submit(struct nbio_uring_t *handle)
+{
+   unsigned i;
+
+   for (i = 0; i < NBIO_URING_ENTRIES && handle->next < handle->len; i++)
+   {
+      struct nbio_uring_req *req = &handle->reqs[i];
+
+      if (req->busy)
+         continue;
+
+      req->busy    = true;
+      req->offset  = handle->next;
+      req->len     = handle->len - handle->next;
+      if (req->len > NBIO_URING_CHUNK)
+         req->len  = NBIO_URING_CHUNK;
+      handle->next += req->len;
+      handle->inflight++;
+      nbio_uring_queue(handle, i);
+   }
+
+   if (handle->pending)
+   {
+      int ret = io_uring_enter(handle->ring_fd, handle->pending, 0, 0);
+
+      if (ret >= 0)
+         handle->pending -= (unsigned)ret;
+      /* Out of resources, submitted again on the next iteration */
+      else if (errno != EINTR && errno != EAGAIN && errno != EBUSY)
+         abort();
+   }
+}
+
+static void nbio_uring_reap(struct nbio_uring_t *handle)
+{
+   unsigned head = *handle->cq_head;
+   unsigned tail = __atomic_load_n(handle->cq_tail, __ATOMIC_ACQUIRE);
+
+   while (head != tail)
+   {
+      struct io_uring_cqe *cqe   = &handle->cqes[head & *handle->cq_mask];
+      unsigned i                 = (unsigned)cqe->user_data;
+      struct nbio_uring_req *req = &handle->reqs[i];
+      int res                    = cqe->res;
+
+      head++;
+
+      /* Short reads and writes are continued, unless cancelled */
+      if (handle->busy && (res == -EAGAIN || res == -EINTR))
+         nbio_uring_queue(handle, i);
+      else if (handle->busy && res > 0 && (size_t)res < req->len)
+      {
+         req->offset += (size_t)res;
+         req->len    -= (size_t)res;
+         nbio_uring_queue(handle, i);
+      }
+      else
+      {
+         /* Errors and the end of the file also end the request */
+         req->busy = false;
+         handle->inflight--;
+      }
+   }
+
+   __atomic_store_n(handle->cq_head, head, __ATOMIC_RELEASE);
+}
+
+static void nbio_uring_begin_op(struct nbio_uring_t *handle, bool write)
+{
+   if (handle->busy)
+      abort();
+
+   /* The kernel maps the buffer once instead of for every request */
+   if (!handle->registered && handle->len)
+   {
+      struct iovec iov;
+      iov.iov_base = handle->ptr;
+      iov.iov_len  = handle->len;
+      handle->registered = io_uring_register(handle->ring_fd,
+            IORING_REGISTER_BUFFERS, &iov, 1) == 0;
+   }
+
+   if (handle->registered)
+      handle->op = write ? IORING_OP_WRITE_FIXED : IORING_OP_READ_FIXED;
+   else
+      handle->op = write ? IORING_OP_WRITEV : IORING_OP_READV;
+
+   handle->next = 0;
+   handle->busy = handle->len > 0;
+
+   if (handle->busy)
+      nbio_uring_submit(handle);
+}
+
+static void *nbio_uring_open(const char * filename, unsigned mode)
+{
+   static const int o_flags[]  =   { O_RDONLY, O_RDWR|O_CREAT|O_TRUNC, O_RDWR, O_RDONLY, O_RDWR|O_CREAT|O_TRUNC };
+
+   off_t len;
+   int fd;
+   struct nbio_uring_t* handle = (struct nbio_uring_t*)
+      calloc(1, sizeof(struct nbio_uring_t));
+
+   if (!handle)
+      return NULL;
+
+   handle->ring_fd = -1;
+
+   if (!nbio_uring_init_ring(handle))
+   {
+      nbio_uring_deinit_ring(handle);
+      if (!(handle->fallback = nbio_stdio.open(filename, mode)))
+      {
+         free(handle);
+         return NULL;
+      }
+      return handle;
+   }
+
+   if ((fd = open(filename, o_flags[mode]|O_CLOEXEC, 0644)) < 0)
+      goto error;
+
+   if ((len = lseek(fd, 0, SEEK_END)) < 0)
+   {
+      close(fd);
+      goto error;
+   }
+
+   handle->fd   = fd;
+   handle->mode = mode;
+   handle->len  = (size_t)len;
+   handle->ptr  = malloc(handle->len);
+
+   if (handle->len && !handle->ptr)
+   {
+      close(fd);
+      goto error;
+   }
+
+   return handle;
+
+error:
+   nbio_uring_deinit_ring(handle);
+   free(handle);
+   return NULL;
+}
+
+static void nbio_uring_begin_read(void *data)
+{
+   struct nbio_uring_t* handle = (struct nbio_uring_t*)data;
+   if (!handle)
+      return;
+   if (handle->fallback)
+      nbio_stdio.begin_read(handle->fallback);
+   else
+      nbio_uring_begin_op(handle, false);
+}
+
+static void nbio_uring_begin_write(void *data)
+{
+   struct nbio_uring_t* handle = (struct nbio_uring_t*)data;
+   if (!handle)
+      return;
+   if (handle->fallback)
+      nbio_stdio.begin_write(handle->fallback);
+   else
+      nbio_uring_begin_op(handle, true);
+}
+
+static bool nbio_uring_iterate(void *data)
+{
+   struct nbio_uring_t* handle = (struct nbio_uring_t*)data;
+   if (!handle)
+      return false;
+   if (handle->fallback)
+      return nbio_stdio.iterate(handle->fallback);
+
+   while (handle->busy)
+   {
+      nbio_uring_reap(handle);
+      nbio_uring_submit(handle);
+
+      if (!handle->inflight && handle->next >= handle->len)
+         handle->busy = false;
+      /* BIO_READ and BIO_WRITE block until done */
+      else if (handle->mode == BIO_READ || handle->mode == BIO_WRITE)
+         io_uring_enter(handle->ring_fd, 0, 1, IORING_ENTER_GETEVENTS);
+      else
+         break;
+   }
+
+   return !handle->busy;
+}
+
+static void nbio_uring_resize(void *data, size_t len)
+{
+   void *ptr;
+   struct nbio_uring_t* handle = (struct nbio_uring_t*)data;
+   if (!handle)
+      return;
+   if (handle->fallback)
+   {
+      nbio_stdio.resize(handle->fallback, len);
+      return;
+   }
+
+   /* Same restrictions as the other implementations */
+   if (handle->busy || len < handle->len)
+      abort();
+
+   if (ftruncate(handle->fd, len) != 0)
+      abort();
+
+   if (!(ptr = realloc(handle->ptr, len)))
+      abort();
+
+   /* The buffer moved, it is registered again on the next operation */
+   if (handle->registered)
+   {
+      io_uring_register(handle->ring_fd, IORING_UNREGISTER_BUFFERS, NULL, 0);
+      handle->registered = false;
+   }
+
+   handle->ptr = ptr;
+   handle->len = len;
+}
+
+static void *nbio_uring_get_ptr(void *data, size_t* len)
+{
+   struct nbio_uring_t* handle = (struct nbio_uring_t*)data;
+   if (!handle)
+      return NULL;
+   if (handle->fallback)
+      return nbio_stdio.get_ptr(handle->fallback, len);
+   if (len)
+      *len = handle->len;
+   if (!handle->busy)
+      return handle->ptr;
+   return NULL;
+}
+
+static void nbio_uring_cancel(void *data)
+{
+   struct nbio_uring_t* handle = (struct nbio_uring_t*)data;
+   if (!handle)
+      return;
+   if (handle->fallback)
+   {
+      nbio_stdio.cancel(handle->fallback);
+      return;
+   }
+
+   /* The kernel may still write to the buffer,
+    * so wait for what was already submitted */
+   handle->busy = false;
+   handle->next = handle->len;
+
+   while (handle->inflight)
+   {
+      if (handle->pending)
+         nbio_uring_submit(handle);
+      io_uring_enter(handle->ring_fd, 0, 1, IORING_ENTER_GETEVENTS);
+      nbio_uring_reap(handle);
+   }
+}
+
+static void nbio_uring_free(void *data)
+{
+   struct nbio_uring_t* handle = (struct nbio_uring_t*)data;
+   if (!handle)
+      return;
+
+   if (handle->fallback)
+      nbio_stdio.free(handle->fallback);
+   else
+   {
+      nbio_uring_cancel(handle);
+      nbio_uring_deinit_ring(handle);
+      close(handle->fd);
+      free(handle->ptr);
+   }
+   free(handle);
+}
+
+nbio_intf_t nbio_uring = {
+   nbio_uring_open,
+   nbio_uring_begin_read,
+   nbio_uring_begin_write,
+   nbio_uring_iterate,
+   nbio_uring_resize,
+   nbio_uring_get_ptr,
+   nbio_uring_cancel,
+   nbio_uring_free,
+   "nbio_uring",
+};
+#else
+nbio_intf_t nbio_uring = {
+   NULL,
+   NULL,
+   NULL,
+   NULL,
+   NULL,
+   NULL,
+   NULL,
+   NULL,
+   "nbio_uring",
+};
+
+#endif
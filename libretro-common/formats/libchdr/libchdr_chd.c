@@ -62,6 +62,10 @@
 #include <retro_inline.h>
 #include <streams/file_stream.h>
 
+#ifdef HAVE_THREADS
+#include <rthreads/rthreads.h>
+#endif
+
 #define TRUE 1
 #define FALSE 0
 
@@ -191,6 +195,10 @@ struct _metadata_entry
 };
 
 /* internal representation of an open CHD file */
+#ifdef HAVE_THREADS
+typedef struct _chd_pool chd_pool;
+#endif
+
 struct _chd_file
 {
 	UINT32					cookie;			/* cookie, should equal COOKIE_VALUE */
@@ -229,7 +237,41 @@ struct _chd_file
 	UINT32					maxhunk;		/* maximum hunk accessed */
 #endif
    UINT8 *              file_cache; /* cache of underlying file */
+
+#ifdef HAVE_THREADS
+	chd_pool *				pool;			/* decoders for chd_read_hunks(), or NULL */
+	slock_t *				file_lock;		/* serializes file reads while the pool is in use */
+#endif
+};
+
+#ifdef HAVE_THREADS
+/* a decoder on its own thread; shares the file, header and map of
+   the owner and has its own codecs and compressed buffer */
+typedef struct _chd_worker chd_worker;
+struct _chd_worker
+{
+	chd_file				decoder;
+	chd_pool *				pool;
+	sthread_t *				thread;
+};
+
+struct _chd_pool
+{
+	chd_worker *			workers;
+	UINT32					count;			/* number of worker threads */
+	slock_t *				lock;			/* protects the batch */
+	scond_t *				cond;			/* signalled on new work and on completion */
+
+	/* current batch, hunks are claimed by incrementing next */
+	UINT8 *					dest;
+	UINT32					first;
+	UINT32					total;
+	UINT32					next;
+	UINT32					done;
+	chd_error				err;
+	int						quit;
 };
+#endif
 
 /***************************************************************************
     GLOBAL VARIABLES
@@ -1037,6 +1079,10 @@ void chd_close(chd_file *chd)
 	if (chd == NULL || chd->cookie != COOKIE_VALUE)
 		return;
 
+#ifdef HAVE_THREADS
+	chd_set_threads(chd, 1);
+#endif
+
 	/* deinit the codec */
 	if (chd->header.version < 5)
 	{
@@ -1209,6 +1255,313 @@ chd_error chd_read(chd_file *chd, UINT32 hunknum, void *buffer)
 	return hunk_read_into_memory(chd, hunknum, (UINT8 *)buffer);
 }
 
+#ifdef HAVE_THREADS
+/*-------------------------------------------------
+    decoder_codec - return the state of the
+    given codec
+-------------------------------------------------*/
+
+static void *decoder_codec(chd_file *chd, int decompnum)
+{
+	if (chd->header.version < 5)
+	{
+#ifdef HAVE_ZLIB
+		return &chd->zlib_codec_data;
+#else
+		return NULL;
+#endif
+	}
+
+	switch (chd->codecintf[decompnum]->compression)
+	{
+		case CHD_CODEC_ZLIB:
+#ifdef HAVE_ZLIB
+			return &chd->zlib_codec_data;
+#endif
+			break;
+		case CHD_CODEC_CD_ZLIB:
+#ifdef HAVE_ZLIB
+			return &chd->cdzl_codec_data;
+#endif
+			break;
+		case CHD_CODEC_CD_LZMA:
+#ifdef HAVE_7ZIP
+			return &chd->cdlz_codec_data;
+#endif
+			break;
+		case CHD_CODEC_CD_FLAC:
+#ifdef HAVE_FLAC
+			return &chd->cdfl_codec_data;
+#endif
+			break;
+	}
+	return NULL;
+}
+
+/*-------------------------------------------------
+    decoder_free - free the codecs and buffer
+    of a worker's decoder
+-------------------------------------------------*/
+
+static void decoder_free(chd_file *decoder)
+{
+	int i;
+
+	for (i = 0; i < 4; i++)
+	{
+		void *codec;
+		if (decoder->codecintf[i] == NULL || decoder->codecintf[i]->free == NULL)
+			continue;
+		if ((codec = decoder_codec(decoder, i)) != NULL)
+			(*decoder->codecintf[i]->free)(codec);
+	}
+
+	if (decoder->compressed != NULL)
+		free(decoder->compressed);
+}
+
+/*-------------------------------------------------
+    decoder_init - set up a decoder which reads
+    the same file as the given CHD
+-------------------------------------------------*/
+
+static chd_error decoder_init(chd_file *chd, chd_file *decoder)
+{
+	int i;
+
+	memset(decoder, 0, sizeof(*decoder));
+	decoder->cookie     = COOKIE_VALUE;
+	decoder->file       = chd->file;
+	decoder->header     = chd->header;
+	decoder->map        = chd->map;
+	decoder->file_cache = chd->file_cache;
+	decoder->file_lock  = chd->file_lock;
+	memcpy(decoder->codecintf, chd->codecintf, sizeof(decoder->codecintf));
+
+	decoder->compressed = (UINT8 *)malloc(chd->header.hunkbytes);
+	if (decoder->compressed == NULL)
+		return CHDERR_OUT_OF_MEMORY;
+
+	for (i = 0; i < 4; i++)
+	{
+		void *codec;
+		if (decoder->codecintf[i] == NULL || decoder->codecintf[i]->init == NULL)
+			continue;
+		if ((codec = decoder_codec(decoder, i)) == NULL)
+			continue;
+		if ((*decoder->codecintf[i]->init)(codec, chd->header.hunkbytes) != CHDERR_NONE)
+		{
+			/* only free what was initialized */
+			decoder->codecintf[i] = NULL;
+			while (++i < 4)
+				decoder->codecintf[i] = NULL;
+			return CHDERR_CODEC_ERROR;
+		}
+	}
+
+	return CHDERR_NONE;
+}
+
+/*-------------------------------------------------
+    worker_thread - decode hunks of the current
+    batch until told to quit
+-------------------------------------------------*/
+
+static void worker_thread(void *data)
+{
+	chd_worker *worker = (chd_worker *)data;
+	chd_pool *pool     = worker->pool;
+
+	slock_lock(pool->lock);
+	for (;;)
+	{
+		UINT32 index;
+		chd_error err;
+
+		while (!pool->quit && pool->next >= pool->total)
+			scond_wait(pool->cond, pool->lock);
+		if (pool->quit)
+			break;
+
+		index = pool->next++;
+		slock_unlock(pool->lock);
+
+		err = hunk_read_into_memory(&worker->decoder, pool->first + index,
+				pool->dest + (size_t)index * worker->decoder.header.hunkbytes);
+
+		slock_lock(pool->lock);
+		if (err != CHDERR_NONE)
+			pool->err = err;
+		if (++pool->done == pool->total)
+			scond_broadcast(pool->cond);
+	}
+	slock_unlock(pool->lock);
+}
+#endif
+
+/*-------------------------------------------------
+    chd_set_threads - decompress with up to the
+    given number of threads in chd_read_hunks
+-------------------------------------------------*/
+
+chd_error chd_set_threads(chd_file *chd, UINT32 threads)
+{
+#ifdef HAVE_THREADS
+	chd_pool *pool;
+	UINT32 i;
+#endif
+
+	/* punt if NULL or invalid */
+	if (chd == NULL || chd->cookie != COOKIE_VALUE)
+		return CHDERR_INVALID_PARAMETER;
+
+#ifdef HAVE_THREADS
+	/* stop the current workers */
+	if ((pool = chd->pool) != NULL)
+	{
+		slock_lock(pool->lock);
+		pool->quit = 1;
+		scond_broadcast(pool->cond);
+		slock_unlock(pool->lock);
+
+		for (i = 0; i < pool->count; i++)
+		{
+			sthread_join(pool->workers[i].thread);
+			decoder_free(&pool->workers[i].decoder);
+		}
+
+		free(pool->workers);
+		scond_free(pool->cond);
+		slock_free(pool->lock);
+		slock_free(chd->file_lock);
+		free(pool);
+		chd->pool      = NULL;
+		chd->file_lock = NULL;
+	}
+
+	/* the calling thread decodes too; hunks of a parent are read
+	   through the parent's own state, so those stay serial */
+	if (threads <= 1 || chd->parent != NULL)
+		return CHDERR_NONE;
+
+	pool = (chd_pool *)calloc(1, sizeof(*pool));
+	if (pool == NULL)
+		return CHDERR_OUT_OF_MEMORY;
+
+	pool->workers  = (chd_worker *)calloc(threads - 1, sizeof(*pool->workers));
+	pool->lock     = slock_new();
+	pool->cond     = scond_new();
+	chd->file_lock = slock_new();
+	chd->pool      = pool;
+	if (pool->workers == NULL || pool->lock == NULL || pool->cond == NULL || chd->file_lock == NULL)
+		goto error;
+
+	for (i = 0; i < threads - 1; i++)
+	{
+		chd_worker *worker = &pool->workers[i];
+		worker->pool       = pool;
+		if (decoder_init(chd, &worker->decoder) != CHDERR_NONE)
+		{
+			decoder_free(&worker->decoder);
+			goto error;
+		}
+		if ((worker->thread = sthread_create(worker_thread, worker)) == NULL)
+		{
+			decoder_free(&worker->decoder);
+			goto error;
+		}
+		pool->count++;
+	}
+
+	return CHDERR_NONE;
+
+error:
+	if (pool->count)
+		chd_set_threads(chd, 1);
+	else
+	{
+		if (pool->cond)
+			scond_free(pool->cond);
+		if (pool->lock)
+			slock_free(pool->lock);
+		if (chd->file_lock)
+			slock_free(chd->file_lock);
+		free(pool->workers);
+		free(pool);
+		chd->pool      = NULL;
+		chd->file_lock = NULL;
+	}
+	return CHDERR_OUT_OF_MEMORY;
+#else
+	return CHDERR_NONE;
+#endif
+}
+
+/*-------------------------------------------------
+    chd_read_hunks - read consecutive hunks,
+    decompressing them in parallel if threads
+    were set up
+-------------------------------------------------*/
+
+chd_error chd_read_hunks(chd_file *chd, UINT32 hunknum, UINT32 count, void *buffer)
+{
+	UINT32 i;
+	UINT8 *dest = (UINT8 *)buffer;
+
+	/* punt if NULL or invalid */
+	if (chd == NULL || chd->cookie != COOKIE_VALUE || buffer == NULL)
+		return CHDERR_INVALID_PARAMETER;
+
+	if (hunknum >= chd->header.totalhunks || count > chd->header.totalhunks - hunknum)
+		return CHDERR_HUNK_OUT_OF_RANGE;
+
+#ifdef HAVE_THREADS
+	if (chd->pool != NULL && count > 1)
+	{
+		chd_error err;
+		chd_pool *pool = chd->pool;
+
+		slock_lock(pool->lock);
+		pool->dest  = dest;
+		pool->first = hunknum;
+		pool->total = count;
+		pool->next  = 0;
+		pool->done  = 0;
+		pool->err   = CHDERR_NONE;
+		scond_broadcast(pool->cond);
+
+		/* help out */
+		while (pool->next < pool->total)
+		{
+			i = pool->next++;
+			slock_unlock(pool->lock);
+			err = hunk_read_into_memory(chd, hunknum + i, dest + (size_t)i * chd->header.hunkbytes);
+			slock_lock(pool->lock);
+			if (err != CHDERR_NONE)
+				pool->err = err;
+			pool->done++;
+		}
+
+		while (pool->done < pool->total)
+			scond_wait(pool->cond, pool->lock);
+
+		err         = pool->err;
+		pool->total = 0;
+		slock_unlock(pool->lock);
+		return err;
+	}
+#endif
+
+	for (i = 0; i < count; i++)
+	{
+		chd_error err = hunk_read_into_memory(chd, hunknum + i, dest + (size_t)i * chd->header.hunkbytes);
+		if (err != CHDERR_NONE)
+			return err;
+	}
+
+	return CHDERR_NONE;
+}
+
 /***************************************************************************
     METADATA MANAGEMENT
 ***************************************************************************/
@@ -1569,8 +1922,16 @@ static UINT8* hunk_read_compressed(chd_file *chd, UINT64 offset, size_t size)
    int64_t bytes;
    if (chd->file_cache)
       return chd->file_cache + offset;
+#ifdef HAVE_THREADS
+   if (chd->file_lock)
+      slock_lock(chd->file_lock);
+#endif
    filestream_seek(chd->file, offset, SEEK_SET);
    bytes = filestream_read(chd->file, chd->compressed, size);
+#ifdef HAVE_THREADS
+   if (chd->file_lock)
+      slock_unlock(chd->file_lock);
+#endif
    if (bytes != size)
       return NULL;
    return chd->compressed;
@@ -1589,8 +1950,16 @@ static chd_error hunk_read_uncompressed(chd_file *chd, UINT64 offset, size_t siz
       memcpy(dest, chd->file_cache + offset, size);
       return CHDERR_NONE;
    }
+#ifdef HAVE_THREADS
+   if (chd->file_lock)
+      slock_lock(chd->file_lock);
+#endif
    filestream_seek(chd->file, offset, SEEK_SET);
    bytes = filestream_read(chd->file, dest, size);
+#ifdef HAVE_THREADS
+   if (chd->file_lock)
+      slock_unlock(chd->file_lock);
+#endif
    if (bytes != size)
       return CHDERR_READ_ERROR;
    return CHDERR_NONE;
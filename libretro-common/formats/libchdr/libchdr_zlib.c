@@ -174,10 +174,7 @@ chd_error zlib_codec_init(void *codec, uint32_t hunkbytes)
 	else
 		err = CHDERR_NONE;
 
-   /* handle an error */
-   if (err != CHDERR_NONE)
-      free(data);
-
+	/* data is owned by the caller, usually embedded in chd_file */
 	return err;
 }
 
@@ -324,6 +324,16 @@ bool gl_check_capability(enum gl_capability_enum enum_idx)
 #else
          if (gl_query_extension("EXT_texture_storage"))
             return true;
+#endif
+         break;
+      case GL_CAPS_BUFFER_STORAGE:
+         /* Persistently mapped buffers. Only wired up for
+          * desktop GL, where glBufferStorage is core in 4.4. */
+#if !defined(HAVE_OPENGLES) && defined(GL_MAP_PERSISTENT_BIT)
+         if ((major > 4 || (major == 4 && minor >= 4))
+               || gl_query_extension("ARB_buffer_storage"))
+            if (glBufferStorage && glMapBufferRange)
+               return true;
 #endif
          break;
       case GL_CAPS_NONE:
@@ -30,6 +30,250 @@
 #include <gfx/scaler/filter.h>
 #include <gfx/scaler/pixconv.h>
 
+#ifdef HAVE_THREADS
+#include <rthreads/rthreads.h>
+#endif
+
+/* Runs the input conversion and horizontal pass over input rows
+ * [first_row, last_row). Rows are independent in this stage. */
+static void scaler_ctx_scale_horiz_rows(const struct scaler_ctx *ctx,
+      const void *input, int first_row, int last_row)
+{
+   const void *input_frame = input;
+   int input_stride        = ctx->in_stride;
+
+   if (ctx->in_fmt != SCALER_FMT_ARGB8888)
+   {
+      ctx->in_pixconv(
+            (uint8_t*)ctx->input.frame + first_row * ctx->input.stride,
+            (const uint8_t*)input      + first_row * ctx->in_stride,
+            ctx->in_width, last_row - first_row,
+            ctx->input.stride, ctx->in_stride);
+
+      input_frame       = ctx->input.frame;
+      input_stride      = ctx->input.stride;
+   }
+
+   if (ctx->scaler_horiz)
+      ctx->scaler_horiz(ctx, input_frame, input_stride,
+            first_row, last_row);
+}
+
+/* Runs the vertical pass and output conversion over output rows
+ * [first_row, last_row). Requires the whole horizontal pass to
+ * have completed, since a row may sample any scaled row. */
+static void scaler_ctx_scale_vert_rows(const struct scaler_ctx *ctx,
+      void *output, int first_row, int last_row)
+{
+   void *output_frame      = output;
+   int output_stride       = ctx->out_stride;
+
+   if (ctx->out_fmt != SCALER_FMT_ARGB8888)
+   {
+      output_frame  = ctx->output.frame;
+      output_stride = ctx->output.stride;
+   }
+
+   if (ctx->scaler_vert)
+      ctx->scaler_vert(ctx, output_frame, output_stride,
+            first_row, last_row);
+
+   if (ctx->out_fmt != SCALER_FMT_ARGB8888)
+      ctx->out_pixconv(
+            (uint8_t*)output                 + first_row * ctx->out_stride,
+            (const uint8_t*)ctx->output.frame + first_row * ctx->output.stride,
+            ctx->out_width, last_row - first_row,
+            ctx->out_stride, ctx->output.stride);
+}
+
+#ifdef HAVE_THREADS
+enum scaler_job
+{
+   SCALER_JOB_NONE = 0,
+   SCALER_JOB_HORIZ,
+   SCALER_JOB_VERT,
+   SCALER_JOB_QUIT
+};
+
+struct scaler_worker
+{
+   struct scaler_thread_pool *pool;
+   sthread_t *thread;
+   unsigned index;
+};
+
+struct scaler_thread_pool
+{
+   struct scaler_worker *workers;
+   slock_t *lock;
+   scond_t *cond_job;
+   scond_t *cond_done;
+   const struct scaler_ctx *ctx;
+   const void *input;
+   void *output;
+
+   enum scaler_job job;
+   unsigned num_workers;
+   unsigned pending;
+   unsigned generation;
+};
+
+/* Slice 'index' out of 'num_slices' for the given job. The
+ * calling thread always takes slice 0, worker N takes slice N. */
+static void scaler_thread_pool_run_slice(
+      const struct scaler_thread_pool *pool,
+      enum scaler_job job, unsigned index)
+{
+   unsigned num_slices = pool->num_workers + 1;
+
+   switch (job)
+   {
+      case SCALER_JOB_HORIZ:
+         scaler_ctx_scale_horiz_rows(pool->ctx, pool->input,
+               pool->ctx->in_height * index       / num_slices,
+               pool->ctx->in_height * (index + 1) / num_slices);
+         break;
+      case SCALER_JOB_VERT:
+         scaler_ctx_scale_vert_rows(pool->ctx, pool->output,
+               pool->ctx->out_height * index       / num_slices,
+               pool->ctx->out_height * (index + 1) / num_slices);
+         break;
+      default:
+         break;
+   }
+}
+
+static void scaler_thread_pool_worker(void *data)
+{
+   struct scaler_worker *worker     = (struct scaler_worker*)data;
+   struct scaler_thread_pool *pool  = worker->pool;
+   unsigned generation              = 0;
+
+   slock_lock(pool->lock);
+
+   for (;;)
+   {
+      enum scaler_job job;
+
+      while (pool->generation == generation)
+         scond_wait(pool->cond_job, pool->lock);
+
+      generation = pool->generation;
+      job        = pool->job;
+
+      if (job == SCALER_JOB_QUIT)
+         break;
+
+      slock_unlock(pool->lock);
+      scaler_thread_pool_run_slice(pool, job, worker->index);
+      slock_lock(pool->lock);
+
+      if (--pool->pending == 0)
+         scond_signal(pool->cond_done);
+   }
+
+   slock_unlock(pool->lock);
+}
+
+static void scaler_thread_pool_dispatch(struct scaler_thread_pool *pool,
+      enum scaler_job job)
+{
+   slock_lock(pool->lock);
+   pool->job     = job;
+   pool->pending = pool->num_workers;
+   pool->generation++;
+   scond_broadcast(pool->cond_job);
+   slock_unlock(pool->lock);
+}
+
+static void scaler_thread_pool_run(struct scaler_thread_pool *pool,
+      enum scaler_job job)
+{
+   scaler_thread_pool_dispatch(pool, job);
+
+   scaler_thread_pool_run_slice(pool, job, 0);
+
+   slock_lock(pool->lock);
+   while (pool->pending)
+      scond_wait(pool->cond_done, pool->lock);
+   slock_unlock(pool->lock);
+}
+
+static void scaler_thread_pool_free(struct scaler_thread_pool *pool)
+{
+   unsigned i;
+
+   if (!pool)
+      return;
+
+   if (pool->workers)
+   {
+      scaler_thread_pool_dispatch(pool, SCALER_JOB_QUIT);
+
+      for (i = 0; i < pool->num_workers; i++)
+         if (pool->workers[i].thread)
+            sthread_join(pool->workers[i].thread);
+
+      free(pool->workers);
+   }
+
+   if (pool->cond_done)
+      scond_free(pool->cond_done);
+   if (pool->cond_job)
+      scond_free(pool->cond_job);
+   if (pool->lock)
+      slock_free(pool->lock);
+
+   free(pool);
+}
+
+static struct scaler_thread_pool *scaler_thread_pool_new(
+      const struct scaler_ctx *ctx, unsigned num_workers)
+{
+   unsigned i;
+   struct scaler_thread_pool *pool = (struct scaler_thread_pool*)
+      calloc(1, sizeof(*pool));
+
+   if (!pool)
+      return NULL;
+
+   pool->ctx       = ctx;
+   pool->lock      = slock_new();
+   pool->cond_job  = scond_new();
+   pool->cond_done = scond_new();
+
+   if (!pool->lock || !pool->cond_job || !pool->cond_done)
+      goto error;
+
+   pool->workers   = (struct scaler_worker*)
+      calloc(num_workers, sizeof(*pool->workers));
+   if (!pool->workers)
+      goto error;
+
+   for (i = 0; i < num_workers; i++)
+   {
+      pool->workers[i].pool   = pool;
+      pool->workers[i].index  = i + 1;
+      pool->workers[i].thread = sthread_create(
+            scaler_thread_pool_worker, &pool->workers[i]);
+
+      if (!pool->workers[i].thread)
+         break;
+
+      pool->num_workers++;
+   }
+
+   if (!pool->num_workers)
+      goto error;
+
+   return pool;
+
+error:
+   scaler_thread_pool_free(pool);
+   return NULL;
+}
+#endif
+
 static bool allocate_frames(struct scaler_ctx *ctx)
 {
    uint64_t *scaled_frame = NULL;
@@ -261,6 +505,15 @@ bool scaler_ctx_gen_filter(struct scaler_ctx *ctx)
 
       if (!scaler_gen_filter(ctx))
          return false;
+
+#ifdef HAVE_THREADS
+      /* Not worth it for tiny images; a failure to spawn
+       * threads just leaves the context single-threaded. */
+      if (     ctx->threads > 1
+            && !ctx->scaler_special
+            && ctx->out_height >= (int)ctx->threads * 8)
+         ctx->pool = scaler_thread_pool_new(ctx, ctx->threads - 1);
+#endif
    }
 
    return true;
@@ -282,6 +535,9 @@ void scaler_ctx_gen_reset(struct scaler_ctx *ctx)
       free(ctx->input.frame);
    if (ctx->output.frame)
       free(ctx->output.frame);
+#ifdef HAVE_THREADS
+   scaler_thread_pool_free(ctx->pool);
+#endif
 
    ctx->horiz.filter        = NULL;
    ctx->horiz.filter_len    = 0;
@@ -303,6 +559,8 @@ void scaler_ctx_gen_reset(struct scaler_ctx *ctx)
 
    ctx->output.frame        = NULL;
    ctx->output.stride       = 0;
+
+   ctx->pool                = NULL;
 }
 
 /**
@@ -316,44 +574,56 @@ void scaler_ctx_gen_reset(struct scaler_ctx *ctx)
 void scaler_ctx_scale(struct scaler_ctx *ctx,
       void *output, const void *input)
 {
-   const void *input_frame = input;
-   void *output_frame      = output;
-   int input_stride        = ctx->in_stride;
-   int output_stride       = ctx->out_stride;
-
-   if (ctx->in_fmt != SCALER_FMT_ARGB8888)
+   /* Take some special, and (hopefully) more optimized path. */
+   if (ctx->scaler_special)
    {
-      ctx->in_pixconv(ctx->input.frame, input,
-            ctx->in_width, ctx->in_height,
-            ctx->input.stride, ctx->in_stride);
+      const void *input_frame = input;
+      void *output_frame      = output;
+      int input_stride        = ctx->in_stride;
+      int output_stride       = ctx->out_stride;
 
-      input_frame       = ctx->input.frame;
-      input_stride      = ctx->input.stride;
-   }
+      if (ctx->in_fmt != SCALER_FMT_ARGB8888)
+      {
+         ctx->in_pixconv(ctx->input.frame, input,
+               ctx->in_width, ctx->in_height,
+               ctx->input.stride, ctx->in_stride);
 
-   if (ctx->out_fmt != SCALER_FMT_ARGB8888)
-   {
-      output_frame  = ctx->output.frame;
-      output_stride = ctx->output.stride;
-   }
+         input_frame       = ctx->input.frame;
+         input_stride      = ctx->input.stride;
+      }
+
+      if (ctx->out_fmt != SCALER_FMT_ARGB8888)
+      {
+         output_frame  = ctx->output.frame;
+         output_stride = ctx->output.stride;
+      }
 
-   /* Take some special, and (hopefully) more optimized path. */
-   if (ctx->scaler_special)
       ctx->scaler_special(ctx, output_frame, input_frame,
             ctx->out_width, ctx->out_height,
             ctx->in_width, ctx->in_height,
             output_stride, input_stride);
-   else
+
+      if (ctx->out_fmt != SCALER_FMT_ARGB8888)
+         ctx->out_pixconv(output, ctx->output.frame,
+               ctx->out_width, ctx->out_height,
+               ctx->out_stride, ctx->output.stride);
+      return;
+   }
+
+   /* Take generic filter path. */
+#ifdef HAVE_THREADS
+   if (ctx->pool)
    {
-      /* Take generic filter path. */
-      if (ctx->scaler_horiz)
-         ctx->scaler_horiz(ctx, input_frame, input_stride);
-      if (ctx->scaler_vert)
-         ctx->scaler_vert (ctx, output, output_stride);
+      ctx->pool->ctx    = ctx;
+      ctx->pool->input  = input;
+      ctx->pool->output = output;
+
+      scaler_thread_pool_run(ctx->pool, SCALER_JOB_HORIZ);
+      scaler_thread_pool_run(ctx->pool, SCALER_JOB_VERT);
+      return;
    }
+#endif
 
-   if (ctx->out_fmt != SCALER_FMT_ARGB8888)
-      ctx->out_pixconv(output, ctx->output.frame,
-            ctx->out_width, ctx->out_height,
-            ctx->out_stride, ctx->output.stride);
+   scaler_ctx_scale_horiz_rows(ctx, input, 0, ctx->in_height);
+   scaler_ctx_scale_vert_rows(ctx, output, 0, ctx->out_height);
 }
@@ -25,7 +25,14 @@
 #include <retro_inline.h>
 
 #ifdef SCALER_NO_SIMD
+#undef __AVX2__
 #undef __SSE2__
+#undef __ARM_NEON__
+#undef HAVE_NEON
+#endif
+
+#if defined(__AVX2__)
+#include <immintrin.h>
 #endif
 
 #if defined(__SSE2__)
@@ -33,6 +40,8 @@
 #ifdef _WIN32
 #include <intrin.h>
 #endif
+#elif defined(__ARM_NEON__) || defined(HAVE_NEON)
+#include <arm_neon.h>
 #endif
 
 /* ARGB8888 scaler is split in two:
@@ -60,60 +69,148 @@
  *
  * The C version of scalers perform the exact same operations as the
  * SIMD code for testing purposes.
+ *
+ * The SIMD paths process several output pixels per iteration; since each
+ * pixel occupies 64 bits in the intermediate frame, a 128-bit vector
+ * holds two of them (four with AVX2).
  */
 
-void scaler_argb8888_vert(const struct scaler_ctx *ctx, void *output_, int stride)
+#if !defined(__SSE2__) && (defined(__ARM_NEON__) || defined(HAVE_NEON))
+/* NEON has no plain 16-bit mulhi; vqdmulh computes (2 * a * b) >> 16,
+ * so one more arithmetic shift gives the exact (a * b) >> 16. */
+#define SCALER_MULHI_NEON(a, b)   vshrq_n_s16(vqdmulhq_s16((a), (b)), 1)
+#define SCALER_MULHI_N_NEON(a, b) vshrq_n_s16(vqdmulhq_n_s16((a), (b)), 1)
+#endif
+
+/* Both passes take a [first_row, last_row) range so that
+ * scaler_ctx_scale() can split a frame across threads. */
+void scaler_argb8888_vert(const struct scaler_ctx *ctx, void *output_,
+      int stride, int first_row, int last_row)
 {
    int h, w, y;
    const uint64_t      *input = ctx->scaled.frame;
-   uint32_t           *output = (uint32_t*)output_;
+   uint32_t           *output = (uint32_t*)output_
+      + first_row * (stride >> 2);
+   int          scaled_stride = ctx->scaled.stride >> 3;
 
-   const int16_t *filter_vert = ctx->vert.filter;
+   const int16_t *filter_vert = ctx->vert.filter
+      + first_row * ctx->vert.filter_stride;
 
-   for (h = 0; h < ctx->out_height; h++,
+   for (h = first_row; h < last_row; h++,
          filter_vert += ctx->vert.filter_stride, output += stride >> 2)
    {
       const uint64_t *input_base = input + ctx->vert.filter_pos[h]
-         * (ctx->scaled.stride >> 3);
+         * scaled_stride;
+
+      w = 0;
 
-      for (w = 0; w < ctx->out_width; w++)
+#if defined(__AVX2__)
+      /* Four pixels per iteration. */
+      for (; w + 4 <= ctx->out_width; w += 4)
       {
          const uint64_t *input_base_y = input_base + w;
+         __m256i res = _mm256_setzero_si256();
+
+         for (y = 0; y < ctx->vert.filter_len; y++,
+               input_base_y += scaled_stride)
+         {
+            __m256i coeff = _mm256_set1_epi16(filter_vert[y]);
+            __m256i col   = _mm256_loadu_si256((const __m256i*)input_base_y);
+
+            res           = _mm256_adds_epi16(_mm256_mulhi_epi16(col, coeff), res);
+         }
+
+         res = _mm256_srai_epi16(res, (7 - 2 - 2));
+         res = _mm256_packus_epi16(res, res);
+         /* packus works per 128-bit lane, gather both lanes' pixels. */
+         res = _mm256_permute4x64_epi64(res, _MM_SHUFFLE(3, 1, 2, 0));
+
+         _mm_storeu_si128((__m128i*)(output + w), _mm256_castsi256_si128(res));
+      }
+#endif
+
 #if defined(__SSE2__)
-         __m128i final;
+      /* Two pixels per iteration. */
+      for (; w + 2 <= ctx->out_width; w += 2)
+      {
+         const uint64_t *input_base_y = input_base + w;
          __m128i res = _mm_setzero_si128();
 
-         for (y = 0; (y + 1) < ctx->vert.filter_len; y += 2,
-               input_base_y += (ctx->scaled.stride >> 2))
+         for (y = 0; y < ctx->vert.filter_len; y++,
+               input_base_y += scaled_stride)
          {
-            __m128i coeff = _mm_set_epi64x(filter_vert[y + 1] * 0x0001000100010001ll, filter_vert[y + 0] * 0x0001000100010001ll);
-            __m128i col   = _mm_set_epi64x(input_base_y[ctx->scaled.stride >> 3], input_base_y[0]);
+            __m128i coeff = _mm_set1_epi16(filter_vert[y]);
+            __m128i col   = _mm_loadu_si128((const __m128i*)input_base_y);
 
             res           = _mm_adds_epi16(_mm_mulhi_epi16(col, coeff), res);
          }
 
-         for (; y < ctx->vert.filter_len; y++, input_base_y += (ctx->scaled.stride >> 3))
+         res = _mm_srai_epi16(res, (7 - 2 - 2));
+         _mm_storel_epi64((__m128i*)(output + w), _mm_packus_epi16(res, res));
+      }
+
+      for (; w < ctx->out_width; w++)
+      {
+         const uint64_t *input_base_y = input_base + w;
+         __m128i res = _mm_setzero_si128();
+
+         for (y = 0; y < ctx->vert.filter_len; y++,
+               input_base_y += scaled_stride)
          {
-            __m128i coeff = _mm_set_epi64x(0, filter_vert[y] * 0x0001000100010001ll);
-            __m128i col   = _mm_set_epi64x(0, input_base_y[0]);
+            __m128i coeff = _mm_set1_epi16(filter_vert[y]);
+            __m128i col   = _mm_loadl_epi64((const __m128i*)input_base_y);
 
             res           = _mm_adds_epi16(_mm_mulhi_epi16(col, coeff), res);
          }
 
-         res       = _mm_adds_epi16(_mm_srli_si128(res, 8), res);
          res       = _mm_srai_epi16(res, (7 - 2 - 2));
+         output[w] = _mm_cvtsi128_si32(_mm_packus_epi16(res, res));
+      }
+#elif defined(__ARM_NEON__) || defined(HAVE_NEON)
+      /* Two pixels per iteration. */
+      for (; w + 2 <= ctx->out_width; w += 2)
+      {
+         const uint64_t *input_base_y = input_base + w;
+         int16x8_t res = vdupq_n_s16(0);
 
-         final     = _mm_packus_epi16(res, res);
+         for (y = 0; y < ctx->vert.filter_len; y++,
+               input_base_y += scaled_stride)
+         {
+            int16x8_t col = vld1q_s16((const int16_t*)input_base_y);
+            res           = vqaddq_s16(SCALER_MULHI_N_NEON(col, filter_vert[y]), res);
+         }
 
-         output[w] = _mm_cvtsi128_si32(final);
+         res = vshrq_n_s16(res, (7 - 2 - 2));
+         vst1_u8((uint8_t*)(output + w), vqmovun_s16(res));
+      }
+
+      for (; w < ctx->out_width; w++)
+      {
+         const uint64_t *input_base_y = input_base + w;
+         int16x8_t res = vdupq_n_s16(0);
+
+         for (y = 0; y < ctx->vert.filter_len; y++,
+               input_base_y += scaled_stride)
+         {
+            int16x4_t col = vld1_s16((const int16_t*)input_base_y);
+            res           = vqaddq_s16(SCALER_MULHI_N_NEON(
+                     vcombine_s16(col, col), filter_vert[y]), res);
+         }
+
+         res = vshrq_n_s16(res, (7 - 2 - 2));
+         vst1_lane_u32(output + w, vreinterpret_u32_u8(vqmovun_s16(res)), 0);
+      }
 #else
+      for (; w < ctx->out_width; w++)
+      {
+         const uint64_t *input_base_y = input_base + w;
          int16_t res_a = 0;
          int16_t res_r = 0;
          int16_t res_g = 0;
          int16_t res_b = 0;
 
          for (y = 0; y < ctx->vert.filter_len; y++,
-               input_base_y += (ctx->scaled.stride >> 3))
+               input_base_y += scaled_stride)
          {
             uint64_t col   = *input_base_y;
 
@@ -140,41 +237,85 @@ void scaler_argb8888_vert(const struct scaler_ctx *ctx, void *output_, int strid
             (clamp_8bit(res_r) << 16) |
             (clamp_8bit(res_g) << 8)  |
             (clamp_8bit(res_b) << 0);
-#endif
       }
+#endif
    }
 }
 
-void scaler_argb8888_horiz(const struct scaler_ctx *ctx, const void *input_, int stride)
+void scaler_argb8888_horiz(const struct scaler_ctx *ctx, const void *input_,
+      int stride, int first_row, int last_row)
 {
    int h, w, x;
-   const uint32_t *input = (uint32_t*)input_;
-   uint64_t *output      = ctx->scaled.frame;
+   const uint32_t *input = (const uint32_t*)input_
+      + first_row * (stride >> 2);
+   uint64_t *output      = ctx->scaled.frame
+      + first_row * (ctx->scaled.stride >> 3);
 
-   for (h = 0; h < ctx->scaled.height; h++, input += stride >> 2,
+   for (h = first_row; h < last_row; h++, input += stride >> 2,
          output += ctx->scaled.stride >> 3)
    {
       const int16_t *filter_horiz = ctx->horiz.filter;
 
-      for (w = 0; w < ctx->scaled.width; w++,
+      w = 0;
+
+#if defined(__SSE2__)
+      /* Two output pixels per iteration, each vector holding
+       * two taps of both pixels. */
+      for (; w + 2 <= ctx->scaled.width; w += 2,
+            filter_horiz += ctx->horiz.filter_stride << 1)
+      {
+         const uint32_t *input_base_0 = input + ctx->horiz.filter_pos[w + 0];
+         const uint32_t *input_base_1 = input + ctx->horiz.filter_pos[w + 1];
+         const int16_t  *filter_0     = filter_horiz;
+         const int16_t  *filter_1     = filter_horiz + ctx->horiz.filter_stride;
+         __m128i res_0                = _mm_setzero_si128();
+         __m128i res_1                = _mm_setzero_si128();
+
+         for (x = 0; (x + 1) < ctx->horiz.filter_len; x += 2)
+         {
+            __m128i coeff_0 = _mm_unpacklo_epi64(
+                  _mm_set1_epi16(filter_0[x + 0]), _mm_set1_epi16(filter_0[x + 1]));
+            __m128i coeff_1 = _mm_unpacklo_epi64(
+                  _mm_set1_epi16(filter_1[x + 0]), _mm_set1_epi16(filter_1[x + 1]));
+            __m128i col     = _mm_unpacklo_epi64(
+                  _mm_loadl_epi64((const __m128i*)(input_base_0 + x)),
+                  _mm_loadl_epi64((const __m128i*)(input_base_1 + x)));
+            __m128i col_0   = _mm_slli_epi16(_mm_unpacklo_epi8(col, _mm_setzero_si128()), 7);
+            __m128i col_1   = _mm_slli_epi16(_mm_unpackhi_epi8(col, _mm_setzero_si128()), 7);
+
+            res_0           = _mm_adds_epi16(_mm_mulhi_epi16(col_0, coeff_0), res_0);
+            res_1           = _mm_adds_epi16(_mm_mulhi_epi16(col_1, coeff_1), res_1);
+         }
+
+         for (; x < ctx->horiz.filter_len; x++)
+         {
+            __m128i col     = _mm_unpacklo_epi64(
+                  _mm_cvtsi32_si128(input_base_0[x]),
+                  _mm_cvtsi32_si128(input_base_1[x]));
+            __m128i col_0   = _mm_slli_epi16(_mm_unpacklo_epi8(col, _mm_setzero_si128()), 7);
+            __m128i col_1   = _mm_slli_epi16(_mm_unpackhi_epi8(col, _mm_setzero_si128()), 7);
+
+            res_0           = _mm_adds_epi16(_mm_mulhi_epi16(col_0, _mm_set1_epi16(filter_0[x])), res_0);
+            res_1           = _mm_adds_epi16(_mm_mulhi_epi16(col_1, _mm_set1_epi16(filter_1[x])), res_1);
+         }
+
+         _mm_storeu_si128((__m128i*)(output + w), _mm_adds_epi16(
+                  _mm_unpacklo_epi64(res_0, res_1),
+                  _mm_unpackhi_epi64(res_0, res_1)));
+      }
+
+      for (; w < ctx->scaled.width; w++,
             filter_horiz += ctx->horiz.filter_stride)
       {
          const uint32_t *input_base_x = input + ctx->horiz.filter_pos[w];
-#if defined(__SSE2__)
          __m128i res = _mm_setzero_si128();
-#ifndef __x86_64__
-         union
-         {
-            uint32_t *u32;
-            uint64_t *u64;
-         } u;
-#endif
+
          for (x = 0; (x + 1) < ctx->horiz.filter_len; x += 2)
          {
-            __m128i coeff = _mm_set_epi64x(filter_horiz[x + 1] * 0x0001000100010001ll, filter_horiz[x + 0] * 0x0001000100010001ll);
-
-            __m128i col   = _mm_unpacklo_epi8(_mm_set_epi64x(0,
-                     ((uint64_t)input_base_x[x + 1] << 32) | input_base_x[x + 0]), _mm_setzero_si128());
+            __m128i coeff = _mm_unpacklo_epi64(
+                  _mm_set1_epi16(filter_horiz[x + 0]), _mm_set1_epi16(filter_horiz[x + 1]));
+            __m128i col   = _mm_unpacklo_epi8(_mm_loadl_epi64(
+                     (const __m128i*)(input_base_x + x)), _mm_setzero_si128());
 
             col           = _mm_slli_epi16(col, 7);
             res           = _mm_adds_epi16(_mm_mulhi_epi16(col, coeff), res);
@@ -182,23 +323,53 @@ void scaler_argb8888_horiz(const struct scaler_ctx *ctx, const void *input_, int
 
          for (; x < ctx->horiz.filter_len; x++)
          {
-            __m128i coeff = _mm_set_epi64x(0, filter_horiz[x] * 0x0001000100010001ll);
-            __m128i col   = _mm_unpacklo_epi8(_mm_set_epi32(0, 0, 0, input_base_x[x]), _mm_setzero_si128());
+            /* Upper half of 'col' is zero, so broadcasting is fine. */
+            __m128i coeff = _mm_set1_epi16(filter_horiz[x]);
+            __m128i col   = _mm_unpacklo_epi8(_mm_cvtsi32_si128(input_base_x[x]), _mm_setzero_si128());
 
             col           = _mm_slli_epi16(col, 7);
             res           = _mm_adds_epi16(_mm_mulhi_epi16(col, coeff), res);
          }
 
          res              = _mm_adds_epi16(_mm_srli_si128(res, 8), res);
+         _mm_storel_epi64((__m128i*)(output + w), res);
+      }
+#elif defined(__ARM_NEON__) || defined(HAVE_NEON)
+      for (; w < ctx->scaled.width; w++,
+            filter_horiz += ctx->horiz.filter_stride)
+      {
+         const uint32_t *input_base_x = input + ctx->horiz.filter_pos[w];
+         int16x8_t res                = vdupq_n_s16(0);
+         int16x4_t sum;
 
-#ifdef __x86_64__
-         output[w]        = _mm_cvtsi128_si64(res);
-#else /* 32-bit doesn't have si64. Do it in two steps. */
-         u.u64    = output + w;
-         u.u32[0] = _mm_cvtsi128_si32(res);
-         u.u32[1] = _mm_cvtsi128_si32(_mm_srli_si128(res, 4));
-#endif
+         for (x = 0; (x + 1) < ctx->horiz.filter_len; x += 2)
+         {
+            uint8x8_t px    = vreinterpret_u8_u32(vld1_u32(input_base_x + x));
+            int16x8_t col   = vreinterpretq_s16_u16(vshlq_n_u16(vmovl_u8(px), 7));
+            int16x8_t coeff = vcombine_s16(
+                  vdup_n_s16(filter_horiz[x + 0]), vdup_n_s16(filter_horiz[x + 1]));
+
+            res             = vqaddq_s16(SCALER_MULHI_NEON(col, coeff), res);
+         }
+
+         for (; x < ctx->horiz.filter_len; x++)
+         {
+            uint8x8_t px    = vreinterpret_u8_u32(vdup_n_u32(input_base_x[x]));
+            int16x8_t col   = vreinterpretq_s16_u16(vshlq_n_u16(vmovl_u8(px), 7));
+            int16x8_t coeff = vcombine_s16(
+                  vdup_n_s16(filter_horiz[x]), vdup_n_s16(0));
+
+            res             = vqaddq_s16(SCALER_MULHI_NEON(col, coeff), res);
+         }
+
+         sum = vqadd_s16(vget_low_s16(res), vget_high_s16(res));
+         vst1_s16((int16_t*)(output + w), sum);
+      }
 #else
+      for (; w < ctx->scaled.width; w++,
+            filter_horiz += ctx->horiz.filter_stride)
+      {
+         const uint32_t *input_base_x = input + ctx->horiz.filter_pos[w];
          int16_t res_a = 0;
          int16_t res_r = 0;
          int16_t res_g = 0;
@@ -226,8 +397,8 @@ void scaler_argb8888_horiz(const struct scaler_ctx *ctx, const void *input_, int
                ((uint64_t)res_r << 32)  |
                ((uint64_t)res_g << 16)  |
                ((uint64_t)res_b << 0);
-#endif
       }
+#endif
    }
 }
 
@@ -131,6 +131,8 @@ struct file_archive_file_backend
    uint32_t (*stream_crc_calculate)(uint32_t, const uint8_t *, size_t);
    int64_t (*compressed_file_read)(const char *path, const char *needle, void **buf,
          const char *optional_outfile);
+   /* Frees what the backend kept between reads, may be NULL */
+   void (*cache_free)(void);
    const char *ident;
 };
 
@@ -202,6 +204,44 @@ const struct file_archive_file_backend* file_archive_get_file_backend(const char
  **/
 uint32_t file_archive_get_file_crc32(const char *path);
 
+/**
+ * file_archive_cache_init:
+ *
+ * Enables caching between archive reads: the entry index of the
+ * last few archives, used to look up CRCs without parsing the
+ * archive again, and backend state such as the last decompressed
+ * 7z block. Without it every read starts from scratch.
+ **/
+void file_archive_cache_init(void);
+
+/* Frees all caches, must be called upon program termination */
+void file_archive_cache_deinit(void);
+
+/* For backends: whether caching is on, to skip work such as
+ * file_archive_get_fingerprint that only the caches need */
+bool file_archive_cache_is_enabled(void);
+
+/* For backends: locks the caches, returns false if caching is off */
+bool file_archive_cache_lock(void);
+
+void file_archive_cache_unlock(void);
+
+/**
+ * file_archive_get_fingerprint:
+ * @path                         : archive path
+ * @size                         : archive size
+ * @fingerprint                  : CRC32 of the first and last bytes,
+ *                                 and of the ZIP central directory
+ *
+ * Identifies the state of an archive without parsing it. 7z keeps
+ * a checksum of its headers in the first bytes; ZIP only records
+ * where its central directory is, so that directory is hashed too.
+ *
+ * Returns: true on success, otherwise false.
+ **/
+bool file_archive_get_fingerprint(const char *path,
+      int64_t *size, uint32_t *fingerprint);
+
 extern const struct file_archive_file_backend zlib_backend;
 extern const struct file_archive_file_backend sevenzip_backend;
 
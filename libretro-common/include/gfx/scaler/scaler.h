@@ -59,12 +59,15 @@ struct scaler_filter
    int      filter_stride;
 };
 
+struct scaler_thread_pool;
+
 struct scaler_ctx
 {
+   /* Horizontal and vertical passes take a [first, last) row range. */
    void (*scaler_horiz)(const struct scaler_ctx*,
-         const void*, int);
+         const void*, int, int, int);
    void (*scaler_vert)(const struct scaler_ctx*,
-         void*, int);
+         void*, int, int, int);
    void (*scaler_special)(const struct scaler_ctx*,
          void*, const void*, int, int, int, int, int, int);
 
@@ -73,6 +76,10 @@ struct scaler_ctx
    void (*direct_pixconv)(void*, const void*, int, int, int, int);
    struct scaler_filter horiz, vert;   /* ptr alignment */
 
+   /* Worker threads, created by scaler_ctx_gen_filter()
+    * when 'threads' is greater than 1. */
+   struct scaler_thread_pool *pool;
+
    struct
    {
       uint32_t *frame;
@@ -105,6 +112,12 @@ struct scaler_ctx
    enum scaler_pix_fmt out_fmt;
    enum scaler_type scaler_type;
 
+   /* Number of threads scaler_ctx_scale() may split the
+    * output rows across, including the calling thread.
+    * 0 or 1 scales on the calling thread only.
+    * Only honoured when built with HAVE_THREADS. */
+   unsigned threads;
+
    bool unscaled;
 };
 
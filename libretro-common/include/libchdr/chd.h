@@ -375,6 +375,14 @@ const chd_header *chd_get_header(chd_file *chd);
 /* read one hunk from the CHD file */
 chd_error chd_read(chd_file *chd, UINT32 hunknum, void *buffer);
 
+/* read consecutive hunks into one buffer, decompressing them in parallel
+   when threads were set up with chd_set_threads() */
+chd_error chd_read_hunks(chd_file *chd, UINT32 hunknum, UINT32 count, void *buffer);
+
+/* decompress with up to the given number of threads, including the
+   calling one; 1 reads serially again */
+chd_error chd_set_threads(chd_file *chd, UINT32 threads);
+
 /* ----- metadata management ----- */
 
 /* get indexed metadata of a particular sort */
@@ -27,6 +27,7 @@
 #include <stddef.h>
 
 #include <retro_common_api.h>
+#include <boolean.h>
 
 RETRO_BEGIN_DECLS
 
@@ -39,8 +40,42 @@ typedef struct chdstream chdstream_t;
 /* Primary (largest) data track, used for CRC identification purposes */
 #define CHDSTREAM_TRACK_PRIMARY (-3)
 
+/* Default number of decompressed hunks kept in memory */
+#define CHDSTREAM_CACHE_HUNKS 16
+/* Default number of hunks decompressed ahead of sequential reads,
+ * on a worker thread and in parallel where there are several cores */
+#define CHDSTREAM_READ_AHEAD 8
+
+typedef struct chdstream_stats
+{
+   /* Hunks found in the cache */
+   uint64_t hits;
+   /* Hunks decompressed on the reading thread */
+   uint64_t misses;
+   /* Hunks decompressed by read-ahead */
+   uint64_t prefetched;
+   /* Read-ahead hunks that were used */
+   uint64_t prefetch_hits;
+} chdstream_stats_t;
+
 chdstream_t *chdstream_open(const char *path, int32_t track);
 
+/**
+ * chdstream_set_cache:
+ * @stream        : CHD stream
+ * @hunks         : number of decompressed hunks to keep
+ * @read_ahead    : number of hunks to decompress ahead of
+ *                  sequential reads, 0 to disable
+ *
+ * Resizes the hunk cache. Only possible before the first read.
+ *
+ * Returns: true on success, otherwise false.
+ **/
+bool chdstream_set_cache(chdstream_t *stream,
+      unsigned hunks, unsigned read_ahead);
+
+void chdstream_get_stats(chdstream_t *stream, chdstream_stats_t *stats);
+
 void chdstream_close(chdstream_t *stream);
 
 ssize_t chdstream_read(chdstream_t *stream, void *data, size_t bytes);
@@ -58,6 +58,10 @@ typedef struct intfstream_info
       void *handle;
       int32_t track;
    } chd;
+   struct
+   {
+      unsigned codec; /* enum rzip_codec, used when writing */
+   } rzip;
    enum intfstream_type type;
 } intfstream_info_t;
 
@@ -127,6 +131,9 @@ intfstream_t *intfstream_open_chd_track(const char *path,
 intfstream_t *intfstream_open_rzip_file(const char *path,
       unsigned mode);
 
+intfstream_t *intfstream_open_rzip_file_codec(const char *path,
+      unsigned mode, unsigned codec);
+
 RETRO_END_DECLS
 
 #endif
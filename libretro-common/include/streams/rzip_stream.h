@@ -62,7 +62,9 @@ RETRO_BEGIN_DECLS
  * <size of next compressed chunk>: 4 bytes, little endian order
  *                                  - size on-disk of next compressed data
  *                                    chunk, in bytes
- * <next compressed chunk>:         n bytes of zlib compressed data
+ * <next compressed chunk>:         n bytes of compressed data
+ *                                  - zlib for file format version 1,
+ *                                    trans_stream LZ4 stream for version 2
  * ...
  * <size of next compressed chunk> : repeated until end of file
  * <next compressed chunk>         :
@@ -72,6 +74,18 @@ RETRO_BEGIN_DECLS
 /* Prevent direct access to rzipstream_t members */
 typedef struct rzipstream rzipstream_t;
 
+/* Chunk compression used when writing. Readers
+ * detect it from the file header.
+ * > RZIP_CODEC_ZLIB: best ratio, readable by
+ *   every RetroArch version
+ * > RZIP_CODEC_LZ4: several times faster, larger
+ *   files, not readable by older versions */
+enum rzip_codec
+{
+   RZIP_CODEC_ZLIB = 0,
+   RZIP_CODEC_LZ4
+};
+
 /* File Open */
 
 /* Opens a new or existing RZIP file
@@ -84,6 +98,11 @@ typedef struct rzipstream rzipstream_t;
  * is invalid or an IO error occurs */
 rzipstream_t* rzipstream_open(const char *path, unsigned mode);
 
+/* Same as rzipstream_open(), but files opened for
+ * writing are compressed with 'codec' */
+rzipstream_t* rzipstream_open_codec(const char *path, unsigned mode,
+      enum rzip_codec codec);
+
 /* File Read */
 
 /* Reads (a maximum of) 'len' bytes from an RZIP file.
@@ -176,6 +195,16 @@ int64_t rzipstream_tell(rzipstream_t *stream);
  * compressed content */
 bool rzipstream_is_compressed(rzipstream_t *stream);
 
+/* Sets the number of threads that compress or
+ * decompress chunks concurrently. Defaults to the
+ * number of CPU cores (at most 8) when built with
+ * HAVE_THREADS; 1 processes every chunk on the
+ * calling thread. Chunks are independent, so this
+ * does not change the file format. Workers are only
+ * started for files larger than one chunk.
+ * Must be called before the first read or write. */
+void rzipstream_set_threads(rzipstream_t *stream, unsigned threads);
+
 /* File Close */
 
 /* Closes RZIP file. If file is open for writing,
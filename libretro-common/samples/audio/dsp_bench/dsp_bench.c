@@ -0,0 +1,181 @@
+/* Copyright  (C) 2010-2020 The RetroArch team
+ *
+ * ---------------------------------------------------------------------------------------
+ * The following license statement only applies to this file (dsp_bench.c).
+ * ---------------------------------------------------------------------------------------
+ *
+ * Permission is hereby granted, free of charge,
+ * to any person obtaining a copy of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction, including without limitation the rights to
+ * use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies of the Software,
+ * and to permit persons to whom the Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR IMPLIED,
+ * INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.
+ * IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY,
+ * WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ */
+
+/* Runs every .dsp preset of a directory over a synthetic stereo
+ * test signal and reports the processing cost per frame, so that
+ * filter chains can be picked to fit a given CPU budget.
+ *
+ * Usage: dsp_bench [filter_dir] [seconds] [sample_rate]
+ *
+ * 'filter_dir' must contain both the .dsp presets and the compiled
+ * filter plugins (run 'make' in audio/dsp_filters first). */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+
+#include <retro_miscellaneous.h>
+#include <file/file_path.h>
+#include <lists/dir_list.h>
+#include <lists/string_list.h>
+#include <features/features_cpu.h>
+#include <audio/dsp_filter.h>
+
+#define DSP_BENCH_BLOCK_FRAMES 1024
+
+#if defined(_WIN32)
+#define DSP_BENCH_PLUG_EXT "dll"
+#elif defined(__APPLE__)
+#define DSP_BENCH_PLUG_EXT "dylib"
+#else
+#define DSP_BENCH_PLUG_EXT "so"
+#endif
+
+/* A few partials plus low-level noise, so that filters see
+ * realistic (non-denormal, non-silent) input. */
+static void dsp_bench_fill_signal(float *buf, unsigned frames,
+      float sample_rate)
+{
+   unsigned i;
+   uint32_t seed = 0x12345678;
+
+   for (i = 0; i < frames; i++)
+   {
+      float t     = i / sample_rate;
+      float noise;
+
+      seed        = seed * 1664525u + 1013904223u;
+      noise       = ((seed >> 9) / (float)(1 << 23) - 0.5f) * 0.02f;
+
+      buf[2 * i + 0] = 0.30f * sinf(2.0f * M_PI *  220.0f * t)
+                     + 0.15f * sinf(2.0f * M_PI * 1760.0f * t) + noise;
+      buf[2 * i + 1] = 0.30f * sinf(2.0f * M_PI *  330.0f * t)
+                     + 0.15f * sinf(2.0f * M_PI * 4400.0f * t) - noise;
+   }
+}
+
+static void dsp_bench_run_preset(const char *preset, const char *filter_dir,
+      const float *signal, float *work, unsigned frames, float sample_rate)
+{
+   unsigned i;
+   retro_time_t start, elapsed;
+   uint64_t out_frames    = 0;
+   double ns_per_frame    = 0.0;
+   /* The DSP chain takes ownership of the plugin list. */
+   struct string_list *plugs = dir_list_new(filter_dir,
+         DSP_BENCH_PLUG_EXT, false, false, false, false);
+   retro_dsp_filter_t *dsp   = retro_dsp_filter_new(preset,
+         plugs, sample_rate);
+
+   if (!dsp)
+   {
+      printf("%-28s  (failed to initialise)\n", path_basename(preset));
+      return;
+   }
+
+   /* Filters run in place, so work on a pristine copy. A block
+    * only takes a few microseconds, too little to time on its own:
+    * the clock is read once around the whole run instead. */
+   memcpy(work, signal, frames * 2 * sizeof(float));
+
+   start = cpu_features_get_time_usec();
+   for (i = 0; i < frames; i += DSP_BENCH_BLOCK_FRAMES)
+   {
+      struct retro_dsp_data data;
+
+      data.input         = work + 2 * i;
+      data.input_frames  = MIN(DSP_BENCH_BLOCK_FRAMES, frames - i);
+      data.output        = NULL;
+      data.output_frames = 0;
+
+      retro_dsp_filter_process(dsp, &data);
+      out_frames        += data.output_frames;
+   }
+   elapsed = cpu_features_get_time_usec() - start;
+
+   retro_dsp_filter_free(dsp);
+
+   if (frames)
+      ns_per_frame = (elapsed * 1000.0) / frames;
+
+   /* CPU load is relative to a single core running in real time. */
+   printf("%-28s  %10.2f ns/frame  %7.3f %% CPU  (%llu frames out)\n",
+         path_basename(preset), ns_per_frame,
+         ns_per_frame * sample_rate / 1e7,
+         (unsigned long long)out_frames);
+}
+
+int main(int argc, char *argv[])
+{
+   size_t i;
+   float *signal              = NULL;
+   float *work                = NULL;
+   struct string_list *presets = NULL;
+   const char *filter_dir     = argc > 1 ? argv[1] : "../../../audio/dsp_filters";
+   float seconds              = argc > 2 ? (float)atof(argv[2]) : 10.0f;
+   float sample_rate          = argc > 3 ? (float)atof(argv[3]) : 48000.0f;
+   unsigned frames            = (unsigned)(seconds * sample_rate);
+
+   if (!frames)
+   {
+      fprintf(stderr, "Usage: %s [filter_dir] [seconds] [sample_rate]\n", argv[0]);
+      return 1;
+   }
+
+   presets = dir_list_new(filter_dir, "dsp", false, false, false, false);
+   if (!presets || !presets->size)
+   {
+      fprintf(stderr, "No .dsp presets found in \"%s\".\n", filter_dir);
+      string_list_free(presets);
+      return 1;
+   }
+   dir_list_sort(presets, false);
+
+   signal = (float*)malloc(frames * 2 * sizeof(float));
+   /* Some filters (e.g. reverb) may output more frames than they
+    * receive, but never into the caller's buffer, so the input
+    * size suffices. */
+   work   = (float*)malloc(frames * 2 * sizeof(float));
+   if (!signal || !work)
+   {
+      free(signal);
+      free(work);
+      string_list_free(presets);
+      return 1;
+   }
+
+   dsp_bench_fill_signal(signal, frames, sample_rate);
+
+   printf("%u frames @ %.0f Hz, %u-frame blocks, SIMD mask 0x%llx\n\n",
+         frames, sample_rate, DSP_BENCH_BLOCK_FRAMES,
+         (unsigned long long)cpu_features_get());
+
+   for (i = 0; i < presets->size; i++)
+      dsp_bench_run_preset(presets->elems[i].data, filter_dir,
+            signal, work, frames, sample_rate);
+
+   free(signal);
+   free(work);
+   string_list_free(presets);
+   return 0;
+}
@@ -0,0 +1,158 @@
+/* Reads files with every nbio implementation built for this
+ * platform and reports the throughput, with the files evicted
+ * from the page cache (cold) and already cached (warm).
+ *
+ * Usage: nbio_bench [-n runs] <file>... */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+#ifdef __linux__
+#include <fcntl.h>
+#include <unistd.h>
+#endif
+
+#include <file/nbio.h>
+
+extern nbio_intf_t nbio_uring;
+extern nbio_intf_t nbio_linux;
+extern nbio_intf_t nbio_mmap_unix;
+extern nbio_intf_t nbio_stdio;
+
+static nbio_intf_t *backends[] = {
+   &nbio_uring,
+   &nbio_linux,
+   &nbio_mmap_unix,
+   &nbio_stdio
+};
+
+static double get_time(void)
+{
+   struct timespec ts;
+   clock_gettime(CLOCK_MONOTONIC, &ts);
+   return ts.tv_sec + ts.tv_nsec / 1000000000.0;
+}
+
+/* Evicts the file from the page cache, which works
+ * without root as long as its pages are clean */
+static void drop_cache(const char *path)
+{
+#ifdef __linux__
+   int fd = open(path, O_RDONLY);
+   if (fd < 0)
+      return;
+   fdatasync(fd);
+   posix_fadvise(fd, 0, 0, POSIX_FADV_DONTNEED);
+   close(fd);
+#endif
+}
+
+/* Returns the time taken, or a negative value on error.
+ * The data is summed up so lazily mapped files are read too. */
+static double bench_read(nbio_intf_t *nbio, const char *path,
+      unsigned long *sum)
+{
+   size_t i, len;
+   const unsigned char *ptr;
+   double start = get_time();
+   void *handle = nbio->open(path, NBIO_READ);
+
+   if (!handle)
+      return -1.0;
+
+   nbio->begin_read(handle);
+   while (!nbio->iterate(handle));
+
+   if (!(ptr = (const unsigned char*)nbio->get_ptr(handle, &len)))
+   {
+      nbio->free(handle);
+      return -1.0;
+   }
+
+   *sum = 0;
+   for (i = 0; i < len; i += 64)
+      *sum += ptr[i];
+
+   nbio->free(handle);
+   return get_time() - start;
+}
+
+int main(int argc, char *argv[])
+{
+   int i;
+   unsigned b, run;
+   unsigned runs = 5;
+   int first     = 1;
+
+   if (argc > 2 && !strcmp(argv[1], "-n"))
+   {
+      runs  = (unsigned)strtoul(argv[2], NULL, 0);
+      first = 3;
+   }
+
+   if (first >= argc || !runs)
+   {
+      fprintf(stderr, "Usage: %s [-n runs] <file>...\n", argv[0]);
+      return 1;
+   }
+
+   printf("%-16s %-6s %12s %12s\n", "backend", "cache", "MB/s", "ms/file");
+
+   for (b = 0; b < sizeof(backends) / sizeof(backends[0]); b++)
+   {
+      unsigned cold;
+      nbio_intf_t *nbio = backends[b];
+
+      /* Not built for this platform */
+      if (!nbio->open)
+         continue;
+
+      for (cold = 0; cold < 2; cold++)
+      {
+         double total = 0.0;
+         double bytes = 0.0;
+
+         for (run = 0; run < runs; run++)
+         {
+            for (i = first; i < argc; i++)
+            {
+               unsigned long sum = 0;
+               double t;
+               FILE *f;
+
+               if (!cold)
+               {
+                  /* Warm the cache first */
+                  bench_read(nbio, argv[i], &sum);
+               }
+               else
+                  drop_cache(argv[i]);
+
+               if ((t = bench_read(nbio, argv[i], &sum)) < 0.0)
+               {
+                  fprintf(stderr, "%s: failed to read \"%s\".\n",
+                        nbio->ident, argv[i]);
+                  return 1;
+               }
+
+               total += t;
+               if ((f = fopen(argv[i], "rb")))
+               {
+                  fseek(f, 0, SEEK_END);
+                  bytes += (double)ftell(f);
+                  fclose(f);
+               }
+            }
+         }
+
+         printf("%-16s %-6s %12.1f %12.3f\n", nbio->ident,
+               cold ? "cold" : "warm",
+               bytes / total / (1024.0 * 1024.0),
+               total * 1000.0 / (runs * (argc - first)));
+      }
+   }
+
+   return 0;
+}
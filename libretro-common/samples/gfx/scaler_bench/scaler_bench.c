@@ -0,0 +1,192 @@
+/* Copyright  (C) 2010-2020 The RetroArch team
+ *
+ * ---------------------------------------------------------------------------------------
+ * The following license statement only applies to this file (scaler_bench.c).
+ * ---------------------------------------------------------------------------------------
+ *
+ * Permission is hereby granted, free of charge,
+ * to any person obtaining a copy of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction, including without limitation the rights to
+ * use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies of the Software,
+ * and to permit persons to whom the Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR IMPLIED,
+ * INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.
+ * IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY,
+ * WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ */
+
+/* Measures scaler_ctx_scale() for the resolutions commonly seen by
+ * screenshots, recording and the software video drivers, with and
+ * without row-sliced threading. Threaded output is checked against
+ * the single-threaded result.
+ *
+ * Usage: scaler_bench [max_threads] [iterations] */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include <features/features_cpu.h>
+#include <gfx/scaler/scaler.h>
+
+struct scaler_bench_case
+{
+   int in_width, in_height;
+   int out_width, out_height;
+   enum scaler_pix_fmt in_fmt;
+};
+
+static const struct scaler_bench_case scaler_bench_cases[] = {
+   {  256, 224, 1920, 1080, SCALER_FMT_ARGB8888 },
+   {  256, 224, 1920, 1080, SCALER_FMT_RGB565   },
+   {  640, 480, 1280,  960, SCALER_FMT_ARGB8888 },
+   {  640, 480, 1280,  960, SCALER_FMT_RGB565   },
+};
+
+static const char *scaler_bench_type_str(enum scaler_type type)
+{
+   switch (type)
+   {
+      case SCALER_TYPE_POINT:
+         return "point";
+      case SCALER_TYPE_BILINEAR:
+         return "bilinear";
+      case SCALER_TYPE_SINC:
+         return "sinc";
+      default:
+         break;
+   }
+   return "unknown";
+}
+
+static void scaler_bench_fill(uint8_t *buf, size_t size)
+{
+   size_t i;
+   uint32_t seed = 0xdeadbeef;
+
+   for (i = 0; i < size; i++)
+   {
+      seed   = seed * 1664525u + 1013904223u;
+      buf[i] = (uint8_t)(seed >> 24);
+   }
+}
+
+/* Returns the average time per frame in microseconds. */
+static double scaler_bench_run(const struct scaler_bench_case *c,
+      enum scaler_type type, unsigned threads, unsigned iterations,
+      const void *input, void *output)
+{
+   unsigned i;
+   retro_time_t start, elapsed;
+   struct scaler_ctx ctx;
+   int in_bpp        = (c->in_fmt == SCALER_FMT_RGB565) ? 2 : 4;
+
+   memset(&ctx, 0, sizeof(ctx));
+   ctx.in_width      = c->in_width;
+   ctx.in_height     = c->in_height;
+   ctx.in_stride     = c->in_width * in_bpp;
+   ctx.in_fmt        = c->in_fmt;
+   ctx.out_width     = c->out_width;
+   ctx.out_height    = c->out_height;
+   ctx.out_stride    = c->out_width * 4;
+   ctx.out_fmt       = SCALER_FMT_ARGB8888;
+   ctx.scaler_type   = type;
+   ctx.threads       = threads;
+
+   if (!scaler_ctx_gen_filter(&ctx))
+   {
+      scaler_ctx_gen_reset(&ctx);
+      return -1.0;
+   }
+
+   /* Warm up caches and worker threads. */
+   scaler_ctx_scale(&ctx, output, input);
+
+   start = cpu_features_get_time_usec();
+   for (i = 0; i < iterations; i++)
+      scaler_ctx_scale(&ctx, output, input);
+   elapsed = cpu_features_get_time_usec() - start;
+
+   /* Joins the worker threads, which is not part of scaling */
+   scaler_ctx_gen_reset(&ctx);
+   return (double)elapsed / iterations;
+}
+
+int main(int argc, char *argv[])
+{
+   size_t i;
+   unsigned max_threads = argc > 1 ? (unsigned)atoi(argv[1]) : cpu_features_get_core_amount();
+   unsigned iterations  = argc > 2 ? (unsigned)atoi(argv[2]) : 50;
+   static const enum scaler_type types[] = {
+      SCALER_TYPE_POINT, SCALER_TYPE_BILINEAR, SCALER_TYPE_SINC };
+
+   if (max_threads < 1)
+      max_threads = 1;
+   if (iterations < 1)
+      iterations = 1;
+
+   printf("%-26s %-9s %7s %12s %9s\n",
+         "case", "filter", "threads", "us/frame", "speedup");
+
+   for (i = 0; i < sizeof(scaler_bench_cases) / sizeof(scaler_bench_cases[0]); i++)
+   {
+      size_t t;
+      const struct scaler_bench_case *c = &scaler_bench_cases[i];
+      size_t in_size    = (size_t)c->in_width  * c->in_height  * 4;
+      size_t out_size   = (size_t)c->out_width * c->out_height * 4;
+      uint8_t *input    = (uint8_t*)malloc(in_size);
+      uint8_t *output   = (uint8_t*)malloc(out_size);
+      uint8_t *ref      = (uint8_t*)malloc(out_size);
+      char name[64];
+
+      if (!input || !output || !ref)
+      {
+         free(input);
+         free(output);
+         free(ref);
+         return 1;
+      }
+
+      snprintf(name, sizeof(name), "%dx%d %s -> %dx%d",
+            c->in_width, c->in_height,
+            c->in_fmt == SCALER_FMT_RGB565 ? "565" : "8888",
+            c->out_width, c->out_height);
+
+      scaler_bench_fill(input, in_size);
+
+      for (t = 0; t < sizeof(types) / sizeof(types[0]); t++)
+      {
+         unsigned threads;
+         double base = scaler_bench_run(c, types[t], 1, iterations, input, ref);
+
+         for (threads = 1; threads <= max_threads; threads <<= 1)
+         {
+            double us = base;
+
+            if (threads > 1)
+            {
+               memset(output, 0, out_size);
+               us = scaler_bench_run(c, types[t], threads, iterations, input, output);
+               if (memcmp(output, ref, out_size))
+                  printf("[ERROR]: threaded output differs (%s, %s, %u threads)\n",
+                        name, scaler_bench_type_str(types[t]), threads);
+            }
+
+            printf("%-26s %-9s %7u %12.1f %8.2fx\n",
+                  name, scaler_bench_type_str(types[t]), threads,
+                  us, us > 0.0 ? base / us : 0.0);
+         }
+      }
+
+      free(input);
+      free(output);
+      free(ref);
+   }
+
+   return 0;
+}
@@ -0,0 +1,154 @@
+/* Copyright  (C) 2010-2020 The RetroArch team
+ *
+ * ---------------------------------------------------------------------------------------
+ * The following license statement only applies to this file (netplay_udp_loss.c).
+ * ---------------------------------------------------------------------------------------
+ *
+ * Permission is hereby granted, free of charge,
+ * to any person obtaining a copy of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction, including without limitation the rights to
+ * use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies of the Software,
+ * and to permit persons to whom the Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR IMPLIED,
+ * INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.
+ * IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY,
+ * WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ */
+
+/* Simulates how long netplay input frames take to arrive over a lossy
+ * link, with TCP only and with the redundant UDP input channel on top.
+ *
+ * Usage: netplay_udp_loss [loss %] [redundancy] [frames] [one-way ms]
+ *
+ * One input frame is sent every 1/60 s. Over TCP a lost segment is only
+ * resent after the retransmission timeout, and every frame behind it
+ * waits too (head-of-line blocking). Over UDP each datagram carries the
+ * last 'redundancy' frames, so a frame is lost only if all of them are.
+ * A frame counts as late once it arrives more than one frame after it
+ * would have without loss, i.e. it will most likely cause a rollback
+ * or a stall. */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#define FRAME_USEC       16667.0
+#define TCP_MIN_RTO_USEC 200000.0
+
+static unsigned long loss_rand_next = 1;
+
+static double loss_rand(void)
+{
+   loss_rand_next = loss_rand_next * 1103515245 + 12345;
+   return ((loss_rand_next >> 16) & 0x7FFF) / 32768.0;
+}
+
+static int cmp_double(const void *a, const void *b)
+{
+   double x = *(const double*)a;
+   double y = *(const double*)b;
+   return (x > y) - (x < y);
+}
+
+static void report(const char *label, double *lat, unsigned frames,
+      double one_way)
+{
+   unsigned i, late = 0;
+   double sum       = 0;
+
+   for (i = 0; i < frames; i++)
+   {
+      sum += lat[i];
+      if (lat[i] > one_way + FRAME_USEC)
+         late++;
+   }
+   qsort(lat, frames, sizeof(*lat), cmp_double);
+
+   printf("%-10s mean %7.1f ms  p95 %7.1f ms  p99 %7.1f ms  "
+         "max %7.1f ms  late %5u (%.2f %%)\n", label,
+         sum / frames / 1000.0,
+         lat[frames * 95 / 100] / 1000.0,
+         lat[frames * 99 / 100] / 1000.0,
+         lat[frames - 1] / 1000.0,
+         late, late * 100.0 / frames);
+}
+
+int main(int argc, char *argv[])
+{
+   unsigned i, j;
+   double *tcp, *udp, *both;
+   double loss       = (argc > 1) ? atof(argv[1]) / 100.0 : 0.05;
+   unsigned redund   = (argc > 2) ? (unsigned)atoi(argv[2]) : 4;
+   unsigned frames   = (argc > 3) ? (unsigned)atoi(argv[3]) : 36000;
+   double one_way    = ((argc > 4) ? atof(argv[4]) : 30.0) * 1000.0;
+   double rto        = 2.0 * one_way + 4.0 * 5000.0;
+   double tcp_ready  = 0;
+
+   if (rto < TCP_MIN_RTO_USEC)
+      rto = TCP_MIN_RTO_USEC;
+   if (!redund || frames < 100)
+   {
+      fprintf(stderr, "Usage: %s [loss %%] [redundancy >= 1] "
+            "[frames >= 100] [one-way ms]\n", argv[0]);
+      return 1;
+   }
+
+   tcp  = (double*)malloc(frames * sizeof(double));
+   udp  = (double*)malloc(frames * sizeof(double));
+   both = (double*)malloc(frames * sizeof(double));
+   if (!tcp || !udp || !both)
+      return 1;
+
+   for (i = 0; i < frames; i++)
+      udp[i] = 1e30;
+
+   for (i = 0; i < frames; i++)
+   {
+      double sent    = i * FRAME_USEC;
+      double arrival = sent + one_way;
+      double resent  = sent;
+
+      /* TCP: every loss costs an RTO (doubling), and nothing is
+       * delivered out of order */
+      for (j = 0; loss_rand() < loss; j++)
+      {
+         resent  += rto * (1 << (j < 6 ? j : 6));
+         arrival  = resent + one_way;
+      }
+      if (arrival < tcp_ready)
+         arrival = tcp_ready;
+      tcp_ready  = arrival;
+      tcp[i]     = arrival - sent;
+
+      /* UDP: datagram i carries frames i-redund+1 .. i */
+      if (loss_rand() >= loss)
+      {
+         for (j = 0; j < redund && j <= i; j++)
+         {
+            double lat = sent + one_way - (i - j) * FRAME_USEC;
+            if (lat < udp[i - j])
+               udp[i - j] = lat;
+         }
+      }
+   }
+
+   for (i = 0; i < frames; i++)
+      both[i] = (udp[i] < tcp[i]) ? udp[i] : tcp[i];
+
+   printf("%u frames, %.1f %% loss, %.1f ms one way, RTO %.0f ms, "
+         "UDP redundancy %u\n", frames, loss * 100.0, one_way / 1000.0,
+         rto / 1000.0, redund);
+   report("TCP", tcp, frames, one_way);
+   report("UDP+TCP", both, frames, one_way);
+
+   free(tcp);
+   free(udp);
+   free(both);
+
+   return 0;
+}
@@ -0,0 +1,237 @@
+/* Copyright  (C) 2010-2020 The RetroArch team
+ *
+ * ---------------------------------------------------------------------------------------
+ * The following license statement only applies to this file (trans_bench.c).
+ * ---------------------------------------------------------------------------------------
+ *
+ * Permission is hereby granted, free of charge,
+ * to any person obtaining a copy of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction, including without limitation the rights to
+ * use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies of the Software,
+ * and to permit persons to whom the Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR IMPLIED,
+ * INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.
+ * IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY,
+ * WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ */
+
+/* Compresses a set of buffers with every trans_stream codec and
+ * reports ratio and throughput, so the codec used for savestates,
+ * rzip files and netplay can be picked with real numbers.
+ *
+ * Usage: trans_bench [file ...]
+ *
+ * Without arguments, synthetic buffers shaped like typical savestates
+ * (mostly zeroes, RAM-like tables, incompressible noise) are used.
+ * Every round trip is verified. */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include <retro_miscellaneous.h>
+#include <file/file_path.h>
+#include <streams/file_stream.h>
+#include <streams/trans_stream.h>
+#include <features/features_cpu.h>
+
+#define TRANS_BENCH_STATE_SIZE (4 * 1024 * 1024)
+#define TRANS_BENCH_MIN_USEC   250000
+
+struct trans_bench_codec
+{
+   const char *name;
+   const struct trans_stream_backend *(*get_backend)(void);
+   int level;
+};
+
+static const struct trans_bench_codec trans_bench_codecs[] = {
+#ifdef HAVE_ZLIB
+   { "zlib -1", trans_stream_get_zlib_deflate_backend, 1 },
+   { "zlib -6", trans_stream_get_zlib_deflate_backend, 6 },
+   { "zlib -9", trans_stream_get_zlib_deflate_backend, 9 },
+#endif
+   { "lz4",     trans_stream_get_lz4_compress_backend, -1 },
+};
+
+static uint32_t trans_bench_rand(uint32_t *seed)
+{
+   *seed = *seed * 1664525u + 1013904223u;
+   return *seed >> 8;
+}
+
+/* Large zeroed regions with a few islands of data, like
+ * the unused WRAM/VRAM banks of most cores */
+static void trans_bench_fill_sparse(uint8_t *buf, size_t len)
+{
+   size_t i;
+   uint32_t seed = 1;
+
+   memset(buf, 0, len);
+   for (i = 0; i < len; i += 4096)
+   {
+      size_t j;
+      size_t n = trans_bench_rand(&seed) & 255;
+      if (trans_bench_rand(&seed) & 3)
+         continue;
+      for (j = 0; j < n && i + j < len; j++)
+         buf[i + j] = (uint8_t)trans_bench_rand(&seed);
+   }
+}
+
+/* Tile maps, sprite tables and repeated structs with
+ * small per-entry variations */
+static void trans_bench_fill_ram(uint8_t *buf, size_t len)
+{
+   size_t i;
+   uint32_t seed = 2;
+
+   for (i = 0; i < len; i++)
+   {
+      uint32_t r = trans_bench_rand(&seed);
+      if ((r & 15) == 0)
+         buf[i] = (uint8_t)(r >> 4);
+      else if (i >= 32)
+         buf[i] = buf[i - 32] + ((r & 0x70) == 0);
+      else
+         buf[i] = (uint8_t)i;
+   }
+}
+
+static void trans_bench_fill_noise(uint8_t *buf, size_t len)
+{
+   size_t i;
+   uint32_t seed = 3;
+
+   for (i = 0; i < len; i++)
+      buf[i] = (uint8_t)trans_bench_rand(&seed);
+}
+
+static bool trans_bench_run(const struct trans_stream_backend *backend,
+      int level, const uint8_t *in, uint32_t in_size,
+      uint8_t *out, uint32_t out_size, uint32_t *written)
+{
+   uint32_t rd = 0;
+   bool ret    = false;
+   void *s     = backend->stream_new();
+
+   *written    = 0;
+   if (!s)
+      return false;
+
+   if (level >= 0 && backend->define)
+      backend->define(s, "level", (uint32_t)level);
+
+   backend->set_in(s, in, in_size);
+   backend->set_out(s, out, out_size);
+   if (backend->trans(s, true, &rd, written, NULL))
+      ret = (rd == in_size);
+
+   backend->stream_free(s);
+   return ret;
+}
+
+static void trans_bench_buffer(const char *label,
+      const uint8_t *buf, uint32_t len)
+{
+   unsigned i;
+   uint32_t packed_size = len + (len >> 1) + 1024;
+   uint8_t *packed      = (uint8_t*)malloc(packed_size);
+   uint8_t *unpacked    = (uint8_t*)malloc(len + 1);
+
+   printf("%s (%u bytes)\n", label, (unsigned)len);
+
+   if (!packed || !unpacked)
+      goto end;
+
+   for (i = 0; i < ARRAY_SIZE(trans_bench_codecs); i++)
+   {
+      const struct trans_bench_codec *codec  = &trans_bench_codecs[i];
+      const struct trans_stream_backend *enc = codec->get_backend();
+      retro_time_t start, enc_usec = 0, dec_usec = 0;
+      uint32_t comp_len = 0, decomp_len = 0;
+      unsigned runs = 0;
+
+      if (!enc)
+         continue;
+
+      do
+      {
+         start     = cpu_features_get_time_usec();
+         if (!trans_bench_run(enc, codec->level, buf, len,
+                  packed, packed_size, &comp_len))
+            break;
+         enc_usec += cpu_features_get_time_usec() - start;
+
+         start     = cpu_features_get_time_usec();
+         if (!trans_bench_run(enc->reverse, -1, packed, comp_len,
+                  unpacked, len + 1, &decomp_len))
+            break;
+         dec_usec += cpu_features_get_time_usec() - start;
+         runs++;
+      } while (enc_usec + dec_usec < TRANS_BENCH_MIN_USEC);
+
+      if (!runs || decomp_len != len || memcmp(buf, unpacked, len))
+      {
+         printf("   %-8s  FAILED\n", codec->name);
+         continue;
+      }
+
+      printf("   %-8s  %6.2f %%  %9.1f MB/s compress  %9.1f MB/s decompress\n",
+            codec->name, comp_len * 100.0 / len,
+            (double)len * runs / (enc_usec ? enc_usec : 1),
+            (double)len * runs / (dec_usec ? dec_usec : 1));
+   }
+
+end:
+   free(packed);
+   free(unpacked);
+}
+
+int main(int argc, char *argv[])
+{
+   int i;
+
+   if (argc > 1)
+   {
+      for (i = 1; i < argc; i++)
+      {
+         void *buf   = NULL;
+         int64_t len = 0;
+
+         if (!filestream_read_file(argv[i], &buf, &len) || len <= 0
+               || len > 0x40000000)
+         {
+            fprintf(stderr, "Failed to read \"%s\".\n", argv[i]);
+            free(buf);
+            return 1;
+         }
+
+         trans_bench_buffer(path_basename(argv[i]),
+               (const uint8_t*)buf, (uint32_t)len);
+         free(buf);
+      }
+   }
+   else
+   {
+      uint8_t *buf = (uint8_t*)malloc(TRANS_BENCH_STATE_SIZE);
+
+      if (!buf)
+         return 1;
+
+      trans_bench_fill_sparse(buf, TRANS_BENCH_STATE_SIZE);
+      trans_bench_buffer("sparse", buf, TRANS_BENCH_STATE_SIZE);
+      trans_bench_fill_ram(buf, TRANS_BENCH_STATE_SIZE);
+      trans_bench_buffer("ram", buf, TRANS_BENCH_STATE_SIZE);
+      trans_bench_fill_noise(buf, TRANS_BENCH_STATE_SIZE);
+      trans_bench_buffer("noise", buf, TRANS_BENCH_STATE_SIZE);
+      free(buf);
+   }
+
+   return 0;
+}
@@ -31,23 +31,83 @@
 #include <libchdr/chd.h>
 #include <string/stdstring.h>
 
+#ifdef HAVE_THREADS
+#include <rthreads/rthreads.h>
+#include <features/features_cpu.h>
+#endif
+
 #define SECTOR_SIZE 2352
 #define SUBCODE_SIZE 96
 #define TRACK_PAD 4
 
+#ifdef HAVE_THREADS
+#define CHDSTREAM_LOCK(stream)   slock_lock((stream)->lock)
+#define CHDSTREAM_UNLOCK(stream) slock_unlock((stream)->lock)
+#define CHD_LOCK(stream)         slock_lock((stream)->chd_lock)
+#define CHD_UNLOCK(stream)       slock_unlock((stream)->chd_lock)
+#else
+#define CHDSTREAM_LOCK(stream)
+#define CHDSTREAM_UNLOCK(stream)
+#define CHD_LOCK(stream)
+#define CHD_UNLOCK(stream)
+#endif
+
+enum chdstream_hunk_state
+{
+   CHDSTREAM_HUNK_EMPTY = 0,
+   CHDSTREAM_HUNK_LOADING,
+   CHDSTREAM_HUNK_READY
+};
+
+typedef struct chdstream_hunk
+{
+   uint8_t *data;
+   /* Access time, for LRU eviction */
+   uint32_t last_used;
+   uint32_t hunknum;
+   enum chdstream_hunk_state state;
+   /* Loaded by read-ahead and not used yet */
+   bool prefetched;
+} chdstream_hunk_t;
+
 struct chdstream
 {
    chd_file *chd;
-   /* Loaded hunk */
-   uint8_t *hunkmem;
+   /* Decompressed hunks */
+   chdstream_hunk_t *hunks;
+   /* Read-ahead batch, decompressed together by chd_read_hunks() */
+   chdstream_hunk_t **batch;
+   uint8_t *batchmem;
+#ifdef HAVE_THREADS
+   /* Read-ahead worker */
+   sthread_t *thread;
+   /* Protects the hunks, stats and read-ahead window */
+   slock_t *lock;
+   /* libchdr is not thread-safe, chd_read() and metadata
+    * lookups have to be serialized */
+   slock_t *chd_lock;
+   /* Signalled when a hunk is loaded or there is read-ahead work */
+   scond_t *cond;
+#endif
+   chdstream_stats_t stats;
    /* Byte offset where track data starts (after pregap) */
    size_t track_start;
    /* Byte offset where track data ends */
    size_t track_end;
    /* Byte offset of read cursor */
    size_t offset;
-   /* Loaded hunk number */
+   /* Last hunk read, to detect sequential access */
    int32_t hunknum;
+   /* Read-ahead window, hunks before prefetch_next were queued */
+   uint32_t prefetch_start;
+   uint32_t prefetch_next;
+   uint32_t prefetch_end;
+   uint32_t hunkbytes;
+   uint32_t hunkcount;
+   uint32_t cache_size;
+   uint32_t read_ahead;
+   /* LRU clock */
+   uint32_t tick;
    /* Size of frame taken from each hunk */
    uint32_t frame_size;
    /* Offset of data within frame */
@@ -58,6 +118,7 @@ struct chdstream
    uint32_t track_frame;
    /* Should we swap bytes? */
    bool swab;
+   bool quit;
 };
 
 typedef struct metadata
@@ -207,7 +268,6 @@ chdstream_t *chdstream_open(const char *path, int32_t track)
 {
    metadata_t meta;
    uint32_t pregap         = 0;
-   uint8_t *hunkmem        = NULL;
    const chd_header *hd    = NULL;
    chdstream_t *stream     = NULL;
    chd_file *chd           = NULL;
@@ -219,7 +279,7 @@ chdstream_t *chdstream_open(const char *path, int32_t track)
    if (!chdstream_find_track(chd, track, &meta))
       goto error;
 
-   stream                  = (chdstream_t*)malloc(sizeof(*stream));
+   stream                  = (chdstream_t*)calloc(1, sizeof(*stream));
    if (!stream)
       goto error;
 
@@ -232,15 +292,19 @@ chdstream_t *chdstream_open(const char *path, int32_t track)
    stream->track_start     = 0;
    stream->track_end       = 0;
    stream->offset          = 0;
-   stream->hunkmem         = NULL;
+   stream->hunks           = NULL;
    stream->hunknum         = -1;
 
    hd                      = chd_get_header(chd);
-   hunkmem                 = (uint8_t*)malloc(hd->hunkbytes);
-   if (!hunkmem)
-      goto error;
+   stream->hunkbytes       = hd->hunkbytes;
+   stream->hunkcount       = hd->totalhunks;
 
-   stream->hunkmem         = hunkmem;
+#ifdef HAVE_THREADS
+   if (     !(stream->lock     = slock_new())
+         || !(stream->chd_lock = slock_new())
+         || !(stream->cond     = scond_new()))
+      goto error;
+#endif
 
    if (string_is_equal(meta.type, "MODE1_RAW"))
       stream->frame_size   = SECTOR_SIZE;
@@ -265,6 +329,13 @@ chdstream_t *chdstream_open(const char *path, int32_t track)
    stream->track_end       = stream->track_start + 
                              (size_t)meta.frames * stream->frame_size;
 
+   if (!chdstream_set_cache(stream, CHDSTREAM_CACHE_HUNKS,
+            CHDSTREAM_READ_AHEAD))
+   {
+      chdstream_close(stream);
+      return NULL;
+   }
+
    return stream;
 
 error:
@@ -277,40 +348,324 @@ error:
    return NULL;
 }
 
+static void chdstream_free_cache(chdstream_t *stream)
+{
+   uint32_t i;
+
+   free(stream->batch);
+   free(stream->batchmem);
+   stream->batch    = NULL;
+   stream->batchmem = NULL;
+
+   if (!stream->hunks)
+      return;
+
+   for (i = 0; i < stream->cache_size; i++)
+      free(stream->hunks[i].data);
+   free(stream->hunks);
+   stream->hunks      = NULL;
+   stream->cache_size = 0;
+}
+
 void chdstream_close(chdstream_t *stream)
 {
    if (!stream)
       return;
 
-   if (stream->hunkmem)
-      free(stream->hunkmem);
+#ifdef HAVE_THREADS
+   if (stream->thread)
+   {
+      slock_lock(stream->lock);
+      stream->quit = true;
+      scond_broadcast(stream->cond);
+      slock_unlock(stream->lock);
+      sthread_join(stream->thread);
+   }
+   if (stream->cond)
+      scond_free(stream->cond);
+   if (stream->chd_lock)
+      slock_free(stream->chd_lock);
+   if (stream->lock)
+      slock_free(stream->lock);
+#endif
+
+   chdstream_free_cache(stream);
    if (stream->chd)
       chd_close(stream->chd);
    free(stream);
 }
 
-static bool
-chdstream_load_hunk(chdstream_t *stream, uint32_t hunknum)
+bool chdstream_set_cache(chdstream_t *stream,
+      unsigned hunks, unsigned read_ahead)
 {
-   uint16_t *array;
+   uint32_t i;
 
-   if (hunknum == stream->hunknum)
-      return true;
+   /* The worker only exists once reading started */
+   if (stream->tick)
+      return false;
+
+#ifndef HAVE_THREADS
+   read_ahead = 0;
+#endif
+
+   /* Keep the hunk being read and the one before it when the
+    * whole read-ahead window is loaded */
+   if (hunks < read_ahead + 2)
+      hunks = read_ahead + 2;
+
+   chdstream_free_cache(stream);
+
+   stream->hunks = (chdstream_hunk_t*)calloc(hunks, sizeof(*stream->hunks));
+   if (!stream->hunks)
+      return false;
+   stream->cache_size = hunks;
+   stream->read_ahead = read_ahead;
+
+   for (i = 0; i < hunks; i++)
+   {
+      if (!(stream->hunks[i].data = (uint8_t*)malloc(stream->hunkbytes)))
+      {
+         chdstream_free_cache(stream);
+         return false;
+      }
+   }
+
+#ifdef HAVE_THREADS
+   if (read_ahead)
+   {
+      unsigned threads = cpu_features_get_core_amount();
+
+      stream->batch    = (chdstream_hunk_t**)malloc(
+            read_ahead * sizeof(*stream->batch));
+      stream->batchmem = (uint8_t*)malloc(
+            (size_t)read_ahead * stream->hunkbytes);
+      if (!stream->batch || !stream->batchmem)
+      {
+         chdstream_free_cache(stream);
+         return false;
+      }
+
+      /* Batches are at least half the window */
+      if (threads > (read_ahead + 1) / 2)
+         threads = (read_ahead + 1) / 2;
+      chd_set_threads(stream->chd, threads);
+   }
+   else
+      chd_set_threads(stream->chd, 1);
+#endif
+
+   return true;
+}
+
+void chdstream_get_stats(chdstream_t *stream, chdstream_stats_t *stats)
+{
+   CHDSTREAM_LOCK(stream);
+   *stats = stream->stats;
+   CHDSTREAM_UNLOCK(stream);
+}
+
+static chdstream_hunk_t *chdstream_find_hunk(chdstream_t *stream,
+      uint32_t hunknum)
+{
+   uint32_t i;
+   for (i = 0; i < stream->cache_size; i++)
+   {
+      chdstream_hunk_t *hunk = &stream->hunks[i];
+      if (hunk->state != CHDSTREAM_HUNK_EMPTY && hunk->hunknum == hunknum)
+         return hunk;
+   }
+   return NULL;
+}
+
+/* Least recently used slot, or NULL if all of them are loading */
+static chdstream_hunk_t *chdstream_evict_hunk(chdstream_t *stream)
+{
+   uint32_t i;
+   chdstream_hunk_t *victim = NULL;
+
+   for (i = 0; i < stream->cache_size; i++)
+   {
+      chdstream_hunk_t *hunk = &stream->hunks[i];
+      if (hunk->state == CHDSTREAM_HUNK_EMPTY)
+         return hunk;
+      if (     hunk->state == CHDSTREAM_HUNK_READY
+            && (!victim || hunk->last_used < victim->last_used))
+         victim = hunk;
+   }
+
+   return victim;
+}
+
+static void chdstream_swab_hunk(chdstream_t *stream, uint8_t *data)
+{
+   uint32_t i;
+   uint32_t count  = stream->hunkbytes / 2;
+   uint16_t *array = (uint16_t*)data;
+   for (i = 0; i < count; ++i)
+      array[i] = SWAP16(array[i]);
+}
 
-   if (chd_read(stream->chd, hunknum, stream->hunkmem) != CHDERR_NONE)
+/* Decompresses into a slot marked as loading. Called without
+ * the stream lock, so the other thread can keep using the cache. */
+static bool chdstream_decode_hunk(chdstream_t *stream,
+      chdstream_hunk_t *hunk)
+{
+   chd_error err;
+
+   CHD_LOCK(stream);
+   err = chd_read(stream->chd, hunk->hunknum, hunk->data);
+   CHD_UNLOCK(stream);
+
+   if (err != CHDERR_NONE)
       return false;
 
    if (stream->swab)
+      chdstream_swab_hunk(stream, hunk->data);
+
+   return true;
+}
+
+#ifdef HAVE_THREADS
+static void chdstream_read_ahead_thread(void *data)
+{
+   chdstream_t *stream = (chdstream_t*)data;
+
+   slock_lock(stream->lock);
+
+   while (!stream->quit)
    {
+      bool ok;
       uint32_t i;
-      uint32_t count = chd_get_header(stream->chd)->hunkbytes / 2;
-      array          = (uint16_t*)stream->hunkmem;
-      for (i = 0; i < count; ++i)
-         array[i] = SWAP16(array[i]);
+      uint32_t count = 0;
+      uint32_t first;
+      chdstream_hunk_t *hunk;
+
+      while (     stream->prefetch_next < stream->prefetch_end
+            && chdstream_find_hunk(stream, stream->prefetch_next))
+         stream->prefetch_next++;
+
+      /* Queue the run of missing hunks */
+      first = stream->prefetch_next;
+      while (     stream->prefetch_next < stream->prefetch_end
+            && count < stream->read_ahead
+            && !chdstream_find_hunk(stream, stream->prefetch_next)
+            && (hunk = chdstream_evict_hunk(stream)))
+      {
+         hunk->hunknum          = stream->prefetch_next++;
+         hunk->state            = CHDSTREAM_HUNK_LOADING;
+         hunk->prefetched       = true;
+         stream->batch[count++] = hunk;
+      }
+
+      if (!count)
+      {
+         scond_wait(stream->cond, stream->lock);
+         continue;
+      }
+
+      slock_unlock(stream->lock);
+
+      CHD_LOCK(stream);
+      ok = chd_read_hunks(stream->chd, first, count, stream->batchmem)
+         == CHDERR_NONE;
+      CHD_UNLOCK(stream);
+
+      for (i = 0; ok && i < count; i++)
+      {
+         uint8_t *data = stream->batchmem + (size_t)i * stream->hunkbytes;
+         if (stream->swab)
+            chdstream_swab_hunk(stream, data);
+         memcpy(stream->batch[i]->data, data, stream->hunkbytes);
+      }
+
+      slock_lock(stream->lock);
+      for (i = 0; i < count; i++)
+      {
+         stream->batch[i]->last_used = ++stream->tick;
+         stream->batch[i]->state     = ok
+            ? CHDSTREAM_HUNK_READY : CHDSTREAM_HUNK_EMPTY;
+      }
+      if (ok)
+         stream->stats.prefetched += count;
+      scond_broadcast(stream->cond);
+   }
+
+   slock_unlock(stream->lock);
+}
+#endif
+
+/* Returns the hunk with the stream lock held, so it can't be
+ * evicted while it is being copied from */
+static chdstream_hunk_t *chdstream_load_hunk(chdstream_t *stream,
+      uint32_t hunknum)
+{
+   chdstream_hunk_t *hunk;
+
+   for (;;)
+   {
+      hunk = chdstream_find_hunk(stream, hunknum);
+
+      if (!hunk)
+         break;
+      if (hunk->state == CHDSTREAM_HUNK_READY)
+      {
+         stream->stats.hits++;
+         if (hunk->prefetched)
+            stream->stats.prefetch_hits++;
+         hunk->prefetched = false;
+         hunk->last_used  = ++stream->tick;
+         goto end;
+      }
+#ifdef HAVE_THREADS
+      /* Being read ahead, wait for it */
+      scond_wait(stream->cond, stream->lock);
+#endif
    }
 
+   if (!(hunk = chdstream_evict_hunk(stream)))
+      return NULL;
+
+   stream->stats.misses++;
+   hunk->hunknum    = hunknum;
+   hunk->state      = CHDSTREAM_HUNK_LOADING;
+   hunk->prefetched = false;
+   hunk->last_used  = ++stream->tick;
+
+   CHDSTREAM_UNLOCK(stream);
+   if (!chdstream_decode_hunk(stream, hunk))
+   {
+      CHDSTREAM_LOCK(stream);
+      hunk->state = CHDSTREAM_HUNK_EMPTY;
+      return NULL;
+   }
+   CHDSTREAM_LOCK(stream);
+   hunk->state = CHDSTREAM_HUNK_READY;
+#ifdef HAVE_THREADS
+   scond_broadcast(stream->cond);
+#endif
+
+end:
+#ifdef HAVE_THREADS
+   /* Only read ahead of sequential reads. The window is moved
+    * once half of it was used, so hunks are decompressed in
+    * batches that can be spread over several threads. */
+   if (     stream->read_ahead
+         && (stream->hunknum < 0 || hunknum == (uint32_t)stream->hunknum + 1)
+         && (     hunknum + 1 < stream->prefetch_start
+               || hunknum + 1 + stream->read_ahead / 2 >= stream->prefetch_end))
+   {
+      if (!stream->thread)
+         stream->thread = sthread_create(chdstream_read_ahead_thread, stream);
+      stream->prefetch_start = hunknum + 1;
+      stream->prefetch_next  = hunknum + 1;
+      stream->prefetch_end   = hunknum + 1 + stream->read_ahead;
+      if (stream->prefetch_end > stream->hunkcount)
+         stream->prefetch_end = stream->hunkcount;
+      scond_broadcast(stream->cond);
+   }
+#endif
    stream->hunknum = hunknum;
-   return true;
+   return hunk;
 }
 
 ssize_t chdstream_read(chdstream_t *stream, void *data, size_t bytes)
@@ -325,6 +680,8 @@ ssize_t chdstream_read(chdstream_t *stream, void *data, size_t bytes)
 
    end                  = stream->offset + bytes;
 
+   CHDSTREAM_LOCK(stream);
+
    while (stream->offset < end)
    {
       uint32_t frame_offset = stream->offset % stream->frame_size;
@@ -343,12 +700,16 @@ ssize_t chdstream_read(chdstream_t *stream, void *data, size_t bytes)
          uint32_t hunk        = chd_frame / stream->frames_per_hunk;
          uint32_t hunk_offset = (chd_frame % stream->frames_per_hunk) 
             * hd->unitbytes;
+         chdstream_hunk_t *loaded = chdstream_load_hunk(stream, hunk);
 
-         if (!chdstream_load_hunk(stream, hunk))
+         if (!loaded)
+         {
+            CHDSTREAM_UNLOCK(stream);
             return -1;
+         }
 
          memcpy(out + data_offset,
-                stream->hunkmem + frame_offset
+                loaded->data + frame_offset
                 + hunk_offset + stream->frame_offset, amount);
       }
 
@@ -356,6 +717,8 @@ ssize_t chdstream_read(chdstream_t *stream, void *data, size_t bytes)
       stream->offset += amount;
    }
 
+   CHDSTREAM_UNLOCK(stream);
+
    return bytes;
 }
 
@@ -433,16 +796,22 @@ uint32_t chdstream_get_track_start(chdstream_t *stream)
    uint32_t i;
    metadata_t meta;
    uint32_t frame_offset = 0;
+   uint32_t ret          = 0;
 
+   CHD_LOCK(stream);
    for (i = 0; chdstream_get_meta(stream->chd, i, &meta); ++i)
    {
       if (stream->track_frame == frame_offset)
-         return meta.pregap * stream->frame_size;
+      {
+         ret = meta.pregap * stream->frame_size;
+         break;
+      }
 
       frame_offset += meta.frames + meta.extra;
    }
+   CHD_UNLOCK(stream);
 
-   return 0;
+   return ret;
 }
 
 uint32_t chdstream_get_frame_size(chdstream_t *stream)
@@ -456,15 +825,21 @@ uint32_t chdstream_get_first_track_sector(chdstream_t* stream)
    metadata_t meta;
    uint32_t frame_offset = 0;
    uint32_t sector_offset = 0;
+   uint32_t ret           = 0;
 
+   CHD_LOCK(stream);
    for (i = 0; chdstream_get_meta(stream->chd, i, &meta); ++i)
    {
       if (stream->track_frame == frame_offset)
-         return sector_offset;
+      {
+         ret = sector_offset;
+         break;
+      }
 
       sector_offset += meta.frames;
       frame_offset += meta.frames + meta.extra;
    }
+   CHD_UNLOCK(stream);
 
-   return 0;
+   return ret;
 }
@@ -61,6 +61,7 @@ struct intfstream_internal
    struct
    {
       rzipstream_t *fp;
+      enum rzip_codec codec;
    } rzip;
 #endif
    enum intfstream_type type;
@@ -151,7 +152,8 @@ bool intfstream_open(intfstream_internal_t *intf, const char *path,
 #endif
       case INTFSTREAM_RZIP:
 #if defined(HAVE_ZLIB)
-         intf->rzip.fp = rzipstream_open(path, mode);
+         intf->rzip.fp = rzipstream_open_codec(path, mode,
+               intf->rzip.codec);
          if (!intf->rzip.fp)
             return false;
          break;
@@ -237,6 +239,7 @@ void *intfstream_init(intfstream_info_t *info)
 #endif
 #ifdef HAVE_ZLIB
    intf->rzip.fp         = NULL;
+   intf->rzip.codec      = RZIP_CODEC_ZLIB;
 #endif
 
    switch (intf->type)
@@ -256,6 +259,9 @@ void *intfstream_init(intfstream_info_t *info)
          goto error;
 #endif
       case INTFSTREAM_RZIP:
+#ifdef HAVE_ZLIB
+         intf->rzip.codec = (enum rzip_codec)info->rzip.codec;
+#endif
          break;
    }
 
@@ -781,11 +787,19 @@ error:
 
 intfstream_t* intfstream_open_rzip_file(const char *path,
       unsigned mode)
+{
+   return intfstream_open_rzip_file_codec(path, mode,
+         0 /* RZIP_CODEC_ZLIB */);
+}
+
+intfstream_t* intfstream_open_rzip_file_codec(const char *path,
+      unsigned mode, unsigned codec)
 {
    intfstream_info_t info;
    intfstream_t *fd = NULL;
 
    info.type        = INTFSTREAM_RZIP;
+   info.rzip.codec  = codec;
    fd               = (intfstream_t*)intfstream_init(&info);
 
    if (!fd)
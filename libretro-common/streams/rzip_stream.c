@@ -28,8 +28,16 @@
 
 #include <streams/rzip_stream.h>
 
+#ifdef HAVE_THREADS
+#include <rthreads/rthreads.h>
+#include <features/features_cpu.h>
+#endif
+
 /* Current RZIP file format version */
 #define RZIP_VERSION 1
+/* Same layout, with chunks compressed by the
+ * LZ4-format trans_stream backend instead of zlib */
+#define RZIP_VERSION_LZ4 2
 
 /* Compression level
  * > zlib default of 6 provides the best
@@ -44,6 +52,59 @@
 #define RZIP_HEADER_SIZE 20
 #define RZIP_CHUNK_HEADER_SIZE 4
 
+/* Most worker threads per stream. Each one has
+ * two chunks in flight, so that the calling thread
+ * can read or write one while the other is processed */
+#define RZIP_MAX_THREADS 8
+#define RZIP_MAX_JOBS (RZIP_MAX_THREADS * 2)
+
+#ifdef HAVE_THREADS
+enum rzip_job_state
+{
+   RZIP_JOB_EMPTY = 0,
+   RZIP_JOB_PENDING,
+   RZIP_JOB_BUSY,
+   RZIP_JOB_DONE,
+   RZIP_JOB_FAILED
+};
+
+/* One chunk on its way through a worker */
+struct rzip_job
+{
+   uint8_t *in_buf;
+   uint8_t *out_buf;
+   uint32_t in_buf_size;
+   uint32_t in_len;
+   uint32_t out_len;
+   enum rzip_job_state state;
+};
+
+/* Chunks are independent, so they can be (de)compressed
+ * concurrently. Jobs form a ring that only the calling
+ * thread fills and empties, in file order - chunks are
+ * therefore read and written in the same order as without
+ * workers, and the file format does not change. */
+struct rzip_workers
+{
+   struct rzip_job jobs[RZIP_MAX_JOBS];
+   sthread_t *threads[RZIP_MAX_THREADS];
+   slock_t *lock;
+   /* Signalled whenever a job changes state */
+   scond_t *cond;
+   /* Chunks read from the file so far */
+   uint64_t chunks_read;
+   unsigned num_threads;
+   unsigned num_jobs;
+   /* Next job to fill */
+   unsigned head;
+   /* Oldest job, next to be written or read out */
+   unsigned tail;
+   /* Jobs between tail and head */
+   unsigned queued;
+   bool quit;
+};
+#endif
+
 /* Holds all metadata for an RZIP file stream */
 struct rzipstream
 {
@@ -64,6 +125,13 @@ struct rzipstream
    uint32_t out_buf_ptr;
    uint32_t out_buf_occupancy;
    uint32_t chunk_size;
+#ifdef HAVE_THREADS
+   /* Started once the file turns out to span
+    * more than one chunk */
+   struct rzip_workers *workers;
+#endif
+   unsigned num_threads;
+   enum rzip_codec codec;
    bool is_compressed;
    bool is_writing;
 };
@@ -104,7 +172,8 @@ static bool rzipstream_read_file_header(rzipstream_t *stream)
        (header_bytes[3] !=           73) || /* I */
        (header_bytes[4] !=           80) || /* P */
        (header_bytes[5] !=          118) || /* v */
-       (header_bytes[6] != RZIP_VERSION) || /* file format version number */
+       (   header_bytes[6] != RZIP_VERSION   /* file format version number */
+        && header_bytes[6] != RZIP_VERSION_LZ4) ||
        (header_bytes[7] !=           35))   /* # */
    {
       /* Reset file to start */
@@ -133,6 +202,8 @@ static bool rzipstream_read_file_header(rzipstream_t *stream)
                    (uint64_t)header_bytes[12]) == 0)
       return false;
 
+   stream->codec         = (header_bytes[6] == RZIP_VERSION_LZ4)
+         ? RZIP_CODEC_LZ4 : RZIP_CODEC_ZLIB;
    stream->is_compressed = true;
    return true;
 }
@@ -159,7 +230,8 @@ static bool rzipstream_write_file_header(rzipstream_t *stream)
    header_bytes[3]    =        73;    /* I */
    header_bytes[4]    =        80;    /* P */
    header_bytes[5]    =       118;    /* v */
-   header_bytes[6]    = RZIP_VERSION; /* file format version number */
+   header_bytes[6]    = (stream->codec == RZIP_CODEC_LZ4)
+         ? RZIP_VERSION_LZ4 : RZIP_VERSION; /* file format version number */
    header_bytes[7]    =        35;    /* # */
 
    /* > Uncompressed chunk size - next 4 bytes */
@@ -186,12 +258,365 @@ static bool rzipstream_write_file_header(rzipstream_t *stream)
          header_bytes, sizeof(header_bytes)) == RZIP_HEADER_SIZE);
 }
 
+/* Chunk Functions */
+
+/* Compresses or decompresses a single chunk with
+ * 'trans', which must not be in use elsewhere */
+static bool rzipstream_trans_chunk(
+      const struct trans_stream_backend *backend, void *trans,
+      const uint8_t *in_buf, uint32_t in_len,
+      uint8_t *out_buf, uint32_t out_buf_size, uint32_t *out_len)
+{
+   uint32_t trans_read;
+   uint32_t trans_written;
+
+   backend->set_in(trans, in_buf, in_len);
+   backend->set_out(trans, out_buf, out_buf_size);
+
+   /* Note: We have to set 'flush == true' here, otherwise we
+    * can't guarantee that the entire chunk will be written
+    * to the output buffer - this is inefficient, but not
+    * much we can do... */
+   if (!backend->trans(trans, true, &trans_read, &trans_written, NULL))
+      return false;
+
+   /* Error checking */
+   if (trans_read != in_len)
+      return false;
+
+   if ((trans_written == 0) ||
+       (trans_written > out_buf_size))
+      return false;
+
+   *out_len = trans_written;
+   return true;
+}
+
+/* Writes a compressed chunk, preceded by its size */
+static bool rzipstream_write_chunk_data(rzipstream_t *stream,
+      const uint8_t *data, uint32_t len)
+{
+   uint8_t chunk_header_bytes[RZIP_CHUNK_HEADER_SIZE];
+
+   chunk_header_bytes[3] = (len >> 24) & 0xFF;
+   chunk_header_bytes[2] = (len >> 16) & 0xFF;
+   chunk_header_bytes[1] = (len >>  8) & 0xFF;
+   chunk_header_bytes[0] =  len        & 0xFF;
+
+   if (filestream_write(
+         stream->file, chunk_header_bytes, sizeof(chunk_header_bytes)) !=
+         RZIP_CHUNK_HEADER_SIZE)
+      return false;
+
+   return (filestream_write(stream->file, data, len) == len);
+}
+
+/* Reads the next compressed chunk into '*buf',
+ * growing it if required */
+static bool rzipstream_read_chunk_data(rzipstream_t *stream,
+      uint8_t **buf, uint32_t *buf_size, uint32_t *len)
+{
+   uint8_t chunk_header_bytes[RZIP_CHUNK_HEADER_SIZE];
+   uint32_t compressed_chunk_size;
+
+   /* Attempt to read chunk header bytes */
+   if (filestream_read(
+         stream->file, chunk_header_bytes, sizeof(chunk_header_bytes)) !=
+         RZIP_CHUNK_HEADER_SIZE)
+      return false;
+
+   /* Get size of next compressed chunk */
+   compressed_chunk_size = ((uint32_t)chunk_header_bytes[3] << 24) |
+                           ((uint32_t)chunk_header_bytes[2] << 16) |
+                           ((uint32_t)chunk_header_bytes[1] <<  8) |
+                            (uint32_t)chunk_header_bytes[0];
+   if (compressed_chunk_size == 0)
+      return false;
+
+   /* Resize input buffer, if required */
+   if (compressed_chunk_size > *buf_size)
+   {
+      free(*buf);
+      *buf_size = 0;
+
+      if (!(*buf = (uint8_t *)calloc(compressed_chunk_size, 1)))
+         return false;
+      *buf_size = compressed_chunk_size;
+
+      /* Note: Uncompressed data size is fixed, and read
+       * from the file header - we therefore don't attempt
+       * to resize the output buffer (if it's too small, then
+       * that's an error condition) */
+   }
+
+   /* Read compressed chunk from file */
+   if (filestream_read(
+         stream->file, *buf, compressed_chunk_size) !=
+         compressed_chunk_size)
+      return false;
+
+   *len = compressed_chunk_size;
+   return true;
+}
+
+#ifdef HAVE_THREADS
+/* Worker Threads */
+
+static void rzipstream_worker(void *data)
+{
+   rzipstream_t *stream                       = (rzipstream_t*)data;
+   struct rzip_workers *workers               = stream->workers;
+   const struct trans_stream_backend *backend = stream->is_writing
+         ? stream->deflate_backend : stream->inflate_backend;
+   /* Transform streams keep state between calls,
+    * every worker needs its own */
+   void *trans                                = backend->stream_new();
+
+   if (     trans
+         && stream->is_writing
+         && stream->codec == RZIP_CODEC_ZLIB
+         && !backend->define(trans, "level", RZIP_COMPRESSION_LEVEL))
+   {
+      backend->stream_free(trans);
+      trans = NULL;
+   }
+
+   slock_lock(workers->lock);
+
+   while (!workers->quit)
+   {
+      unsigned i;
+      bool success;
+      struct rzip_job *job = NULL;
+
+      /* Oldest chunk first, the calling thread waits for it */
+      for (i = 0; i < workers->queued; i++)
+      {
+         struct rzip_job *next = &workers->jobs[
+               (workers->tail + i) % workers->num_jobs];
+         if (next->state == RZIP_JOB_PENDING)
+         {
+            job = next;
+            break;
+         }
+      }
+
+      if (!job)
+      {
+         scond_wait(workers->cond, workers->lock);
+         continue;
+      }
+
+      job->state = RZIP_JOB_BUSY;
+      slock_unlock(workers->lock);
+
+      success    = trans && rzipstream_trans_chunk(backend, trans,
+            job->in_buf, job->in_len,
+            job->out_buf, stream->out_buf_size, &job->out_len);
+
+      slock_lock(workers->lock);
+      job->state = success ? RZIP_JOB_DONE : RZIP_JOB_FAILED;
+      scond_broadcast(workers->cond);
+   }
+
+   slock_unlock(workers->lock);
+
+   if (trans)
+      backend->stream_free(trans);
+}
+
+/* Stops and frees the workers of a stream. Chunks
+ * that were not collected yet are discarded */
+static void rzipstream_stop_workers(rzipstream_t *stream)
+{
+   unsigned i;
+   struct rzip_workers *workers = stream->workers;
+
+   if (!workers)
+      return;
+
+   if (workers->lock && workers->cond)
+   {
+      slock_lock(workers->lock);
+      workers->quit = true;
+      scond_broadcast(workers->cond);
+      slock_unlock(workers->lock);
+
+      for (i = 0; i < workers->num_threads; i++)
+         sthread_join(workers->threads[i]);
+   }
+
+   for (i = 0; i < workers->num_jobs; i++)
+   {
+      free(workers->jobs[i].in_buf);
+      free(workers->jobs[i].out_buf);
+   }
+
+   if (workers->cond)
+      scond_free(workers->cond);
+   if (workers->lock)
+      slock_free(workers->lock);
+
+   free(workers);
+   stream->workers = NULL;
+}
+
+/* Starts stream->num_threads workers. On failure, the
+ * stream carries on (de)compressing on the calling thread */
+static void rzipstream_start_workers(rzipstream_t *stream)
+{
+   unsigned i;
+   struct rzip_workers *workers = (struct rzip_workers*)
+         calloc(1, sizeof(*workers));
+
+   if (!(stream->workers = workers))
+      return;
+
+   workers->num_jobs = stream->num_threads * 2;
+   workers->lock     = slock_new();
+   workers->cond     = scond_new();
+
+   if (!workers->lock || !workers->cond)
+      goto error;
+
+   for (i = 0; i < workers->num_jobs; i++)
+   {
+      struct rzip_job *job = &workers->jobs[i];
+
+      /* Writing: uncompressed chunks in, compressed out
+       * Reading: compressed chunks in, grown on demand,
+       *          uncompressed out */
+      job->in_buf_size     = stream->in_buf_size;
+      if (     !(job->in_buf  = (uint8_t*)malloc(job->in_buf_size))
+            || !(job->out_buf = (uint8_t*)malloc(stream->out_buf_size)))
+         goto error;
+   }
+
+   for (i = 0; i < stream->num_threads; i++)
+   {
+      if (!(workers->threads[i] = sthread_create(
+            rzipstream_worker, stream)))
+         goto error;
+      workers->num_threads++;
+   }
+
+   return;
+
+error:
+   rzipstream_stop_workers(stream);
+}
+
+/* Waits for the oldest job, then writes its chunk to
+ * the file or moves it to the output buffer */
+static bool rzipstream_collect_chunk(rzipstream_t *stream)
+{
+   struct rzip_workers *workers = stream->workers;
+   struct rzip_job *job         = &workers->jobs[workers->tail];
+   bool success;
+
+   slock_lock(workers->lock);
+   while (job->state == RZIP_JOB_PENDING || job->state == RZIP_JOB_BUSY)
+      scond_wait(workers->cond, workers->lock);
+   slock_unlock(workers->lock);
+
+   /* Done jobs are left alone by the workers */
+   if ((success = (job->state == RZIP_JOB_DONE)))
+   {
+      if (stream->is_writing)
+         success = rzipstream_write_chunk_data(stream,
+               job->out_buf, job->out_len);
+      else
+      {
+         /* Swap buffers instead of copying, both
+          * are stream->out_buf_size bytes */
+         uint8_t *out_buf          = stream->out_buf;
+         stream->out_buf           = job->out_buf;
+         job->out_buf              = out_buf;
+         stream->out_buf_occupancy = job->out_len;
+         stream->out_buf_ptr       = 0;
+      }
+   }
+
+   slock_lock(workers->lock);
+   job->state     = RZIP_JOB_EMPTY;
+   workers->tail  = (workers->tail + 1) % workers->num_jobs;
+   workers->queued--;
+   slock_unlock(workers->lock);
+
+   return success;
+}
+
+/* Hands the job at the head of the ring to the workers */
+static void rzipstream_queue_job(struct rzip_workers *workers)
+{
+   slock_lock(workers->lock);
+   workers->jobs[workers->head].state = RZIP_JOB_PENDING;
+   workers->head  = (workers->head + 1) % workers->num_jobs;
+   workers->queued++;
+   scond_broadcast(workers->cond);
+   slock_unlock(workers->lock);
+}
+
+/* Queues the input buffer for compression. Only
+ * waits if all jobs are in flight */
+static bool rzipstream_queue_write_chunk(rzipstream_t *stream)
+{
+   uint8_t *in_buf;
+   struct rzip_job *job;
+   struct rzip_workers *workers = stream->workers;
+
+   if (     workers->queued == workers->num_jobs
+         && !rzipstream_collect_chunk(stream))
+      return false;
+
+   /* Swap buffers instead of copying, both are
+    * stream->in_buf_size bytes */
+   job                = &workers->jobs[workers->head];
+   in_buf             = job->in_buf;
+   job->in_buf        = stream->in_buf;
+   job->in_len        = stream->in_buf_ptr;
+   stream->in_buf     = in_buf;
+   stream->in_buf_ptr = 0;
+
+   rzipstream_queue_job(workers);
+   return true;
+}
+
+/* Keeps the workers busy decompressing the chunks
+ * that follow, then returns the next one */
+static bool rzipstream_read_chunk_threaded(rzipstream_t *stream)
+{
+   struct rzip_workers *workers = stream->workers;
+   uint64_t num_chunks          = (stream->size + stream->chunk_size - 1)
+         / stream->chunk_size;
+
+   while (     workers->queued      < workers->num_jobs
+            && workers->chunks_read < num_chunks)
+   {
+      struct rzip_job *job = &workers->jobs[workers->head];
+
+      if (!rzipstream_read_chunk_data(stream,
+            &job->in_buf, &job->in_buf_size, &job->in_len))
+         return false;
+
+      workers->chunks_read++;
+      rzipstream_queue_job(workers);
+   }
+
+   if (!workers->queued)
+      return false;
+
+   return rzipstream_collect_chunk(stream);
+}
+#endif
+
 /* Stream Initialisation/De-initialisation */
 
 /* Initialises all members of an rzipstream_t struct,
  * reading config from existing file header if available */
 static bool rzipstream_init_stream(
-      rzipstream_t *stream, const char *path, bool is_writing)
+      rzipstream_t *stream, const char *path, bool is_writing,
+      enum rzip_codec codec)
 {
    unsigned file_mode;
 
@@ -213,6 +638,7 @@ static bool rzipstream_init_stream(
    stream->out_buf_size      = 0;
    stream->out_buf_ptr       = 0;
    stream->out_buf_occupancy = 0;
+   stream->codec             = codec;
 
    /* Check whether this is a read or write stream */
    stream->is_writing = is_writing;
@@ -253,14 +679,20 @@ static bool rzipstream_init_stream(
    if (stream->is_writing)
    {
       /* Compression */
-      if (!(stream->deflate_backend = trans_stream_get_zlib_deflate_backend()))
+      if (stream->codec == RZIP_CODEC_LZ4)
+         stream->deflate_backend = trans_stream_get_lz4_compress_backend();
+      else
+         stream->deflate_backend = trans_stream_get_zlib_deflate_backend();
+
+      if (!stream->deflate_backend)
          return false;
 
       if (!(stream->deflate_stream = stream->deflate_backend->stream_new()))
          return false;
 
       /* Set compression level */
-      if (!stream->deflate_backend->define(
+      if (     stream->codec == RZIP_CODEC_ZLIB
+            && !stream->deflate_backend->define(
             stream->deflate_stream, "level", RZIP_COMPRESSION_LEVEL))
          return false;
 
@@ -286,7 +718,12 @@ static bool rzipstream_init_stream(
    else if (stream->is_compressed)
    {
       /* Decompression */
-      if (!(stream->inflate_backend = trans_stream_get_zlib_inflate_backend()))
+      if (stream->codec == RZIP_CODEC_LZ4)
+         stream->inflate_backend = trans_stream_get_lz4_decompress_backend();
+      else
+         stream->inflate_backend = trans_stream_get_zlib_inflate_backend();
+
+      if (!stream->inflate_backend)
          return false;
 
       if (!(stream->inflate_stream = stream->inflate_backend->stream_new()))
@@ -336,6 +773,10 @@ static int rzipstream_free_stream(rzipstream_t *stream)
    if (!stream)
       return -1;
 
+#ifdef HAVE_THREADS
+   rzipstream_stop_workers(stream);
+#endif
+
    /* Free transform streams */
    if (stream->deflate_stream && stream->deflate_backend)
       stream->deflate_backend->stream_free(stream->deflate_stream);
@@ -378,7 +819,8 @@ static int rzipstream_free_stream(rzipstream_t *stream)
  *   or uncompressed data
  * Returns NULL if arguments are invalid, file
  * is invalid or an IO error occurs */
-rzipstream_t* rzipstream_open(const char *path, unsigned mode)
+rzipstream_t* rzipstream_open_codec(const char *path, unsigned mode,
+      enum rzip_codec codec)
 {
    rzipstream_t *stream = NULL;
 
@@ -416,11 +858,19 @@ rzipstream_t* rzipstream_open(const char *path, unsigned mode)
    stream->out_buf_size    = 0;
    stream->out_buf_ptr     = 0;
    stream->out_buf_occupancy = 0;
+#ifdef HAVE_THREADS
+   stream->workers         = NULL;
+   stream->num_threads     = cpu_features_get_core_amount();
+   if (stream->num_threads > RZIP_MAX_THREADS)
+      stream->num_threads  = RZIP_MAX_THREADS;
+#else
+   stream->num_threads     = 1;
+#endif
 
    /* Initialise stream */
    if (!rzipstream_init_stream(
          stream, path,
-         (mode == RETRO_VFS_FILE_ACCESS_WRITE)))
+         (mode == RETRO_VFS_FILE_ACCESS_WRITE), codec))
    {
       rzipstream_free_stream(stream);
       return NULL;
@@ -429,85 +879,43 @@ rzipstream_t* rzipstream_open(const char *path, unsigned mode)
    return stream;
 }
 
+rzipstream_t* rzipstream_open(const char *path, unsigned mode)
+{
+   return rzipstream_open_codec(path, mode, RZIP_CODEC_ZLIB);
+}
+
 /* File Read */
 
 /* Reads and decompresses the next chunk of data
  * in the RZIP file */
 static bool rzipstream_read_chunk(rzipstream_t *stream)
 {
-   unsigned i;
-   uint8_t chunk_header_bytes[RZIP_CHUNK_HEADER_SIZE];
    uint32_t compressed_chunk_size;
-   uint32_t inflate_read;
    uint32_t inflate_written;
 
    if (!stream || !stream->inflate_backend || !stream->inflate_stream)
       return false;
 
-   for (i = 0; i < RZIP_CHUNK_HEADER_SIZE; i++)
-      chunk_header_bytes[i] = 0;
-
-   /* Attempt to read chunk header bytes */
-   if (filestream_read(
-         stream->file, chunk_header_bytes, sizeof(chunk_header_bytes)) !=
-         RZIP_CHUNK_HEADER_SIZE)
-      return false;
-
-   /* Get size of next compressed chunk */
-   compressed_chunk_size = ((uint32_t)chunk_header_bytes[3] << 24) |
-                           ((uint32_t)chunk_header_bytes[2] << 16) |
-                           ((uint32_t)chunk_header_bytes[1] <<  8) |
-                            (uint32_t)chunk_header_bytes[0];
-   if (compressed_chunk_size == 0)
-      return false;
-
-   /* Resize input buffer, if required */
-   if (compressed_chunk_size > stream->in_buf_size)
-   {
-      free(stream->in_buf);
-      stream->in_buf      = NULL;
-
-      stream->in_buf_size = compressed_chunk_size;
-      stream->in_buf      = (uint8_t *)calloc(stream->in_buf_size, 1);
-      if (!stream->in_buf)
-         return false;
+#ifdef HAVE_THREADS
+   /* Decompress ahead if the file has more than one chunk */
+   if (     !stream->workers
+         && stream->num_threads > 1
+         && stream->size > stream->chunk_size)
+      rzipstream_start_workers(stream);
 
-      /* Note: Uncompressed data size is fixed, and read
-       * from the file header - we therefore don't attempt
-       * to resize the output buffer (if it's too small, then
-       * that's an error condition) */
-   }
+   if (stream->workers)
+      return rzipstream_read_chunk_threaded(stream);
+#endif
 
-   /* Read compressed chunk from file */
-   if (filestream_read(
-         stream->file, stream->in_buf, compressed_chunk_size) !=
-         compressed_chunk_size)
+   if (!rzipstream_read_chunk_data(stream,
+         &stream->in_buf, &stream->in_buf_size, &compressed_chunk_size))
       return false;
 
    /* Decompress chunk data */
-   stream->inflate_backend->set_in(
-         stream->inflate_stream,
-         stream->in_buf, compressed_chunk_size);
-
-   stream->inflate_backend->set_out(
-         stream->inflate_stream,
-         stream->out_buf, stream->out_buf_size);
-
-   /* Note: We have to set 'flush == true' here, otherwise we
-    * can't guarantee that the entire chunk will be written
-    * to the output buffer - this is inefficient, but not
-    * much we can do... */
-   if (!stream->inflate_backend->trans(
-         stream->inflate_stream, true,
-         &inflate_read, &inflate_written, NULL))
-      return false;
-
-   /* Error checking */
-   if (inflate_read != compressed_chunk_size)
-      return false;
-
-   if ((inflate_written == 0) ||
-       (inflate_written > stream->out_buf_size))
+   if (!rzipstream_trans_chunk(
+         stream->inflate_backend, stream->inflate_stream,
+         stream->in_buf, compressed_chunk_size,
+         stream->out_buf, stream->out_buf_size, &inflate_written))
       return false;
 
    /* Record current output buffer occupancy
@@ -720,57 +1128,25 @@ error:
  * as the next RZIP file chunk */
 static bool rzipstream_write_chunk(rzipstream_t *stream)
 {
-   unsigned i;
-   uint8_t chunk_header_bytes[RZIP_CHUNK_HEADER_SIZE];
-   uint32_t deflate_read;
    uint32_t deflate_written;
 
    if (!stream || !stream->deflate_backend || !stream->deflate_stream)
       return false;
 
-   for (i = 0; i < RZIP_CHUNK_HEADER_SIZE; i++)
-      chunk_header_bytes[i] = 0;
+#ifdef HAVE_THREADS
+   if (stream->workers)
+      return rzipstream_queue_write_chunk(stream);
+#endif
 
    /* Compress data currently held in input buffer */
-   stream->deflate_backend->set_in(
-         stream->deflate_stream,
-         stream->in_buf, stream->in_buf_ptr);
-
-   stream->deflate_backend->set_out(
-         stream->deflate_stream,
-         stream->out_buf, stream->out_buf_size);
-
-   /* Note: We have to set 'flush == true' here, otherwise we
-    * can't guarantee that the entire chunk will be written
-    * to the output buffer - this is inefficient, but not
-    * much we can do... */
-   if (!stream->deflate_backend->trans(
-         stream->deflate_stream, true,
-         &deflate_read, &deflate_written, NULL))
-      return false;
-
-   /* Error checking */
-   if (deflate_read != stream->in_buf_ptr)
-      return false;
-
-   if ((deflate_written == 0) ||
-       (deflate_written > stream->out_buf_size))
-      return false;
-
-   /* Write compressed chunk size to file */
-   chunk_header_bytes[3] = (deflate_written >> 24) & 0xFF;
-   chunk_header_bytes[2] = (deflate_written >> 16) & 0xFF;
-   chunk_header_bytes[1] = (deflate_written >>  8) & 0xFF;
-   chunk_header_bytes[0] =  deflate_written        & 0xFF;
-
-   if (filestream_write(
-         stream->file, chunk_header_bytes, sizeof(chunk_header_bytes)) !=
-         RZIP_CHUNK_HEADER_SIZE)
+   if (!rzipstream_trans_chunk(
+         stream->deflate_backend, stream->deflate_stream,
+         stream->in_buf, stream->in_buf_ptr,
+         stream->out_buf, stream->out_buf_size, &deflate_written))
       return false;
 
-   /* Write compressed data to file */
-   if (filestream_write(
-         stream->file, stream->out_buf, deflate_written) != deflate_written)
+   /* Write compressed chunk to file */
+   if (!rzipstream_write_chunk_data(stream, stream->out_buf, deflate_written))
       return false;
 
    /* Reset input buffer pointer */
@@ -797,8 +1173,15 @@ int64_t rzipstream_write(rzipstream_t *stream, const void *data, int64_t len)
 
       /* If input buffer is full, compress and write to disk */
       if (stream->in_buf_ptr >= stream->in_buf_size)
+      {
+#ifdef HAVE_THREADS
+         /* More than one chunk, compress them in parallel */
+         if (!stream->workers && stream->num_threads > 1)
+            rzipstream_start_workers(stream);
+#endif
          if (!rzipstream_write_chunk(stream))
             return -1;
+      }
 
       /* Get amount of data to cache during this loop
        * > i.e. minimum of space remaining in input buffer
@@ -940,6 +1323,11 @@ void rzipstream_rewind(rzipstream_t *stream)
    /* Check whether we are reading or writing */
    if (stream->is_writing)
    {
+#ifdef HAVE_THREADS
+      /* Drop chunks that have not been written yet */
+      rzipstream_stop_workers(stream);
+#endif
+
       /* Reset file position to first chunk location */
       filestream_seek(stream->file, RZIP_HEADER_SIZE, SEEK_SET);
       if (filestream_error(stream->file))
@@ -968,6 +1356,11 @@ void rzipstream_rewind(rzipstream_t *stream)
       {
          /* It isn't: Have to re-read the first chunk
           * from disk... */
+#ifdef HAVE_THREADS
+         /* > Read-ahead continues from the wrong place,
+          *   restarted by rzipstream_read_chunk() */
+         rzipstream_stop_workers(stream);
+#endif
 
          /* Reset file position to first chunk location */
          filestream_seek(stream->file, RZIP_HEADER_SIZE, SEEK_SET);
@@ -1035,6 +1428,25 @@ bool rzipstream_is_compressed(rzipstream_t *stream)
    return stream && stream->is_compressed;
 }
 
+/* Sets the number of threads that compress or
+ * decompress chunks concurrently. Defaults to the
+ * number of CPU cores; 1 processes every chunk on
+ * the calling thread. Workers are only started for
+ * files larger than one chunk.
+ * Must be called before the first read or write. */
+void rzipstream_set_threads(rzipstream_t *stream, unsigned threads)
+{
+   if (!stream)
+      return;
+
+   if (threads < 1)
+      threads = 1;
+   else if (threads > RZIP_MAX_THREADS)
+      threads = RZIP_MAX_THREADS;
+
+   stream->num_threads = threads;
+}
+
 /* File Close */
 
 /* Closes RZIP file. If file is open for writing,
@@ -1054,6 +1466,13 @@ int rzipstream_close(rzipstream_t *stream)
          if (!rzipstream_write_chunk(stream))
             goto error;
 
+#ifdef HAVE_THREADS
+      /* Write chunks still held by the workers */
+      while (stream->workers && stream->workers->queued)
+         if (!rzipstream_collect_chunk(stream))
+            goto error;
+#endif
+
       if (!rzipstream_write_file_header(stream))
          goto error;
    }
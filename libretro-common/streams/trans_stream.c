@@ -90,3 +90,13 @@ const struct trans_stream_backend* trans_stream_get_pipe_backend(void)
 {
    return &pipe_backend;
 }
+
+const struct trans_stream_backend* trans_stream_get_lz4_compress_backend(void)
+{
+   return &lz4_compress_backend;
+}
+
+const struct trans_stream_backend* trans_stream_get_lz4_decompress_backend(void)
+{
+   return &lz4_decompress_backend;
+}
@@ -0,0 +1,709 @@
+/* Copyright  (C) 2010-2020 The RetroArch team
+ *
+ * ---------------------------------------------------------------------------------------
+ * The following license statement only applies to this file (trans_stream_lz4.c).
+ * ---------------------------------------------------------------------------------------
+ *
+ * Permission is hereby granted, free of charge,
+ * to any person obtaining a copy of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction, including without limitation the rights to
+ * use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies of the Software,
+ * and to permit persons to whom the Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR IMPLIED,
+ * INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.
+ * IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY,
+ * WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ */
+
+/* Fast LZ77 transcoder, trading ratio for speed compared to zlib.
+ *
+ * Blocks use the LZ4 block format (token, literals, 16-bit offset,
+ * match length), compressed greedily with a single hash probe.
+ * The stream wraps them in a minimal frame:
+ *
+ *    repeat {
+ *       uint32le packed_size; (bit 31 set: block is stored as is)
+ *       uint32le size;        (at most LZ4_TRANS_BLOCK_SIZE)
+ *       uint8    data[packed_size];
+ *    }
+ *    uint32le 0; uint32le 0;  (end of stream)
+ *
+ * Blocks are independent, so a block can be decoded as soon as it
+ * has been received. */
+
+#include <stdlib.h>
+#include <string.h>
+
+#include <retro_inline.h>
+#include <retro_miscellaneous.h>
+#include <string/stdstring.h>
+#include <streams/trans_stream.h>
+
+#define LZ4_TRANS_BLOCK_SIZE   (256 * 1024)
+#define LZ4_TRANS_HEADER_SIZE  8
+#define LZ4_TRANS_STORED       0x80000000U
+#define LZ4_TRANS_BOUND(n)     ((n) + ((n) / 255) + 16)
+
+#define LZ4_MINMATCH           4
+#define LZ4_LASTLITERALS       5
+#define LZ4_MFLIMIT            12
+#define LZ4_MAX_DISTANCE       65535
+#define LZ4_HASH_LOG           14
+/* How fast the search skips ahead over data that doesn't match */
+#define LZ4_SKIP_TRIGGER       6
+
+struct lz4_trans_stream
+{
+   const uint8_t *in;
+   uint8_t *out;
+   /* Compression: input waiting for a full block.
+    * Decompression: decoded block waiting for output space. */
+   uint8_t *block;
+   /* Compression: encoded block waiting for output space.
+    * Decompression: encoded block being received. */
+   uint8_t *pend;
+   uint32_t *table;
+   uint32_t in_size;
+   uint32_t out_size;
+   uint32_t block_fill;
+   uint32_t block_ptr;
+   uint32_t pend_size;
+   uint32_t pend_ptr;
+   uint32_t hdr_fill;
+   uint32_t raw_size;
+   unsigned skip_trigger;
+   uint8_t hdr[LZ4_TRANS_HEADER_SIZE];
+   bool stored;
+   bool ended;
+};
+
+static INLINE uint32_t lz4_read32(const uint8_t *p)
+{
+   uint32_t v;
+   memcpy(&v, p, sizeof(v));
+   return v;
+}
+
+static INLINE uint32_t lz4_hash(uint32_t v)
+{
+   return (v * 2654435761U) >> (32 - LZ4_HASH_LOG);
+}
+
+static INLINE void lz4_write_le32(uint8_t *p, uint32_t v)
+{
+   p[0] = (uint8_t)(v);
+   p[1] = (uint8_t)(v >>  8);
+   p[2] = (uint8_t)(v >> 16);
+   p[3] = (uint8_t)(v >> 24);
+}
+
+static INLINE uint32_t lz4_read_le32(const uint8_t *p)
+{
+   return  (uint32_t)p[0]        | ((uint32_t)p[1] <<  8)
+         | ((uint32_t)p[2] << 16) | ((uint32_t)p[3] << 24);
+}
+
+static INLINE uint8_t *lz4_write_length(uint8_t *op, size_t len)
+{
+   while (len >= 255)
+   {
+      *op++ = 255;
+      len  -= 255;
+   }
+   *op++    = (uint8_t)len;
+   return op;
+}
+
+/* Number of bytes 'p' and 'm' have in common, up to 'limit' */
+static INLINE size_t lz4_count(const uint8_t *p, const uint8_t *m,
+      const uint8_t *limit)
+{
+   const uint8_t *start = p;
+
+   while (p + sizeof(uint64_t) <= limit)
+   {
+      uint64_t a, b;
+      memcpy(&a, p, sizeof(a));
+      memcpy(&b, m, sizeof(b));
+      if (a != b)
+         break;
+      p += sizeof(uint64_t);
+      m += sizeof(uint64_t);
+   }
+
+   while (p < limit && *p == *m)
+   {
+      p++;
+      m++;
+   }
+
+   return p - start;
+}
+
+/* Compresses 'len' bytes of 'src' into 'dst', which must hold
+ * LZ4_TRANS_BOUND(len) bytes. Returns the compressed size. */
+static size_t lz4_compress_block(uint32_t *table, unsigned skip_trigger,
+      const uint8_t *src, size_t len, uint8_t *dst)
+{
+   const uint8_t *ip     = src;
+   const uint8_t *anchor = src;
+   const uint8_t *iend   = src + len;
+   uint8_t *op           = dst;
+   uint8_t *token;
+   size_t lit;
+
+   if (len > LZ4_MFLIMIT)
+   {
+      const uint8_t *mflimit    = iend - LZ4_MFLIMIT;
+      const uint8_t *matchlimit = iend - LZ4_LASTLITERALS;
+
+      memset(table, 0, sizeof(*table) << LZ4_HASH_LOG);
+      ip++;
+
+      for (;;)
+      {
+         size_t mlen;
+         const uint8_t *match;
+         unsigned attempts = 1 << skip_trigger;
+
+         /* Find a match */
+         for (;;)
+         {
+            uint32_t seq = lz4_read32(ip);
+            uint32_t h   = lz4_hash(seq);
+
+            match        = src + table[h];
+            table[h]     = (uint32_t)(ip - src);
+
+            if (     match < ip
+                  && ip - match <= LZ4_MAX_DISTANCE
+                  && lz4_read32(match) == seq)
+               break;
+
+            ip += attempts++ >> skip_trigger;
+            if (ip > mflimit)
+               goto last_literals;
+         }
+
+         /* Extend it backwards */
+         while (ip > anchor && match > src && ip[-1] == match[-1])
+         {
+            ip--;
+            match--;
+         }
+
+         /* Literals */
+         lit   = ip - anchor;
+         token = op++;
+         if (lit >= 15)
+         {
+            *token = 15 << 4;
+            op     = lz4_write_length(op, lit - 15);
+         }
+         else
+            *token = (uint8_t)(lit << 4);
+         memcpy(op, anchor, lit);
+         op   += lit;
+
+         /* Offset */
+         *op++ = (uint8_t)(ip - match);
+         *op++ = (uint8_t)((ip - match) >> 8);
+
+         /* Match length */
+         mlen  = LZ4_MINMATCH + lz4_count(ip + LZ4_MINMATCH,
+               match + LZ4_MINMATCH, matchlimit);
+         if (mlen - LZ4_MINMATCH >= 15)
+         {
+            *token |= 15;
+            op      = lz4_write_length(op, mlen - LZ4_MINMATCH - 15);
+         }
+         else
+            *token |= (uint8_t)(mlen - LZ4_MINMATCH);
+
+         ip     += mlen;
+         anchor  = ip;
+
+         if (ip > mflimit)
+            break;
+
+         table[lz4_hash(lz4_read32(ip - 2))] = (uint32_t)(ip - 2 - src);
+      }
+   }
+
+last_literals:
+   lit   = iend - anchor;
+   token = op++;
+   if (lit >= 15)
+   {
+      *token = 15 << 4;
+      op     = lz4_write_length(op, lit - 15);
+   }
+   else
+      *token = (uint8_t)(lit << 4);
+   memcpy(op, anchor, lit);
+   op   += lit;
+
+   return op - dst;
+}
+
+/* Decodes exactly 'dst_len' bytes from 'src', checking every
+ * length and offset against both buffers. */
+static bool lz4_decompress_block(const uint8_t *src, size_t src_len,
+      uint8_t *dst, size_t dst_len)
+{
+   const uint8_t *ip   = src;
+   const uint8_t *iend = src + src_len;
+   uint8_t *op         = dst;
+   uint8_t *oend       = dst + dst_len;
+
+   for (;;)
+   {
+      size_t lit, mlen, off;
+      unsigned token;
+
+      if (ip >= iend)
+         return false;
+      token = *ip++;
+
+      lit   = token >> 4;
+      if (lit == 15)
+      {
+         unsigned b;
+         do
+         {
+            if (ip >= iend)
+               return false;
+            b    = *ip++;
+            lit += b;
+         } while (b == 255);
+      }
+
+      if (lit > (size_t)(iend - ip) || lit > (size_t)(oend - op))
+         return false;
+      memcpy(op, ip, lit);
+      ip += lit;
+      op += lit;
+
+      /* The last sequence has no match */
+      if (ip == iend)
+         break;
+
+      if (iend - ip < 2)
+         return false;
+      off  = ip[0] | (ip[1] << 8);
+      ip  += 2;
+      if (!off || off > (size_t)(op - dst))
+         return false;
+
+      mlen = token & 15;
+      if (mlen == 15)
+      {
+         unsigned b;
+         do
+         {
+            if (ip >= iend)
+               return false;
+            b     = *ip++;
+            mlen += b;
+         } while (b == 255);
+      }
+      mlen += LZ4_MINMATCH;
+
+      if (mlen > (size_t)(oend - op))
+         return false;
+
+      if (off >= mlen)
+         memcpy(op, op - off, mlen);
+      else if (off == 1)
+         memset(op, op[-1], mlen);
+      else
+      {
+         /* Overlapping copy, repeats the last 'off' bytes */
+         const uint8_t *m = op - off;
+         size_t i;
+         for (i = 0; i < mlen; i++)
+            op[i] = m[i];
+      }
+      op += mlen;
+   }
+
+   return op == oend;
+}
+
+static void *lz4_stream_new(void)
+{
+   struct lz4_trans_stream *s = (struct lz4_trans_stream*)
+      calloc(1, sizeof(*s));
+   if (!s)
+      return NULL;
+   s->skip_trigger = LZ4_SKIP_TRIGGER;
+   return s;
+}
+
+static void lz4_stream_free(void *data)
+{
+   struct lz4_trans_stream *s = (struct lz4_trans_stream*)data;
+   if (!s)
+      return;
+   free(s->block);
+   free(s->pend);
+   free(s->table);
+   free(s);
+}
+
+static bool lz4_compress_define(void *data, const char *prop, uint32_t val)
+{
+   struct lz4_trans_stream *s = (struct lz4_trans_stream*)data;
+   /* Higher is faster, with a worse ratio on incompressible data */
+   if (string_is_equal(prop, "acceleration"))
+   {
+      if (s)
+         s->skip_trigger = (val >= LZ4_SKIP_TRIGGER)
+            ? 1 : LZ4_SKIP_TRIGGER - val;
+      return true;
+   }
+   return false;
+}
+
+static void lz4_set_in(void *data, const uint8_t *in, uint32_t in_size)
+{
+   struct lz4_trans_stream *s = (struct lz4_trans_stream*)data;
+   if (!s)
+      return;
+   s->in      = in;
+   s->in_size = in_size;
+}
+
+static void lz4_set_out(void *data, uint8_t *out, uint32_t out_size)
+{
+   struct lz4_trans_stream *s = (struct lz4_trans_stream*)data;
+   if (!s)
+      return;
+   s->out      = out;
+   s->out_size = out_size;
+}
+
+/* Encodes one block, straight into the output if it is
+ * guaranteed to fit, otherwise into the pending buffer. */
+static bool lz4_compress_emit(struct lz4_trans_stream *s,
+      const uint8_t *src, uint32_t len, uint32_t *wn)
+{
+   uint8_t *dst;
+   size_t packed;
+   bool direct = s->out_size >= LZ4_TRANS_HEADER_SIZE + LZ4_TRANS_BOUND(len);
+
+   if (!s->table && !(s->table = (uint32_t*)
+            malloc(sizeof(*s->table) << LZ4_HASH_LOG)))
+      return false;
+
+   if (direct)
+      dst = s->out;
+   else
+   {
+      if (!s->pend && !(s->pend = (uint8_t*)malloc(
+            LZ4_TRANS_HEADER_SIZE + LZ4_TRANS_BOUND(LZ4_TRANS_BLOCK_SIZE))))
+         return false;
+      dst = s->pend;
+   }
+
+   packed = lz4_compress_block(s->table, s->skip_trigger,
+         src, len, dst + LZ4_TRANS_HEADER_SIZE);
+
+   if (packed >= len)
+   {
+      memcpy(dst + LZ4_TRANS_HEADER_SIZE, src, len);
+      lz4_write_le32(dst, len | LZ4_TRANS_STORED);
+      packed = len;
+   }
+   else
+      lz4_write_le32(dst, (uint32_t)packed);
+   lz4_write_le32(dst + 4, len);
+
+   packed += LZ4_TRANS_HEADER_SIZE;
+
+   if (direct)
+   {
+      s->out      += packed;
+      s->out_size -= (uint32_t)packed;
+      *wn         += (uint32_t)packed;
+   }
+   else
+   {
+      s->pend_size = (uint32_t)packed;
+      s->pend_ptr  = 0;
+   }
+
+   return true;
+}
+
+static bool lz4_compress_trans(
+   void *data, bool flush,
+   uint32_t *rd, uint32_t *wn,
+   enum trans_stream_error *error)
+{
+   struct lz4_trans_stream *s = (struct lz4_trans_stream*)data;
+   enum trans_stream_error err = TRANS_STREAM_ERROR_AGAIN;
+   bool ret                    = true;
+
+   *rd = *wn = 0;
+
+   for (;;)
+   {
+      /* Flush whatever is already encoded */
+      if (s->pend_ptr < s->pend_size)
+      {
+         uint32_t n = MIN(s->pend_size - s->pend_ptr, s->out_size);
+         memcpy(s->out, s->pend + s->pend_ptr, n);
+         s->pend_ptr += n;
+         s->out      += n;
+         s->out_size -= n;
+         *wn         += n;
+         if (s->pend_ptr < s->pend_size)
+         {
+            err = TRANS_STREAM_ERROR_BUFFER_FULL;
+            ret = false;
+            break;
+         }
+      }
+
+      if (s->in_size)
+      {
+         uint32_t n;
+
+         /* Whole blocks go straight from the input */
+         if (!s->block_fill && s->in_size >= LZ4_TRANS_BLOCK_SIZE)
+         {
+            if (!lz4_compress_emit(s, s->in, LZ4_TRANS_BLOCK_SIZE, wn))
+               goto alloc_error;
+            s->in      += LZ4_TRANS_BLOCK_SIZE;
+            s->in_size -= LZ4_TRANS_BLOCK_SIZE;
+            *rd        += LZ4_TRANS_BLOCK_SIZE;
+            continue;
+         }
+
+         if (!s->block && !(s->block = (uint8_t*)
+                  malloc(LZ4_TRANS_BLOCK_SIZE)))
+            goto alloc_error;
+
+         n = MIN(s->in_size, LZ4_TRANS_BLOCK_SIZE - s->block_fill);
+         memcpy(s->block + s->block_fill, s->in, n);
+         s->block_fill += n;
+         s->in         += n;
+         s->in_size    -= n;
+         *rd           += n;
+
+         if (s->block_fill == LZ4_TRANS_BLOCK_SIZE)
+         {
+            if (!lz4_compress_emit(s, s->block, s->block_fill, wn))
+               goto alloc_error;
+            s->block_fill = 0;
+         }
+         continue;
+      }
+
+      if (!flush)
+         break;
+
+      if (s->block_fill)
+      {
+         if (!lz4_compress_emit(s, s->block, s->block_fill, wn))
+            goto alloc_error;
+         s->block_fill = 0;
+         continue;
+      }
+
+      if (!s->ended)
+      {
+         if (!s->pend && !(s->pend = (uint8_t*)malloc(
+               LZ4_TRANS_HEADER_SIZE + LZ4_TRANS_BOUND(LZ4_TRANS_BLOCK_SIZE))))
+            goto alloc_error;
+         memset(s->pend, 0, LZ4_TRANS_HEADER_SIZE);
+         s->pend_size = LZ4_TRANS_HEADER_SIZE;
+         s->pend_ptr  = 0;
+         s->ended     = true;
+         continue;
+      }
+
+      /* Finished, ready for the next stream */
+      s->ended = false;
+      err      = TRANS_STREAM_ERROR_NONE;
+      break;
+   }
+
+   if (error)
+      *error = err;
+   return ret;
+
+alloc_error:
+   if (error)
+      *error = TRANS_STREAM_ERROR_ALLOCATION_FAILURE;
+   return false;
+}
+
+static bool lz4_decompress_trans(
+   void *data, bool flush,
+   uint32_t *rd, uint32_t *wn,
+   enum trans_stream_error *error)
+{
+   struct lz4_trans_stream *s = (struct lz4_trans_stream*)data;
+   enum trans_stream_error err = TRANS_STREAM_ERROR_AGAIN;
+   bool ret                    = true;
+
+   *rd = *wn = 0;
+
+   for (;;)
+   {
+      uint32_t packed;
+      const uint8_t *src;
+
+      /* Hand out what is already decoded */
+      if (s->block_ptr < s->block_fill)
+      {
+         uint32_t n = MIN(s->block_fill - s->block_ptr, s->out_size);
+         memcpy(s->out, s->block + s->block_ptr, n);
+         s->block_ptr += n;
+         s->out       += n;
+         s->out_size  -= n;
+         *wn          += n;
+         if (s->block_ptr < s->block_fill)
+         {
+            err = TRANS_STREAM_ERROR_BUFFER_FULL;
+            ret = false;
+            break;
+         }
+      }
+
+      /* Block header */
+      if (s->hdr_fill < LZ4_TRANS_HEADER_SIZE)
+      {
+         uint32_t n = MIN(s->in_size, LZ4_TRANS_HEADER_SIZE - s->hdr_fill);
+         memcpy(s->hdr + s->hdr_fill, s->in, n);
+         s->hdr_fill += n;
+         s->in       += n;
+         s->in_size  -= n;
+         *rd         += n;
+
+         if (s->hdr_fill < LZ4_TRANS_HEADER_SIZE)
+            break;
+
+         packed      = lz4_read_le32(s->hdr);
+         s->raw_size = lz4_read_le32(s->hdr + 4);
+         s->stored   = (packed & LZ4_TRANS_STORED) ? true : false;
+         packed     &= ~LZ4_TRANS_STORED;
+
+         if (!packed && !s->raw_size)
+         {
+            /* End of stream, ready for the next one */
+            s->hdr_fill = 0;
+            err         = TRANS_STREAM_ERROR_NONE;
+            break;
+         }
+
+         if (     !packed
+               || s->raw_size > LZ4_TRANS_BLOCK_SIZE
+               || packed > LZ4_TRANS_BOUND(LZ4_TRANS_BLOCK_SIZE)
+               || (s->stored && packed != s->raw_size))
+            goto invalid;
+
+         s->pend_size = packed;
+         s->pend_ptr  = 0;
+      }
+
+      /* Block payload, straight from the input if it's all there */
+      if (!s->pend_ptr && s->in_size >= s->pend_size)
+      {
+         src         = s->in;
+         s->in      += s->pend_size;
+         s->in_size -= s->pend_size;
+         *rd        += s->pend_size;
+      }
+      else
+      {
+         uint32_t n;
+
+         if (!s->pend && !(s->pend = (uint8_t*)malloc(
+               LZ4_TRANS_BOUND(LZ4_TRANS_BLOCK_SIZE))))
+            goto alloc_error;
+
+         n = MIN(s->in_size, s->pend_size - s->pend_ptr);
+         memcpy(s->pend + s->pend_ptr, s->in, n);
+         s->pend_ptr += n;
+         s->in       += n;
+         s->in_size  -= n;
+         *rd         += n;
+
+         if (s->pend_ptr < s->pend_size)
+            break;
+         src = s->pend;
+      }
+
+      s->hdr_fill = 0;
+
+      if (s->out_size >= s->raw_size)
+      {
+         if (s->stored)
+            memcpy(s->out, src, s->raw_size);
+         else if (!lz4_decompress_block(src, s->pend_size,
+                  s->out, s->raw_size))
+            goto invalid;
+         s->out      += s->raw_size;
+         s->out_size -= s->raw_size;
+         *wn         += s->raw_size;
+      }
+      else
+      {
+         if (!s->block && !(s->block = (uint8_t*)
+                  malloc(LZ4_TRANS_BLOCK_SIZE)))
+            goto alloc_error;
+         if (s->stored)
+            memcpy(s->block, src, s->raw_size);
+         else if (!lz4_decompress_block(src, s->pend_size,
+                  s->block, s->raw_size))
+            goto invalid;
+         s->block_fill = s->raw_size;
+         s->block_ptr  = 0;
+      }
+   }
+
+   if (error)
+      *error = err;
+   return ret;
+
+invalid:
+   s->hdr_fill = 0;
+   if (error)
+      *error = TRANS_STREAM_ERROR_INVALID;
+   return false;
+
+alloc_error:
+   if (error)
+      *error = TRANS_STREAM_ERROR_ALLOCATION_FAILURE;
+   return false;
+}
+
+const struct trans_stream_backend lz4_compress_backend = {
+   "lz4_compress",
+   &lz4_decompress_backend,
+   lz4_stream_new,
+   lz4_stream_free,
+   lz4_compress_define,
+   lz4_set_in,
+   lz4_set_out,
+   lz4_compress_trans
+};
+
+const struct trans_stream_backend lz4_decompress_backend = {
+   "lz4_decompress",
+   &lz4_compress_backend,
+   lz4_stream_new,
+   lz4_stream_free,
+   NULL,
+   lz4_set_in,
+   lz4_set_out,
+   lz4_decompress_trans
+};
@@ -680,6 +680,8 @@ DEFAULT_SUBLABEL_MACRO(action_bind_sublabel_savestate_auto_load,           MENU_
 DEFAULT_SUBLABEL_MACRO(action_bind_sublabel_savestate_thumbnail_enable,    MENU_ENUM_SUBLABEL_SAVESTATE_THUMBNAIL_ENABLE)
 DEFAULT_SUBLABEL_MACRO(action_bind_sublabel_save_file_compression,         MENU_ENUM_SUBLABEL_SAVE_FILE_COMPRESSION)
 DEFAULT_SUBLABEL_MACRO(action_bind_sublabel_savestate_file_compression,    MENU_ENUM_SUBLABEL_SAVESTATE_FILE_COMPRESSION)
+DEFAULT_SUBLABEL_MACRO(action_bind_sublabel_savestate_file_compression_lz4, MENU_ENUM_SUBLABEL_SAVESTATE_FILE_COMPRESSION_LZ4)
+DEFAULT_SUBLABEL_MACRO(action_bind_sublabel_replay_keyframe_interval,      MENU_ENUM_SUBLABEL_REPLAY_KEYFRAME_INTERVAL)
 DEFAULT_SUBLABEL_MACRO(action_bind_sublabel_savestate_max_keep,            MENU_ENUM_SUBLABEL_SAVESTATE_MAX_KEEP)
 DEFAULT_SUBLABEL_MACRO(action_bind_sublabel_autosave_interval,             MENU_ENUM_SUBLABEL_AUTOSAVE_INTERVAL)
 DEFAULT_SUBLABEL_MACRO(action_bind_sublabel_input_remap_binds_enable,      MENU_ENUM_SUBLABEL_INPUT_REMAP_BINDS_ENABLE)
@@ -875,6 +877,8 @@ DEFAULT_SUBLABEL_MACRO(action_bind_thumbnails_directory,
 DEFAULT_SUBLABEL_MACRO(action_bind_rgui_config_directory,                          MENU_ENUM_SUBLABEL_RGUI_CONFIG_DIRECTORY)
 DEFAULT_SUBLABEL_MACRO(action_bind_sublabel_input_latency_frames,                  MENU_ENUM_SUBLABEL_NETPLAY_INPUT_LATENCY_FRAMES_MIN)
 DEFAULT_SUBLABEL_MACRO(action_bind_sublabel_input_latency_frames_range,            MENU_ENUM_SUBLABEL_NETPLAY_INPUT_LATENCY_FRAMES_RANGE)
+DEFAULT_SUBLABEL_MACRO(action_bind_sublabel_netplay_replay_max_frames,             MENU_ENUM_SUBLABEL_NETPLAY_REPLAY_MAX_FRAMES)
+DEFAULT_SUBLABEL_MACRO(action_bind_sublabel_netplay_udp_input_frames,              MENU_ENUM_SUBLABEL_NETPLAY_UDP_INPUT_FRAMES)
 DEFAULT_SUBLABEL_MACRO(action_bind_sublabel_disk_tray_eject,                       MENU_ENUM_SUBLABEL_DISK_TRAY_EJECT)
 DEFAULT_SUBLABEL_MACRO(action_bind_sublabel_disk_tray_insert,                      MENU_ENUM_SUBLABEL_DISK_TRAY_INSERT)
 DEFAULT_SUBLABEL_MACRO(action_bind_sublabel_disk_index,                            MENU_ENUM_SUBLABEL_DISK_INDEX)
@@ -2992,6 +2996,12 @@ int menu_cbs_init_bind_sublabel(menu_file_list_cbs_t *cbs,
          case MENU_ENUM_LABEL_NETPLAY_INPUT_LATENCY_FRAMES_RANGE:
             BIND_ACTION_SUBLABEL(cbs, action_bind_sublabel_input_latency_frames_range);
             break;
+         case MENU_ENUM_LABEL_NETPLAY_REPLAY_MAX_FRAMES:
+            BIND_ACTION_SUBLABEL(cbs, action_bind_sublabel_netplay_replay_max_frames);
+            break;
+         case MENU_ENUM_LABEL_NETPLAY_UDP_INPUT_FRAMES:
+            BIND_ACTION_SUBLABEL(cbs, action_bind_sublabel_netplay_udp_input_frames);
+            break;
          case MENU_ENUM_LABEL_NETPLAY_INPUT_LATENCY_FRAMES_MIN:
             BIND_ACTION_SUBLABEL(cbs, action_bind_sublabel_input_latency_frames);
             break;
@@ -3550,6 +3560,12 @@ int menu_cbs_init_bind_sublabel(menu_file_list_cbs_t *cbs,
          case MENU_ENUM_LABEL_SAVESTATE_FILE_COMPRESSION:
             BIND_ACTION_SUBLABEL(cbs, action_bind_sublabel_savestate_file_compression);
             break;
+         case MENU_ENUM_LABEL_SAVESTATE_FILE_COMPRESSION_LZ4:
+            BIND_ACTION_SUBLABEL(cbs, action_bind_sublabel_savestate_file_compression_lz4);
+            break;
+         case MENU_ENUM_LABEL_REPLAY_KEYFRAME_INTERVAL:
+            BIND_ACTION_SUBLABEL(cbs, action_bind_sublabel_replay_keyframe_interval);
+            break;
          case MENU_ENUM_LABEL_SAVESTATE_AUTO_SAVE:
             BIND_ACTION_SUBLABEL(cbs, action_bind_sublabel_savestate_auto_save);
             break;
@@ -3470,6 +3470,12 @@ static void ozone_update_savestate_thumbnail_path(void *data, unsigned i)
 
             strlcat(path, FILE_PATH_PNG_EXTENSION, sizeof(path));
 
+            /* Without a screenshot, use the thumbnail stored in
+             * the state itself. The thumbnail task reads it, a
+             * state without one shows as a missing thumbnail. */
+            if (!path_is_valid(path))
+               path[strlen(path) - STRLEN_CONST(FILE_PATH_PNG_EXTENSION)] = '\0';
+
             if (path_is_valid(path))
             {
                strlcpy(
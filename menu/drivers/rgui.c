@@ -2314,11 +2314,16 @@ static bool rgui_request_thumbnail(
       {
          /* Would like to cancel any existing image load tasks
           * here, but can't see how to do it... */
-         if (task_push_image_load(thumbnail->path,
-                  video_driver_supports_rgba(), 0,
-                  (thumbnail_id == GFX_THUMBNAIL_LEFT) ?
-            menu_display_handle_left_thumbnail_upload 
-            : menu_display_handle_thumbnail_upload, NULL))
+         retro_task_callback_t cb = (thumbnail_id == GFX_THUMBNAIL_LEFT)
+            ? menu_display_handle_left_thumbnail_upload
+            : menu_display_handle_thumbnail_upload;
+
+         /* Not an image: the thumbnail stored in a savestate */
+         if (image_texture_get_type(thumbnail->path) == IMAGE_TYPE_NONE
+               ? task_push_load_state_thumbnail(thumbnail->path,
+                  video_driver_supports_rgba(), cb, NULL)
+               : task_push_image_load(thumbnail->path,
+                  video_driver_supports_rgba(), 0, cb, NULL))
          {
             *queue_size = *queue_size + 1;
             return true;
@@ -6646,6 +6651,12 @@ static void rgui_update_savestate_thumbnail_path(void *data, unsigned i)
 
             strlcat(path, FILE_PATH_PNG_EXTENSION, sizeof(path));
 
+            /* Without a screenshot, use the thumbnail stored in
+             * the state itself. The thumbnail task reads it, a
+             * state without one shows as a missing thumbnail. */
+            if (!path_is_valid(path))
+               path[strlen(path) - STRLEN_CONST(FILE_PATH_PNG_EXTENSION)] = '\0';
+
             if (path_is_valid(path))
             {
                strlcpy(
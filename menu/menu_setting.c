@@ -10805,6 +10805,37 @@ static bool setting_append_list(
                   general_write_handler,
                   general_read_handler,
                   SD_FLAG_NONE);
+
+            CONFIG_BOOL(
+                  list, list_info,
+                  &settings->bools.savestate_file_compression_lz4,
+                  MENU_ENUM_LABEL_SAVESTATE_FILE_COMPRESSION_LZ4,
+                  MENU_ENUM_LABEL_VALUE_SAVESTATE_FILE_COMPRESSION_LZ4,
+                  DEFAULT_SAVESTATE_FILE_COMPRESSION_LZ4,
+                  MENU_ENUM_LABEL_VALUE_OFF,
+                  MENU_ENUM_LABEL_VALUE_ON,
+                  &group_info,
+                  &subgroup_info,
+                  parent_group,
+                  general_write_handler,
+                  general_read_handler,
+                  SD_FLAG_NONE);
+#endif
+
+#ifdef HAVE_BSV_MOVIE
+            CONFIG_UINT(
+                  list, list_info,
+                  &settings->uints.replay_keyframe_interval,
+                  MENU_ENUM_LABEL_REPLAY_KEYFRAME_INTERVAL,
+                  MENU_ENUM_LABEL_VALUE_REPLAY_KEYFRAME_INTERVAL,
+                  DEFAULT_REPLAY_KEYFRAME_INTERVAL,
+                  &group_info,
+                  &subgroup_info,
+                  parent_group,
+                  general_write_handler,
+                  general_read_handler);
+            (*list)[list_info->index - 1].action_ok     = &setting_action_ok_uint;
+            menu_settings_list_current_add_range(list, list_info, 0, 36000, 60, true, true);
 #endif
 
             /* TODO/FIXME: This is in the wrong group... */
@@ -20251,6 +20282,36 @@ static bool setting_append_list(
             (*list)[list_info->index - 1].action_ok = &setting_action_ok_uint;
             menu_settings_list_current_add_range(list, list_info, 0, 15, 1, true, true);
 
+            CONFIG_INT(
+                  list, list_info,
+                  (int *) &settings->uints.netplay_replay_max_frames,
+                  MENU_ENUM_LABEL_NETPLAY_REPLAY_MAX_FRAMES,
+                  MENU_ENUM_LABEL_VALUE_NETPLAY_REPLAY_MAX_FRAMES,
+                  0,
+                  &group_info,
+                  &subgroup_info,
+                  parent_group,
+                  general_write_handler,
+                  general_read_handler);
+            (*list)[list_info->index - 1].ui_type   = ST_UI_TYPE_UINT_SPINBOX;
+            (*list)[list_info->index - 1].action_ok = &setting_action_ok_uint;
+            menu_settings_list_current_add_range(list, list_info, 0, 30, 1, true, true);
+
+            CONFIG_INT(
+                  list, list_info,
+                  (int *) &settings->uints.netplay_udp_input_frames,
+                  MENU_ENUM_LABEL_NETPLAY_UDP_INPUT_FRAMES,
+                  MENU_ENUM_LABEL_VALUE_NETPLAY_UDP_INPUT_FRAMES,
+                  0,
+                  &group_info,
+                  &subgroup_info,
+                  parent_group,
+                  general_write_handler,
+                  general_read_handler);
+            (*list)[list_info->index - 1].ui_type   = ST_UI_TYPE_UINT_SPINBOX;
+            (*list)[list_info->index - 1].action_ok = &setting_action_ok_uint;
+            menu_settings_list_current_add_range(list, list_info, 0, 16, 1, true, true);
+
             CONFIG_BOOL(
                   list, list_info,
                   &settings->bools.netplay_nat_traversal,
@@ -2005,6 +2005,8 @@ enum msg_hash_enums
    MENU_LABEL(SAVESTATE_THUMBNAIL_ENABLE),
    MENU_LABEL(SAVE_FILE_COMPRESSION),
    MENU_LABEL(SAVESTATE_FILE_COMPRESSION),
+   MENU_LABEL(SAVESTATE_FILE_COMPRESSION_LZ4),
+   MENU_LABEL(REPLAY_KEYFRAME_INTERVAL),
 
    MENU_LABEL(SUSPEND_SCREENSAVER_ENABLE),
    MENU_ENUM_LABEL_VOLUME_UP,
@@ -2036,6 +2038,8 @@ enum msg_hash_enums
    MENU_LABEL(NETPLAY_CHECK_FRAMES),
    MENU_LABEL(NETPLAY_INPUT_LATENCY_FRAMES_MIN),
    MENU_LABEL(NETPLAY_INPUT_LATENCY_FRAMES_RANGE),
+   MENU_LABEL(NETPLAY_REPLAY_MAX_FRAMES),
+   MENU_LABEL(NETPLAY_UDP_INPUT_FRAMES),
    MENU_LABEL(NETPLAY_SPECTATOR_MODE_ENABLE),
    MENU_LABEL(NETPLAY_TCP_UDP_PORT),
    MENU_LABEL(NETPLAY_MAX_CONNECTIONS),
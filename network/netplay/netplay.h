@@ -267,6 +267,10 @@ typedef struct
 #endif
    int room_count;
    int latest_ping;
+   /* Rollback replay cost over the last statistics window,
+    * shown next to the ping; negative when hidden */
+   float latest_replay_ms;
+   unsigned latest_replay_depth;
    unsigned server_port_deferred;
    char server_address_deferred[256];
    char server_session_deferred[32];
@@ -55,6 +55,9 @@
 #include "../../retroarch.h"
 #include "../../version.h"
 #include "../../verbosity.h"
+#ifdef HAVE_REWIND
+#include "../../state_manager.h"
+#endif
 
 #include "../../tasks/tasks_internal.h"
 #include "../../input/input_driver.h"
@@ -680,6 +683,98 @@ static uint32_t simple_rand_uint32(unsigned long *simple_rand_next)
    return ((part0 << 30) + (part1 << 15) + part2);
 }
 
+/**
+ * netplay_random_bytes
+ *
+ * Fills buf with len bytes from the system's secure random source.
+ *
+ * Returns true on success, false if there is none.
+ */
+static bool netplay_random_bytes(void *buf, size_t len)
+{
+#if defined(_WIN32) && !defined(_XBOX) && !defined(__WINRT__)
+   /* RtlGenRandom, looked up so as not to link against advapi32 */
+   typedef BOOLEAN (WINAPI *rtl_gen_random_t)(PVOID, ULONG);
+   bool ret    = false;
+   HMODULE lib = LoadLibraryA("advapi32.dll");
+
+   if (lib)
+   {
+      rtl_gen_random_t rtl_gen_random = (rtl_gen_random_t)
+         GetProcAddress(lib, "SystemFunction036");
+      ret = rtl_gen_random && rtl_gen_random(buf, (ULONG)len);
+      FreeLibrary(lib);
+   }
+
+   return ret;
+#elif defined(_WIN32)
+   return false;
+#else
+   bool ret = false;
+   FILE *fp = fopen("/dev/urandom", "rb");
+
+   if (fp)
+   {
+      ret = fread(buf, 1, len, fp) == len;
+      fclose(fp);
+   }
+
+   return ret;
+#endif
+}
+
+/**
+ * netplay_sockaddr_to_address
+ *
+ * Converts an IPv4 or IPv6 socket address to a netplay address
+ * (IPv4 as ::ffff:a.b.c.d) and its port.
+ *
+ * Returns false for other address families.
+ */
+static bool netplay_sockaddr_to_address(const struct sockaddr_storage *in,
+      netplay_address_t *out, uint16_t *port)
+{
+   switch (in->ss_family)
+   {
+      case AF_INET:
+         memset(&out->addr[0], 0, 10);
+         out->addr[10] = 0xff;
+         out->addr[11] = 0xff;
+         memcpy(&out->addr[12],
+            &((const struct sockaddr_in*)in)->sin_addr, 4);
+         *port = ((const struct sockaddr_in*)in)->sin_port;
+         return true;
+#ifdef HAVE_INET6
+      case AF_INET6:
+         memcpy(out->addr, &((const struct sockaddr_in6*)in)->sin6_addr,
+            sizeof(out->addr));
+         *port = ((const struct sockaddr_in6*)in)->sin6_port;
+         return true;
+#endif
+      default:
+         break;
+   }
+
+   return false;
+}
+
+/**
+ * netplay_sockaddr_equal
+ *
+ * Are both socket addresses the same host and port?
+ */
+static bool netplay_sockaddr_equal(const struct sockaddr_storage *a,
+      const struct sockaddr_storage *b)
+{
+   netplay_address_t addr_a, addr_b;
+   uint16_t port_a, port_b;
+
+   return netplay_sockaddr_to_address(a, &addr_a, &port_a) &&
+      netplay_sockaddr_to_address(b, &addr_b, &port_b) &&
+      port_a == port_b &&
+      !memcmp(&addr_a, &addr_b, sizeof(addr_a));
+}
+
 /*
  * netplay_init_socket_buffer
  *
@@ -721,7 +816,8 @@ static bool netplay_handshake_init_send(netplay_t *netplay,
 
    header[0] = htonl(NETPLAY_MAGIC);
    header[1] = htonl(netplay_platform_magic());
-   header[2] = htonl(NETPLAY_COMPRESSION_SUPPORTED);
+   header[2] = htonl(NETPLAY_COMPRESSION_ADVERTISED |
+      ((netplay->udp_fd >= 0) ? NETPLAY_COMPRESSION_UDP_INPUT : 0));
 
    if (netplay->is_server)
    {
@@ -753,6 +849,8 @@ static bool netplay_handshake_init_send(netplay_t *netplay,
 
    /* First ping */
    connection->ping       = -1;
+   connection->rtt_avg    = 0;
+   connection->rtt_jitter = 0;
    connection->ping_timer = cpu_features_get_time_usec();
 
    if (!netplay_send(&connection->send_packet_buffer, connection->fd, header,
@@ -856,7 +954,17 @@ static int select_compression(netplay_t *netplay, uint32_t compression)
 
    compression &= NETPLAY_COMPRESSION_SUPPORTED;
 
-   if (compression & NETPLAY_COMPRESSION_ZLIB)
+   /* Savestates are sent every time a peer joins or desyncs, often
+    * mid-game, so prefer the fast codec over the smaller one. */
+   if (compression & NETPLAY_COMPRESSION_LZ4)
+   {
+      ctrans = &netplay->compress_lz4;
+      if (!ctrans->compression_backend)
+         ctrans->compression_backend =
+            trans_stream_get_lz4_compress_backend();
+      ret = NETPLAY_COMPRESSION_LZ4;
+   }
+   else if (compression & NETPLAY_COMPRESSION_ZLIB)
    {
       ctrans = &netplay->compress_zlib;
       if (!ctrans->compression_backend)
@@ -1067,6 +1175,16 @@ bool netplay_handshake_init(netplay_t *netplay,
       return false;
    connection->compression_supported = (uint32_t)compression;
 
+   /* Delta patches count in native 16-bit words. */
+   connection->delta_base_valid      = false;
+   connection->delta_states          =
+         (ntohl(header[2]) & NETPLAY_COMPRESSION_ADVERTISED
+            & NETPLAY_COMPRESSION_DELTA)
+      && !netplay_endian_mismatch(netplay_platform_magic(),
+            ntohl(header[1]));
+   connection->udp_input             = netplay->udp_fd >= 0 &&
+      (ntohl(header[2]) & NETPLAY_COMPRESSION_UDP_INPUT);
+
    if (!netplay->is_server)
    {
       /* If a password is demanded, ask for it */
@@ -1353,6 +1471,32 @@ static bool netplay_handshake_sync(netplay_t *netplay,
          return false;
    }
 
+   /* Both sides offered UDP input, hand out its token. It is all
+    * that tells a client's datagrams apart, so it must not be
+    * guessable. Without a secure random source, stay on TCP. */
+   if (connection->udp_input)
+   {
+      uint32_t token[2];
+
+      connection->udp_token = 0;
+      if (!netplay_random_bytes(&connection->udp_token,
+            sizeof(connection->udp_token)) || !connection->udp_token)
+      {
+         RARCH_WARN("[Netplay] No secure random source, "
+            "not using UDP input.\n");
+         connection->udp_token = 0;
+         connection->udp_input = false;
+      }
+      else
+      {
+         token[0] = htonl((uint32_t)(connection->udp_token >> 32));
+         token[1] = htonl((uint32_t)connection->udp_token);
+         if (!netplay_send_raw_cmd(netplay, connection,
+               NETPLAY_CMD_UDP_INPUT_TOKEN, token, sizeof(token)))
+            return false;
+      }
+   }
+
    if (!netplay_send_flush(&connection->send_packet_buffer,
          connection->fd, false))
       return false;
@@ -1928,9 +2072,13 @@ static bool netplay_handshake(netplay_t *netplay,
          return false;
    }
 
-   if (connection->mode >= NETPLAY_CONNECTION_CONNECTED &&
-         !netplay_send_cur_input(netplay, connection))
-      return false;
+   if (connection->mode >= NETPLAY_CONNECTION_CONNECTED)
+   {
+      /* Input may have arrived since the spectator data was encoded */
+      netplay->spectator_frame_words = 0;
+      if (!netplay_send_cur_input(netplay, connection))
+         return false;
+   }
 
    return ret;
 }
@@ -2573,22 +2721,151 @@ static bool netplay_cmd_crc(netplay_t *netplay, struct delta_frame *delta)
 
 /**
  * netplay_cmd_request_savestate
+ * @full                 : ask for a full savestate rather than a delta
  *
  * Send a savestate request command.
  */
-static bool netplay_cmd_request_savestate(netplay_t *netplay)
+static bool netplay_cmd_request_savestate(netplay_t *netplay, bool full)
 {
+   struct netplay_connection *connection = &netplay->connections[0];
+
    if (netplay->connections_size == 0 ||
-       !netplay->connections[0].active ||
-       netplay->connections[0].mode < NETPLAY_CONNECTION_CONNECTED)
+       !connection->active ||
+       connection->mode < NETPLAY_CONNECTION_CONNECTED)
       return false;
-   if (netplay->savestate_request_outstanding)
+   if (netplay->savestate_request_outstanding && !full)
       return true;
    netplay->savestate_request_outstanding = true;
-   return netplay_send_raw_cmd(netplay, &netplay->connections[0],
+
+   /* Only peers that send deltas understand the payload. */
+   if (full && connection->delta_states)
+   {
+      uint32_t flags = htonl(NETPLAY_CMD_REQUEST_SAVESTATE_BIT_FULL);
+      return netplay_send_raw_cmd(netplay, connection,
+         NETPLAY_CMD_REQUEST_SAVESTATE, &flags, sizeof(flags));
+   }
+
+   return netplay_send_raw_cmd(netplay, connection,
       NETPLAY_CMD_REQUEST_SAVESTATE, NULL, 0);
 }
 
+#ifdef HAVE_REWIND
+static void netplay_free_delta_buffers(netplay_t *netplay)
+{
+   free(netplay->delta_base);
+   free(netplay->delta_scratch);
+   free(netplay->delta_patch);
+   netplay->delta_base       = NULL;
+   netplay->delta_scratch    = NULL;
+   netplay->delta_patch      = NULL;
+   netplay->delta_base_valid = false;
+}
+
+/**
+ * netplay_init_delta_buffers
+ *
+ * Allocate the buffers used for delta savestates, if not done yet.
+ */
+static bool netplay_init_delta_buffers(netplay_t *netplay)
+{
+   if (netplay->delta_base)
+      return true;
+   if (!netplay->state_size)
+      return false;
+
+   /* The two states being diffed need different guard words. */
+   netplay->delta_base    = (uint8_t*)state_manager_raw_alloc(
+         netplay->state_size, 0);
+   netplay->delta_scratch = (uint8_t*)state_manager_raw_alloc(
+         netplay->state_size, 0xFFFF);
+   netplay->delta_patch   = (uint8_t*)malloc(
+         state_manager_raw_maxsize(netplay->state_size));
+
+   if (     !netplay->delta_base
+         || !netplay->delta_scratch
+         || !netplay->delta_patch)
+   {
+      netplay_free_delta_buffers(netplay);
+      return false;
+   }
+
+   return true;
+}
+
+/**
+ * netplay_set_delta_base
+ *
+ * Client: remember a savestate loaded from the server as the
+ * base the following delta savestates apply to.
+ */
+static void netplay_set_delta_base(netplay_t *netplay,
+      const void *state, uint32_t frame)
+{
+   if (!netplay_init_delta_buffers(netplay))
+      return;
+
+   memcpy(netplay->delta_base, state, netplay->state_size);
+   netplay->delta_base_frame = frame;
+   netplay->delta_base_crc   = encoding_crc32(0L,
+         netplay->delta_base, netplay->state_size);
+   netplay->delta_base_valid = true;
+}
+
+/**
+ * netplay_load_delta_savestate
+ * @ctrans               : decompression to use
+ * @size_raw             : size of the compressed patch in zbuffer
+ * @delta_hdr            : base frame, base CRC, state CRC, patch size
+ * @state                : where to put the resulting savestate
+ *
+ * Client: apply a delta savestate sitting in zbuffer to our base.
+ * On success the result also becomes the new base.
+ *
+ * Returns true if @state now holds the server's savestate.
+ */
+static bool netplay_load_delta_savestate(netplay_t *netplay,
+      struct compression_transcoder *ctrans, uint32_t size_raw,
+      const uint32_t *delta_hdr, uint32_t frame, void *state)
+{
+   uint32_t rd, wn;
+   size_t patch_cap;
+
+   if (     !netplay->delta_base_valid
+         || delta_hdr[0] != netplay->delta_base_frame
+         || delta_hdr[1] != netplay->delta_base_crc)
+      return false;
+
+   patch_cap = state_manager_raw_maxsize(netplay->state_size);
+   if (delta_hdr[3] > patch_cap)
+      return false;
+
+   ctrans->decompression_backend->set_in(
+      ctrans->decompression_stream,
+      netplay->zbuffer, size_raw);
+   ctrans->decompression_backend->set_out(
+      ctrans->decompression_stream,
+      netplay->delta_patch, (uint32_t)patch_cap);
+   if (!ctrans->decompression_backend->trans(
+         ctrans->decompression_stream, true, &rd, &wn, NULL)
+         || wn != delta_hdr[3])
+      return false;
+
+   if (!state_manager_raw_decompress_checked(netplay->delta_patch, wn,
+         netplay->delta_base, netplay->state_size))
+      return false;
+
+   if (encoding_crc32(0L, netplay->delta_base,
+         netplay->state_size) != delta_hdr[2])
+      return false;
+
+   memcpy(state, netplay->delta_base, netplay->state_size);
+   netplay->delta_base_frame = frame;
+   netplay->delta_base_crc   = delta_hdr[2];
+
+   return true;
+}
+#endif
+
 /**
  * netplay_cmd_stall
  *
@@ -3109,7 +3386,7 @@ static void netplay_handle_frame_hash(netplay_t *netplay,
             }
 
             if (netplay->check_frames)
-               netplay_cmd_request_savestate(netplay);
+               netplay_cmd_request_savestate(netplay, false);
             else
                RARCH_WARN("[Netplay] Netplay CRCs mismatch!\n");
          }
@@ -3571,15 +3848,25 @@ static bool netplay_sync_pre_frame(netplay_t *netplay)
       /* Don't serialize until it's safe. */
       if (!(netplay->quirks & NETPLAY_QUIRK_INITIALIZATION))
       {
+         bool serialized;
+         retro_time_t start;
          retro_ctx_serialize_info_t serial_info = {0};
 
          serial_info.data = netplay->buffer[netplay->run_ptr].state;
          serial_info.size = netplay->state_size;
+         start            = cpu_features_get_time_usec();
          memset(serial_info.data, 0, serial_info.size);
-         if (core_serialize_special(&serial_info))
+         serialized       = core_serialize_special(&serial_info);
+         netplay->replay_stats_window.serialize_time +=
+            cpu_features_get_time_usec() - start;
+         netplay->replay_stats_window.serializes++;
+
+         if (serialized)
          {
+            /* A deferred rollback means this state is a stale
+             * prediction, so hold on to it until it's caught up. */
             if (netplay->force_send_savestate && !netplay->stall &&
-                  !netplay->remote_paused)
+                  !netplay->remote_paused && !netplay->replay_pending)
             {
                /* Bring our running frame and input frames into
                 * parity so we don't send old info. */
@@ -3677,6 +3964,59 @@ process:
    return ret;
 }
 
+static void netplay_replay_stats_merge(struct netplay_replay_stats *dst,
+      const struct netplay_replay_stats *src)
+{
+   dst->serialize_time   += src->serialize_time;
+   dst->unserialize_time += src->unserialize_time;
+   dst->replay_time      += src->replay_time;
+   dst->frames           += src->frames;
+   dst->serializes       += src->serializes;
+   dst->unserializes     += src->unserializes;
+   dst->rollbacks        += src->rollbacks;
+   dst->replayed_frames  += src->replayed_frames;
+   dst->deferred         += src->deferred;
+   if (src->replay_time_max > dst->replay_time_max)
+      dst->replay_time_max = src->replay_time_max;
+   if (src->depth_max > dst->depth_max)
+      dst->depth_max       = src->depth_max;
+}
+
+static void netplay_replay_stats_log(const char *label,
+      const struct netplay_replay_stats *stats)
+{
+   unsigned frames = stats->frames ? stats->frames : 1;
+
+   RARCH_LOG("[Netplay] %s: %u frames, %u rollbacks (%u frames replayed, "
+         "max depth %u, %u deferred), replay %.3f ms/frame (max %.3f ms), "
+         "serialize %.3f ms, unserialize %.3f ms.\n",
+         label, stats->frames, stats->rollbacks, stats->replayed_frames,
+         stats->depth_max, stats->deferred,
+         stats->replay_time / (1000.0 * frames),
+         stats->replay_time_max / 1000.0,
+         stats->serializes
+            ? stats->serialize_time / (1000.0 * stats->serializes) : 0.0,
+         stats->unserializes
+            ? stats->unserialize_time / (1000.0 * stats->unserializes) : 0.0);
+}
+
+/* Closes the current rollback statistics window every
+ * NETPLAY_REPLAY_STATS_WINDOW host frames. */
+static void netplay_replay_stats_frame(netplay_t *netplay)
+{
+   struct netplay_replay_stats *window = &netplay->replay_stats_window;
+
+   if (++window->frames < NETPLAY_REPLAY_STATS_WINDOW)
+      return;
+
+   if (window->deferred)
+      netplay_replay_stats_log("Rollback replay over budget", window);
+
+   netplay_replay_stats_merge(&netplay->replay_stats, window);
+   memcpy(&netplay->replay_stats_last, window, sizeof(*window));
+   memset(window, 0, sizeof(*window));
+}
+
 /**
  * netplay_sync_post_frame
  * @netplay              : pointer to netplay object
@@ -3694,6 +4034,7 @@ static void netplay_sync_post_frame(netplay_t *netplay, bool stalled)
    {
       netplay->run_ptr = NEXT_PTR(netplay->run_ptr);
       netplay->run_frame_count++;
+      netplay_replay_stats_frame(netplay);
    }
 
    /* We've finished an input frame even if we're stalling */
@@ -3712,6 +4053,14 @@ static void netplay_sync_post_frame(netplay_t *netplay, bool stalled)
    {
       netplay->other_frame_count = netplay->self_frame_count;
       netplay->other_ptr         = netplay->self_ptr;
+      /* Nobody left to agree with, the prediction stands. The
+       * rewind of a deferred replay goes with it, or the next
+       * peer would trigger it against a stale frame. */
+      if (netplay->replay_pending)
+      {
+         netplay->force_rewind   = false;
+         netplay->replay_pending = false;
+      }
 
       /* FIXME: Duplication */
       if (netplay->catch_up)
@@ -3777,6 +4126,35 @@ static void netplay_sync_post_frame(netplay_t *netplay, bool stalled)
        netplay->replay_frame_count < netplay->run_frame_count)
    {
       retro_ctx_serialize_info_t serial_info;
+      retro_time_t replay_start, replay_time, start;
+      struct netplay_replay_stats *stats = &netplay->replay_stats_window;
+      uint32_t depth     =
+         netplay->run_frame_count - netplay->replay_frame_count;
+      uint32_t replay_to = netplay->run_frame_count;
+      bool deferred      = false;
+
+      replay_start       = cpu_features_get_time_usec();
+
+      /* Too deep to replay in one frame? Replay part of it now, and
+       * carry on running the current prediction in the meantime. */
+      if (netplay->replay_max_frames && depth > netplay->replay_max_frames &&
+            netplay_delta_frame_ready(netplay,
+               &netplay->buffer[netplay->run_ptr], netplay->run_frame_count))
+      {
+         serial_info.data       = netplay->buffer[netplay->run_ptr].state;
+         serial_info.data_const = NULL;
+         serial_info.size       = netplay->state_size;
+         start                  = cpu_features_get_time_usec();
+         memset(serial_info.data, 0, serial_info.size);
+         if (core_serialize_special(&serial_info))
+         {
+            replay_to = netplay->replay_frame_count +
+               netplay->replay_max_frames;
+            deferred  = true;
+         }
+         stats->serialize_time += cpu_features_get_time_usec() - start;
+         stats->serializes++;
+      }
 
       /* Replay frames. */
       netplay->is_replay = true;
@@ -3806,12 +4184,20 @@ static void netplay_sync_post_frame(netplay_t *netplay, bool stalled)
       serial_info.data       = NULL;
       serial_info.data_const = netplay->buffer[netplay->replay_ptr].state;
       serial_info.size       = netplay->state_size;
+      start                  = cpu_features_get_time_usec();
       if (!core_unserialize_special(&serial_info))
          RARCH_ERR("[Netplay] Netplay savestate loading failed: Prepare for desync!\n");
+      stats->unserialize_time += cpu_features_get_time_usec() - start;
+      stats->unserializes++;
+
+      stats->rollbacks++;
+      stats->replayed_frames += replay_to - netplay->replay_frame_count;
+      if (depth > stats->depth_max)
+         stats->depth_max = depth;
 
-      while (netplay->replay_frame_count < netplay->run_frame_count)
+      while (netplay->replay_frame_count < replay_to)
       {
-         retro_time_t start, tm;
+         retro_time_t tm;
          struct delta_frame *ptr = &netplay->buffer[netplay->replay_ptr];
 
          serial_info.data_const  = NULL;
@@ -3823,6 +4209,8 @@ static void netplay_sync_post_frame(netplay_t *netplay, bool stalled)
          /* Remember the current state */
          memset(serial_info.data, 0, serial_info.size);
          core_serialize_special(&serial_info);
+         stats->serialize_time  += cpu_features_get_time_usec() - start;
+         stats->serializes++;
 
          if (netplay->replay_frame_count < netplay->unread_frame_count)
             netplay_handle_frame_hash(netplay, ptr);
@@ -3871,18 +4259,49 @@ static void netplay_sync_post_frame(netplay_t *netplay, bool stalled)
       /* Average our time */
       netplay->frame_run_time_avg   = netplay->frame_run_time_sum / NETPLAY_FRAME_RUN_TIME_WINDOW;
 
-      if (netplay->unread_frame_count < netplay->run_frame_count)
+      if (deferred)
+      {
+         /* Keep where the replay got to, so the next frame resumes
+          * from there, then go back to running the prediction. */
+         serial_info.data_const = NULL;
+         serial_info.data       = netplay->buffer[netplay->replay_ptr].state;
+         start                  = cpu_features_get_time_usec();
+         memset(serial_info.data, 0, serial_info.size);
+         core_serialize_special(&serial_info);
+         stats->serialize_time += cpu_features_get_time_usec() - start;
+         stats->serializes++;
+
+         serial_info.data       = NULL;
+         serial_info.data_const = netplay->buffer[netplay->run_ptr].state;
+         start                  = cpu_features_get_time_usec();
+         if (!core_unserialize_special(&serial_info))
+            RARCH_ERR("[Netplay] Netplay savestate loading failed: Prepare for desync!\n");
+         stats->unserialize_time += cpu_features_get_time_usec() - start;
+         stats->unserializes++;
+         stats->deferred++;
+      }
+
+      if (netplay->unread_frame_count < replay_to)
       {
          netplay->other_ptr         = netplay->unread_ptr;
          netplay->other_frame_count = netplay->unread_frame_count;
       }
       else
       {
-         netplay->other_ptr         = netplay->run_ptr;
-         netplay->other_frame_count = netplay->run_frame_count;
+         netplay->other_ptr         = netplay->replay_ptr;
+         netplay->other_frame_count = netplay->replay_frame_count;
       }
       netplay->is_replay            = false;
-      netplay->force_rewind         = false;
+      /* Everything past replay_to is still on the stale timeline,
+       * regardless of whether its input was predicted right */
+      netplay->force_rewind         = deferred;
+      netplay->replay_pending       = deferred;
+
+      replay_time                   =
+         cpu_features_get_time_usec() - replay_start;
+      stats->replay_time           += replay_time;
+      if (replay_time > stats->replay_time_max)
+         stats->replay_time_max     = replay_time;
    }
 
    if (netplay->is_server)
@@ -4189,22 +4608,15 @@ static void netplay_delayed_state_change(netplay_t *netplay)
    }
 }
 
-/* Send the specified input data */
-static bool send_input_frame(netplay_t *netplay, struct delta_frame *dframe,
-      struct netplay_connection *only, struct netplay_connection *except,
-      uint32_t client_num, bool slave)
+/* Packs the real input of 'client_num' in 'dframe' into 'buffer', in
+ * network byte order. Returns the number of words written. */
+static size_t netplay_input_frame_words(netplay_t *netplay,
+      struct delta_frame *dframe, uint32_t client_num, bool slave,
+      uint32_t *buffer, size_t size)
 {
-#define BUFSZ 16 /* FIXME: Arbitrary restriction */
-   uint32_t buffer[BUFSZ], devices, device;
-   size_t bufused, i;
-
-   /* Set up the basic buffer */
-   bufused = 4;
-   buffer[0] = htonl(NETPLAY_CMD_INPUT);
-   buffer[2] = htonl(dframe->frame);
-   buffer[3] = htonl(client_num);
+   uint32_t devices, device;
+   size_t used = 0, i;
 
-   /* Add the device data */
    devices = netplay->client_devices[client_num];
    for (device = 0; device < MAX_INPUT_DEVICES; device++)
    {
@@ -4216,13 +4628,47 @@ static bool send_input_frame(netplay_t *netplay, struct delta_frame *dframe,
          istate = istate->next;
       if (!istate)
          continue;
-      if (bufused + istate->size >= BUFSZ)
+      if (used + istate->size > size)
          continue; /* FIXME: More severe? */
       for (i = 0; i < istate->size; i++)
-         buffer[bufused+i] = htonl(istate->data[i]);
-      bufused += istate->size;
+         buffer[used+i] = htonl(istate->data[i]);
+      used += istate->size;
    }
-   buffer[1] = htonl((bufused-2) * sizeof(uint32_t));
+
+   return used;
+}
+
+/* Builds the NETPLAY_CMD_INPUT command for the specified input data into
+ * 'buffer', which must hold NETPLAY_INPUT_CMD_WORDS words. Returns the
+ * number of words used. */
+static size_t netplay_encode_input_frame(netplay_t *netplay,
+      struct delta_frame *dframe, uint32_t client_num, bool slave,
+      uint32_t *buffer)
+{
+   size_t bufused;
+
+   /* Set up the basic buffer */
+   buffer[0] = htonl(NETPLAY_CMD_INPUT);
+   buffer[2] = htonl(dframe->frame);
+   buffer[3] = htonl(client_num);
+
+   /* Add the device data */
+   bufused   = 4 + netplay_input_frame_words(netplay, dframe, client_num,
+         slave, buffer + 4, NETPLAY_INPUT_CMD_WORDS - 4);
+   buffer[1] = htonl((uint32_t)((bufused-2) * sizeof(uint32_t)));
+
+   return bufused;
+}
+
+/* Send the specified input data */
+static bool send_input_frame(netplay_t *netplay, struct delta_frame *dframe,
+      struct netplay_connection *only, struct netplay_connection *except,
+      uint32_t client_num, bool slave)
+{
+   uint32_t buffer[NETPLAY_INPUT_CMD_WORDS];
+   size_t i;
+   size_t bufused = netplay_encode_input_frame(netplay, dframe, client_num,
+         slave, buffer);
 
 #ifdef DEBUG_NETPLAY_STEPS
    RARCH_LOG("[Netplay] Sending input for client %u\n", (unsigned) client_num);
@@ -4255,71 +4701,467 @@ static bool send_input_frame(netplay_t *netplay, struct delta_frame *dframe,
          }
       }
    }
-
-   return true;
-#undef BUFSZ
+
+   return true;
+}
+
+/**
+ * netplay_spectator_frame
+ *
+ * Every connection that isn't playing gets the exact same input data
+ * for a frame, so on the server it is encoded once, the first time a
+ * spectator needs it, and only copied to the others.
+ *
+ * The block is still sent once per spectator connection. To keep host
+ * upload flat with many spectators, have them join through
+ * tools/ranetrelay, which is a single spectator here.
+ *
+ * Returns the number of words in netplay->spectator_frame.
+ */
+static size_t netplay_spectator_frame(netplay_t *netplay)
+{
+   uint32_t client_num;
+   struct delta_frame *dframe = &netplay->buffer[netplay->self_ptr];
+   uint32_t *buffer           = netplay->spectator_frame;
+   size_t bufused             = 0;
+
+   if (netplay->spectator_frame_words)
+      return netplay->spectator_frame_words;
+
+   /* Same order as netplay_send_cur_input */
+   for (client_num = 1; client_num < MAX_CLIENTS; client_num++)
+   {
+      if (     (netplay->connected_players & (1<<client_num))
+            && dframe->have_real[client_num])
+         bufused += netplay_encode_input_frame(netplay, dframe, client_num,
+               false, buffer + bufused);
+   }
+
+   if (netplay->self_mode == NETPLAY_CONNECTION_PLAYING)
+      bufused += netplay_encode_input_frame(netplay, dframe,
+            netplay->self_client_num, false, buffer + bufused);
+   else
+   {
+      buffer[bufused]     = htonl(NETPLAY_CMD_NOINPUT);
+      buffer[bufused + 1] = htonl(sizeof(uint32_t));
+      buffer[bufused + 2] = htonl(netplay->self_frame_count);
+      bufused            += 3;
+   }
+
+   netplay->spectator_frame_words = bufused;
+
+   return bufused;
+}
+
+/**
+ * netplay_send_cur_input
+ *
+ * Send the current input frame to a given connection.
+ *
+ * Returns true if successful, false otherwise.
+ */
+bool netplay_send_cur_input(netplay_t *netplay,
+   struct netplay_connection *connection)
+{
+   uint32_t from_client, to_client;
+   struct delta_frame *dframe = &netplay->buffer[netplay->self_ptr];
+
+   if (netplay->is_server)
+   {
+      to_client = (uint32_t)(connection - netplay->connections + 1);
+
+      /* Not a player, share the data encoded for all spectators */
+      if (!(netplay->connected_players & (1<<to_client)))
+      {
+         if (!netplay_send(&connection->send_packet_buffer, connection->fd,
+               netplay->spectator_frame,
+               netplay_spectator_frame(netplay) * sizeof(uint32_t)))
+         {
+            netplay_hangup(netplay, connection);
+            return false;
+         }
+
+         return netplay_send_flush(&connection->send_packet_buffer,
+               connection->fd, false);
+      }
+
+      /* Send the other players' input data */
+      for (from_client = 1; from_client < MAX_CLIENTS; from_client++)
+      {
+         if (from_client == to_client)
+            continue;
+
+         if ((netplay->connected_players & (1<<from_client)))
+         {
+            if (dframe->have_real[from_client])
+            {
+               if (!send_input_frame(netplay, dframe, connection, NULL, from_client, false))
+                  return false;
+            }
+         }
+      }
+
+      /* If we're not playing, send a NOINPUT */
+      if (netplay->self_mode != NETPLAY_CONNECTION_PLAYING)
+      {
+         uint32_t payload = htonl(netplay->self_frame_count);
+         if (!netplay_send_raw_cmd(netplay, connection, NETPLAY_CMD_NOINPUT,
+               &payload, sizeof(payload)))
+            return false;
+      }
+
+   }
+
+   /* Send our own data */
+   if (netplay->self_mode == NETPLAY_CONNECTION_PLAYING
+         || netplay->self_mode == NETPLAY_CONNECTION_SLAVE)
+   {
+      if (!send_input_frame(netplay, dframe, connection, NULL,
+            netplay->self_client_num,
+            netplay->self_mode == NETPLAY_CONNECTION_SLAVE))
+         return false;
+   }
+
+   if (!netplay_send_flush(&connection->send_packet_buffer, connection->fd,
+         false))
+      return false;
+
+   return true;
+}
+
+/**
+ * netplay_init_udp_socket
+ *
+ * Opens the UDP input socket. The server binds it to the address and
+ * port of its listening socket; clients send from an ephemeral port to
+ * the server's address and port, taken from the TCP connection.
+ *
+ * Returns true on success, false otherwise.
+ */
+static bool netplay_init_udp_socket(netplay_t *netplay)
+{
+   struct sockaddr_storage addr;
+   socklen_t addr_len = sizeof(addr);
+   int fd;
+
+   memset(&addr, 0, sizeof(addr));
+
+   if (netplay->is_server)
+   {
+      if (netplay->listen_fd < 0 || getsockname(netplay->listen_fd,
+            (struct sockaddr*)&addr, &addr_len))
+         return false;
+   }
+   else
+   {
+      if (!netplay->connections[0].udp_addr_len)
+         return false;
+      memcpy(&addr, &netplay->connections[0].udp_addr,
+         netplay->connections[0].udp_addr_len);
+      addr_len = netplay->connections[0].udp_addr_len;
+   }
+
+   fd = socket(addr.ss_family, SOCK_DGRAM, 0);
+   if (fd < 0)
+      return false;
+
+   SET_FD_CLOEXEC(fd)
+
+   if (netplay->is_server)
+   {
+#if defined(HAVE_INET6) && defined(IPV6_V6ONLY)
+      /* Same as the listening socket, take IPv4 too. */
+      if (addr.ss_family == AF_INET6)
+      {
+         int on = 0;
+
+         setsockopt(fd, IPPROTO_IPV6, IPV6_V6ONLY,
+               (const char*)&on, sizeof(on));
+      }
+#endif
+
+      if (bind(fd, (struct sockaddr*)&addr, addr_len) < 0)
+      {
+         socket_close(fd);
+         return false;
+      }
+   }
+
+   if (!socket_nonblock(fd))
+   {
+      socket_close(fd);
+      return false;
+   }
+
+   netplay->udp_fd = fd;
+
+   return true;
+}
+
+/**
+ * netplay_udp_input_record
+ *
+ * Applies one input record from a UDP datagram. Only the next frame
+ * expected from that client is taken; anything else either arrived
+ * already or has to wait for the TCP copy.
+ */
+static void netplay_udp_input_record(netplay_t *netplay,
+      struct netplay_connection *connection, uint32_t frame_num,
+      uint32_t client_num, const uint32_t *data, uint32_t words)
+{
+   uint32_t devices, device;
+   struct delta_frame *dframe;
+
+   client_num &= 0xFFFF;
+
+   /* Must be this client's own input */
+   if (netplay->is_server)
+      client_num = (uint32_t)(connection - netplay->connections + 1);
+   else if (client_num == netplay->self_client_num)
+      return;
+
+   if (client_num >= MAX_CLIENTS ||
+         !(netplay->connected_players & (1<<client_num)))
+      return;
+
+   devices = netplay->client_devices[client_num];
+   if (words != netplay_expected_input_size(netplay, devices) ||
+         frame_num != netplay->read_frame_count[client_num])
+      return;
+
+   dframe = &netplay->buffer[netplay->read_ptr[client_num]];
+   if (!netplay_delta_frame_ready(netplay, dframe, frame_num))
+      return;
+
+   for (device = 0; device < MAX_INPUT_DEVICES; device++)
+   {
+      netplay_input_state_t istate;
+      uint32_t dsize, di;
+      if (!(devices & (1<<device)))
+         continue;
+
+      dsize  = netplay_expected_input_size(netplay, 1 << device);
+      istate = netplay_input_state_for(&dframe->real_input[device],
+            client_num, dsize, false, false);
+      if (!istate)
+         return;
+      for (di = 0; di < dsize; di++)
+         istate->data[di] = ntohl(data[di]);
+      data += dsize;
+   }
+   dframe->have_real[client_num] = true;
+
+   /* From here on, the same as NETPLAY_CMD_INPUT, except for
+    * server_frame_count on clients: it follows the TCP stream, which
+    * orders commands such as savestate loads against it, so it only
+    * moves when the TCP copy of this frame arrives. */
+   netplay->read_ptr[client_num] = NEXT_PTR(netplay->read_ptr[client_num]);
+   netplay->read_frame_count[client_num]++;
+
+   if (netplay->is_server)
+   {
+      if (dframe->frame <= netplay->self_frame_count)
+         send_input_frame(netplay, dframe, NULL, connection, client_num, false);
+   }
+}
+
+/**
+ * netplay_udp_recv_input
+ *
+ * Reads every pending UDP input datagram.
+ */
+static void netplay_udp_recv_input(netplay_t *netplay)
+{
+   unsigned packets;
+   uint32_t buf[NETPLAY_UDP_INPUT_MAX_SIZE / sizeof(uint32_t)];
+
+   if (netplay->udp_fd < 0)
+      return;
+
+   /* Bounded, in case someone floods the port */
+   for (packets = 0; packets < 256; packets++)
+   {
+      size_t i, pos, words;
+      uint64_t token;
+      uint32_t count;
+      struct sockaddr_storage addr;
+      struct netplay_connection *connection = NULL;
+      socklen_t addr_len                    = sizeof(addr);
+      ssize_t len                           = recvfrom(netplay->udp_fd,
+            (char*)buf, sizeof(buf), 0, (struct sockaddr*)&addr, &addr_len);
+
+      if (len < 0)
+         break;
+      if (len < (ssize_t)(4 * sizeof(uint32_t)) || (len % sizeof(uint32_t)))
+         continue;
+      token = ((uint64_t)ntohl(buf[1]) << 32) | ntohl(buf[2]);
+      if (ntohl(buf[0]) != NETPLAY_UDP_INPUT_MAGIC || !token)
+         continue;
+
+      for (i = 0; i < netplay->connections_size; i++)
+      {
+         if (netplay->connections[i].active &&
+               netplay->connections[i].udp_token == token)
+         {
+            connection = &netplay->connections[i];
+            break;
+         }
+      }
+      if (!connection || connection->mode != NETPLAY_CONNECTION_PLAYING)
+         continue;
+
+      if (!connection->udp_addr_len)
+      {
+         netplay_address_t from;
+         uint16_t port;
+
+         /* The first datagram must come from the host on the other
+          * end of the TCP connection. Its port is whatever NAT picked,
+          * replies go there, and nothing else is accepted after it. */
+         if (!netplay->is_server ||
+               !netplay_sockaddr_to_address(&addr, &from, &port) ||
+               memcmp(&from, &connection->addr, sizeof(from)))
+            continue;
+
+         RARCH_LOG("[Netplay] Receiving input from %s over UDP.\n",
+            connection->nick);
+         memcpy(&connection->udp_addr, &addr, addr_len);
+         connection->udp_addr_len = addr_len;
+      }
+      else if (!netplay_sockaddr_equal(&addr, &connection->udp_addr))
+         continue;
+      if (connection->udp_timed_out)
+      {
+         RARCH_LOG("[Netplay] UDP input from %s is back.\n", connection->nick);
+         connection->udp_timed_out = false;
+      }
+      connection->udp_last_recv = cpu_features_get_time_usec();
+
+      words = (size_t)len / sizeof(uint32_t);
+      count = ntohl(buf[3]);
+      pos   = 4;
+      while (count-- && pos + 3 <= words)
+      {
+         uint32_t frame_num  = ntohl(buf[pos]);
+         uint32_t client_num = ntohl(buf[pos + 1]);
+         uint32_t size       = ntohl(buf[pos + 2]);
+
+         pos += 3;
+         if (size > words - pos)
+            break;
+         netplay_udp_input_record(netplay, connection, frame_num, client_num,
+               buf + pos, size);
+         pos += size;
+      }
+   }
 }
 
 /**
- * netplay_send_cur_input
+ * netplay_udp_send_input
  *
- * Send the current input frame to a given connection.
- *
- * Returns true if successful, false otherwise.
+ * Sends the last udp_input_frames frames of input the peer may need
+ * in one UDP datagram, so that any single lost datagram is covered by
+ * the next ones instead of waiting on a TCP retransmission. Clients
+ * send their own input, the server everyone else's.
  */
-bool netplay_send_cur_input(netplay_t *netplay,
-   struct netplay_connection *connection)
+static void netplay_udp_send_input(netplay_t *netplay,
+      struct netplay_connection *connection)
 {
-   uint32_t from_client, to_client;
-   struct delta_frame *dframe = &netplay->buffer[netplay->self_ptr];
+   uint32_t buf[NETPLAY_UDP_INPUT_MAX_SIZE / sizeof(uint32_t)];
+   uint32_t client_num, to_client;
+   size_t pos     = 4;
+   uint32_t count = 0;
 
-   if (netplay->is_server)
+   if (netplay->udp_fd < 0 || !connection->udp_token ||
+         !connection->udp_addr_len)
+      return;
+
+   if (cpu_features_get_time_usec() - connection->udp_last_recv
+         >= NETPLAY_UDP_INPUT_TIMEOUT)
    {
-      to_client = (uint32_t)(connection - netplay->connections + 1);
+      if (!connection->udp_timed_out)
+      {
+         RARCH_WARN("[Netplay] No UDP input from %s, using TCP only.\n",
+            connection->nick);
+         connection->udp_timed_out = true;
+      }
 
-      /* Send the other players' input data (FIXME: This involves an
-       * unacceptable amount of recalculating) */
-      for (from_client = 1; from_client < MAX_CLIENTS; from_client++)
+      /* The server waits to hear from the client again, which keeps
+       * probing about once a second. */
+      if (netplay->is_server || (netplay->self_frame_count % 60))
+         return;
+   }
+
+   to_client = netplay->is_server
+      ? (uint32_t)(connection - netplay->connections + 1)
+      : 0;
+
+   for (client_num = 0; client_num < MAX_CLIENTS; client_num++)
+   {
+      uint32_t frame, hi, expected;
+
+      if (client_num == netplay->self_client_num)
       {
-         if (from_client == to_client)
+         if (netplay->self_mode != NETPLAY_CONNECTION_PLAYING)
             continue;
-
-         if ((netplay->connected_players & (1<<from_client)))
-         {
-            if (dframe->have_real[from_client])
-            {
-               if (!send_input_frame(netplay, dframe, connection, NULL, from_client, false))
-                  return false;
-            }
-         }
+         hi = netplay->self_frame_count + 1;
       }
-
-      /* If we're not playing, send a NOINPUT */
-      if (netplay->self_mode != NETPLAY_CONNECTION_PLAYING)
+      else
       {
-         uint32_t payload = htonl(netplay->self_frame_count);
-         if (!netplay_send_raw_cmd(netplay, connection, NETPLAY_CMD_NOINPUT,
-               &payload, sizeof(payload)))
-            return false;
+         if (!netplay->is_server || client_num == to_client ||
+               !(netplay->connected_players & (1<<client_num)))
+            continue;
+         /* Like NETPLAY_CMD_INPUT, nothing past our own frame */
+         hi = MIN(netplay->read_frame_count[client_num],
+               netplay->self_frame_count + 1);
       }
 
-   }
+      expected = netplay_expected_input_size(netplay,
+            netplay->client_devices[client_num]);
+      frame    = (hi > netplay->udp_input_frames)
+         ? hi - netplay->udp_input_frames : 0;
 
-   /* Send our own data */
-   if (netplay->self_mode == NETPLAY_CONNECTION_PLAYING
-         || netplay->self_mode == NETPLAY_CONNECTION_SLAVE)
-   {
-      if (!send_input_frame(netplay, dframe, connection, NULL,
-            netplay->self_client_num,
-            netplay->self_mode == NETPLAY_CONNECTION_SLAVE))
-         return false;
+      for (; frame < hi; frame++)
+      {
+         struct delta_frame *dframe;
+         size_t words;
+         uint32_t back = netplay->self_frame_count - frame;
+
+         if (back >= netplay->buffer_size)
+            continue;
+         dframe = &netplay->buffer[(netplay->self_ptr +
+               netplay->buffer_size - back) % netplay->buffer_size];
+         if (!dframe->used || dframe->frame != frame ||
+               !dframe->have_real[client_num])
+            continue;
+
+         if (pos + 3 + expected > ARRAY_SIZE(buf))
+            goto send;
+         words = netplay_input_frame_words(netplay, dframe, client_num,
+               false, buf + pos + 3, expected);
+         if (words != expected)
+            continue;
+
+         buf[pos]     = htonl(frame);
+         buf[pos + 1] = htonl(client_num);
+         buf[pos + 2] = htonl((uint32_t)words);
+         pos         += 3 + words;
+         count++;
+      }
    }
 
-   if (!netplay_send_flush(&connection->send_packet_buffer, connection->fd,
-         false))
-      return false;
+send:
+   if (!count)
+      return;
 
-   return true;
+   buf[0] = htonl(NETPLAY_UDP_INPUT_MAGIC);
+   buf[1] = htonl((uint32_t)(connection->udp_token >> 32));
+   buf[2] = htonl((uint32_t)connection->udp_token);
+   buf[3] = htonl(count);
+
+   /* Best effort, TCP has it too */
+   sendto(netplay->udp_fd, (const char*)buf, pos * sizeof(uint32_t), 0,
+      (struct sockaddr*)&connection->udp_addr, connection->udp_addr_len);
 }
 
 /**
@@ -5127,6 +5969,10 @@ static void request_ping(netplay_t *netplay,
    if (!connection->active || connection->mode < NETPLAY_CONNECTION_CONNECTED)
       return;
 
+   /* Restarting the timer would make the pending response look faster. */
+   if (connection->ping_requested)
+      return;
+
    /* Only protocol 6+ supports the ping command. */
    REQUIRE_PROTOCOL_VERSION(connection, 6)
    {
@@ -5143,6 +5989,31 @@ static void request_ping(netplay_t *netplay,
    }
 }
 
+/* Feeds one RTT sample into the connection's smoothed RTT and jitter,
+ * the same way TCP estimates its retransmission timeout (RFC 6298). */
+static void netplay_update_rtt(struct netplay_connection *connection,
+      retro_time_t rtt)
+{
+   if (rtt < 0)
+      return;
+
+   if (!connection->rtt_avg)
+   {
+      connection->rtt_avg    = rtt ? rtt : 1;
+      connection->rtt_jitter = rtt / 2;
+   }
+   else
+   {
+      retro_time_t err = rtt - connection->rtt_avg;
+
+      connection->rtt_jitter += ((err < 0 ? -err : err)
+            - connection->rtt_jitter) / 4;
+      connection->rtt_avg    += err / 8;
+      if (connection->rtt_avg < 1)
+         connection->rtt_avg  = 1;
+   }
+}
+
 static void answer_ping(netplay_t *netplay,
       struct netplay_connection *connection)
 {
@@ -5264,6 +6135,14 @@ static bool netplay_get_cmd(netplay_t *netplay,
                      RECV(&buf, sizeof(uint32_t))
                         return false;
                   }
+
+                  /* Server input that came first over UDP */
+                  if (!netplay->is_server && client_num == 0 &&
+                        frame_num == netplay->server_frame_count)
+                  {
+                     netplay->server_ptr = NEXT_PTR(netplay->server_ptr);
+                     netplay->server_frame_count++;
+                  }
                   break;
                }
                else if (frame_num > netplay->read_frame_count[client_num])
@@ -5789,7 +6668,7 @@ static bool netplay_get_cmd(netplay_t *netplay,
 
                /* Problem! */
                if (buffer[1] != local_crc)
-                  netplay_cmd_request_savestate(netplay);
+                  netplay_cmd_request_savestate(netplay, false);
             }
             else
             {
@@ -5801,12 +6680,31 @@ static bool netplay_get_cmd(netplay_t *netplay,
          }
 
       case NETPLAY_CMD_REQUEST_SAVESTATE:
+         if (cmd_size)
+         {
+            uint32_t flags;
+
+            if (cmd_size != sizeof(flags))
+            {
+               RARCH_ERR("[Netplay] Received invalid payload size for NETPLAY_CMD_REQUEST_SAVESTATE.\n");
+               return netplay_cmd_nak(netplay, connection);
+            }
+
+            RECV(&flags, sizeof(flags))
+               return false;
+
+            /* They could not apply our last delta. */
+            if (ntohl(flags) & NETPLAY_CMD_REQUEST_SAVESTATE_BIT_FULL)
+               connection->delta_base_valid = false;
+         }
+
          /* Delay until next frame so we don't send the savestate after the
           * input */
          netplay->force_send_savestate = true;
          break;
 
       case NETPLAY_CMD_LOAD_SAVESTATE:
+      case NETPLAY_CMD_LOAD_SAVESTATE_DELTA:
          {
             uint32_t i;
             uint32_t frame;
@@ -5814,6 +6712,10 @@ static bool netplay_get_cmd(netplay_t *netplay,
             size_t   load_ptr;
             uint32_t load_frame_count;
             uint32_t rd, wn;
+            /* base frame, base CRC, state CRC, patch size */
+            uint32_t delta_hdr[4];
+            size_t   hdr_size = sizeof(frame) + sizeof(state_size);
+            bool     delta    = (cmd == NETPLAY_CMD_LOAD_SAVESTATE_DELTA);
             struct compression_transcoder *ctrans = NULL;
 
             if (netplay->is_server)
@@ -5822,7 +6724,19 @@ static bool netplay_get_cmd(netplay_t *netplay,
                return netplay_cmd_nak(netplay, connection);
             }
 
-            if (cmd_size < sizeof(frame) + sizeof(state_size))
+            if (delta)
+            {
+#ifdef HAVE_REWIND
+               if (!connection->delta_states)
+#endif
+               {
+                  RARCH_ERR("[Netplay] Unexpected NETPLAY_CMD_LOAD_SAVESTATE_DELTA.\n");
+                  return netplay_cmd_nak(netplay, connection);
+               }
+               hdr_size += sizeof(delta_hdr);
+            }
+
+            if (cmd_size < hdr_size)
             {
                RARCH_ERR("[Netplay] Received invalid payload size for NETPLAY_CMD_LOAD_SAVESTATE.\n");
                return netplay_cmd_nak(netplay, connection);
@@ -5884,7 +6798,15 @@ static bool netplay_get_cmd(netplay_t *netplay,
             RECV(&state_size, sizeof(state_size))
                return false;
             state_size     = ntohl(state_size);
-            state_size_raw = cmd_size - (sizeof(frame) + sizeof(state_size));
+            state_size_raw = cmd_size - hdr_size;
+
+            if (delta)
+            {
+               RECV(delta_hdr, sizeof(delta_hdr))
+                  return false;
+               for (i = 0; i < ARRAY_SIZE(delta_hdr); i++)
+                  delta_hdr[i] = ntohl(delta_hdr[i]);
+            }
 
             if (state_size != netplay->state_size ||
                   state_size_raw > netplay->zbuffer_size)
@@ -5901,20 +6823,49 @@ static bool netplay_get_cmd(netplay_t *netplay,
                case NETPLAY_COMPRESSION_ZLIB:
                   ctrans = &netplay->compress_zlib;
                   break;
+               case NETPLAY_COMPRESSION_LZ4:
+                  ctrans = &netplay->compress_lz4;
+                  break;
                default:
                   ctrans = &netplay->compress_nil;
                   break;
             }
 
-            ctrans->decompression_backend->set_in(
-               ctrans->decompression_stream,
-               netplay->zbuffer, state_size_raw);
-            ctrans->decompression_backend->set_out(
-               ctrans->decompression_stream,
-               (uint8_t*)netplay->buffer[load_ptr].state, state_size);
-            ctrans->decompression_backend->trans(
-               ctrans->decompression_stream,
-               true, &rd, &wn, NULL);
+#ifdef HAVE_REWIND
+            if (delta)
+            {
+               if (!netplay_load_delta_savestate(netplay, ctrans,
+                     state_size_raw, delta_hdr, frame,
+                     netplay->buffer[load_ptr].state))
+               {
+                  /* Whatever we had as a base, it is not theirs.
+                   * Carry on desynced until the full state arrives. */
+                  RARCH_WARN("[Netplay] Could not apply delta savestate, requesting a full one.\n");
+                  netplay->delta_base_valid = false;
+                  netplay_cmd_request_savestate(netplay, true);
+                  break;
+               }
+            }
+            else
+#endif
+            {
+               ctrans->decompression_backend->set_in(
+                  ctrans->decompression_stream,
+                  netplay->zbuffer, state_size_raw);
+               ctrans->decompression_backend->set_out(
+                  ctrans->decompression_stream,
+                  (uint8_t*)netplay->buffer[load_ptr].state, state_size);
+               ctrans->decompression_backend->trans(
+                  ctrans->decompression_stream,
+                  true, &rd, &wn, NULL);
+
+#ifdef HAVE_REWIND
+               /* Keep it around as the base for future deltas. */
+               if (connection->delta_states)
+                  netplay_set_delta_base(netplay,
+                        netplay->buffer[load_ptr].state, frame);
+#endif
+            }
 
             /* Force a rewind to the relevant frame. */
             netplay->force_rewind = true;
@@ -6215,10 +7166,41 @@ static bool netplay_get_cmd(netplay_t *netplay,
             /* Only process ping responses if we requested them. */
             if (connection->ping_requested)
             {
-               connection->ping           = (int32_t)
-                  ((cpu_features_get_time_usec() - connection->ping_timer)
-                     / 1000);
+               retro_time_t rtt           = cpu_features_get_time_usec()
+                  - connection->ping_timer;
+
+               connection->ping           = (int32_t)(rtt / 1000);
                connection->ping_requested = false;
+               netplay_update_rtt(connection, rtt);
+            }
+         }
+         break;
+
+      case NETPLAY_CMD_UDP_INPUT_TOKEN:
+         {
+            uint32_t token[2];
+
+            if (netplay->is_server)
+            {
+               RARCH_ERR("[Netplay] NETPLAY_CMD_UDP_INPUT_TOKEN from client.\n");
+               return netplay_cmd_nak(netplay, connection);
+            }
+
+            if (cmd_size != sizeof(token))
+            {
+               RARCH_ERR("[Netplay] NETPLAY_CMD_UDP_INPUT_TOKEN with incorrect payload size.\n");
+               return netplay_cmd_nak(netplay, connection);
+            }
+
+            RECV(token, sizeof(token))
+               return false;
+
+            if (connection->udp_input)
+            {
+               /* Gives the server NETPLAY_UDP_INPUT_TIMEOUT to answer */
+               connection->udp_token     =
+                  ((uint64_t)ntohl(token[0]) << 32) | ntohl(token[1]);
+               connection->udp_last_recv = cpu_features_get_time_usec();
             }
          }
          break;
@@ -6319,6 +7301,9 @@ static void netplay_poll_net_input(netplay_t *netplay)
    bool had_input;
    struct netplay_connection *connection;
 
+   /* UDP first, so the TCP copies of the same frames are just skipped */
+   netplay_udp_recv_input(netplay);
+
    do
    {
       had_input = false;
@@ -6695,6 +7680,16 @@ try_ipv4:
          break;
    } while ((tmp_info = tmp_info->ai_next));
 
+   /* Clients send UDP input to the same address and port. */
+   if (server && fd >= 0 &&
+         tmp_info->ai_addrlen <= sizeof(netplay->connections[0].udp_addr))
+   {
+      memcpy(&netplay->connections[0].udp_addr, tmp_info->ai_addr,
+         tmp_info->ai_addrlen);
+      netplay->connections[0].udp_addr_len =
+         (socklen_t)tmp_info->ai_addrlen;
+   }
+
    if (netplay->mitm_handler && netplay->mitm_handler->addr)
       netplay->mitm_handler->base_addr = addr;
    else
@@ -6889,9 +7884,18 @@ static void netplay_free(netplay_t *netplay)
 {
    size_t i;
 
+   netplay_replay_stats_merge(&netplay->replay_stats,
+      &netplay->replay_stats_window);
+   if (netplay->replay_stats.rollbacks)
+      netplay_replay_stats_log("Rollback replay this session",
+         &netplay->replay_stats);
+
    if (netplay->listen_fd >= 0)
       socket_close(netplay->listen_fd);
 
+   if (netplay->udp_fd >= 0)
+      socket_close(netplay->udp_fd);
+
    if (netplay->mitm_handler)
    {
       for (i = 0; i < ARRAY_SIZE(netplay->mitm_handler->pending); i++)
@@ -6930,6 +7934,9 @@ static void netplay_free(netplay_t *netplay)
    }
 
    free(netplay->zbuffer);
+#ifdef HAVE_REWIND
+   netplay_free_delta_buffers(netplay);
+#endif
 
    if (netplay->compress_nil.compression_stream)
       netplay->compress_nil.compression_backend->stream_free(
@@ -6943,6 +7950,12 @@ static void netplay_free(netplay_t *netplay)
    if (netplay->compress_zlib.decompression_stream)
       netplay->compress_zlib.decompression_backend->stream_free(
          netplay->compress_zlib.decompression_stream);
+   if (netplay->compress_lz4.compression_stream)
+      netplay->compress_lz4.compression_backend->stream_free(
+         netplay->compress_lz4.compression_stream);
+   if (netplay->compress_lz4.decompression_stream)
+      netplay->compress_lz4.decompression_backend->stream_free(
+         netplay->compress_lz4.decompression_stream);
 
    free(netplay);
 }
@@ -6980,6 +7993,7 @@ static netplay_t *netplay_new(const char *server, const char *mitm,
    netplay->quirks           = quirks;
    netplay->crcs_valid       = true;
    netplay->listen_fd        = -1;
+   netplay->udp_fd           = -1;
    netplay->next_announce    = -1;
    netplay->next_ping        = -1;
    netplay->simple_rand_next = 1;
@@ -6990,6 +8004,12 @@ static netplay_t *netplay_new(const char *server, const char *mitm,
 
    netplay_key_init(netplay);
 
+   /* Replaying a single frame at a time would never catch up */
+   netplay->replay_max_frames =
+      config_get_ptr()->uints.netplay_replay_max_frames;
+   if (netplay->replay_max_frames == 1)
+      netplay->replay_max_frames = 2;
+
    if (netplay->is_server)
    {
       unsigned i;
@@ -7073,6 +8093,16 @@ static netplay_t *netplay_new(const char *server, const char *mitm,
          !netplay_init_buffers(netplay))
       goto failure;
 
+   /* Relay servers only forward TCP. */
+   netplay->udp_input_frames = MIN(
+      config_get_ptr()->uints.netplay_udp_input_frames,
+      NETPLAY_UDP_INPUT_MAX_FRAMES);
+   if (netplay->udp_input_frames && !netplay->mitm_handler &&
+         !netplay->mitm_session_id.magic &&
+         !netplay_init_udp_socket(netplay))
+      RARCH_WARN("[Netplay] Failed to open the UDP input socket, "
+         "using TCP only.\n");
+
    return netplay;
 
 failure:
@@ -7081,56 +8111,176 @@ failure:
    return NULL;
 }
 
+#ifdef HAVE_REWIND
+/**
+ * netplay_prepare_delta_savestate
+ * @netplay              : pointer to netplay object
+ * @serial_info          : the savestate being loaded
+ *
+ * Server: diff the savestate about to be sent against the last one
+ * sent, into delta_patch.
+ *
+ * Returns the size of the patch, or 0 if it has to be sent in full.
+ */
+static size_t netplay_prepare_delta_savestate(netplay_t *netplay,
+   retro_ctx_serialize_info_t *serial_info)
+{
+   size_t patch_size;
+
+   if (     serial_info->size != netplay->state_size
+         || !netplay_init_delta_buffers(netplay))
+   {
+      netplay->delta_base_valid = false;
+      return 0;
+   }
+
+   memcpy(netplay->delta_scratch, serial_info->data_const,
+         netplay->state_size);
+   netplay->delta_scratch_crc = encoding_crc32(0L,
+         netplay->delta_scratch, netplay->state_size);
+
+   if (!netplay->delta_base_valid)
+      return 0;
+
+   patch_size = state_manager_raw_compress(netplay->delta_scratch,
+         netplay->delta_base, netplay->state_size, netplay->delta_patch);
+
+   /* Not worth it, most of the state changed. */
+   if (patch_size >= netplay->state_size)
+      return 0;
+
+   return patch_size;
+}
+
+/**
+ * netplay_commit_delta_savestate
+ * @netplay              : pointer to netplay object
+ *
+ * Server: the savestate just sent becomes the base for the next
+ * delta, for every peer it was sent to.
+ */
+static void netplay_commit_delta_savestate(netplay_t *netplay)
+{
+   size_t i;
+   uint8_t *tmp;
+
+   if (!netplay->delta_scratch)
+      return;
+
+   tmp                        = netplay->delta_base;
+   netplay->delta_base        = netplay->delta_scratch;
+   netplay->delta_scratch     = tmp;
+   netplay->delta_base_frame  = netplay->run_frame_count;
+   netplay->delta_base_crc    = netplay->delta_scratch_crc;
+   netplay->delta_base_valid  = true;
+
+   for (i = 0; i < netplay->connections_size; i++)
+   {
+      struct netplay_connection *connection = &netplay->connections[i];
+      if (!connection->active ||
+          connection->mode < NETPLAY_CONNECTION_CONNECTED)
+         continue;
+
+      connection->delta_base_valid = connection->delta_states;
+      connection->delta_base_frame = netplay->delta_base_frame;
+   }
+}
+#endif
+
 /**
  * netplay_send_savestate
  * @netplay              : pointer to netplay object
  * @serial_info          : the savestate being loaded
  * @cx                   : compression type
  * @z                    : compression backend to use
+ * @delta_size           : size of the patch in delta_patch, 0 if none
  *
  * Send a loaded savestate to those connected peers using the given compression
- * scheme.
+ * scheme. Peers holding our last savestate get a patch against it when
+ * @delta_size is nonzero, everyone else gets the full savestate.
  */
 static void netplay_send_savestate(netplay_t *netplay,
    retro_ctx_serialize_info_t *serial_info, uint32_t cx,
-   struct compression_transcoder *z)
+   struct compression_transcoder *z, size_t delta_size)
 {
-   uint32_t header[4];
+   uint32_t header[8];
+   size_t header_size;
    uint32_t rd, wn;
    size_t i;
+   int pass;
 
-   /* Compress it */
-   z->compression_backend->set_in(z->compression_stream,
-      (const uint8_t*)serial_info->data_const, (uint32_t)serial_info->size);
-   z->compression_backend->set_out(z->compression_stream,
-      netplay->zbuffer, (uint32_t)netplay->zbuffer_size);
-   if (!z->compression_backend->trans(z->compression_stream, true, &rd,
-         &wn, NULL))
+   /* First pass sends the delta, second one the full savestate. */
+   for (pass = 0; pass < 2; pass++)
    {
-      /* Catastrophe! */
+      bool delta      = (pass == 0);
+      bool compressed = false;
+
+      if (delta && !delta_size)
+         continue;
+
       for (i = 0; i < netplay->connections_size; i++)
-         netplay_hangup(netplay, &netplay->connections[i]);
-      return;
-   }
+      {
+         struct netplay_connection *connection = &netplay->connections[i];
+         bool has_base = delta_size
+            && connection->delta_base_valid
+            && connection->delta_base_frame == netplay->delta_base_frame;
+
+         if (!connection->active ||
+             connection->mode < NETPLAY_CONNECTION_CONNECTED ||
+             connection->compression_supported != cx ||
+             has_base != delta)
+            continue;
 
-   /* Send it to relevant peers */
-   header[0] = htonl(NETPLAY_CMD_LOAD_SAVESTATE);
-   header[1] = htonl(wn + 2*sizeof(uint32_t));
-   header[2] = htonl(netplay->run_frame_count);
-   header[3] = htonl(serial_info->size);
+         if (!compressed)
+         {
+            /* Compress it */
+            if (delta)
+               z->compression_backend->set_in(z->compression_stream,
+                  netplay->delta_patch, (uint32_t)delta_size);
+            else
+               z->compression_backend->set_in(z->compression_stream,
+                  (const uint8_t*)serial_info->data_const,
+                  (uint32_t)serial_info->size);
+            z->compression_backend->set_out(z->compression_stream,
+               netplay->zbuffer, (uint32_t)netplay->zbuffer_size);
+            if (!z->compression_backend->trans(z->compression_stream, true,
+                  &rd, &wn, NULL))
+            {
+               /* Catastrophe! */
+               for (i = 0; i < netplay->connections_size; i++)
+                  netplay_hangup(netplay, &netplay->connections[i]);
+               return;
+            }
 
-   for (i = 0; i < netplay->connections_size; i++)
-   {
-      struct netplay_connection *connection = &netplay->connections[i];
-      if (!connection->active ||
-          connection->mode < NETPLAY_CONNECTION_CONNECTED ||
-          connection->compression_supported != cx) continue;
+            header[2] = htonl(netplay->run_frame_count);
+            header[3] = htonl(serial_info->size);
 
-      if (!netplay_send(&connection->send_packet_buffer, connection->fd, header,
-            sizeof(header)) ||
-          !netplay_send(&connection->send_packet_buffer, connection->fd,
-            netplay->zbuffer, wn))
-         netplay_hangup(netplay, connection);
+            if (delta)
+            {
+               header[0]   = htonl(NETPLAY_CMD_LOAD_SAVESTATE_DELTA);
+               header[1]   = htonl(wn + 6*sizeof(uint32_t));
+               header[4]   = htonl(netplay->delta_base_frame);
+               header[5]   = htonl(netplay->delta_base_crc);
+               header[6]   = htonl(netplay->delta_scratch_crc);
+               header[7]   = htonl((uint32_t)delta_size);
+               header_size = 8*sizeof(uint32_t);
+            }
+            else
+            {
+               header[0]   = htonl(NETPLAY_CMD_LOAD_SAVESTATE);
+               header[1]   = htonl(wn + 2*sizeof(uint32_t));
+               header_size = 4*sizeof(uint32_t);
+            }
+
+            compressed = true;
+         }
+
+         if (!netplay_send(&connection->send_packet_buffer, connection->fd,
+               header, header_size) ||
+             !netplay_send(&connection->send_packet_buffer, connection->fd,
+               netplay->zbuffer, wn))
+            netplay_hangup(netplay, connection);
+      }
    }
 }
 
@@ -7296,13 +8446,29 @@ void netplay_load_savestate(netplay_t *netplay,
    /* Don't send it if we're expected to be desynced. */
    if (!netplay->desync)
    {
+      size_t delta_size = 0;
+
+#ifdef HAVE_REWIND
+      if (netplay->is_server)
+         delta_size = netplay_prepare_delta_savestate(netplay, serial_info);
+#endif
+
       /* Send this to every peer. */
       if (netplay->compress_nil.compression_backend)
          netplay_send_savestate(netplay, serial_info, 0,
-            &netplay->compress_nil);
+            &netplay->compress_nil, delta_size);
       if (netplay->compress_zlib.compression_backend)
          netplay_send_savestate(netplay, serial_info, NETPLAY_COMPRESSION_ZLIB,
-            &netplay->compress_zlib);
+            &netplay->compress_zlib, delta_size);
+      if (netplay->compress_lz4.compression_backend)
+         netplay_send_savestate(netplay, serial_info, NETPLAY_COMPRESSION_LZ4,
+            &netplay->compress_lz4, delta_size);
+
+#ifdef HAVE_REWIND
+      if (netplay->is_server && netplay->delta_scratch
+            && serial_info->size == netplay->state_size)
+         netplay_commit_delta_savestate(netplay);
+#endif
    }
 }
 
@@ -7568,11 +8734,15 @@ static bool get_self_input_state(
    }
 
    /* And send this input to our peers */
+   netplay->spectator_frame_words = 0;
    for (i = 0; i < netplay->connections_size; i++)
    {
       struct netplay_connection *connection = &netplay->connections[i];
       if (connection->active && connection->mode >= NETPLAY_CONNECTION_CONNECTED)
+      {
          netplay_send_cur_input(netplay, &netplay->connections[i]);
+         netplay_udp_send_input(netplay, connection);
+      }
    }
 
    /* Handle any delayed state changes */
@@ -7582,6 +8752,44 @@ static bool get_self_input_state(
    return true;
 }
 
+/* How many frames of input latency the measured network needs, given
+ * that replay can hide 'replay_frames' frames of it per frame without
+ * falling behind. The one-way delay is taken as half the smoothed RTT
+ * plus twice the jitter, so that most late packets are still covered.
+ * Returns -1 until there is an RTT estimate for every playing peer. */
+static int netplay_input_latency_target(netplay_t *netplay,
+      retro_time_t frame_usec, unsigned replay_frames)
+{
+   size_t i;
+   retro_time_t one_way = -1;
+
+   for (i = 0; i < netplay->connections_size; i++)
+   {
+      retro_time_t delay;
+      struct netplay_connection *connection = &netplay->connections[i];
+
+      if (!connection->active)
+         continue;
+      /* The server only waits on players, a client only on the server. */
+      if (netplay->is_server && connection->mode != NETPLAY_CONNECTION_PLAYING)
+         continue;
+      if (!connection->rtt_avg)
+         return -1;
+
+      delay = connection->rtt_avg / 2 + 2 * connection->rtt_jitter;
+      if (delay > one_way)
+         one_way = delay;
+   }
+
+   if (one_way < 0)
+      return -1;
+
+   /* Leave half of the replay budget for input that arrives later than
+    * predicted, so rollbacks don't eat the whole frame. */
+   return (int)((one_way + frame_usec - 1) / frame_usec)
+      - (int)(replay_frames / 2);
+}
+
 /**
  * netplay_poll:
  * @netplay              : pointer to netplay object
@@ -7621,15 +8829,18 @@ static bool netplay_poll(netplay_t *netplay, bool block_libretro_input)
       hide network latency. */
    if (netplay->frame_run_time_avg)
    {
-      /* FIXME: Using fixed 60fps for this calculation */
-      unsigned frames_per_frame    = netplay->frame_run_time_avg ?
-         (unsigned)(16666 / netplay->frame_run_time_avg) : 0;
+      float fps                    = video_state_get_ptr()->av_info.timing.fps;
+      retro_time_t frame_usec      = (fps > 1.0f) ?
+         (retro_time_t)(1000000.0f / fps) : 16666;
+      unsigned frames_per_frame    =
+         (unsigned)(frame_usec / netplay->frame_run_time_avg);
       unsigned frames_ahead        =
          (netplay->run_frame_count > netplay->unread_frame_count) ?
             (unsigned)(netplay->run_frame_count - netplay->unread_frame_count)
             : 0;
       int input_latency_frames_min = (int)netplay->input_latency_frames_min;
       int input_latency_frames_max = (int)netplay->input_latency_frames_max;
+      int target;
 
       /* Assume we need a couple frames worth of time
          to actually run the current frame. */
@@ -7638,17 +8849,42 @@ static bool netplay_poll(netplay_t *netplay, bool block_libretro_input)
       else
          frames_per_frame  = 0;
 
+      target = netplay_input_latency_target(netplay, frame_usec,
+            frames_per_frame);
+
       /* We can't hide this much network latency with replay,
          so hide some with input latency. */
       if (netplay->input_latency_frames < input_latency_frames_min ||
-            (frames_per_frame < frames_ahead &&
-               netplay->input_latency_frames < input_latency_frames_max))
+            (netplay->input_latency_frames < input_latency_frames_max &&
+               (frames_per_frame < frames_ahead ||
+                target > netplay->input_latency_frames)))
+      {
          netplay->input_latency_frames++;
-      /* We don't need this much latency (any more). */
-      else if (netplay->input_latency_frames > input_latency_frames_max ||
-            (frames_per_frame > (frames_ahead + 2) &&
-               netplay->input_latency_frames > input_latency_frames_min))
+         netplay->input_latency_lower_frames = 0;
+      }
+      else if (netplay->input_latency_frames > input_latency_frames_max)
+      {
          netplay->input_latency_frames--;
+         netplay->input_latency_lower_frames = 0;
+      }
+      /* We don't need this much latency (any more). Without an RTT
+         estimate (peers older than protocol 6) go by the replay depth
+         alone; otherwise only drop a frame once the link has been good
+         enough for a while, so jitter doesn't make it flap. */
+      else if (netplay->input_latency_frames > input_latency_frames_min &&
+            ((target < 0 && frames_per_frame > (frames_ahead + 2)) ||
+             (target >= 0 && target < netplay->input_latency_frames &&
+               frames_per_frame > frames_ahead)))
+      {
+         if (target < 0 || ++netplay->input_latency_lower_frames
+               >= NETPLAY_LATENCY_LOWER_FRAMES)
+         {
+            netplay->input_latency_frames--;
+            netplay->input_latency_lower_frames = 0;
+         }
+      }
+      else
+         netplay->input_latency_lower_frames = 0;
    }
 
    /* If we're stalled, consider unstalling. */
@@ -8385,7 +9621,11 @@ static bool netplay_pre_frame(netplay_t *netplay)
          {
             request_ping(netplay, &netplay->connections[0]);
 
-            netplay->next_ping = ctime + NETPLAY_PING_TIME;
+            /* Adaptive input latency wants a fresh RTT estimate. */
+            netplay->next_ping = ctime +
+               ((netplay->input_latency_frames_max >
+                  netplay->input_latency_frames_min)
+                     ? NETPLAY_LATENCY_PING_TIME : NETPLAY_PING_TIME);
          }
       }
    }
@@ -9294,7 +10534,8 @@ static void gfx_widget_netplay_ping_iterate(void *user_data,
 
    if (!netplay || !show_ping)
    {
-      net_st->latest_ping = -1;
+      net_st->latest_ping      = -1;
+      net_st->latest_replay_ms = -1.0f;
       return;
    }
 
@@ -9302,7 +10543,8 @@ static void gfx_widget_netplay_ping_iterate(void *user_data,
 #ifdef HAVE_MENU
    if (menu_open)
    {
-      net_st->latest_ping = -1;
+      net_st->latest_ping      = -1;
+      net_st->latest_replay_ms = -1.0f;
       return;
    }
 #endif
@@ -9312,17 +10554,30 @@ static void gfx_widget_netplay_ping_iterate(void *user_data,
       net_st->latest_ping = netplay->connections[0].ping;
    else
       net_st->latest_ping = -1;
+
+   /* Only worth showing once there's someone to roll back for. */
+   if (netplay->replay_stats_last.frames &&
+         netplay->self_mode == NETPLAY_CONNECTION_PLAYING &&
+         (!netplay->is_server || netplay->connected_players > 1))
+   {
+      net_st->latest_replay_ms    = netplay->replay_stats_last.replay_time /
+         (1000.0f * netplay->replay_stats_last.frames);
+      net_st->latest_replay_depth = netplay->replay_stats_last.depth_max;
+   }
+   else
+      net_st->latest_replay_ms    = -1.0f;
 }
 
 static void gfx_widget_netplay_ping_frame(void *data, void *userdata)
 {
    net_driver_state_t *net_st = &networking_driver_st;
    int ping                   = net_st->latest_ping;
+   float replay_ms            = net_st->latest_replay_ms;
 
-   if (ping >= 0)
+   if (ping >= 0 || replay_ms >= 0.0f)
    {
-      char ping_str[16];
-      size_t ping_len;
+      char ping_str[64];
+      size_t ping_len            = 0;
       int ping_width, total_width;
       video_frame_info_t     *video_info   = (video_frame_info_t*)data;
       dispgfx_widget_t       *p_dispwidget = (dispgfx_widget_t*)userdata;
@@ -9335,8 +10590,17 @@ static void gfx_widget_netplay_ping_frame(void *data, void *userdata)
       if (ping > 999)
          ping = 999;
 
-      ping_len    = (size_t)snprintf(ping_str,
-            sizeof(ping_str), "PING: %d", ping);
+      ping_str[0] = '\0';
+      if (ping >= 0)
+         ping_len = (size_t)snprintf(ping_str,
+               sizeof(ping_str), "PING: %d", ping);
+
+      /* Replay time per frame and deepest rollback, e.g. "RB: 1.2ms/4" */
+      if (replay_ms >= 0.0f)
+         ping_len += (size_t)snprintf(ping_str + ping_len,
+               sizeof(ping_str) - ping_len, "%sRB: %.1fms/%u",
+               ping_len ? "  " : "", replay_ms,
+               MIN(net_st->latest_replay_depth, 999));
 
       ping_width  = font_driver_get_message_width(
          font->font, ping_str, ping_len, 1.0f);
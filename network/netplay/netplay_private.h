@@ -44,6 +44,12 @@
 #define NETPLAY_ANNOUNCE_TIME  20000000
 #define NETPLAY_PING_TIME      3000000
 
+/* While input latency is adaptive (max > min), RTT is sampled this often */
+#define NETPLAY_LATENCY_PING_TIME    500000
+/* Frames the latency target must stay below the current input latency
+ * before a frame of it is dropped */
+#define NETPLAY_LATENCY_LOWER_FRAMES 180
+
 #define MAX_SERVER_STALL_TIME_USEC (5*1000*1000)
 #define MAX_CLIENT_STALL_TIME_USEC (10*1000*1000)
 #define CATCH_UP_CHECK_TIME_USEC   (500*1000)
@@ -60,6 +66,9 @@
 
 #define NETPLAY_MAX_STALL_FRAMES        60
 #define NETPLAY_FRAME_RUN_TIME_WINDOW   120
+
+/* Host frames per rollback statistics window (log and widget) */
+#define NETPLAY_REPLAY_STATS_WINDOW     60
 #define NETPLAY_MAX_REQ_STALL_TIME      60
 #define NETPLAY_MAX_REQ_STALL_FREQUENCY 120
 
@@ -74,12 +83,43 @@
 
 /* Compression protocols supported */
 #define NETPLAY_COMPRESSION_ZLIB (1<<0)
+#define NETPLAY_COMPRESSION_LZ4  (1<<1)
 #if HAVE_ZLIB
-#define NETPLAY_COMPRESSION_SUPPORTED NETPLAY_COMPRESSION_ZLIB
+#define NETPLAY_COMPRESSION_SUPPORTED \
+   (NETPLAY_COMPRESSION_ZLIB | NETPLAY_COMPRESSION_LZ4)
+#else
+#define NETPLAY_COMPRESSION_SUPPORTED NETPLAY_COMPRESSION_LZ4
+#endif
+
+/* Not a compression protocol as such: savestates may be sent as a
+ * patch against the last one sent (NETPLAY_CMD_LOAD_SAVESTATE_DELTA).
+ * Advertised alongside the compression protocols. */
+#define NETPLAY_COMPRESSION_DELTA (1<<16)
+#ifdef HAVE_REWIND
+#define NETPLAY_COMPRESSION_ADVERTISED \
+   (NETPLAY_COMPRESSION_SUPPORTED | NETPLAY_COMPRESSION_DELTA)
 #else
-#define NETPLAY_COMPRESSION_SUPPORTED 0
+#define NETPLAY_COMPRESSION_ADVERTISED NETPLAY_COMPRESSION_SUPPORTED
 #endif
 
+/* Not a compression protocol either: input frames may also be sent
+ * over UDP (NETPLAY_CMD_UDP_INPUT_TOKEN). Only advertised when enabled,
+ * so it isn't part of NETPLAY_COMPRESSION_ADVERTISED. */
+#define NETPLAY_COMPRESSION_UDP_INPUT (1<<17)
+
+/* Largest NETPLAY_CMD_INPUT command, header included, in words
+ * (FIXME: Arbitrary restriction) */
+#define NETPLAY_INPUT_CMD_WORDS 16
+
+/* UDP input datagrams: magic, 64-bit token (high word first), record
+ * count, then per record frame, client number, word count and the
+ * input words */
+#define NETPLAY_UDP_INPUT_MAGIC    0x5241494E /* RAIN */
+#define NETPLAY_UDP_INPUT_MAX_SIZE 1200
+#define NETPLAY_UDP_INPUT_MAX_FRAMES 16
+/* No UDP input for this long and the peer is back to TCP only */
+#define NETPLAY_UDP_INPUT_TIMEOUT  5000000
+
 /* The keys supported by netplay */
 enum netplay_keys
 {
@@ -163,6 +203,9 @@ enum netplay_cmd
    /* Sends over cheats enabled on client (unsupported) */
    NETPLAY_CMD_CHEATS         = 0x0047,
 
+   /* Send a savestate as a patch against the last one sent */
+   NETPLAY_CMD_LOAD_SAVESTATE_DELTA = 0x0048,
+
    /* Misc. commands */
 
    /* Sends multiple config requests over,
@@ -189,6 +232,13 @@ enum netplay_cmd
    NETPLAY_CMD_PING_REQUEST   = 0x1100,
    NETPLAY_CMD_PING_RESPONSE  = 0x1101,
 
+   /* Input channel commands */
+
+   /* Server to client: input frames may also be exchanged over UDP,
+    * on the same port as the TCP connection, tagged with this 64-bit
+    * token. TCP keeps carrying every input frame as well. */
+   NETPLAY_CMD_UDP_INPUT_TOKEN = 0x1200,
+
    /* Setting commands */
 
    /* These host settings should be honored by the client,
@@ -198,6 +248,7 @@ enum netplay_cmd
 };
 
 #define NETPLAY_CMD_SYNC_BIT_PAUSED  (1U<<31)
+#define NETPLAY_CMD_REQUEST_SAVESTATE_BIT_FULL (1U<<0)
 #define NETPLAY_CMD_PLAY_BIT_SLAVE   (1U<<31)
 #define NETPLAY_CMD_MODE_BIT_YOU     (1U<<31)
 #define NETPLAY_CMD_MODE_BIT_PLAYING (1U<<30)
@@ -346,6 +397,18 @@ struct netplay_connection
    /* Timer used to estimate a connection's latency */
    retro_time_t ping_timer;
 
+   /* Where to send UDP input: the server's address on clients,
+    * wherever the client's datagrams come from on the server */
+   struct sockaddr_storage udp_addr;
+
+   /* Last valid UDP input datagram from this peer */
+   retro_time_t udp_last_recv;
+
+   /* Smoothed round-trip time and its mean deviation (jitter),
+    * in microseconds, from PING_RESPONSEs. 0 until sampled. */
+   retro_time_t rtt_avg;
+   retro_time_t rtt_jitter;
+
    /* Connection's address */
    netplay_address_t addr;
 
@@ -356,6 +419,14 @@ struct netplay_connection
    /* What compression does this peer support? */
    uint32_t compression_supported;
 
+   /* Tags this connection's UDP input datagrams; 0 if unused.
+    * Random from the system's secure source, server-assigned. */
+   uint64_t udp_token;
+
+   /* Size of udp_addr. On the server, 0 until the client's first
+    * datagram, which pins it. */
+   socklen_t udp_addr_len;
+
    /* Salt associated with password transaction */
    uint32_t salt;
 
@@ -406,6 +477,20 @@ struct netplay_connection
 
    /* Did we request a ping response? */
    bool ping_requested;
+
+   /* Does this peer accept delta savestates? */
+   bool delta_states;
+
+   /* Did this peer offer UDP input? */
+   bool udp_input;
+
+   /* Has UDP input from this peer stopped arriving? */
+   bool udp_timed_out;
+
+   /* Server only: does this peer hold our delta base
+    * (the last savestate we sent it)? */
+   bool delta_base_valid;
+   uint32_t delta_base_frame;
 };
 
 /* Compression transcoder */
@@ -460,6 +545,27 @@ struct netplay_chat
    } messages[NETPLAY_CHAT_MAX_MESSAGES];
 };
 
+/* Rollback cost, accumulated per session and per
+ * NETPLAY_REPLAY_STATS_WINDOW. Times are in microseconds. */
+struct netplay_replay_stats
+{
+   retro_time_t serialize_time;
+   retro_time_t unserialize_time;
+   /* Everything spent in replay, including the (un)serializes above */
+   retro_time_t replay_time;
+   /* Longest replay within a single host frame */
+   retro_time_t replay_time_max;
+   uint32_t frames;
+   uint32_t serializes;
+   uint32_t unserializes;
+   /* Rollbacks and the frames they replayed */
+   uint32_t rollbacks;
+   uint32_t replayed_frames;
+   uint32_t depth_max;
+   /* Rollbacks cut short by replay_max_frames */
+   uint32_t deferred;
+};
+
 struct netplay
 {
    /* We stall if we're far enough ahead that we
@@ -471,6 +577,12 @@ struct netplay
    retro_time_t frame_run_time_sum;
    retro_time_t frame_run_time_avg;
 
+   /* Rollback cost for the whole session, the window being
+    * accumulated and the last complete window */
+   struct netplay_replay_stats replay_stats;
+   struct netplay_replay_stats replay_stats_window;
+   struct netplay_replay_stats replay_stats_last;
+
    /* When did we start falling behind? */
    retro_time_t catch_up_time;
    /* How long have we been stalled? */
@@ -484,6 +596,7 @@ struct netplay
    /* Compression transcoder */
    struct compression_transcoder compress_nil;
    struct compression_transcoder compress_zlib;
+   struct compression_transcoder compress_lz4;
 
    /* MITM session id */
    mitm_id_t mitm_session_id;
@@ -505,6 +618,14 @@ struct netplay
    /* A buffer into which to compress frames for transfer */
    uint8_t *zbuffer;
 
+   /* Delta savestate transfer. The base is the last savestate
+    * sent (server) or loaded from the server (client); the
+    * scratch buffer holds the state being sent, and the patch
+    * buffer the difference between the two. */
+   uint8_t *delta_base;
+   uint8_t *delta_scratch;
+   uint8_t *delta_patch;
+
    size_t connections_size;
    size_t buffer_size;
    size_t zbuffer_size;
@@ -577,6 +698,11 @@ struct netplay
    /* Frequency with which to check CRCs */
    uint32_t check_frames;
 
+   /* Identity of the delta base, and CRC of the delta scratch */
+   uint32_t delta_base_frame;
+   uint32_t delta_base_crc;
+   uint32_t delta_scratch_crc;
+
    /* How far behind did we fall? */
    uint32_t catch_up_behind;
 
@@ -591,8 +717,28 @@ struct netplay
    /* TCP connection for listening (server only) */
    int listen_fd;
 
+   /* UDP input socket, -1 if unused */
+   int udp_fd;
+
+   /* Input frames repeated in every UDP datagram, 0 = TCP only */
+   uint32_t udp_input_frames;
+
+   /* Server only: this frame's input data as sent to every connection
+    * that isn't playing, and its size in words (0 until encoded).
+    * Encoded once, but still sent to each spectator connection. */
+   uint32_t spectator_frame[MAX_CLIENTS * NETPLAY_INPUT_CMD_WORDS + 3];
+   size_t spectator_frame_words;
+
    int frame_run_time_ptr;
 
+   /* Most frames a single host frame may replay; the rest of a deeper
+    * rollback is caught up over the following frames. 0 = unlimited. */
+   uint32_t replay_max_frames;
+
+   /* Consecutive frames the latency target has been lower than
+    * input_latency_frames; see NETPLAY_LATENCY_LOWER_FRAMES */
+   uint32_t input_latency_lower_frames;
+
    /* Latency frames; positive to hide network latency, 
     * negative to hide input latency */
    int input_latency_frames;
@@ -654,12 +800,19 @@ struct netplay
    /* Force a reset */
    bool force_reset;
 
+   /* A rollback was cut short by replay_max_frames: the core runs
+    * ahead on a stale prediction until the replay catches up */
+   bool replay_pending;
+
    /* Force our state to be sent to all connections */
    bool force_send_savestate;
 
    /* Have we requested a savestate as a sync point? */
    bool savestate_request_outstanding;
 
+   /* Does delta_base hold a savestate? */
+   bool delta_base_valid;
+
    /* Host settings */
    bool allow_pausing;
 };
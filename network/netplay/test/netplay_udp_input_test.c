@@ -0,0 +1,320 @@
+/*  RetroArch - A frontend for libretro.
+ *
+ *  RetroArch is free software: you can redistribute it and/or modify it under the terms
+ *  of the GNU General Public License as published by the Free Software Found-
+ *  ation, either version 3 of the License, or (at your option) any later version.
+ *
+ *  RetroArch is distributed in the hope that it will be useful, but WITHOUT ANY WARRANTY;
+ *  without even the implied warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR
+ *  PURPOSE.  See the GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License along with RetroArch.
+ *  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+/* Sends a client's input to a server with the real UDP input channel,
+ * over loopback, through a relay socket that drops and reorders
+ * datagrams, and checks that the server still reads every frame, in
+ * order, with the right data, without any help from TCP.
+ *
+ * Build and run from the top directory with:
+ *    make netplay_udp_input_test && ./netplay_udp_input_test
+ */
+
+#include "../netplay_frontend.c"
+
+#define TEST_FRAMES      200
+#define TEST_BUFFER_SIZE 32
+#define TEST_WINDOW      8
+#define TEST_TOKEN       0x0123456789ABCDEFULL
+
+/* One datagram is held back at a time, to be delivered after the next
+ * one; a run of TEST_WINDOW - 1 losses is the most the window covers. */
+struct lossy_link
+{
+   int fd;
+   struct sockaddr_in to;
+   uint32_t held[NETPLAY_UDP_INPUT_MAX_SIZE / sizeof(uint32_t)];
+   ssize_t held_len;
+   unsigned seen;
+   unsigned dropped;
+   unsigned reordered;
+   bool lossless;
+};
+
+static uint32_t test_input(uint32_t frame)
+{
+   return (frame * 2654435761U) ^ 0xA5A5;
+}
+
+static int test_socket(struct sockaddr_in *addr)
+{
+   socklen_t addr_len = sizeof(*addr);
+   int fd             = socket(AF_INET, SOCK_DGRAM, 0);
+
+   if (fd < 0)
+      return -1;
+
+   memset(addr, 0, sizeof(*addr));
+   addr->sin_family      = AF_INET;
+   addr->sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+   if (     bind(fd, (struct sockaddr*)addr, sizeof(*addr)) < 0
+         || getsockname(fd, (struct sockaddr*)addr, &addr_len) < 0
+         || !socket_nonblock(fd))
+   {
+      socket_close(fd);
+      return -1;
+   }
+
+   return fd;
+}
+
+static bool test_netplay_init(netplay_t *netplay, int fd, bool is_server)
+{
+   struct netplay_connection *connection;
+
+   netplay->buffer          = (struct delta_frame*)calloc(TEST_BUFFER_SIZE,
+         sizeof(*netplay->buffer));
+   netplay->connections     = (struct netplay_connection*)calloc(1,
+         sizeof(*netplay->connections));
+   if (!netplay->buffer || !netplay->connections)
+      return false;
+
+   netplay->buffer_size       = TEST_BUFFER_SIZE;
+   netplay->connections_size  = 1;
+   netplay->is_server         = is_server;
+   netplay->udp_fd            = fd;
+   netplay->udp_input_frames  = TEST_WINDOW;
+   netplay->config_devices[0] = RETRO_DEVICE_JOYPAD;
+   netplay->client_devices[1] = 1;
+   netplay->connected_players = 1 << 1;
+   if (is_server)
+      netplay->self_mode      = NETPLAY_CONNECTION_SPECTATING;
+   else
+   {
+      netplay->self_client_num = 1;
+      netplay->self_mode       = NETPLAY_CONNECTION_PLAYING;
+   }
+
+   connection                 = &netplay->connections[0];
+   connection->active         = true;
+   connection->mode           = NETPLAY_CONNECTION_PLAYING;
+   connection->udp_token      = TEST_TOKEN;
+   connection->udp_last_recv  = cpu_features_get_time_usec();
+   strlcpy(connection->nick, is_server ? "client" : "server",
+         sizeof(connection->nick));
+
+   return true;
+}
+
+static void test_netplay_deinit(netplay_t *netplay)
+{
+   size_t i;
+
+   if (netplay->buffer)
+      for (i = 0; i < netplay->buffer_size; i++)
+         netplay_delta_frame_free(&netplay->buffer[i]);
+   free(netplay->buffer);
+   free(netplay->connections);
+   if (netplay->udp_fd >= 0)
+      socket_close(netplay->udp_fd);
+}
+
+/* Moves every pending datagram from the client to the server. */
+static void lossy_link_pump(struct lossy_link *link)
+{
+   uint32_t buf[NETPLAY_UDP_INPUT_MAX_SIZE / sizeof(uint32_t)];
+
+   for (;;)
+   {
+      ssize_t len = recv(link->fd, (char*)buf, sizeof(buf), 0);
+
+      if (len < 0)
+         break;
+      link->seen++;
+
+      if (!link->lossless)
+      {
+         /* Bursts of up to three losses, and every fifth datagram
+          * that survives overtakes the one before it */
+         if ((link->seen % 11) < 3 || (link->seen % 7) == 0)
+         {
+            link->dropped++;
+            continue;
+         }
+         if (!link->held_len && (link->seen % 5) == 0)
+         {
+            memcpy(link->held, buf, len);
+            link->held_len = len;
+            continue;
+         }
+      }
+
+      sendto(link->fd, (const char*)buf, len, 0,
+            (struct sockaddr*)&link->to, sizeof(link->to));
+      if (link->held_len)
+      {
+         sendto(link->fd, (const char*)link->held, link->held_len, 0,
+               (struct sockaddr*)&link->to, sizeof(link->to));
+         link->held_len = 0;
+         link->reordered++;
+      }
+   }
+}
+
+/* The client's input for the frame it is on. */
+static bool test_client_frame(netplay_t *client, uint32_t frame)
+{
+   netplay_input_state_t istate;
+   struct delta_frame *dframe = &client->buffer[client->self_ptr];
+
+   /* Nothing is ever replayed here */
+   client->other_frame_count = frame;
+   if (!netplay_delta_frame_ready(client, dframe, frame))
+      return false;
+   istate = netplay_input_state_for(&dframe->real_input[0], 1, 1,
+         false, false);
+   if (!istate)
+      return false;
+   istate->data[0]          = test_input(frame);
+   dframe->have_real[1]     = true;
+   client->self_frame_count = frame;
+
+   return true;
+}
+
+/* Checks, and then lets go of, what the server has read. */
+static bool test_server_check(netplay_t *server, uint32_t *checked)
+{
+   while (*checked < server->read_frame_count[1])
+   {
+      netplay_input_state_t istate;
+      struct delta_frame *dframe = &server->buffer[
+         *checked % server->buffer_size];
+
+      if (!dframe->used || dframe->frame != *checked || !dframe->have_real[1])
+      {
+         fprintf(stderr, "Frame %u missing on the server.\n",
+               (unsigned)*checked);
+         return false;
+      }
+      istate = netplay_input_state_for(&dframe->real_input[0], 1, 1,
+            false, true);
+      if (!istate || istate->data[0] != test_input(*checked))
+      {
+         fprintf(stderr, "Frame %u has the wrong input.\n",
+               (unsigned)*checked);
+         return false;
+      }
+      (*checked)++;
+   }
+
+   /* As if the server had replayed up to here */
+   server->other_frame_count = *checked;
+   return true;
+}
+
+int main(void)
+{
+   netplay_t client, server;
+   struct lossy_link link;
+   struct sockaddr_storage client_from;
+   struct sockaddr_in client_addr, server_addr;
+   uint16_t client_port;
+   uint32_t frame;
+   uint32_t checked = 0;
+   unsigned stalls  = 0;
+   int ret          = 1;
+
+   memset(&client, 0, sizeof(client));
+   memset(&server, 0, sizeof(server));
+   memset(&link, 0, sizeof(link));
+   client.udp_fd = server.udp_fd = link.fd = -1;
+
+   if (!network_init())
+      return 1;
+
+   client.udp_fd = test_socket(&client_addr);
+   server.udp_fd = test_socket(&server_addr);
+   link.fd       = test_socket(&link.to);
+   if (client.udp_fd < 0 || server.udp_fd < 0 || link.fd < 0)
+   {
+      fprintf(stderr, "Could not open the loopback sockets.\n");
+      goto end;
+   }
+
+   if (     !test_netplay_init(&client, client.udp_fd, false)
+         || !test_netplay_init(&server, server.udp_fd, true))
+      goto end;
+
+   /* The client sends to the link and the link to the server, which
+    * takes the link for the client; both are on the same host as the
+    * TCP connection would be. */
+   memcpy(&client.connections[0].udp_addr, &link.to, sizeof(link.to));
+   client.connections[0].udp_addr_len = sizeof(link.to);
+   memset(&client_from, 0, sizeof(client_from));
+   memcpy(&client_from, &client_addr, sizeof(client_addr));
+   netplay_sockaddr_to_address(&client_from,
+         &server.connections[0].addr, &client_port);
+   link.to = server_addr;
+
+   for (frame = 0; frame < TEST_FRAMES; frame++)
+   {
+      uint32_t read_before = server.read_frame_count[1];
+
+      if (!test_client_frame(&client, frame))
+      {
+         fprintf(stderr, "Client buffer full at frame %u.\n",
+               (unsigned)frame);
+         goto end;
+      }
+      netplay_udp_send_input(&client, &client.connections[0]);
+      lossy_link_pump(&link);
+      netplay_udp_recv_input(&server);
+      if (!test_server_check(&server, &checked))
+         goto end;
+
+      if (server.read_frame_count[1] == read_before)
+         stalls++;
+      if (frame + 1 - server.read_frame_count[1] >= TEST_WINDOW)
+      {
+         fprintf(stderr, "Server fell %u frames behind at frame %u.\n",
+               (unsigned)(frame + 1 - server.read_frame_count[1]),
+               (unsigned)frame);
+         goto end;
+      }
+
+      client.self_ptr = (client.self_ptr + 1) % client.buffer_size;
+   }
+
+   /* The link recovers, so the last frames get through too */
+   client.self_ptr  = (client.self_ptr + client.buffer_size - 1)
+      % client.buffer_size;
+   link.lossless    = true;
+   netplay_udp_send_input(&client, &client.connections[0]);
+   lossy_link_pump(&link);
+   netplay_udp_recv_input(&server);
+   if (!test_server_check(&server, &checked))
+      goto end;
+
+   printf("%u datagrams, %u dropped, %u reordered, "
+         "%u frames late, %u of %u frames read.\n",
+         link.seen, link.dropped, link.reordered, stalls,
+         (unsigned)checked, (unsigned)TEST_FRAMES);
+
+   if (checked != TEST_FRAMES)
+      fprintf(stderr, "Server read %u of %u frames.\n",
+            (unsigned)checked, (unsigned)TEST_FRAMES);
+   else if (!link.dropped || !link.reordered)
+      fprintf(stderr, "The link neither dropped nor reordered anything.\n");
+   else
+      ret = 0;
+
+end:
+   if (link.fd >= 0)
+      socket_close(link.fd);
+   test_netplay_deinit(&client);
+   test_netplay_deinit(&server);
+
+   return ret;
+}
@@ -178,6 +178,7 @@ HAVE_VIDEOPROCESSOR=auto   # Enable video processor core
 HAVE_VIDEOCORE=auto        # Broadcom Videocore 4 support
 HAVE_DRMINGW=no            # DrMingw exception handler
 HAVE_CDROM=auto            # CD-ROM support
+HAVE_IO_URING=auto         # io_uring nbio backend (Linux 5.1+)
 HAVE_GLSL=yes              # GLSL shaders support
 HAVE_SLANG=auto            # slang support
 C89_SLANG=no
@@ -24,6 +24,7 @@
 #include <compat/strl.h>
 
 #include <boolean.h>
+#include <features/features_cpu.h>
 #include <queues/fifo_queue.h>
 #include <rthreads/rthreads.h>
 #include <gfx/scaler/scaler.h>
@@ -72,13 +73,30 @@ extern "C" {
 
 #define FFMPEG3 (LIBAVCODEC_VERSION_INT < AV_VERSION_INT(58, 10, 100))
 
+/* Captured frames waiting to be scaled, and scaled frames
+ * waiting to be encoded. Both pools are allocated up front. */
+#define FFMPEG_IN_FRAMES  8
+#define FFMPEG_OUT_FRAMES 4
+#define FFMPEG_QUEUE_SIZE 32
+/* Queue entry for a frame that repeats the previous one. */
+#define FFMPEG_DUPE       -1
+
+struct ff_queue
+{
+   int slots[FFMPEG_QUEUE_SIZE];
+   unsigned head;
+   unsigned count;
+};
+
+#define FF_QUEUE_FULL(q) ((q)->count >= FFMPEG_QUEUE_SIZE)
+
 struct ff_video_info
 {
    AVCodecContext *codec;
    const AVCodec *encoder;
 
-   AVFrame *conv_frame;
-   uint8_t *conv_frame_buf;
+   AVFrame *conv_frame[FFMPEG_OUT_FRAMES];
+   uint8_t *conv_frame_buf[FFMPEG_OUT_FRAMES];
    int64_t frame_cnt;
 
    uint8_t *outbuf;
@@ -183,17 +201,34 @@ typedef struct ffmpeg
    struct record_params params;
 
    AVPacket *pkt;
+   AVPacket *audio_pkt;
 
-   scond_t *cond;
-   slock_t *cond_lock;
+   /* Guards the queues, the audio FIFO and the statistics. */
    slock_t *lock;
+   /* Video and audio are encoded on different threads. */
+   slock_t *mux_lock;
+   scond_t *cond;
    fifo_buffer_t *audio_fifo;
-   fifo_buffer_t *video_fifo;
-   fifo_buffer_t *attr_fifo;
-   sthread_t *thread;
+   sthread_t *scale_thread;
+   sthread_t *encode_thread;
+   sthread_t *audio_thread;
 
+   uint8_t *in_frame_buf[FFMPEG_IN_FRAMES];
+   struct record_video_data in_frame[FFMPEG_IN_FRAMES];
+
+   /* push_video -> scale thread -> encode thread. */
+   struct ff_queue in_free;
+   struct ff_queue in_ready;
+   struct ff_queue out_free;
+   struct ff_queue out_ready;
+   /* Last encoded frame, kept for duplicates. */
+   int out_last;
+
+   struct record_stats stats;
+
+   /* Streams would rather lose frames than slow the game down. */
+   bool drop_frames;
    volatile bool alive;
-   volatile bool can_sleep;
 } ffmpeg_t;
 
 AVFormatContext *ctx;
@@ -371,6 +406,7 @@ static bool ffmpeg_init_audio(ffmpeg_t *handle, const char *audio_resampler)
 
 static bool ffmpeg_init_video(ffmpeg_t *handle)
 {
+   unsigned i;
    size_t size;
    struct ff_config_param *params  = &handle->config;
    struct ff_video_info *video     = &handle->video;
@@ -452,6 +488,11 @@ static bool ffmpeg_init_video(ffmpeg_t *handle)
          return false;
    }
 
+   /* Upscaling to the output size dominates the recording thread
+    * at high resolutions, so let the in-house scaler split rows
+    * across a few cores. */
+   video->scaler.threads = MIN(cpu_features_get_core_amount(), 4);
+
    video->codec = avcodec_alloc_context3(codec);
 
    /* Useful to set scale_factor to 2 for chroma subsampled formats to
@@ -495,16 +536,26 @@ static bool ffmpeg_init_video(ffmpeg_t *handle)
 
    size = av_image_get_buffer_size(video->pix_fmt, param->out_width,
          param->out_height, 1);
-   video->conv_frame_buf   = (uint8_t*)av_malloc(size);
-   video->conv_frame       = av_frame_alloc();
 
-   AVFrame* frame = video->conv_frame;
-   av_image_fill_arrays(frame->data, frame->linesize, video->conv_frame_buf,
-         video->pix_fmt, param->out_width, param->out_height, 1);
+   for (i = 0; i < FFMPEG_OUT_FRAMES; i++)
+   {
+      AVFrame *frame;
 
-   video->conv_frame->width  = param->out_width;
-   video->conv_frame->height = param->out_height;
-   video->conv_frame->format = video->pix_fmt;
+      video->conv_frame_buf[i] = (uint8_t*)av_malloc(size);
+      video->conv_frame[i]     = av_frame_alloc();
+      frame                    = video->conv_frame[i];
+
+      if (!video->conv_frame_buf[i] || !frame)
+         return false;
+
+      av_image_fill_arrays(frame->data, frame->linesize,
+            video->conv_frame_buf[i], video->pix_fmt,
+            param->out_width, param->out_height, 1);
+
+      frame->width  = param->out_width;
+      frame->height = param->out_height;
+      frame->format = video->pix_fmt;
+   }
 
    return true;
 }
@@ -865,73 +916,122 @@ static bool ffmpeg_init_muxer_post(ffmpeg_t *handle)
 
 #define MAX_FRAMES 32
 
-static void ffmpeg_thread(void *data);
+static void ffmpeg_scale_thread(void *data);
+static void ffmpeg_encode_thread(void *data);
+static void ffmpeg_audio_thread(void *data);
+
+static void ff_queue_push(struct ff_queue *q, int slot)
+{
+   q->slots[(q->head + q->count++) % FFMPEG_QUEUE_SIZE] = slot;
+}
+
+static int ff_queue_pop(struct ff_queue *q)
+{
+   int slot = q->slots[q->head];
+   q->head  = (q->head + 1) % FFMPEG_QUEUE_SIZE;
+   q->count--;
+   return slot;
+}
 
 static bool init_thread(ffmpeg_t *handle)
 {
-   handle->lock = slock_new();
-   handle->cond_lock = slock_new();
-   handle->cond = scond_new();
+   unsigned i;
+   /* For some reason, FFmpeg has a tendency to crash
+    * if we don't overallocate a bit. */
+   size_t in_size = 2 * handle->params.fb_width *
+      handle->params.fb_height * handle->video.pix_size;
+
+   handle->lock       = slock_new();
+   handle->mux_lock   = slock_new();
+   handle->cond       = scond_new();
    handle->audio_fifo = fifo_new(32000 * sizeof(int16_t) *
          handle->params.channels * MAX_FRAMES / 60); /* Some arbitrary max size. */
-   handle->attr_fifo = fifo_new(sizeof(struct record_video_data) * MAX_FRAMES);
-   handle->video_fifo = fifo_new(handle->params.fb_width * handle->params.fb_height *
-            handle->video.pix_size * MAX_FRAMES);
 
-   handle->alive = true;
-   handle->can_sleep = true;
-   handle->thread = sthread_create(ffmpeg_thread, handle);
+   if (     !handle->lock || !handle->mux_lock
+         || !handle->cond || !handle->audio_fifo)
+      return false;
+
+   for (i = 0; i < FFMPEG_IN_FRAMES; i++)
+   {
+      if (!(handle->in_frame_buf[i] = (uint8_t*)av_malloc(in_size)))
+         return false;
+      ff_queue_push(&handle->in_free, i);
+   }
+
+   for (i = 0; i < FFMPEG_OUT_FRAMES; i++)
+      ff_queue_push(&handle->out_free, i);
 
-   retro_assert(handle->lock && handle->cond_lock &&
-      handle->cond && handle->audio_fifo &&
-      handle->attr_fifo && handle->video_fifo && handle->thread);
+   handle->out_last         = FFMPEG_DUPE;
+   handle->stats.queue_size = FFMPEG_IN_FRAMES;
+   handle->drop_frames      =
+         handle->params.preset >= RECORD_CONFIG_TYPE_STREAMING_CUSTOM
+      || strstr(handle->params.filename, "://");
 
-   return true;
+   handle->alive         = true;
+   handle->scale_thread  = sthread_create(ffmpeg_scale_thread, handle);
+   handle->encode_thread = sthread_create(ffmpeg_encode_thread, handle);
+   if (handle->config.audio_enable)
+      handle->audio_thread = sthread_create(ffmpeg_audio_thread, handle);
+
+   return handle->scale_thread && handle->encode_thread
+      && (handle->audio_thread || !handle->config.audio_enable);
 }
 
 static void deinit_thread(ffmpeg_t *handle)
 {
-   if (!handle->thread)
+   if (!handle->lock)
       return;
 
-   slock_lock(handle->cond_lock);
+   slock_lock(handle->lock);
    handle->alive = false;
-   handle->can_sleep = false;
-   slock_unlock(handle->cond_lock);
-
-   scond_signal(handle->cond);
-   sthread_join(handle->thread);
-
-   slock_free(handle->lock);
-   slock_free(handle->cond_lock);
-   scond_free(handle->cond);
-
-   handle->thread = NULL;
+   slock_unlock(handle->lock);
+   scond_broadcast(handle->cond);
+
+   /* Each stage finishes the frame it is working on,
+    * ffmpeg_flush_buffers takes care of the rest. */
+   if (handle->scale_thread)
+      sthread_join(handle->scale_thread);
+   if (handle->encode_thread)
+      sthread_join(handle->encode_thread);
+   if (handle->audio_thread)
+      sthread_join(handle->audio_thread);
+
+   handle->scale_thread  = NULL;
+   handle->encode_thread = NULL;
+   handle->audio_thread  = NULL;
 }
 
 static void deinit_thread_buf(ffmpeg_t *handle)
 {
+   unsigned i;
+
    if (handle->audio_fifo)
    {
       fifo_free(handle->audio_fifo);
       handle->audio_fifo = NULL;
    }
 
-   if (handle->attr_fifo)
+   for (i = 0; i < FFMPEG_IN_FRAMES; i++)
    {
-      fifo_free(handle->attr_fifo);
-      handle->attr_fifo = NULL;
+      av_free(handle->in_frame_buf[i]);
+      handle->in_frame_buf[i] = NULL;
    }
 
-   if (handle->video_fifo)
-   {
-      fifo_free(handle->video_fifo);
-      handle->video_fifo = NULL;
-   }
+   if (handle->lock)
+      slock_free(handle->lock);
+   if (handle->mux_lock)
+      slock_free(handle->mux_lock);
+   if (handle->cond)
+      scond_free(handle->cond);
+
+   handle->lock     = NULL;
+   handle->mux_lock = NULL;
+   handle->cond     = NULL;
 }
 
 static void ffmpeg_free(void *data)
 {
+   unsigned i;
    ffmpeg_t *handle = (ffmpeg_t*)data;
    if (!handle)
       return;
@@ -953,8 +1053,11 @@ static void ffmpeg_free(void *data)
       av_free(handle->video.codec);
    }
 
-   av_frame_free(&handle->video.conv_frame);
-   av_free(handle->video.conv_frame_buf);
+   for (i = 0; i < FFMPEG_OUT_FRAMES; i++)
+   {
+      av_frame_free(&handle->video.conv_frame[i]);
+      av_free(handle->video.conv_frame_buf[i]);
+   }
 
    scaler_ctx_gen_reset(&handle->video.scaler);
 
@@ -982,6 +1085,7 @@ static void ffmpeg_free(void *data)
 #endif
    av_free(handle->muxer.ctx);
    av_packet_free(&handle->pkt);
+   av_packet_free(&handle->audio_pkt);
 
    free(handle);
 
@@ -1003,6 +1107,10 @@ static void *ffmpeg_new(const struct record_params *params)
 
    handle->params       = *params;
    handle->pkt          = av_packet_alloc();
+   handle->audio_pkt    = av_packet_alloc();
+
+   if (!handle->pkt || !handle->audio_pkt)
+      goto error;
 
    switch (params->preset)
    {
@@ -1054,10 +1162,11 @@ static bool ffmpeg_push_video(void *data,
       const struct record_video_data *vid)
 {
    unsigned y;
-   struct record_video_data attr_data;
-   bool drop_frame  = false;
-   ffmpeg_t *handle = (ffmpeg_t*)data;
-   int       offset = 0;
+   struct record_video_data *attr_data;
+   retro_time_t wait_start = 0;
+   int slot                = FFMPEG_DUPE;
+   bool drop_frame         = false;
+   ffmpeg_t *handle        = (ffmpeg_t*)data;
 
    if (!handle || !vid)
       return false;
@@ -1070,53 +1179,75 @@ static bool ffmpeg_push_video(void *data,
    if (drop_frame)
       return true;
 
+   slock_lock(handle->lock);
+   handle->stats.frames_pushed++;
+
    for (;;)
    {
-      unsigned avail;
-
-      slock_lock(handle->lock);
-      avail = FIFO_WRITE_AVAIL(handle->attr_fifo);
-      slock_unlock(handle->lock);
-
       if (!handle->alive)
+      {
+         slock_unlock(handle->lock);
          return false;
+      }
 
-      if (avail >= sizeof(*vid))
-         break;
+      if (!FF_QUEUE_FULL(&handle->in_ready))
+      {
+         if (vid->is_dupe)
+            break;
+
+         if (handle->in_free.count)
+         {
+            slot = ff_queue_pop(&handle->in_free);
+            break;
+         }
 
-      slock_lock(handle->cond_lock);
-      if (handle->can_sleep)
+         /* Repeat the last frame instead, keeps audio in sync. */
+         if (handle->drop_frames)
+         {
+            handle->stats.frames_dropped++;
+            break;
+         }
+      }
+
+      if (!wait_start)
       {
-         handle->can_sleep = false;
-         scond_wait(handle->cond, handle->cond_lock);
-         handle->can_sleep = true;
+         wait_start = cpu_features_get_time_usec();
+         handle->stats.stalls++;
       }
-      else
-         scond_signal(handle->cond);
 
-      slock_unlock(handle->cond_lock);
+      scond_wait(handle->cond, handle->lock);
    }
 
-   slock_lock(handle->lock);
+   if (wait_start)
+      handle->stats.stall_usec += cpu_features_get_time_usec() - wait_start;
+
+   if (slot == FFMPEG_DUPE)
+   {
+      ff_queue_push(&handle->in_ready, FFMPEG_DUPE);
+      slock_unlock(handle->lock);
+      scond_broadcast(handle->cond);
+      return true;
+   }
+
+   slock_unlock(handle->lock);
 
    /* Tightly pack our frame to conserve memory.
     * libretro tends to use a very large pitch.
+    * The slot is ours until it is queued.
     */
-   attr_data = *vid;
-
-   if (attr_data.is_dupe)
-      attr_data.width = attr_data.height = attr_data.pitch = 0;
-   else
-      attr_data.pitch = attr_data.width * handle->video.pix_size;
-
-   fifo_write(handle->attr_fifo, &attr_data, sizeof(attr_data));
+   attr_data        = &handle->in_frame[slot];
+   *attr_data       = *vid;
+   attr_data->pitch = attr_data->width * handle->video.pix_size;
+   attr_data->data  = handle->in_frame_buf[slot];
 
-   for (y = 0; y < attr_data.height; y++, offset += vid->pitch)
-      fifo_write(handle->video_fifo,
-            (const uint8_t*)vid->data + offset, attr_data.pitch);
+   for (y = 0; y < attr_data->height; y++)
+      memcpy(handle->in_frame_buf[slot] + y * attr_data->pitch,
+            (const uint8_t*)vid->data + y * vid->pitch, attr_data->pitch);
 
+   slock_lock(handle->lock);
+   ff_queue_push(&handle->in_ready, slot);
    slock_unlock(handle->lock);
-   scond_signal(handle->cond);
+   scond_broadcast(handle->cond);
 
    return true;
 }
@@ -1132,39 +1263,42 @@ static bool ffmpeg_push_audio(void *data,
    if (!handle->config.audio_enable)
       return true;
 
+   slock_lock(handle->lock);
+
    for (;;)
    {
-      unsigned avail;
-
-      slock_lock(handle->lock);
-      avail = FIFO_WRITE_AVAIL(handle->audio_fifo);
-      slock_unlock(handle->lock);
-
       if (!handle->alive)
+      {
+         slock_unlock(handle->lock);
          return false;
+      }
 
-      if (avail >= audio_data->frames * handle->params.channels
-            * sizeof(int16_t))
+      if (FIFO_WRITE_AVAIL(handle->audio_fifo) >= audio_data->frames
+            * handle->params.channels * sizeof(int16_t))
          break;
 
-      slock_lock(handle->cond_lock);
-      if (handle->can_sleep)
-      {
-         handle->can_sleep = false;
-         scond_wait(handle->cond, handle->cond_lock);
-         handle->can_sleep = true;
-      }
-      else
-         scond_signal(handle->cond);
-
-      slock_unlock(handle->cond_lock);
+      scond_wait(handle->cond, handle->lock);
    }
 
-   slock_lock(handle->lock);
    fifo_write(handle->audio_fifo, audio_data->data,
          audio_data->frames * handle->params.channels * sizeof(int16_t));
    slock_unlock(handle->lock);
-   scond_signal(handle->cond);
+   scond_broadcast(handle->cond);
+
+   return true;
+}
+
+static bool ffmpeg_get_stats(void *data, struct record_stats *stats)
+{
+   ffmpeg_t *handle = (ffmpeg_t*)data;
+
+   if (!handle || !handle->lock)
+      return false;
+
+   slock_lock(handle->lock);
+   *stats        = handle->stats;
+   stats->queued = FFMPEG_IN_FRAMES - handle->in_free.count;
+   slock_unlock(handle->lock);
 
    return true;
 }
@@ -1214,7 +1348,9 @@ static bool encode_video(ffmpeg_t *handle, AVFrame *frame)
 
       pkt->stream_index = handle->muxer.vstream->index;
 
+      slock_lock(handle->mux_lock);
       ret = av_interleaved_write_frame(handle->muxer.ctx, pkt);
+      slock_unlock(handle->mux_lock);
       if (ret < 0)
       {
 #ifdef __cplusplus
@@ -1231,7 +1367,7 @@ static bool encode_video(ffmpeg_t *handle, AVFrame *frame)
 }
 
 static void ffmpeg_scale_input(ffmpeg_t *handle,
-      const struct record_video_data *vid)
+      const struct record_video_data *vid, AVFrame *out)
 {
    /* Attempt to preserve more information if we scale down. */
    bool shrunk = handle->params.out_width < vid->width
@@ -1248,38 +1384,58 @@ static void ffmpeg_scale_input(ffmpeg_t *handle,
             shrunk ? SWS_BILINEAR : SWS_POINT, NULL, NULL, NULL);
 
       sws_scale(handle->video.sws, (const uint8_t* const*)&vid->data,
-            &linesize, 0, vid->height, handle->video.conv_frame->data,
-            handle->video.conv_frame->linesize);
+            &linesize, 0, vid->height, out->data, out->linesize);
    }
    else
       video_frame_record_scale(
             &handle->video.scaler,
-            handle->video.conv_frame->data[0],
+            out->data[0],
             vid->data,
             handle->params.out_width,
             handle->params.out_height,
-            handle->video.conv_frame->linesize[0],
+            out->linesize[0],
             vid->width,
             vid->height,
             vid->pitch,
             shrunk);
 }
 
-static bool ffmpeg_push_video_thread(ffmpeg_t *handle,
-      const struct record_video_data *vid)
+static bool ffmpeg_push_video_thread(ffmpeg_t *handle, AVFrame *frame)
 {
-   if (!vid->is_dupe)
-      ffmpeg_scale_input(handle, vid);
-
-   handle->video.conv_frame->pts = handle->video.frame_cnt;
+   frame->pts = handle->video.frame_cnt;
 
-   if (!encode_video(handle, handle->video.conv_frame))
+   if (!encode_video(handle, frame))
       return false;
 
    handle->video.frame_cnt++;
    return true;
 }
 
+/* Encodes one entry of out_ready. The encoder copies frames it
+ * keeps, so the previous frame can go back to the pool. */
+static void ffmpeg_encode_video_slot(ffmpeg_t *handle, int slot)
+{
+   int frame_slot     = (slot == FFMPEG_DUPE) ? handle->out_last : slot;
+   retro_time_t start = cpu_features_get_time_usec();
+
+   if (frame_slot != FFMPEG_DUPE)
+      ffmpeg_push_video_thread(handle, handle->video.conv_frame[frame_slot]);
+   else /* Nothing to repeat yet */
+      handle->video.frame_cnt++;
+
+   slock_lock(handle->lock);
+   if (slot != FFMPEG_DUPE)
+   {
+      if (handle->out_last != FFMPEG_DUPE)
+         ff_queue_push(&handle->out_free, handle->out_last);
+      handle->out_last = slot;
+   }
+   handle->stats.frames_encoded++;
+   handle->stats.encode_usec += cpu_features_get_time_usec() - start;
+   slock_unlock(handle->lock);
+   scond_broadcast(handle->cond);
+}
+
 static void planarize_float(float *out, const float *in, size_t frames)
 {
    size_t i;
@@ -1335,7 +1491,7 @@ static bool encode_audio(ffmpeg_t *handle, bool dry)
    int samples_size;
    int ret;
 
-   pkt = handle->pkt;
+   pkt = handle->audio_pkt;
 
    pkt->data = handle->audio.outbuf;
    pkt->size = handle->audio.outbuf_size;
@@ -1405,7 +1561,9 @@ static bool encode_audio(ffmpeg_t *handle, bool dry)
 
       pkt->stream_index = handle->muxer.astream->index;
 
+      slock_lock(handle->mux_lock);
       ret = av_interleaved_write_frame(handle->muxer.ctx, pkt);
+      slock_unlock(handle->mux_lock);
       if (ret < 0)
       {
          av_frame_free(&frame);
@@ -1561,62 +1719,57 @@ static void ffmpeg_flush_video(ffmpeg_t *handle)
 
 }
 
+/* Runs once the threads are gone, so nothing else
+ * touches the queues anymore. */
 static void ffmpeg_flush_buffers(ffmpeg_t *handle)
 {
    void *audio_buf       = NULL;
-   bool did_work         = false;
-   void *video_buf       = av_malloc(2 * handle->params.fb_width *
-         handle->params.fb_height * handle->video.pix_size);
    size_t audio_buf_size = handle->config.audio_enable ?
       (handle->audio.codec->frame_size *
        handle->params.channels * sizeof(int16_t)) : 0;
 
    if (audio_buf_size)
       audio_buf = av_malloc(audio_buf_size);
-   /* Try pushing data in an interleaving pattern to
-    * ease the work of the muxer a bit. */
 
-   do
-   {
-      struct record_video_data attr_buf;
+   /* Scaled frames first, they are older. */
+   while (handle->out_ready.count)
+      ffmpeg_encode_video_slot(handle, ff_queue_pop(&handle->out_ready));
 
-      did_work = false;
+   while (handle->in_ready.count)
+   {
+      int in_slot  = ff_queue_pop(&handle->in_ready);
+      int out_slot = FFMPEG_DUPE;
 
-      if (handle->config.audio_enable)
+      if (in_slot != FFMPEG_DUPE)
       {
-         if (FIFO_READ_AVAIL(handle->audio_fifo) >= audio_buf_size)
-         {
-            struct record_audio_data aud = {0};
-
-            fifo_read(handle->audio_fifo, audio_buf, audio_buf_size);
-            aud.frames = handle->audio.codec->frame_size;
-            aud.data   = audio_buf;
-            ffmpeg_push_audio_thread(handle, &aud, true);
-
-            did_work = true;
-         }
+         out_slot = ff_queue_pop(&handle->out_free);
+         ffmpeg_scale_input(handle, &handle->in_frame[in_slot],
+               handle->video.conv_frame[out_slot]);
+         ff_queue_push(&handle->in_free, in_slot);
       }
 
-      if (FIFO_READ_AVAIL(handle->attr_fifo) >= sizeof(attr_buf))
+      ffmpeg_encode_video_slot(handle, out_slot);
+   }
+
+   if (handle->config.audio_enable && audio_buf)
+   {
+      while (FIFO_READ_AVAIL(handle->audio_fifo) >= audio_buf_size)
       {
-         fifo_read(handle->attr_fifo, &attr_buf, sizeof(attr_buf));
-         fifo_read(handle->video_fifo, video_buf,
-               attr_buf.height * attr_buf.pitch);
-         attr_buf.data = video_buf;
-         ffmpeg_push_video_thread(handle, &attr_buf);
+         struct record_audio_data aud = {0};
 
-         did_work = true;
+         fifo_read(handle->audio_fifo, audio_buf, audio_buf_size);
+         aud.frames = handle->audio.codec->frame_size;
+         aud.data   = audio_buf;
+         ffmpeg_push_audio_thread(handle, &aud, true);
       }
-   }while (did_work);
 
-   /* Flush out last audio. */
-   if (handle->config.audio_enable)
+      /* Flush out last audio. */
       ffmpeg_flush_audio(handle, audio_buf, audio_buf_size);
+   }
 
    /* Flush out last video. */
    ffmpeg_flush_video(handle);
 
-   av_free(video_buf);
    av_free(audio_buf);
 }
 
@@ -1641,83 +1794,117 @@ static bool ffmpeg_finalize(void *data)
    return true;
 }
 
-static void ffmpeg_thread(void *data)
+static bool ffmpeg_can_scale(ffmpeg_t *ff)
 {
-   size_t audio_buf_size;
-   void *audio_buf = NULL;
-   ffmpeg_t *ff    = (ffmpeg_t*)data;
-   /* For some reason, FFmpeg has a tendency to crash
-    * if we don't overallocate a bit. */
-   void *video_buf = av_malloc(2 * ff->params.fb_width *
-         ff->params.fb_height * ff->video.pix_size);
+   if (!ff->in_ready.count || FF_QUEUE_FULL(&ff->out_ready))
+      return false;
+   /* Duplicates don't need a frame to scale into. */
+   return ff->out_free.count
+      || ff->in_ready.slots[ff->in_ready.head] == FFMPEG_DUPE;
+}
 
-   retro_assert(video_buf);
+static void ffmpeg_scale_thread(void *data)
+{
+   ffmpeg_t *ff = (ffmpeg_t*)data;
 
-   audio_buf_size = ff->config.audio_enable ?
-      (ff->audio.codec->frame_size * ff->params.channels * sizeof(int16_t)) : 0;
-   audio_buf      = audio_buf_size ? av_malloc(audio_buf_size) : NULL;
+   slock_lock(ff->lock);
 
-   while (ff->alive)
+   for (;;)
    {
-      struct record_video_data attr_buf;
+      int in_slot;
+      int out_slot = FFMPEG_DUPE;
 
-      bool avail_video = false;
-      bool avail_audio = false;
+      while (ff->alive && !ffmpeg_can_scale(ff))
+         scond_wait(ff->cond, ff->lock);
 
-      slock_lock(ff->lock);
-      if (FIFO_READ_AVAIL(ff->attr_fifo) >= sizeof(attr_buf))
-         avail_video = true;
+      if (!ff->alive)
+         break;
 
-      if (ff->config.audio_enable)
-         if (FIFO_READ_AVAIL(ff->audio_fifo) >= audio_buf_size)
-            avail_audio = true;
-      slock_unlock(ff->lock);
+      in_slot = ff_queue_pop(&ff->in_ready);
 
-      if (!avail_video && !avail_audio)
+      if (in_slot != FFMPEG_DUPE)
       {
-         slock_lock(ff->cond_lock);
-         if (ff->can_sleep)
-         {
-            ff->can_sleep = false;
-            scond_wait(ff->cond, ff->cond_lock);
-            ff->can_sleep = true;
-         }
-         else
-            scond_signal(ff->cond);
+         out_slot = ff_queue_pop(&ff->out_free);
+         slock_unlock(ff->lock);
 
-         slock_unlock(ff->cond_lock);
-      }
+         ffmpeg_scale_input(ff, &ff->in_frame[in_slot],
+               ff->video.conv_frame[out_slot]);
 
-      if (avail_video && video_buf)
-      {
          slock_lock(ff->lock);
-         fifo_read(ff->attr_fifo, &attr_buf, sizeof(attr_buf));
-         fifo_read(ff->video_fifo, video_buf,
-               attr_buf.height * attr_buf.pitch);
-         slock_unlock(ff->lock);
-         scond_signal(ff->cond);
-
-         attr_buf.data = video_buf;
-         ffmpeg_push_video_thread(ff, &attr_buf);
+         ff_queue_push(&ff->in_free, in_slot);
       }
 
-      if (avail_audio && audio_buf)
-      {
-         struct record_audio_data aud = {0};
+      ff_queue_push(&ff->out_ready, out_slot);
+      scond_broadcast(ff->cond);
+   }
 
-         slock_lock(ff->lock);
-         fifo_read(ff->audio_fifo, audio_buf, audio_buf_size);
-         slock_unlock(ff->lock);
-         scond_signal(ff->cond);
+   slock_unlock(ff->lock);
+}
 
-         aud.frames = ff->audio.codec->frame_size;
-         aud.data   = audio_buf;
+static void ffmpeg_encode_thread(void *data)
+{
+   ffmpeg_t *ff = (ffmpeg_t*)data;
 
-         ffmpeg_push_audio_thread(ff, &aud, true);
-      }
+   slock_lock(ff->lock);
+
+   for (;;)
+   {
+      int slot;
+
+      while (ff->alive && !ff->out_ready.count)
+         scond_wait(ff->cond, ff->lock);
+
+      if (!ff->alive)
+         break;
+
+      slot = ff_queue_pop(&ff->out_ready);
+      slock_unlock(ff->lock);
+
+      ffmpeg_encode_video_slot(ff, slot);
+
+      slock_lock(ff->lock);
+   }
+
+   slock_unlock(ff->lock);
+}
+
+static void ffmpeg_audio_thread(void *data)
+{
+   ffmpeg_t *ff          = (ffmpeg_t*)data;
+   size_t audio_buf_size = ff->audio.codec->frame_size
+      * ff->params.channels * sizeof(int16_t);
+   void *audio_buf       = av_malloc(audio_buf_size);
+
+   retro_assert(audio_buf);
+
+   slock_lock(ff->lock);
+
+   for (;;)
+   {
+      struct record_audio_data aud = {0};
+
+      while (ff->alive
+            && FIFO_READ_AVAIL(ff->audio_fifo) < audio_buf_size)
+         scond_wait(ff->cond, ff->lock);
+
+      if (!ff->alive)
+         break;
+
+      fifo_read(ff->audio_fifo, audio_buf, audio_buf_size);
+      slock_unlock(ff->lock);
+      scond_broadcast(ff->cond);
+
+      aud.frames = ff->audio.codec->frame_size;
+      aud.data   = audio_buf;
+
+      /* Resampling, planarization and encoding */
+      ffmpeg_push_audio_thread(ff, &aud, true);
+
+      slock_lock(ff->lock);
    }
 
-   av_free(video_buf);
+   slock_unlock(ff->lock);
+
    av_free(audio_buf);
 }
 
@@ -1727,5 +1914,6 @@ const record_driver_t record_ffmpeg = {
    ffmpeg_push_video,
    ffmpeg_push_audio,
    ffmpeg_finalize,
+   ffmpeg_get_stats,
    "ffmpeg",
 };
@@ -0,0 +1,427 @@
+/*  RetroArch - A frontend for libretro.
+ *  Copyright (C) 2010-2014 - Hans-Kristian Arntzen
+ *  Copyright (C) 2011-2021 - Daniel De Matteis
+ *
+ *  RetroArch is free software: you can redistribute it and/or modify it under the terms
+ *  of the GNU General Public License as published by the Free Software Found-
+ *  ation, either version 3 of the License, or (at your option) any later version.
+ *
+ *  RetroArch is distributed in the hope that it will be useful, but WITHOUT ANY WARRANTY;
+ *  without even the implied warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR
+ *  PURPOSE.  See the GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License along with RetroArch.
+ *  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+/* Lossless capture without an encoder. Frames are delta coded
+ * against the previous one and packed with LZ4 on the calling
+ * thread, audio is stored as is. Selected by recording to a file
+ * with the .rcap extension, tools/rcap2raw turns the result into
+ * raw video and audio for ffmpeg. */
+
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include <boolean.h>
+#include <retro_endianness.h>
+#include <features/features_cpu.h>
+#include <file/file_path.h>
+#include <streams/file_stream.h>
+#include <streams/trans_stream.h>
+#include <string/stdstring.h>
+
+#include "../record_driver.h"
+#include "../../verbosity.h"
+
+#include "record_rcap.h"
+
+struct rcap_index_entry
+{
+   uint64_t offset;
+   uint32_t frame;
+};
+
+typedef struct rcap
+{
+   RFILE *file;
+   const struct trans_stream_backend *backend;
+   void *stream;
+   /* Packed current frame, then its delta */
+   uint8_t *frame;
+   /* Packed previous frame */
+   uint8_t *prev;
+   /* Chunk header followed by the compressed frame */
+   uint8_t *packed;
+   struct rcap_index_entry *index;
+   struct record_params params;
+   struct record_stats stats;
+   size_t frame_size;
+   size_t packed_size;
+   size_t index_count;
+   size_t index_cap;
+   unsigned pix_size;
+   unsigned width;
+   unsigned height;
+   unsigned since_key;
+   uint32_t frame_count;
+   bool has_prev;
+   bool failed;
+} rcap_t;
+
+static void rcap_put32(uint8_t *p, uint32_t v)
+{
+   v = swap_if_big32(v);
+   memcpy(p, &v, sizeof(v));
+}
+
+static void rcap_put64(uint8_t *p, uint64_t v)
+{
+   v = swap_if_big64(v);
+   memcpy(p, &v, sizeof(v));
+}
+
+static bool rcap_write(rcap_t *handle, const void *data, size_t len)
+{
+   if (handle->failed)
+      return false;
+   if (filestream_write(handle->file, data, len) != (int64_t)len)
+   {
+      RARCH_ERR("[RCAP]: Failed to write capture, stopping.\n");
+      handle->failed = true;
+      return false;
+   }
+   return true;
+}
+
+static bool rcap_write_header(rcap_t *handle, uint64_t index_offset)
+{
+   uint8_t hdr[RCAP_HEADER_SIZE];
+   uint32_t flags = is_little_endian() ? 0 : RCAP_FLAG_BIG_ENDIAN;
+
+   rcap_put32(hdr +  0, RCAP_MAGIC);
+   rcap_put32(hdr +  4, RCAP_VERSION);
+   rcap_put32(hdr +  8, flags);
+   rcap_put32(hdr + 12, handle->params.pix_fmt);
+   rcap_put32(hdr + 16, handle->params.fb_width);
+   rcap_put32(hdr + 20, handle->params.fb_height);
+   rcap_put32(hdr + 24, handle->params.channels);
+   rcap_put32(hdr + 28, RCAP_KEYFRAME_INTERVAL);
+   rcap_put64(hdr + 32, (uint64_t)(handle->params.fps * 1000000.0));
+   rcap_put64(hdr + 40, (uint64_t)(handle->params.samplerate * 1000000.0));
+   rcap_put64(hdr + 48, index_offset);
+   rcap_put64(hdr + 56, handle->frame_count);
+
+   return rcap_write(handle, hdr, sizeof(hdr));
+}
+
+static bool rcap_add_index(rcap_t *handle, uint64_t offset)
+{
+   if (handle->index_count == handle->index_cap)
+   {
+      size_t cap = handle->index_cap ? handle->index_cap * 2 : 256;
+      struct rcap_index_entry *index = (struct rcap_index_entry*)
+         realloc(handle->index, cap * sizeof(*index));
+      if (!index)
+         return false;
+      handle->index     = index;
+      handle->index_cap = cap;
+   }
+
+   handle->index[handle->index_count].offset = offset;
+   handle->index[handle->index_count].frame  = handle->frame_count;
+   handle->index_count++;
+   return true;
+}
+
+/* Replaces 'cur' with cur ^ prev and 'prev' with cur */
+static void rcap_delta(uint8_t *cur, uint8_t *prev, size_t len)
+{
+   size_t i;
+   size_t words = len / sizeof(size_t);
+
+   for (i = 0; i < words; i++)
+   {
+      size_t c, p;
+      memcpy(&c, cur  + i * sizeof(size_t), sizeof(c));
+      memcpy(&p, prev + i * sizeof(size_t), sizeof(p));
+      p ^= c;
+      memcpy(cur  + i * sizeof(size_t), &p, sizeof(p));
+      memcpy(prev + i * sizeof(size_t), &c, sizeof(c));
+   }
+
+   for (i = words * sizeof(size_t); i < len; i++)
+   {
+      uint8_t c = cur[i];
+      cur[i]   ^= prev[i];
+      prev[i]   = c;
+   }
+}
+
+static void rcap_free(void *data)
+{
+   rcap_t *handle = (rcap_t*)data;
+   if (!handle)
+      return;
+
+   if (handle->file)
+      filestream_close(handle->file);
+   if (handle->stream)
+      handle->backend->stream_free(handle->stream);
+   free(handle->frame);
+   free(handle->prev);
+   free(handle->packed);
+   free(handle->index);
+   free(handle);
+}
+
+static void *rcap_init(const struct record_params *params)
+{
+   rcap_t *handle = NULL;
+
+   if (!string_is_equal_noncase(
+            path_get_extension(params->filename), "rcap"))
+      return NULL;
+
+   if (!(handle = (rcap_t*)calloc(1, sizeof(*handle))))
+      return NULL;
+
+   handle->params = *params;
+   /* Not needed past init */
+   handle->params.filename        = NULL;
+   handle->params.config          = NULL;
+   handle->params.audio_resampler = NULL;
+
+   switch (params->pix_fmt)
+   {
+      case FFEMU_PIX_RGB565:
+         handle->pix_size = 2;
+         break;
+      case FFEMU_PIX_BGR24:
+         handle->pix_size = 3;
+         break;
+      case FFEMU_PIX_ARGB8888:
+      default:
+         handle->pix_size = 4;
+         break;
+   }
+
+   handle->frame_size  = (size_t)params->fb_width
+      * params->fb_height * handle->pix_size;
+   /* Worst case LZ4 expansion, plus a block header per 256 KiB */
+   handle->packed_size = RCAP_CHUNK_HEADER_SIZE + RCAP_VIDEO_HEADER_SIZE
+      + handle->frame_size + handle->frame_size / 255
+      + (handle->frame_size / (256 * 1024) + 2) * 32;
+   handle->backend     = trans_stream_get_lz4_compress_backend();
+
+   if (     !handle->frame_size
+         || !handle->backend
+         || !(handle->stream = handle->backend->stream_new())
+         || !(handle->frame  = (uint8_t*)malloc(handle->frame_size))
+         || !(handle->prev   = (uint8_t*)malloc(handle->frame_size))
+         || !(handle->packed = (uint8_t*)malloc(handle->packed_size)))
+      goto error;
+
+   if (!(handle->file = filestream_open(params->filename,
+               RETRO_VFS_FILE_ACCESS_WRITE,
+               RETRO_VFS_FILE_ACCESS_HINT_NONE)))
+   {
+      RARCH_ERR("[RCAP]: Failed to open \"%s\".\n", params->filename);
+      goto error;
+   }
+
+   if (!rcap_write_header(handle, 0))
+      goto error;
+
+   RARCH_LOG("[RCAP]: Capturing %ux%u, %u bytes per pixel.\n",
+         params->fb_width, params->fb_height, handle->pix_size);
+
+   return handle;
+
+error:
+   rcap_free(handle);
+   return NULL;
+}
+
+static bool rcap_push_video(void *data,
+      const struct record_video_data *vid)
+{
+   unsigned y;
+   uint32_t rd = 0, wn = 0;
+   uint32_t flags          = 0;
+   size_t row, len;
+   uint8_t *out;
+   retro_time_t start;
+   rcap_t *handle          = (rcap_t*)data;
+   const uint8_t *src      = (const uint8_t*)vid->data;
+
+   if (!handle || handle->failed)
+      return false;
+
+   handle->stats.frames_pushed++;
+   start = cpu_features_get_time_usec();
+   out   = handle->packed;
+
+   if (vid->is_dupe || !vid->data)
+   {
+      if (!handle->has_prev)
+         return true;
+
+      rcap_put32(out +  0, RCAP_CHUNK_VIDEO);
+      rcap_put32(out +  4, RCAP_VIDEO_HEADER_SIZE);
+      rcap_put32(out +  8, handle->frame_count);
+      rcap_put32(out + 12, handle->width);
+      rcap_put32(out + 16, handle->height);
+      rcap_put32(out + 20, RCAP_VIDEO_DUPE);
+      if (!rcap_write(handle, out,
+               RCAP_CHUNK_HEADER_SIZE + RCAP_VIDEO_HEADER_SIZE))
+         return false;
+      goto end;
+   }
+
+   row = (size_t)vid->width * handle->pix_size;
+   len = row * vid->height;
+   if (!len || len > handle->frame_size)
+      return false;
+
+   for (y = 0; y < vid->height; y++)
+      memcpy(handle->frame + y * row, src + (int)y * vid->pitch, row);
+
+   if (     !handle->has_prev
+         || vid->width  != handle->width
+         || vid->height != handle->height
+         || handle->since_key >= RCAP_KEYFRAME_INTERVAL)
+   {
+      uint8_t *tmp;
+
+      flags = RCAP_VIDEO_KEY;
+      if (!rcap_add_index(handle, filestream_tell(handle->file)))
+         return false;
+
+      /* The raw frame becomes the reference for the next one */
+      tmp               = handle->prev;
+      handle->prev      = handle->frame;
+      handle->frame     = tmp;
+      handle->since_key = 0;
+      src               = handle->prev;
+   }
+   else
+   {
+      rcap_delta(handle->frame, handle->prev, len);
+      src               = handle->frame;
+   }
+
+   handle->backend->set_in(handle->stream, src, (uint32_t)len);
+   handle->backend->set_out(handle->stream,
+         out + RCAP_CHUNK_HEADER_SIZE + RCAP_VIDEO_HEADER_SIZE,
+         (uint32_t)(handle->packed_size
+            - RCAP_CHUNK_HEADER_SIZE - RCAP_VIDEO_HEADER_SIZE));
+   if (     !handle->backend->trans(handle->stream, true, &rd, &wn, NULL)
+         || rd != len)
+   {
+      RARCH_ERR("[RCAP]: Failed to compress frame.\n");
+      handle->failed = true;
+      return false;
+   }
+
+   rcap_put32(out +  0, RCAP_CHUNK_VIDEO);
+   rcap_put32(out +  4, RCAP_VIDEO_HEADER_SIZE + wn);
+   rcap_put32(out +  8, handle->frame_count);
+   rcap_put32(out + 12, vid->width);
+   rcap_put32(out + 16, vid->height);
+   rcap_put32(out + 20, flags);
+   if (!rcap_write(handle, out,
+            RCAP_CHUNK_HEADER_SIZE + RCAP_VIDEO_HEADER_SIZE + wn))
+      return false;
+
+   handle->width     = vid->width;
+   handle->height    = vid->height;
+   handle->has_prev  = true;
+   handle->since_key++;
+
+end:
+   handle->frame_count++;
+   handle->stats.frames_encoded++;
+   handle->stats.encode_usec += cpu_features_get_time_usec() - start;
+   return true;
+}
+
+static bool rcap_push_audio(void *data,
+      const struct record_audio_data *aud)
+{
+   uint8_t hdr[RCAP_CHUNK_HEADER_SIZE];
+   rcap_t *handle = (rcap_t*)data;
+   size_t len;
+
+   if (!handle || handle->failed)
+      return false;
+
+   len = aud->frames * handle->params.channels * sizeof(int16_t);
+   if (!len)
+      return true;
+
+   rcap_put32(hdr + 0, RCAP_CHUNK_AUDIO);
+   rcap_put32(hdr + 4, (uint32_t)len);
+   return rcap_write(handle, hdr, sizeof(hdr))
+      && rcap_write(handle, aud->data, len);
+}
+
+static bool rcap_finalize(void *data)
+{
+   size_t i;
+   int64_t offset;
+   uint8_t tmp[RCAP_INDEX_ENTRY_SIZE];
+   rcap_t *handle = (rcap_t*)data;
+
+   if (!handle || handle->failed)
+      return false;
+
+   offset = filestream_tell(handle->file);
+
+   rcap_put32(tmp + 0, RCAP_CHUNK_INDEX);
+   rcap_put32(tmp + 4, (uint32_t)(handle->index_count
+            * RCAP_INDEX_ENTRY_SIZE));
+   if (!rcap_write(handle, tmp, RCAP_CHUNK_HEADER_SIZE))
+      return false;
+
+   for (i = 0; i < handle->index_count; i++)
+   {
+      rcap_put32(tmp + 0, handle->index[i].frame);
+      rcap_put32(tmp + 4, 0);
+      rcap_put64(tmp + 8, handle->index[i].offset);
+      if (!rcap_write(handle, tmp, RCAP_INDEX_ENTRY_SIZE))
+         return false;
+   }
+
+   /* Patch the index offset and frame count into the header */
+   filestream_seek(handle->file, 48, RETRO_VFS_SEEK_POSITION_START);
+   rcap_put64(tmp + 0, (uint64_t)offset);
+   rcap_put64(tmp + 8, handle->frame_count);
+   if (!rcap_write(handle, tmp, 16))
+      return false;
+   filestream_seek(handle->file, 0, RETRO_VFS_SEEK_POSITION_END);
+
+   RARCH_LOG("[RCAP]: Wrote %u frames, %u keyframes.\n",
+         handle->frame_count, (unsigned)handle->index_count);
+   return true;
+}
+
+static bool rcap_get_stats(void *data, struct record_stats *stats)
+{
+   rcap_t *handle = (rcap_t*)data;
+   if (!handle)
+      return false;
+   *stats = handle->stats;
+   return true;
+}
+
+const record_driver_t record_rcap = {
+   rcap_init,
+   rcap_free,
+   rcap_push_video,
+   rcap_push_audio,
+   rcap_finalize,
+   rcap_get_stats,
+   "rcap",
+};
@@ -0,0 +1,70 @@
+/*  RetroArch - A frontend for libretro.
+ *  Copyright (C) 2010-2014 - Hans-Kristian Arntzen
+ *  Copyright (C) 2011-2021 - Daniel De Matteis
+ *
+ *  RetroArch is free software: you can redistribute it and/or modify it under the terms
+ *  of the GNU General Public License as published by the Free Software Found-
+ *  ation, either version 3 of the License, or (at your option) any later version.
+ *
+ *  RetroArch is distributed in the hope that it will be useful, but WITHOUT ANY WARRANTY;
+ *  without even the implied warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR
+ *  PURPOSE.  See the GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License along with RetroArch.
+ *  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef _RECORD_RCAP_H
+#define _RECORD_RCAP_H
+
+/* RCAP: lossless capture, cheap enough to record without a GPU
+ * encoder and converted offline (see tools/rcap2raw).
+ *
+ * Header fields and chunk headers are little-endian. Pixels and
+ * samples are stored in the byte order of the recording machine,
+ * RCAP_FLAG_BIG_ENDIAN is set if that is big-endian.
+ *
+ * Header, RCAP_HEADER_SIZE bytes:
+ *    uint32 magic, uint32 version, uint32 flags,
+ *    uint32 pixel format (enum ffemu_pix_format),
+ *    uint32 max width, uint32 max height,
+ *    uint32 audio channels, uint32 keyframe interval,
+ *    uint64 fps and uint64 sample rate, both times 1000000,
+ *    uint64 offset of the index chunk, 0 if the capture was cut short,
+ *    uint64 number of video frames
+ *
+ * Followed by chunks, uint32 type + uint32 payload size + payload:
+ *
+ * RCAP_CHUNK_VIDEO:
+ *    uint32 frame number, uint32 width, uint32 height, uint32 flags,
+ *    then the rows, packed without padding, as an LZ4 trans_stream.
+ *    Delta frames hold the XOR against the previous frame, which is
+ *    mostly zeroes for typical content. RCAP_VIDEO_DUPE frames repeat
+ *    the previous frame and have no data.
+ * RCAP_CHUNK_AUDIO:
+ *    interleaved int16 PCM.
+ * RCAP_CHUNK_INDEX:
+ *    uint32 frame number + uint32 reserved + uint64 chunk offset
+ *    for every keyframe.
+ */
+
+#define RCAP_MAGIC                 0x50414352 /* "RCAP" */
+#define RCAP_VERSION               1
+#define RCAP_HEADER_SIZE           64
+#define RCAP_CHUNK_HEADER_SIZE     8
+#define RCAP_VIDEO_HEADER_SIZE     16
+#define RCAP_INDEX_ENTRY_SIZE      16
+
+/* Every 2 seconds at 60 fps */
+#define RCAP_KEYFRAME_INTERVAL     120
+
+#define RCAP_FLAG_BIG_ENDIAN       (1 << 0)
+
+#define RCAP_CHUNK_VIDEO           1
+#define RCAP_CHUNK_AUDIO           2
+#define RCAP_CHUNK_INDEX           3
+
+#define RCAP_VIDEO_KEY             (1 << 0)
+#define RCAP_VIDEO_DUPE            (1 << 1)
+
+#endif
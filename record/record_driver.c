@@ -39,10 +39,13 @@ static const record_driver_t record_null = {
    NULL, /* push_video */
    NULL, /* push_audio */
    NULL, /* finalize */
+   NULL, /* get_stats */
    "null",
 };
 
 const record_driver_t *record_drivers[] = {
+   /* Only takes .rcap files, so it has to come before ffmpeg */
+   &record_rcap,
 #ifdef HAVE_FFMPEG
    &record_ffmpeg,
 #endif
@@ -188,6 +191,23 @@ bool recording_deinit(void)
    return true;
 }
 
+/**
+ * recording_driver_get_stats:
+ * @stats                   : Filled in on success.
+ *
+ * Returns: true if recording and the driver keeps statistics,
+ * otherwise false.
+ **/
+bool recording_driver_get_stats(struct record_stats *stats)
+{
+   recording_state_t *recording_st = &recording_state;
+   if (     !recording_st->data
+         || !recording_st->driver
+         || !recording_st->driver->get_stats)
+      return false;
+   return recording_st->driver->get_stats(recording_st->data, stats);
+}
+
 void streaming_set_state(bool state)
 {
    recording_state_t *recording_st = &recording_state;
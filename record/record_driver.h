@@ -1,6 +1,7 @@
 #ifndef _RECORD_DRIVER_H
 #define _RECORD_DRIVER_H
 
+#include <stdint.h>
 #include <boolean.h>
 
 enum ffemu_pix_format
@@ -97,6 +98,24 @@ struct record_audio_data
    size_t frames;
 };
 
+struct record_stats
+{
+   /* Time push_video spent waiting for the encoder. */
+   uint64_t stall_usec;
+   /* Time spent encoding the frames_encoded video frames. */
+   uint64_t encode_usec;
+   unsigned frames_pushed;
+   unsigned frames_encoded;
+   /* Frames replaced by a duplicate of the previous one
+    * because the encoder fell behind. */
+   unsigned frames_dropped;
+   /* How many times push_video had to wait. */
+   unsigned stalls;
+   /* Frames waiting in the queue, and its size. */
+   unsigned queued;
+   unsigned queue_size;
+};
+
 typedef struct record_driver
 {
    void *(*init)(const struct record_params *params);
@@ -106,6 +125,8 @@ typedef struct record_driver
    bool  (*push_audio)(void *data,
          const struct record_audio_data *audio_data);
    bool  (*finalize)(void *data);
+   /* Optional. */
+   bool  (*get_stats)(void *data, struct record_stats *stats);
    const char *ident;
 } record_driver_t;
 
@@ -134,6 +155,7 @@ struct recording
 typedef struct recording recording_state_t;
 
 extern const record_driver_t record_ffmpeg;
+extern const record_driver_t record_rcap;
 
 /**
  * config_get_record_driver_options:
@@ -148,6 +170,8 @@ void recording_driver_update_streaming_url(void);
 
 bool recording_deinit(void);
 
+bool recording_driver_get_stats(struct record_stats *stats);
+
 /**
  * recording_init:
  *
@@ -81,6 +81,9 @@
 #include <compat/getopt.h>
 #include <compat/posix_string.h>
 #include <file/file_path.h>
+#ifdef HAVE_COMPRESSION
+#include <file/archive_file.h>
+#endif
 #include <retro_assert.h>
 #include <retro_miscellaneous.h>
 #include <lists/dir_list.h>
@@ -276,6 +279,8 @@ enum
    RA_OPT_FEATURES,
    RA_OPT_VERSION,
    RA_OPT_EOF_EXIT,
+   RA_OPT_BSV_SEEK,
+   RA_OPT_BSV_VERIFY,
    RA_OPT_LOG_FILE,
    RA_OPT_MAX_FRAMES,
    RA_OPT_MAX_FRAMES_SCREENSHOT,
@@ -3739,6 +3744,10 @@ void main_exit(void *args)
    frontend_driver_free();
 
    rtime_deinit();
+   content_save_state_deinit();
+#ifdef HAVE_COMPRESSION
+   file_archive_cache_deinit();
+#endif
 
 #if defined(ANDROID)
    play_feature_delivery_deinit();
@@ -3791,6 +3800,10 @@ int rarch_main(int argc, char *argv[], void *data)
 #endif
 
    rtime_init();
+   content_save_state_init();
+#ifdef HAVE_COMPRESSION
+   file_archive_cache_init();
+#endif
 
 #if defined(ANDROID)
    play_feature_delivery_init();
@@ -4273,6 +4286,10 @@ static void retroarch_print_help(const char *arg0)
          "Start recording a BSV movie file from the beginning.\n"
          "      --eof-exit                 "
          "Exit upon reaching the end of the BSV movie file.\n"
+         "      --bsvseek=FRAME            "
+         "Start BSV playback from the last keyframe before FRAME.\n"
+         "      --bsvverify                "
+         "Check the core state against the keyframes of the BSV movie.\n"
          , sizeof(buf));
 #endif
 
@@ -4554,6 +4571,8 @@ static bool retroarch_parse_input_and_config(
       { "max-frames-ss",      0, NULL, RA_OPT_MAX_FRAMES_SCREENSHOT },
       { "max-frames-ss-path", 1, NULL, RA_OPT_MAX_FRAMES_SCREENSHOT_PATH },
       { "eof-exit",           0, NULL, RA_OPT_EOF_EXIT },
+      { "bsvseek",            1, NULL, RA_OPT_BSV_SEEK },
+      { "bsvverify",          0, NULL, RA_OPT_BSV_VERIFY },
       { "version",            0, NULL, RA_OPT_VERSION },
       { "log-file",           1, NULL, RA_OPT_LOG_FILE },
       { "accessibility",      0, NULL, RA_OPT_ACCESSIBILITY},
@@ -5057,6 +5076,25 @@ static bool retroarch_parse_input_and_config(
 #endif
                break;
 
+            case RA_OPT_BSV_SEEK:
+#ifdef HAVE_BSV_MOVIE
+               {
+                  input_driver_state_t *input_st = input_state_get_ptr();
+                  input_st->bsv_movie_state.movie_start_frame =
+                     (unsigned)strtoul(optarg, NULL, 0);
+               }
+#endif
+               break;
+
+            case RA_OPT_BSV_VERIFY:
+#ifdef HAVE_BSV_MOVIE
+               {
+                  input_driver_state_t *input_st = input_state_get_ptr();
+                  input_st->bsv_movie_state.movie_verify = true;
+               }
+#endif
+               break;
+
             case RA_OPT_VERSION:
                retroarch_print_version();
                exit(0);
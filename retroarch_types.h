@@ -351,6 +351,7 @@ typedef struct content_file_info
    size_t data_size;
    bool file_in_archive;
    bool persistent_data;
+   bool data_mapped; /* data is a file mapping, not malloc'd */
 } content_file_info_t;
 
 typedef struct content_file_list
@@ -7730,10 +7730,7 @@ int runloop_iterate(void)
 #endif
 
 #ifdef HAVE_BSV_MOVIE
-   /* Used for rewinding while playback/record. */
-   if (input_st->bsv_movie_state_handle)
-      input_st->bsv_movie_state_handle->frame_pos[input_st->bsv_movie_state_handle->frame_ptr]
-         = intfstream_tell(input_st->bsv_movie_state_handle->file);
+   bsv_movie_frame_start(input_st);
 #endif
 
    if (     camera_st->cb.caps
@@ -7948,6 +7945,7 @@ int runloop_iterate(void)
       input_st->bsv_movie_state_handle->frame_ptr    =
          (input_st->bsv_movie_state_handle->frame_ptr + 1)
          & input_st->bsv_movie_state_handle->frame_mask;
+      input_st->bsv_movie_state_handle->frame_count++;
 
       input_st->bsv_movie_state_handle->first_rewind =
          !input_st->bsv_movie_state_handle->did_rewind;
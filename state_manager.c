@@ -187,7 +187,7 @@ static size_t find_same(const uint16_t *a, const uint16_t *b)
 
 /* Returns the maximum compressed size of a savestate.
  * It is very likely to compress to far less. */
-static size_t state_manager_raw_maxsize(size_t uncomp)
+size_t state_manager_raw_maxsize(size_t uncomp)
 {
    /* bytes covered by a compressed block */
    const int maxcblkcover = UINT16_MAX * sizeof(uint16_t);
@@ -203,7 +203,7 @@ static size_t state_manager_raw_maxsize(size_t uncomp)
  * See state_manager_raw_compress for information about this.
  * When you're done with it, send it to free().
  */
-static void *state_manager_raw_alloc(size_t len, uint16_t uniq)
+void *state_manager_raw_alloc(size_t len, uint16_t uniq)
 {
    size_t  len16 = (len + sizeof(uint16_t) - 1) & -sizeof(uint16_t);
    uint16_t *ret = (uint16_t*)calloc(len16 + sizeof(uint16_t) * 4 + 16, 1);
@@ -235,7 +235,7 @@ static void *state_manager_raw_alloc(size_t len, uint16_t uniq)
  * 'patch' must be size 'state_manager_raw_maxsize(len)' or more.
  * Returns the number of bytes actually written to 'patch'.
  */
-static size_t state_manager_raw_compress(const void *src,
+size_t state_manager_raw_compress(const void *src,
       const void *dst, size_t len, void *patch)
 {
    const uint16_t  *old16 = (const uint16_t*)src;
@@ -301,7 +301,7 @@ static size_t state_manager_raw_compress(const void *src,
  * If the given arguments do not match a previous call to
  * state_manager_raw_compress(), anything at all can happen.
  */
-static void state_manager_raw_decompress(const void *patch,
+void state_manager_raw_decompress(const void *patch,
       size_t patchlen, void *data, size_t datalen)
 {
    uint16_t         *out16 = (uint16_t*)data;
@@ -340,6 +340,69 @@ static void state_manager_raw_decompress(const void *patch,
    }
 }
 
+/*
+ * Same as state_manager_raw_decompress, but for patches that did not
+ * come from this process (e.g. netplay). Every block is bounds checked
+ * against both 'patchlen' and 'datalen' (rounded up to 16 bits, as
+ * with state_manager_raw_alloc).
+ *
+ * Returns false if the patch is malformed, in which case 'data' is
+ * left partially patched.
+ */
+bool state_manager_raw_decompress_checked(const void *patch,
+      size_t patchlen, void *data, size_t datalen)
+{
+   uint16_t         *out16 = (uint16_t*)data;
+   const uint16_t *patch16 = (const uint16_t*)patch;
+   size_t        patch16s  = patchlen / sizeof(uint16_t);
+   size_t          out16s  = (datalen + sizeof(uint16_t) - 1)
+      / sizeof(uint16_t);
+   size_t             pos  = 0;
+   size_t             ppos = 0;
+
+   for (;;)
+   {
+      uint16_t numchanged;
+
+      if (ppos >= patch16s)
+         return false;
+
+      numchanged = patch16[ppos++];
+
+      if (numchanged)
+      {
+         if (patch16s - ppos < (size_t)numchanged + 1)
+            return false;
+
+         pos  += patch16[ppos++];
+         if (pos > out16s || out16s - pos < numchanged)
+            return false;
+
+         memcpy(out16 + pos, patch16 + ppos,
+               numchanged * sizeof(uint16_t));
+
+         ppos += numchanged;
+         pos  += numchanged;
+      }
+      else
+      {
+         uint32_t numunchanged;
+
+         if (patch16s - ppos < 2)
+            return false;
+
+         numunchanged = patch16[ppos] | ((uint32_t)patch16[ppos + 1] << 16);
+         if (!numunchanged)
+            return true;
+
+         ppos += 2;
+         pos  += numunchanged;
+         if (pos > out16s)
+            return false;
+      }
+   }
+}
+
 /* The start offsets point to 'nextstart' of any given compressed frame.
  * Each uint16 is stored native endian; anything that claims any other
  * endianness refers to the endianness of this specific item.
@@ -68,6 +68,22 @@ struct state_manager_rewind_state
    bool hotkey_was_pressed;
 };
 
+/* Raw savestate diffing. Used by rewind, and by netplay to
+ * send savestates as a patch against one the peer already has.
+ * See state_manager.c for the patch format. */
+size_t state_manager_raw_maxsize(size_t uncomp);
+
+void *state_manager_raw_alloc(size_t len, uint16_t uniq);
+
+size_t state_manager_raw_compress(const void *src,
+      const void *dst, size_t len, void *patch);
+
+void state_manager_raw_decompress(const void *patch,
+      size_t patchlen, void *data, size_t datalen);
+
+bool state_manager_raw_decompress_checked(const void *patch,
+      size_t patchlen, void *data, size_t datalen);
+
 bool state_manager_frame_is_reversed(void);
 
 void state_manager_event_deinit(
@@ -58,6 +58,13 @@
 #include <lists/dir_list.h>
 #include <vfs/vfs_implementation.h>
 #include <array/rbuf.h>
+#include <features/features_cpu.h>
+#if defined(HAVE_MMAP)
+#include <sys/stat.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <memmap.h>
+#endif
 
 #include <retro_miscellaneous.h>
 #include <retro_assert.h>
@@ -108,6 +115,10 @@
 
 #define MAX_ARGS 32
 
+/* Uncompressed content at least this large is mapped
+ * instead of read into memory, see content_file_map() */
+#define CONTENT_MAP_MIN_SIZE (16 * 1024 * 1024)
+
 typedef struct content_stream content_stream_t;
 typedef struct content_information_ctx content_information_ctx_t;
 
@@ -276,6 +287,19 @@ bool content_file_override_set(
    return true;
 }
 
+static void content_file_data_free(void *data, size_t size,
+      bool mapped)
+{
+#if defined(HAVE_MMAP)
+   if (mapped)
+   {
+      munmap(data, size);
+      return;
+   }
+#endif
+   free(data);
+}
+
 /* Frees any content data that is not flagged
  * as 'persistent'. Should be called after
  * content_file_load() */
@@ -294,10 +318,12 @@ static void content_file_list_free_transient_data(
       if (file_info->data &&
           !file_info->persistent_data)
       {
-         free((void*)file_info->data);
+         content_file_data_free(file_info->data,
+               file_info->data_size, file_info->data_mapped);
 
-         file_info->data      = NULL;
-         file_info->data_size = 0;
+         file_info->data        = NULL;
+         file_info->data_size   = 0;
+         file_info->data_mapped = false;
       }
    }
 }
@@ -352,10 +378,12 @@ static void content_file_list_free_entry(
 
    if (file_info->data)
    {
-      free((void*)file_info->data);
+      content_file_data_free(file_info->data,
+            file_info->data_size, file_info->data_mapped);
       file_info->data = NULL;
    }
-   file_info->data_size = 0;
+   file_info->data_size   = 0;
+   file_info->data_mapped = false;
 
    file_info->file_in_archive = false;
    file_info->persistent_data = false;
@@ -482,6 +510,7 @@ static bool content_file_list_set_info(
       const char *path,
       void *data,
       size_t data_size,
+      bool data_mapped,
       bool persistent_data,
       size_t idx)
 {
@@ -529,6 +558,7 @@ static bool content_file_list_set_info(
 
    file_info->data            = data;
    file_info->data_size       = data_size;
+   file_info->data_mapped     = data_mapped;
    file_info->persistent_data = persistent_data;
 
    /* Assign paths
@@ -664,11 +694,86 @@ static bool content_file_list_set_info(
 #define CONTENT_FILE_ATTR_GET_REQUIRED(attr)      ((attr.i & 4) != 0)
 #define CONTENT_FILE_ATTR_GET_PERSISTENT(attr)    ((attr.i & 8) != 0)
 
+#if defined(HAVE_MMAP)
+/**
+ * content_file_map:
+ * @content_path : path of the content file.
+ * @data         : mapping of the content file.
+ * @data_size    : size of the content file.
+ *
+ * Maps large content files instead of reading them, which
+ * saves both the copy and a second resident copy of the data
+ * in the page cache. The mapping is private, so a core that
+ * writes to retro_game_info::data regardless of its const
+ * only modifies its own copy of those pages.
+ *
+ * Returns: true if the file was mapped, false if it has to
+ * be read into memory instead.
+ **/
+static bool content_file_map(const char *content_path,
+      uint8_t **data, int64_t *data_size)
+{
+   struct stat st;
+   void *addr = MAP_FAILED;
+   int fd     = open(content_path, O_RDONLY);
+
+   if (fd < 0)
+      return false;
+
+   if (     fstat(fd, &st) == 0
+         && S_ISREG(st.st_mode)
+         && st.st_size >= CONTENT_MAP_MIN_SIZE
+         && (off_t)(size_t)st.st_size == st.st_size)
+      addr = mmap(NULL, (size_t)st.st_size, PROT_READ | PROT_WRITE,
+            MAP_PRIVATE, fd, 0);
+
+   close(fd);
+
+   if (addr == MAP_FAILED)
+      return false;
+
+   /* Hints only, the mapping works without them */
+#ifdef MADV_HUGEPAGE
+   madvise(addr, (size_t)st.st_size, MADV_HUGEPAGE);
+#endif
+#ifdef MADV_WILLNEED
+   madvise(addr, (size_t)st.st_size, MADV_WILLNEED);
+#endif
+
+   *data      = (uint8_t*)addr;
+   *data_size = (int64_t)st.st_size;
+   return true;
+}
+#endif
+
+/* Patching reallocates the content buffer, which
+ * rules out a mapping */
+static bool content_file_has_patch(
+      content_information_ctx_t *content_ctx,
+      size_t idx,
+      enum rarch_content_type first_content_type)
+{
+#ifdef HAVE_PATCH
+   if (     idx == 0
+         && first_content_type == RARCH_CONTENT_NONE
+         && !content_ctx->patch_is_blocked)
+      return (!string_is_empty(content_ctx->name_ips)
+               && path_is_valid(content_ctx->name_ips))
+          || (!string_is_empty(content_ctx->name_bps)
+               && path_is_valid(content_ctx->name_bps))
+          || (!string_is_empty(content_ctx->name_ups)
+               && path_is_valid(content_ctx->name_ups));
+#endif
+   return false;
+}
+
 /**
  * content_file_load_into_memory:
  * @content_path : path of the content file.
  * @data         : buffer into which the content file will be read.
  * @data_size    : size of the resultant content buffer.
+ * @data_mapped  : true if @data is a mapping of the file
+ *                 (see content_file_map function).
  *
  * Reads the content file into memory. Also performs soft patching
  * (see patch_content function) if soft patching has not been
@@ -684,13 +789,17 @@ static bool content_file_load_into_memory(
       size_t idx,
       enum rarch_content_type first_content_type,
       uint8_t **data,
-      size_t *data_size)
+      size_t *data_size,
+      bool *data_mapped)
 {
    uint8_t *content_data = NULL;
    int64_t content_size  = 0;
+   bool mapped           = false;
+   retro_time_t start    = cpu_features_get_time_usec();
 
    *data                 = NULL;
    *data_size            = 0;
+   *data_mapped          = false;
 
    RARCH_LOG("[Content]: %s: \"%s\".\n",
          msg_hash_to_str(MSG_LOADING_CONTENT_FILE), content_path);
@@ -704,6 +813,12 @@ static bool content_file_load_into_memory(
          return false;
    }
    else
+#endif
+#if defined(HAVE_MMAP)
+   if (     !content_file_has_patch(content_ctx, idx, first_content_type)
+         && content_file_map(content_path, &content_data, &content_size))
+      mapped = true;
+   else
 #endif
       if (!filestream_read_file(content_path,
             (void**)&content_data, &content_size))
@@ -712,6 +827,10 @@ static bool content_file_load_into_memory(
    if (content_size < 0)
       return false;
 
+   RARCH_LOG("[Content]: %s %" PRIu64 " bytes in %u ms.\n",
+         mapped ? "Mapped" : "Read", (uint64_t)content_size,
+         (unsigned)((cpu_features_get_time_usec() - start) / 1000));
+
    /* First content file is significant: attempt to do
     * soft patching, CRC checking, etc. */
    if (idx == 0)
@@ -724,7 +843,7 @@ static bool content_file_load_into_memory(
 
 #ifdef HAVE_PATCH
          /* Attempt to apply a patch. */
-         if (!content_ctx->patch_is_blocked)
+         if (!content_ctx->patch_is_blocked && !mapped)
             has_patch = patch_content(
                   content_ctx->is_ips_pref,
                   content_ctx->is_bps_pref,
@@ -763,8 +882,9 @@ static bool content_file_load_into_memory(
          p_content->rom_crc = 0;
    }
 
-   *data      = content_data;
-   *data_size = (size_t)content_size;
+   *data        = content_data;
+   *data_size   = (size_t)content_size;
+   *data_mapped = mapped;
 
    return true;
 }
@@ -958,6 +1078,7 @@ static bool content_file_load(
       const char *content_path = NULL;
       uint8_t *content_data    = NULL;
       size_t content_size      = 0;
+      bool content_mapped      = false;
       const char *valid_exts   = special
             ? special->roms[i].valid_extensions
             : content_ctx->valid_extensions;
@@ -996,7 +1117,7 @@ static bool content_file_load(
             if (!content_file_load_into_memory(
                   content_ctx, p_content, content_path,
                   content_compressed, i, first_content_type,
-                  &content_data, &content_size))
+                  &content_data, &content_size, &content_mapped))
             {
                snprintf(msg, sizeof(msg), "%s \"%s\"\n",
                      msg_hash_to_str(MSG_COULD_NOT_READ_CONTENT_FILE),
@@ -1113,12 +1234,13 @@ static bool content_file_load(
       /* Add current entry to content file list */
       if (!content_file_list_set_info(
             p_content->content_list,
-            content_path, content_data, content_size,
+            content_path, content_data, content_size, content_mapped,
             CONTENT_FILE_ATTR_GET_PERSISTENT(content->elems[i].attr), i))
       {
          RARCH_LOG("[Content]: Failed to process content file: \"%s\".\n", content_path);
          if (content_data)
-            free((void*)content_data);
+            content_file_data_free(content_data, content_size,
+                  content_mapped);
          *error_enum = MSG_FAILED_TO_LOAD_CONTENT;
          return false;
       }
@@ -25,6 +25,7 @@
 #include <boolean.h>
 
 #include <compat/msvc.h>
+#include <compat/strl.h>
 #include <file/file_path.h>
 #include <streams/file_stream.h>
 #include <string/stdstring.h>
@@ -60,50 +61,50 @@ enum patch_error
    PATCH_PATCH_CHECKSUM_INVALID
 };
 
+/* Most patches are applied by one of .ips, .bps or .ups
+ * followed by up to nine indexed ones (.ips1 ... .ips9) */
+#define PATCH_MAX                 10
+
+/* Patched content of at least this size is kept in the
+ * cache directory, so it is not patched again on the next
+ * launch */
+#define PATCH_CACHE_MIN_SIZE      (8 * 1024 * 1024)
+#define PATCH_CACHE_MAGIC         0x43504152 /* "RAPC" */
+#define PATCH_CACHE_HEADER_SIZE   24
+
 struct bps_data
 {
    const uint8_t *modify_data;
-   const uint8_t *source_data;
-   uint8_t *target_data;
    size_t modify_length;
-   size_t source_length;
-   size_t target_length;
    size_t modify_offset;
-   size_t source_offset;
-   size_t target_offset;
-   size_t source_relative_offset;
-   size_t target_relative_offset;
-   size_t output_offset;
-   uint32_t modify_checksum;
-   uint32_t source_checksum;
-   uint32_t target_checksum;
 };
 
-struct ups_data
+/* Patches the content in buf in place or replaces it,
+ * buf and size are left unchanged if patching fails */
+typedef enum patch_error (*patch_func_t)(const uint8_t*, uint64_t,
+      uint8_t**, uint64_t*);
+
+struct patch_file
 {
-   const uint8_t *patch_data;
-   const uint8_t *source_data;
-   uint8_t *target_data;
-   unsigned patch_length;
-   unsigned source_length;
-   unsigned target_length;
-   unsigned patch_offset;
-   unsigned source_offset;
-   unsigned target_offset;
-   unsigned patch_checksum;
-   unsigned source_checksum;
-   unsigned target_checksum;
+   const char *desc;
+   patch_func_t func;
+   void *data;
+   int64_t size;
+   char path[PATH_MAX_LENGTH];
 };
 
-typedef enum patch_error (*patch_func_t)(const uint8_t*, uint64_t,
-      const uint8_t*, uint64_t, uint8_t**, uint64_t*);
+static uint32_t patch_read_le32(const uint8_t *data)
+{
+   return   (uint32_t)data[0]        | ((uint32_t)data[1] << 8)
+         | ((uint32_t)data[2] << 16) | ((uint32_t)data[3] << 24);
+}
 
 static uint8_t bps_read(struct bps_data *bps)
 {
-   uint8_t data         = bps->modify_data[bps->modify_offset++];
-   bps->modify_checksum = ~(encoding_crc32(
-         ~bps->modify_checksum, &data, 1));
-   return data;
+   if (bps->modify_offset < bps->modify_length)
+      return bps->modify_data[bps->modify_offset++];
+   /* Ends any number being decoded */
+   return 0x80;
 }
 
 static uint64_t bps_decode(struct bps_data *bps)
@@ -123,23 +124,20 @@ static uint64_t bps_decode(struct bps_data *bps)
    return data;
 }
 
-static void bps_write(struct bps_data *bps, uint8_t data)
-{
-   bps->target_data[bps->output_offset++] = data;
-   bps->target_checksum = ~(encoding_crc32(~bps->target_checksum, &data, 1));
-}
-
 static enum patch_error bps_apply_patch(
       const uint8_t *modify_data, uint64_t modify_length,
-      const uint8_t *source_data, uint64_t source_length,
-      uint8_t **target_data, uint64_t *target_length)
+      uint8_t **buf, uint64_t *size)
 {
-   size_t i;
    struct bps_data bps;
-   uint32_t checksum               = 0;
-   size_t modify_source_size       = 0;
-   size_t modify_target_size       = 0;
-   size_t modify_markup_size       = 0;
+   uint8_t *target_data            = NULL;
+   const uint8_t *source_data      = *buf;
+   uint64_t source_length          = *size;
+   uint64_t source_offset          = 0;
+   uint64_t target_offset          = 0;
+   uint64_t output_offset          = 0;
+   uint64_t modify_source_size     = 0;
+   uint64_t modify_target_size     = 0;
+   uint64_t modify_markup_size     = 0;
    uint32_t modify_source_checksum = 0;
    uint32_t modify_target_checksum = 0;
    uint32_t modify_modify_checksum = 0;
@@ -147,304 +145,264 @@ static enum patch_error bps_apply_patch(
    if (modify_length < 19)
       return PATCH_PATCH_TOO_SMALL;
 
-   bps.modify_data            = modify_data;
-   bps.source_data            = source_data;
-   bps.target_data            = *target_data;
-   bps.modify_length          = modify_length;
-   bps.source_length          = source_length;
-   bps.target_length          = *target_length;
-   bps.modify_offset          = 0;
-   bps.source_offset          = 0;
-   bps.target_offset          = 0;
-   bps.modify_checksum        = ~0;
-   bps.source_checksum        = 0;
-   bps.target_checksum        = ~0;
-   bps.source_relative_offset = 0;
-   bps.target_relative_offset = 0;
-   bps.output_offset          = 0;
-
-   if (  (bps_read(&bps) != 'B') ||
-         (bps_read(&bps) != 'P') ||
-         (bps_read(&bps) != 'S') ||
-         (bps_read(&bps) != '1'))
+   if (  (modify_data[0] != 'B') ||
+         (modify_data[1] != 'P') ||
+         (modify_data[2] != 'S') ||
+         (modify_data[3] != '1'))
       return PATCH_PATCH_INVALID_HEADER;
 
-   modify_source_size  = bps_decode(&bps);
-   modify_target_size  = bps_decode(&bps);
-   modify_markup_size  = bps_decode(&bps);
+   /* The actions end where the checksums begin */
+   bps.modify_data    = modify_data;
+   bps.modify_length  = (size_t)(modify_length - 12);
+   bps.modify_offset  = 4;
 
-   for (i = 0; i < modify_markup_size; i++)
-      bps_read(&bps);
+   modify_source_size = bps_decode(&bps);
+   modify_target_size = bps_decode(&bps);
+   modify_markup_size = bps_decode(&bps);
 
-   if (modify_source_size > bps.source_length)
+   if (modify_markup_size > bps.modify_length - bps.modify_offset)
+      return PATCH_PATCH_INVALID;
+   bps.modify_offset += (size_t)modify_markup_size;
+
+   modify_source_checksum = patch_read_le32(modify_data + modify_length - 12);
+   modify_target_checksum = patch_read_le32(modify_data + modify_length - 8);
+   modify_modify_checksum = patch_read_le32(modify_data + modify_length - 4);
+
+   if (modify_source_size > source_length)
       return PATCH_SOURCE_TOO_SMALL;
 
-   if (modify_target_size > bps.target_length)
-   {
-      uint8_t *prov=(uint8_t*)malloc((size_t)modify_target_size);
+   /* Checked up front, so the actions below can trust
+    * the patch and copy whole runs at once */
+   if (encoding_crc32(0, source_data, (size_t)source_length)
+         != modify_source_checksum)
+      return PATCH_SOURCE_CHECKSUM_INVALID;
 
-      if (!prov)
-         return PATCH_TARGET_ALLOC_FAILED;
+   if (encoding_crc32(0, modify_data, (size_t)(modify_length - 4))
+         != modify_modify_checksum)
+      return PATCH_PATCH_CHECKSUM_INVALID;
 
-      free(*target_data);
-      bps.target_data   = prov;
-      *target_data      = prov;
-      bps.target_length = modify_target_size;
-   }
+   if (!(target_data = (uint8_t*)malloc((size_t)modify_target_size)))
+      return PATCH_TARGET_ALLOC_FAILED;
 
-   while (bps.modify_offset < bps.modify_length - 12)
+   while (bps.modify_offset < bps.modify_length)
    {
-      size_t length = bps_decode(&bps);
-      unsigned mode = length & 3;
+      uint64_t length = bps_decode(&bps);
+      unsigned mode   = length & 3;
 
       length = (length >> 2) + 1;
 
+      if (length > modify_target_size - output_offset)
+         goto error;
+
       switch (mode)
       {
          case SOURCE_READ:
-            while (length--)
-               bps_write(&bps, bps.source_data[bps.output_offset]);
+            if (output_offset + length > source_length)
+               goto error;
+            memcpy(target_data + output_offset,
+                  source_data + output_offset, (size_t)length);
             break;
 
          case TARGET_READ:
-            while (length--)
-               bps_write(&bps, bps_read(&bps));
+            if (length > bps.modify_length - bps.modify_offset)
+               goto error;
+            memcpy(target_data + output_offset,
+                  modify_data + bps.modify_offset, (size_t)length);
+            bps.modify_offset += (size_t)length;
             break;
 
          case SOURCE_COPY:
          case TARGET_COPY:
          {
-            int    offset = (int)bps_decode(&bps);
-            bool negative = offset & 1;
+            uint64_t offset = bps_decode(&bps);
+            bool negative   = offset & 1;
 
             offset >>= 1;
 
-            if (negative)
-               offset = -offset;
-
             if (mode == SOURCE_COPY)
             {
-               bps.source_offset += offset;
-               while (length--)
-                  bps_write(&bps, bps.source_data[bps.source_offset++]);
+               source_offset = negative
+                  ? source_offset - offset : source_offset + offset;
+               if (     source_offset > source_length
+                     || length > source_length - source_offset)
+                  goto error;
+               memcpy(target_data + output_offset,
+                     source_data + source_offset, (size_t)length);
+               source_offset += length;
             }
             else
             {
-               bps.target_offset += offset;
-               while (length--)
-                  bps_write(&bps, bps.target_data[bps.target_offset++]);
-               break;
+               uint64_t i;
+
+               target_offset = negative
+                  ? target_offset - offset : target_offset + offset;
+               if (target_offset >= output_offset)
+                  goto error;
+               /* May overlap the output to repeat a pattern,
+                * so this has to go byte by byte */
+               for (i = 0; i < length; i++)
+                  target_data[output_offset + i] =
+                     target_data[target_offset + i];
+               target_offset += length;
             }
             break;
          }
       }
-   }
-
-   for (i = 0; i < 32; i += 8)
-      modify_source_checksum |= bps_read(&bps) << i;
-   for (i = 0; i < 32; i += 8)
-      modify_target_checksum |= bps_read(&bps) << i;
-
-   checksum = ~bps.modify_checksum;
-   for (i = 0; i < 32; i += 8)
-      modify_modify_checksum |= bps_read(&bps) << i;
 
-   bps.source_checksum = encoding_crc32(0,
-         bps.source_data, bps.source_length);
-   bps.target_checksum = ~bps.target_checksum;
-
-   if (bps.source_checksum != modify_source_checksum)
-      return PATCH_SOURCE_CHECKSUM_INVALID;
+      output_offset += length;
+   }
 
-   if (bps.target_checksum != modify_target_checksum)
+   if (     output_offset != modify_target_size
+         || encoding_crc32(0, target_data, (size_t)output_offset)
+            != modify_target_checksum)
+   {
+      free(target_data);
       return PATCH_TARGET_CHECKSUM_INVALID;
+   }
 
-   if (checksum != modify_modify_checksum)
-      return PATCH_PATCH_CHECKSUM_INVALID;
-
-   *target_length = modify_target_size;
+   free(*buf);
+   *buf  = target_data;
+   *size = modify_target_size;
 
    return PATCH_SUCCESS;
-}
 
-static uint8_t ups_patch_read(struct ups_data *data)
-{
-   if (data && data->patch_offset < data->patch_length)
-   {
-      uint8_t n = data->patch_data[data->patch_offset++];
-      data->patch_checksum =
-         ~(encoding_crc32(~data->patch_checksum, &n, 1));
-      return n;
-   }
-   return 0x00;
-}
-
-static uint8_t ups_source_read(struct ups_data *data)
-{
-   if (data && data->source_offset < data->source_length)
-   {
-      uint8_t n = data->source_data[data->source_offset++];
-      data->source_checksum =
-         ~(encoding_crc32(~data->source_checksum, &n, 1));
-      return n;
-   }
-   return 0x00;
+error:
+   free(target_data);
+   return PATCH_PATCH_INVALID;
 }
 
-static void ups_target_write(struct ups_data *data, uint8_t n)
+static uint64_t ups_decode(const uint8_t *patchdata, uint64_t patchlength,
+      uint64_t *offset)
 {
+   uint64_t data = 0, shift = 1;
 
-   if (data && data->target_offset < data->target_length)
+   while (*offset < patchlength)
    {
-      data->target_data[data->target_offset] = n;
-      data->target_checksum =
-         ~(encoding_crc32(~data->target_checksum, &n, 1));
-   }
+      uint8_t x = patchdata[(*offset)++];
+      data     += (x & 0x7f) * shift;
 
-   if (data)
-      data->target_offset++;
+      if (x & 0x80)
+         break;
+      shift <<= 7;
+      data  += shift;
+   }
+   return data;
 }
 
-static uint64_t ups_decode(struct ups_data *data)
+/* XORs the patch into data, running it twice undoes it.
+ * Bytes the patch skips are left as they are. */
+static void ups_xor(const uint8_t *patchdata, uint64_t patchlength,
+      uint64_t offset, uint8_t *data, uint64_t length)
 {
-   uint64_t offset = 0, shift = 1;
+   uint64_t target_offset = 0;
 
-   for (;;)
+   while (offset < patchlength - 12)
    {
-      uint8_t x = ups_patch_read(data);
-      offset   += (x & 0x7f) * shift;
+      target_offset += ups_decode(patchdata, patchlength - 12, &offset);
 
-      if (x & 0x80)
-         break;
-      shift <<= 7;
-      offset += shift;
+      while (offset < patchlength - 12)
+      {
+         uint8_t patch_xor = patchdata[offset++];
+         if (target_offset < length)
+            data[target_offset] ^= patch_xor;
+         target_offset++;
+         if (patch_xor == 0)
+            break;
+      }
    }
-   return offset;
 }
 
 static enum patch_error ups_apply_patch(
       const uint8_t *patchdata, uint64_t patchlength,
-      const uint8_t *sourcedata, uint64_t sourcelength,
-      uint8_t **targetdata, uint64_t *targetlength)
+      uint8_t **buf, uint64_t *size)
 {
-   size_t i;
-   struct ups_data data;
-   unsigned source_read_length;
-   unsigned target_read_length;
-   uint32_t patch_result_checksum = 0;
+   uint64_t source_read_length;
+   uint64_t target_read_length;
+   uint64_t target_length;
+   uint32_t target_checksum;
+   uint32_t source_checksum;
+   uint64_t offset                = 4;
+   uint64_t source_length         = *size;
    uint32_t patch_read_checksum   = 0;
    uint32_t source_read_checksum  = 0;
    uint32_t target_read_checksum  = 0;
 
-   data.patch_data      = patchdata;
-   data.source_data     = sourcedata;
-   data.target_data     = *targetdata;
-   data.patch_length    = (unsigned)patchlength;
-   data.source_length   = (unsigned)sourcelength;
-   data.target_length   = (unsigned)*targetlength;
-   data.patch_offset    = 0;
-   data.source_offset   = 0;
-   data.target_offset   = 0;
-   data.patch_checksum  = ~0;
-   data.source_checksum = ~0;
-   data.target_checksum = ~0;
-
-   if (data.patch_length < 18)
+   if (patchlength < 18)
       return PATCH_PATCH_INVALID;
 
    if (
-         (ups_patch_read(&data) != 'U') ||
-         (ups_patch_read(&data) != 'P') ||
-         (ups_patch_read(&data) != 'S') ||
-         (ups_patch_read(&data) != '1')
+         (patchdata[0] != 'U') ||
+         (patchdata[1] != 'P') ||
+         (patchdata[2] != 'S') ||
+         (patchdata[3] != '1')
       )
       return PATCH_PATCH_INVALID;
 
-   source_read_length = (unsigned)ups_decode(&data);
-   target_read_length = (unsigned)ups_decode(&data);
+   source_read_length   = ups_decode(patchdata, patchlength - 12, &offset);
+   target_read_length   = ups_decode(patchdata, patchlength - 12, &offset);
 
-   if (     (data.source_length != source_read_length)
-         && (data.source_length != target_read_length))
-      return PATCH_SOURCE_INVALID;
+   source_read_checksum = patch_read_le32(patchdata + patchlength - 12);
+   target_read_checksum = patch_read_le32(patchdata + patchlength - 8);
+   patch_read_checksum  = patch_read_le32(patchdata + patchlength - 4);
+
+   if (encoding_crc32(0, patchdata, (size_t)(patchlength - 4))
+         != patch_read_checksum)
+      return PATCH_PATCH_INVALID;
 
-   *targetlength = (data.source_length == source_read_length ?
-         target_read_length : source_read_length);
+   /* UPS patches apply both ways */
+   source_checksum = encoding_crc32(0, *buf, (size_t)source_length);
 
-   if (data.target_length < *targetlength)
+   if (     source_checksum == source_read_checksum
+         && source_length   == source_read_length)
    {
-      uint8_t *prov=(uint8_t*)malloc((size_t)*targetlength);
-      if (!prov)
-         return PATCH_TARGET_ALLOC_FAILED;
-      free(*targetdata);
-      *targetdata      = prov;
-      data.target_data = prov;
+      target_length   = target_read_length;
+      target_checksum = target_read_checksum;
    }
-
-   data.target_length = (unsigned)*targetlength;
-   
-   while (data.patch_offset < data.patch_length - 12)
+   else if (source_checksum == target_read_checksum
+         && source_length   == target_read_length)
    {
-      unsigned length = (unsigned)ups_decode(&data);
-      while (length--)
-         ups_target_write(&data, ups_source_read(&data));
-
-      for (;;)
-      {
-         uint8_t patch_xor = ups_patch_read(&data);
-         ups_target_write(&data, patch_xor ^ ups_source_read(&data));
-         if (patch_xor == 0)
-            break;
-      }
+      target_length   = source_read_length;
+      target_checksum = source_read_checksum;
    }
+   else
+      return PATCH_SOURCE_INVALID;
 
-   while (data.source_offset < data.source_length)
-      ups_target_write(&data, ups_source_read(&data));
-   while (data.target_offset < data.target_length)
-      ups_target_write(&data, ups_source_read(&data));
-
-   for (i = 0; i < 4; i++)
-      source_read_checksum |= ups_patch_read(&data) << (i * 8);
-   for (i = 0; i < 4; i++)
-      target_read_checksum |= ups_patch_read(&data) << (i * 8);
-
-   patch_result_checksum = ~data.patch_checksum;
-   data.source_checksum  = ~data.source_checksum;
-   data.target_checksum  = ~data.target_checksum;
-
-   for (i = 0; i < 4; i++)
-      patch_read_checksum |= ups_patch_read(&data) << (i * 8);
-
-   if (patch_result_checksum != patch_read_checksum)
-      return PATCH_PATCH_INVALID;
-
-   if (     data.source_checksum == source_read_checksum
-         && data.source_length   == source_read_length)
+   /* The target is patched in place, past the end of the
+    * source it reads as zeroes */
+   if (target_length > source_length)
    {
-      if (     data.target_checksum == target_read_checksum
-            && data.target_length   == target_read_length)
-         return PATCH_SUCCESS;
-      return PATCH_TARGET_INVALID;
+      uint8_t *prov = (uint8_t*)realloc(*buf, (size_t)target_length);
+      if (!prov)
+         return PATCH_TARGET_ALLOC_FAILED;
+      memset(prov + source_length, 0,
+            (size_t)(target_length - source_length));
+      *buf = prov;
    }
-   else if (data.source_checksum == target_read_checksum
-         && data.source_length   == target_read_length)
+
+   ups_xor(patchdata, patchlength, offset, *buf, target_length);
+
+   if (encoding_crc32(0, *buf, (size_t)target_length) != target_checksum)
    {
-      if (     data.target_checksum == source_read_checksum
-            && data.target_length   == source_read_length)
-         return PATCH_SUCCESS;
+      ups_xor(patchdata, patchlength, offset, *buf, target_length);
       return PATCH_TARGET_INVALID;
    }
 
-   return PATCH_SOURCE_INVALID;
+   *size = target_length;
+
+   return PATCH_SUCCESS;
 }
 
-static enum patch_error ips_alloc_targetdata(
+/* Walks the whole patch, so it cannot fail once applying
+ * has started. buffer_length also covers records past the
+ * end of a truncated target. */
+static enum patch_error ips_get_target_size(
       const uint8_t *patchdata, uint64_t patchlen,
       uint64_t sourcelength,
-      uint8_t **targetdata, uint64_t *targetlength)
+      uint64_t *targetlength, uint64_t *bufferlength)
 {
-   uint8_t *prov_alloc;
    uint32_t offset = 5;
    *targetlength   = sourcelength;
+   *bufferlength   = sourcelength;
 
    for (;;)
    {
@@ -461,26 +419,15 @@ static enum patch_error ips_alloc_targetdata(
       if (address == 0x454f46) /* EOF */
       {
          if (offset == patchlen)
-         {
-            prov_alloc     = (uint8_t*)malloc((size_t)*targetlength);
-            if (!prov_alloc)
-               return PATCH_TARGET_ALLOC_FAILED;
-            free(*targetdata);
-            *targetdata    = prov_alloc;
             return PATCH_SUCCESS;
-         }
          else if (offset == patchlen - 3)
          {
             uint32_t size  = patchdata[offset++] << 16;
             size          |= patchdata[offset++] << 8;
             size          |= patchdata[offset++] << 0;
             *targetlength  = size;
-            prov_alloc     = (uint8_t*)malloc((size_t)*targetlength);
-
-            if (!prov_alloc)
-               return PATCH_TARGET_ALLOC_FAILED;
-            free(*targetdata);
-            *targetdata    = prov_alloc;
+            if (size > *bufferlength)
+               *bufferlength = size;
             return PATCH_SUCCESS;
          }
       }
@@ -496,11 +443,8 @@ static enum patch_error ips_alloc_targetdata(
          if (offset > patchlen - length)
             break;
 
-         while (length--)
-         {
-            address++;
-            offset++;
-         }
+         address += length;
+         offset  += length;
       }
       else /* RLE */
       {
@@ -513,14 +457,14 @@ static enum patch_error ips_alloc_targetdata(
          if (length == 0) /* Illegal */
             break;
 
-         while (length--)
-            address++;
-
+         address += length;
          offset++;
       }
 
       if (address > *targetlength)
          *targetlength = address;
+      if (address > *bufferlength)
+         *bufferlength = address;
    }
 
    return PATCH_PATCH_INVALID;
@@ -528,10 +472,12 @@ static enum patch_error ips_alloc_targetdata(
 
 static enum patch_error ips_apply_patch(
       const uint8_t *patchdata, uint64_t patchlen,
-      const uint8_t *sourcedata, uint64_t sourcelength,
-      uint8_t **targetdata, uint64_t *targetlength)
+      uint8_t **buf, uint64_t *size)
 {
-   uint32_t offset = 5;
+   uint64_t targetlength;
+   uint64_t bufferlength;
+   uint8_t *targetdata          = NULL;
+   uint32_t offset              = 5;
    enum patch_error error_patch = PATCH_UNKNOWN;
    if (  patchlen      < 8   ||
          patchdata[0] != 'P' ||
@@ -540,202 +486,272 @@ static enum patch_error ips_apply_patch(
          patchdata[3] != 'C' ||
          patchdata[4] != 'H')
       return PATCH_PATCH_INVALID;
-   
-   if ((error_patch = ips_alloc_targetdata(
-               patchdata, patchlen, sourcelength,
-               targetdata, targetlength)) != PATCH_SUCCESS)
+
+   if ((error_patch = ips_get_target_size(
+               patchdata, patchlen, *size,
+               &targetlength, &bufferlength)) != PATCH_SUCCESS)
       return error_patch;
 
-   memcpy(*targetdata, sourcedata, (size_t)sourcelength);
+   /* Records are applied to the content in place */
+   if (bufferlength > *size)
+   {
+      if (!(targetdata = (uint8_t*)realloc(*buf, (size_t)bufferlength)))
+         return PATCH_TARGET_ALLOC_FAILED;
+      memset(targetdata + *size, 0, (size_t)(bufferlength - *size));
+      *buf = targetdata;
+   }
+   targetdata = *buf;
+   *size      = targetlength;
 
    for (;;)
    {
       uint32_t address;
       unsigned length;
 
-      if (offset > patchlen - 3)
-         break;
-
       address  = patchdata[offset++] << 16;
       address |= patchdata[offset++] << 8;
       address |= patchdata[offset++] << 0;
 
-      if (address == 0x454f46) /* EOF */
-      {
-         if (offset == patchlen)
-            return PATCH_SUCCESS;
-
-         if (offset == patchlen - 3)
-         {
-#if 0
-            uint32_t size  = patchdata[offset++] << 16;
-            size          |= patchdata[offset++] << 8;
-            size          |= patchdata[offset++] << 0;
-#endif
-            return PATCH_SUCCESS;
-         }
-      }
-
-      if (offset > patchlen - 2)
-         break;
+      /* ips_get_target_size already found the end */
+      if (     address == 0x454f46 /* EOF */
+            && (offset == patchlen || offset == patchlen - 3))
+         return PATCH_SUCCESS;
 
       length  = patchdata[offset++] << 8;
       length |= patchdata[offset++] << 0;
 
       if (length) /* Copy */
       {
-         if (offset > patchlen - length)
-            break;
-
-         while (length--)
-            (*targetdata)[address++] = patchdata[offset++];
+         memcpy(targetdata + address, patchdata + offset, length);
+         offset += length;
       }
       else /* RLE */
       {
-         if (offset > patchlen - 3)
-            break;
-
          length  = patchdata[offset++] << 8;
          length |= patchdata[offset++] << 0;
 
-         if (length == 0) /* Illegal */
-            break;
-
-         while (length--)
-            (*targetdata)[address++] = patchdata[offset];
-
+         memset(targetdata + address, patchdata[offset], length);
          offset++;
       }
    }
-
-   return PATCH_PATCH_INVALID;
 }
 
-static bool apply_patch_content(uint8_t **buf,
-      ssize_t *size, const char *patch_desc, const char *patch_path,
-      patch_func_t func, void *patch_data, int64_t patch_size)
+static void patch_notify(const struct patch_file *patch)
 {
    settings_t *settings     = config_get_ptr();
    bool show_notification   = settings ?
          settings->bools.notification_show_patch_applied : false;
+
+   /* Show an OSD message */
+   if (show_notification)
+   {
+      const char *patch_filename = path_basename_nocompression(patch->path);
+      char msg[256];
+
+      msg[0] = '\0';
+
+      snprintf(msg, sizeof(msg), msg_hash_to_str(MSG_APPLYING_PATCH),
+            patch_filename ? patch_filename :
+                  msg_hash_to_str(MENU_ENUM_LABEL_VALUE_UNKNOWN));
+      runloop_msg_queue_push(msg, 1, 180, false, NULL,
+            MESSAGE_QUEUE_ICON_DEFAULT, MESSAGE_QUEUE_CATEGORY_INFO);
+   }
+}
+
+static bool apply_patch_content(uint8_t **buf,
+      ssize_t *size, const struct patch_file *patch)
+{
    enum patch_error err     = PATCH_UNKNOWN;
-   ssize_t ret_size         = *size;
-   uint8_t *ret_buf         = *buf;
-   uint64_t target_size     = 0;
-   uint8_t *patched_content = NULL;
+   uint64_t target_size     = *size;
 
    RARCH_LOG("Found %s file in \"%s\", attempting to patch ...\n",
-         patch_desc, patch_path);
+         patch->desc, patch->path);
 
-   if ((err = func((const uint8_t*)patch_data, patch_size, ret_buf,
-         ret_size, &patched_content, &target_size)) == PATCH_SUCCESS)
+   if ((err = patch->func((const uint8_t*)patch->data, patch->size,
+         buf, &target_size)) == PATCH_SUCCESS)
    {
-      free(ret_buf);
-      *buf  = patched_content;
       *size = target_size;
-
-      /* Show an OSD message */
-      if (show_notification)
-      {
-         const char *patch_filename = path_basename_nocompression(patch_path);
-         char msg[256];
-
-         msg[0] = '\0';
-
-         snprintf(msg, sizeof(msg), msg_hash_to_str(MSG_APPLYING_PATCH),
-               patch_filename ? patch_filename :
-                     msg_hash_to_str(MENU_ENUM_LABEL_VALUE_UNKNOWN));
-         runloop_msg_queue_push(msg, 1, 180, false, NULL,
-               MESSAGE_QUEUE_ICON_DEFAULT, MESSAGE_QUEUE_CATEGORY_INFO);
-      }
+      patch_notify(patch);
+      return true;
    }
-   else
-      RARCH_ERR("%s %s: %s #%u\n",
-            msg_hash_to_str(MSG_FAILED_TO_PATCH),
-            patch_desc,
-            msg_hash_to_str(MSG_ERROR),
-            (unsigned)err);
 
-   return true;
+   RARCH_ERR("%s %s: %s #%u\n",
+         msg_hash_to_str(MSG_FAILED_TO_PATCH),
+         patch->desc,
+         msg_hash_to_str(MSG_ERROR),
+         (unsigned)err);
+
+   return false;
 }
 
-static bool try_bps_patch(bool allow_bps, const char *name_bps,
-      uint8_t **buf, ssize_t *size)
+static bool load_patch(bool allow, const char *name, const char *desc,
+      patch_func_t func, struct patch_file *patch)
 {
-   if (     allow_bps 
-         && !string_is_empty(name_bps)
-         && path_is_valid(name_bps)
+   if (     allow
+         && !string_is_empty(name)
+         && path_is_valid(name)
       )
    {
-      int64_t patch_size;
-      bool ret                 = false;
-      void *patch_data         = NULL;
+      patch->data = NULL;
+      patch->size = 0;
 
-      if (!filestream_read_file(name_bps, &patch_data, &patch_size))
+      if (!filestream_read_file(name, &patch->data, &patch->size))
          return false;
 
-      if (patch_size >= 0)
-         ret = apply_patch_content(buf, size, "BPS", name_bps,
-               bps_apply_patch, patch_data, patch_size);
+      if (patch->size < 0)
+      {
+         free(patch->data);
+         return false;
+      }
 
-      if (patch_data)
-         free(patch_data);
-      return ret;
+      patch->desc = desc;
+      patch->func = func;
+      strlcpy(patch->path, name, sizeof(patch->path));
+      return true;
    }
 
    return false;
 }
 
-static bool try_ups_patch(bool allow_ups, const char *name_ups,
+/* Copies a patch path with room for an index character,
+ * NUL terminated *after* it */
+static char *patch_name_alloc(const char *name, size_t *len)
+{
+   char *s = NULL;
+
+   *len    = 0;
+   if (string_is_empty(name))
+      return NULL;
+
+   *len    = strlen(name);
+   if (!(s = (char*)malloc((*len + 2) * sizeof(char))))
+      return NULL;
+
+   memcpy(s, name, *len + 1);
+   s[*len + 1] = '\0';
+   return s;
+}
+
+/* The cache holds the last patched version of each content
+ * file, named after its first patch. The key covers the
+ * unpatched content and every patch applied to it. */
+static bool patch_cache_path(char *s, size_t len,
+      const struct patch_file *patch)
+{
+   settings_t *settings = config_get_ptr();
+
+   if (!settings || string_is_empty(settings->paths.directory_cache))
+      return false;
+
+   fill_pathname_join_special(s, settings->paths.directory_cache,
+         path_basename_nocompression(patch->path), len);
+   path_remove_extension(s);
+   strlcat(s, ".patched", len);
+   return true;
+}
+
+static uint32_t patch_cache_key(const uint8_t *buf, ssize_t size,
+      const struct patch_file *patches, size_t count)
+{
+   size_t i;
+   uint32_t key = encoding_crc32(0, buf, (size_t)size);
+
+   for (i = 0; i < count; i++)
+      key = encoding_crc32(key,
+            (const uint8_t*)patches[i].data, (size_t)patches[i].size);
+
+   return key;
+}
+
+static bool patch_cache_load(const char *path, uint32_t key,
       uint8_t **buf, ssize_t *size)
 {
-   if (     allow_ups
-         && !string_is_empty(name_ups)
-         && path_is_valid(name_ups)
-      )
-   {
-      int64_t patch_size;
-      bool ret                 = false;
-      void *patch_data         = NULL;
+   uint8_t header[PATCH_CACHE_HEADER_SIZE];
+   uint64_t source_size, target_size;
+   uint8_t *data = NULL;
+   RFILE *file   = filestream_open(path,
+         RETRO_VFS_FILE_ACCESS_READ,
+         RETRO_VFS_FILE_ACCESS_HINT_NONE);
+
+   if (!file)
+      return false;
 
-      if (!filestream_read_file(name_ups, &patch_data, &patch_size))
-         return false;
+   if (filestream_read(file, header, sizeof(header)) != sizeof(header))
+      goto error;
 
-      if (patch_size >= 0)
-         ret = apply_patch_content(buf, size, "UPS", name_ups,
-               ups_apply_patch, patch_data, patch_size);
+   source_size = patch_read_le32(header +  8)
+      | ((uint64_t)patch_read_le32(header + 12) << 32);
+   target_size = patch_read_le32(header + 16)
+      | ((uint64_t)patch_read_le32(header + 20) << 32);
 
-      if (patch_data)
-         free(patch_data);
-      return ret;
-   }
+   if (     patch_read_le32(header) != PATCH_CACHE_MAGIC
+         || patch_read_le32(header + 4) != key
+         || source_size != (uint64_t)*size
+         || target_size != (uint64_t)(filestream_get_size(file)
+            - PATCH_CACHE_HEADER_SIZE))
+      goto error;
+
+   if (!(data = (uint8_t*)malloc((size_t)target_size + 1)))
+      goto error;
+
+   if (filestream_read(file, data, target_size) != (int64_t)target_size)
+      goto error;
+
+   filestream_close(file);
+
+   /* Terminated like content read with filestream_read_file() */
+   data[target_size] = '\0';
+   free(*buf);
+   *buf  = data;
+   *size = (ssize_t)target_size;
+   return true;
+
+error:
+   free(data);
+   filestream_close(file);
    return false;
 }
 
-static bool try_ips_patch(bool allow_ips,
-      const char *name_ips, uint8_t **buf, ssize_t *size)
+static void patch_cache_save(const char *path, uint32_t key,
+      ssize_t source_size, const uint8_t *buf, ssize_t size)
 {
-   if (     allow_ips 
-         && !string_is_empty(name_ips)
-         && path_is_valid(name_ips)
-      )
-   {
-      int64_t patch_size;
-      bool ret                 = false;
-      void *patch_data         = NULL;
+   size_t i;
+   uint8_t header[PATCH_CACHE_HEADER_SIZE];
+   uint64_t sizes[2];
+   bool success = false;
+   RFILE *file  = filestream_open(path,
+         RETRO_VFS_FILE_ACCESS_WRITE,
+         RETRO_VFS_FILE_ACCESS_HINT_NONE);
 
-      if (!filestream_read_file(name_ips, &patch_data, &patch_size))
-         return false;
+   if (!file)
+      return;
 
-      if (patch_size >= 0)
-         ret = apply_patch_content(buf, size, "IPS", name_ips,
-               ips_apply_patch, patch_data, patch_size);
+   sizes[0] = (uint64_t)source_size;
+   sizes[1] = (uint64_t)size;
 
-      if (patch_data)
-         free(patch_data);
-      return ret;
+   for (i = 0; i < 4; i++)
+   {
+      header[i]     = (uint8_t)(PATCH_CACHE_MAGIC >> (i * 8));
+      header[i + 4] = (uint8_t)(key >> (i * 8));
    }
-   return false;
+   for (i = 0; i < 8; i++)
+   {
+      header[i +  8] = (uint8_t)(sizes[0] >> (i * 8));
+      header[i + 16] = (uint8_t)(sizes[1] >> (i * 8));
+   }
+
+   success =    filestream_write(file, header, sizeof(header))
+                == sizeof(header)
+             && filestream_write(file, buf, size) == size;
+
+   if (filestream_close(file) != 0)
+      success = false;
+
+   /* Never leave a truncated file behind */
+   if (!success)
+      filestream_delete(path);
+   else
+      RARCH_LOG("Cached patched content in \"%s\".\n", path);
 }
 
 /**
@@ -744,6 +760,8 @@ static bool try_ips_patch(bool allow_ips,
  * @size         : size   of the content file.
  *
  * Apply patch to the content file in-memory.
+ * Large patched content is cached in the cache
+ * directory, see PATCH_CACHE_MIN_SIZE.
  *
  **/
 bool patch_content(
@@ -756,6 +774,13 @@ bool patch_content(
       uint8_t **buf,
       void *data)
 {
+   size_t i;
+   size_t name_ips_len, name_bps_len, name_ups_len;
+   char *name_ips_indexed      = NULL;
+   char *name_bps_indexed      = NULL;
+   char *name_ups_indexed      = NULL;
+   struct patch_file *patches  = NULL;
+   size_t count                = 0;
    ssize_t *size    = (ssize_t*)data;
    bool allow_ups   = !is_bps_pref && !is_ips_pref;
    bool allow_ips   = !is_ups_pref && !is_bps_pref;
@@ -770,66 +795,85 @@ bool patch_content(
       return false;
    }
 
-   /* Attempt to apply first (non-indexed) patch */
-   if (     try_ips_patch(allow_ips, name_ips, buf, size)
-         || try_bps_patch(allow_bps, name_bps, buf, size)
-         || try_ups_patch(allow_ups, name_ups, buf, size))
+   if (!(patches = (struct patch_file*)calloc(PATCH_MAX, sizeof(*patches))))
+      return false;
+
+   name_ips_indexed = patch_name_alloc(name_ips, &name_ips_len);
+   name_bps_indexed = patch_name_alloc(name_bps, &name_bps_len);
+   name_ups_indexed = patch_name_alloc(name_ups, &name_ups_len);
+
+   /* Load the first (non-indexed) patch, then any
+    * additional 'indexed' patch files "*.ipsX" */
+   while (count < PATCH_MAX)
    {
-      /* A patch has been found. Now attempt to apply
-       * any additional 'indexed' patch files */
-      size_t name_ips_len    = strlen(name_ips);
-      size_t name_bps_len    = strlen(name_bps);
-      size_t name_ups_len    = strlen(name_ups);
-      char *name_ips_indexed = (char*)malloc((name_ips_len + 2) * sizeof(char));
-      char *name_bps_indexed = (char*)malloc((name_bps_len + 2) * sizeof(char));
-      char *name_ups_indexed = (char*)malloc((name_ups_len + 2) * sizeof(char));
-      /* First patch already applied -> index
-       * for subsequent patches starts at 1 */
-      size_t patch_index     = 1;
-
-      strlcpy(name_ips_indexed, name_ips, (name_ips_len + 1) * sizeof(char));
-      strlcpy(name_bps_indexed, name_bps, (name_bps_len + 1) * sizeof(char));
-      strlcpy(name_ups_indexed, name_ups, (name_ups_len + 1) * sizeof(char));
-
-      /* Ensure that we NUL terminate *after* the
-       * index character */
-      name_ips_indexed[name_ips_len + 1] = '\0';
-      name_bps_indexed[name_bps_len + 1] = '\0';
-      name_ups_indexed[name_ups_len + 1] = '\0';
-
-      /* try to patch "*.ipsX" */
-      while (patch_index < 10)
+      /* Add index character to end of patch
+       * file path string
+       * > Note: This technique only works for
+       *   index values up to 9 (i.e. single
+       *   digit numbers)
+       * > If we want to support more than 10
+       *   patches in total, will have to replace
+       *   this with an snprintf() implementation
+       *   (which will have significantly higher
+       *   performance overheads) */
+      if (count)
       {
-         /* Add index character to end of patch
-          * file path string
-          * > Note: This technique only works for
-          *   index values up to 9 (i.e. single
-          *   digit numbers)
-          * > If we want to support more than 10
-          *   patches in total, will have to replace
-          *   this with an snprintf() implementation
-          *   (which will have significantly higher
-          *   performance overheads) */
-         char index_char = '0' + patch_index;
-
-         name_ips_indexed[name_ips_len] = index_char;
-         name_bps_indexed[name_bps_len] = index_char;
-         name_ups_indexed[name_ups_len] = index_char;
-
-         if (     !try_ips_patch(allow_ips, name_ips_indexed, buf, size)
-               && !try_bps_patch(allow_bps, name_bps_indexed, buf, size)
-               && !try_ups_patch(allow_ups, name_ups_indexed, buf, size))
-            break;
+         char index_char = '0' + count;
+
+         if (name_ips_indexed)
+            name_ips_indexed[name_ips_len] = index_char;
+         if (name_bps_indexed)
+            name_bps_indexed[name_bps_len] = index_char;
+         if (name_ups_indexed)
+            name_ups_indexed[name_ups_len] = index_char;
+      }
+
+      if (     !load_patch(allow_ips, name_ips_indexed, "IPS",
+                  ips_apply_patch, &patches[count])
+            && !load_patch(allow_bps, name_bps_indexed, "BPS",
+                  bps_apply_patch, &patches[count])
+            && !load_patch(allow_ups, name_ups_indexed, "UPS",
+                  ups_apply_patch, &patches[count]))
+         break;
 
-         patch_index++;
+      count++;
+   }
+
+   free(name_ips_indexed);
+   free(name_bps_indexed);
+   free(name_ups_indexed);
+
+   if (count)
+   {
+      char cache_path[PATH_MAX_LENGTH];
+      ssize_t source_size = *size;
+      bool use_cache      = source_size >= PATCH_CACHE_MIN_SIZE
+         && patch_cache_path(cache_path, sizeof(cache_path), &patches[0]);
+      uint32_t key        = use_cache
+         ? patch_cache_key(*buf, source_size, patches, count) : 0;
+
+      if (use_cache && patch_cache_load(cache_path, key, buf, size))
+      {
+         RARCH_LOG("Loaded patched content from \"%s\".\n", cache_path);
+         for (i = 0; i < count; i++)
+            patch_notify(&patches[i]);
       }
+      else
+      {
+         bool success = true;
 
-      free(name_ips_indexed);
-      free(name_bps_indexed);
-      free(name_ups_indexed);
+         for (i = 0; i < count; i++)
+            if (!apply_patch_content(buf, size, &patches[i]))
+               success = false;
 
-      return true;
+         if (use_cache && success)
+            patch_cache_save(cache_path, key, source_size, *buf, *size);
+      }
    }
 
-   return false;
+   for (i = 0; i < count; i++)
+      free(patches[i].data);
+   free(patches);
+
+   return count > 0;
 }
@@ -26,6 +26,8 @@
 #endif
 
 #include <compat/strl.h>
+#include <encodings/crc32.h>
+#include <features/features_cpu.h>
 #include <retro_assert.h>
 #include <lists/string_list.h>
 #include <streams/interface_stream.h>
@@ -36,6 +38,11 @@
 #include <retro_miscellaneous.h>
 #include <string/stdstring.h>
 #include <time/rtime.h>
+#include <formats/image.h>
+
+/* Savestate block checksums, private to this file */
+#define XXH_INLINE_ALL
+#include "../deps/xxHash/xxhash.h"
 
 #ifdef HAVE_CONFIG_H
 #include "../config.h"
@@ -54,6 +61,7 @@
 #include "../core_info.h"
 #include "../file_path_special.h"
 #include "../configuration.h"
+#include "../gfx/video_driver.h"
 #include "../msg_hash.h"
 #include "../retroarch.h"
 #include "../verbosity.h"
@@ -68,11 +76,52 @@
 #define SAVE_STATE_CHUNK 4096
 #endif
 
-#define RASTATE_VERSION 1
+/* Savestates are serialized into one buffer while the
+ * previous one is still being written */
+#define SAVE_STATE_WRITES 2
+
+/* Autosave hashes SRAM in blocks of this size, and only
+ * writes the blocks that changed to the SRAM journal */
+#define AUTOSAVE_BLOCK_SIZE 4096
+
+/* SRAM journal, FILE_PATH_SRM_JOURNAL_EXTENSION appended
+ * to the SRAM path. Little-endian.
+ *
+ * Header: uint32 magic, uint32 block size, uint32 SRAM size,
+ *    uint32 CRC32 of the SRAM file the journal applies to.
+ * Records: uint32 block index, uint32 CRC32 of the block,
+ *    then the block. An index of SRAM_JOURNAL_COMMIT ends
+ *    each autosave, records after the last one are ignored. */
+#define SRAM_JOURNAL_MAGIC         0x4e4a4152 /* "RAJN" */
+#define SRAM_JOURNAL_HEADER_SIZE   16
+#define SRAM_JOURNAL_RECORD_SIZE   8
+#define SRAM_JOURNAL_COMMIT        0xffffffff
+
+/* RASTATE1: 8-byte block headers (marker, uint32 size).
+ * RASTATE2: 16-byte block headers, followed by the XXH3-64
+ * hash of the block. Preview blocks come before the core
+ * state, so they can be read without decompressing it.
+ * Savestates are written as RASTATE2, rewind keeps using
+ * RASTATE1 as its states never leave memory. */
+#define RASTATE_VERSION 2
+#define RASTATE_VERSION_BARE 1
+#define RASTATE_BLOCK_HEADER_SIZE(version) ((version) >= 2 ? 16 : 8)
 #define RASTATE_MEM_BLOCK "MEM "
 #define RASTATE_CHEEVOS_BLOCK "ACHV"
+#define RASTATE_THUMBNAIL_BLOCK "THMB"
+#define RASTATE_SRAM_BLOCK "SRAM"
 #define RASTATE_END_BLOCK "END "
 
+/* Thumbnail block: uint32 width, uint32 height, then
+ * RGB565 pixels. The last frame is scaled down by an
+ * integer factor until it fits. */
+#define RASTATE_THUMBNAIL_HEADER_SIZE 8
+#define RASTATE_THUMBNAIL_MAX_WIDTH 320
+#define RASTATE_THUMBNAIL_MAX_HEIGHT 240
+
+/* Released serialization buffers kept for the next state */
+#define SAVE_STATE_SPARE_BUFS 2
+
 struct ram_type
 {
    const char *path;
@@ -83,6 +132,7 @@ struct save_state_buf
 {
    void* data;
    size_t size;
+   size_t capacity;
    char path[PATH_MAX_LENGTH];
 };
 
@@ -99,9 +149,30 @@ struct sram_block
    unsigned type;
 };
 
+/* A savestate on its way to disk. The buffer is kept
+ * once written, so the next save can reuse it. */
+struct save_state_write
+{
+   void *data;
+   size_t size;
+   size_t capacity;
+   /* Thumbnail block payload followed by SRAM, copied on the
+    * main thread for states serialized by the save task */
+   void *preview;
+   size_t preview_capacity;
+   size_t preview_thumbnail_size;
+   size_t preview_sram_size;
+   char path[PATH_MAX_LENGTH];
+   bool busy;      /* Owned by a save task */
+   bool started;   /* That task has begun writing, the
+                    * data can no longer be replaced */
+   bool discard;   /* Free the buffer once released */
+};
+
 typedef struct
 {
    intfstream_t *file;
+   struct save_state_write *write;
    void *data;
    void *undo_data;
    ssize_t size;
@@ -118,6 +189,7 @@ typedef struct
    bool thumbnail_enable;
    bool has_valid_framebuffer;
    bool compress_files;
+   bool compress_lz4;
 } save_task_state_t;
 
 #ifdef HAVE_THREADS
@@ -132,15 +204,21 @@ struct autosave_st
 
 struct autosave
 {
-   void *buffer;
+   void *buffer;          /* Changed blocks, or all of SRAM */
    const void *retro_buffer;
    const char *path;
+   uint64_t *hashes;      /* One per AUTOSAVE_BLOCK_SIZE block */
+   uint32_t *dirty;       /* Indices of the changed blocks */
    slock_t *lock;
    slock_t *cond_lock;
    scond_t *cond;
    sthread_t *thread;
+   retro_time_t start_time;
+   uint64_t bytes_written;
    size_t bufsize;
+   size_t journal_size;   /* 0 until SRAM has been written */
    unsigned interval;
+   unsigned full_writes;
    bool quit;
    bool compress_files;
 };
@@ -164,6 +242,19 @@ static struct ram_save_state_buf ram_buf;
 static struct autosave_st autosave_state;
 #endif
 
+/* Serialization buffers that are not in use. States keep
+ * their size for the whole session, so these take the next
+ * state without another state-sized allocation.
+ * See save_state_buf_reserve(). */
+static struct save_state_buf save_state_spares[SAVE_STATE_SPARE_BUFS];
+
+/* Savestates waiting for, or being written by, a save task.
+ * See task_push_save_state(). */
+static struct save_state_write save_state_writes[SAVE_STATE_WRITES];
+#ifdef HAVE_THREADS
+static slock_t *save_state_writes_lock     = NULL;
+#endif
+
 static bool save_state_in_background       = false;
 static struct string_list *task_save_files = NULL;
 
@@ -174,9 +265,255 @@ typedef struct rastate_size_info
 #ifdef HAVE_CHEEVOS
    size_t cheevos_size;
 #endif
+   size_t sram_size;
+   size_t thumbnail_size;
+   size_t frame_pitch;
+   const void *sram;
+   const void *frame;
+   const void *thumbnail; /* Encoded already, else from frame */
+   unsigned frame_format;
+   unsigned thumbnail_width;
+   unsigned thumbnail_height;
+   unsigned thumbnail_scale;
+   unsigned version;
 } rastate_size_info_t;
 
+static void sram_journal_path(char *s, size_t len, const char *path)
+{
+   strlcpy(s, path, len);
+   strlcat(s, FILE_PATH_SRM_JOURNAL_EXTENSION, len);
+}
+
+static void sram_journal_write_le32(uint8_t *s, uint32_t val)
+{
+   s[0] = (uint8_t)(val);
+   s[1] = (uint8_t)(val >>  8);
+   s[2] = (uint8_t)(val >> 16);
+   s[3] = (uint8_t)(val >> 24);
+}
+
+static uint32_t sram_journal_read_le32(const uint8_t *s)
+{
+   return  (uint32_t)s[0]        | ((uint32_t)s[1] <<  8)
+         | ((uint32_t)s[2] << 16) | ((uint32_t)s[3] << 24);
+}
+
 #ifdef HAVE_THREADS
+#define AUTOSAVE_BLOCKS(size) \
+   (((size) + AUTOSAVE_BLOCK_SIZE - 1) / AUTOSAVE_BLOCK_SIZE)
+
+static size_t autosave_block_len(const autosave_t *save, size_t block)
+{
+   size_t offset = block * AUTOSAVE_BLOCK_SIZE;
+   return MIN(AUTOSAVE_BLOCK_SIZE, save->bufsize - offset);
+}
+
+/* FNV-1a over 64-bit words. Each step is a bijection of the
+ * hash, so a change confined to one word is always detected. */
+static uint64_t autosave_hash(const uint8_t *data, size_t len)
+{
+   size_t i;
+   uint64_t hash = 0xcbf29ce484222325ULL;
+
+   for (i = 0; i + 8 <= len; i += 8)
+   {
+      uint64_t word;
+      memcpy(&word, data + i, sizeof(word));
+      hash = (hash ^ word) * 0x100000001b3ULL;
+   }
+   for (; i < len; i++)
+      hash = (hash ^ data[i]) * 0x100000001b3ULL;
+
+   return hash;
+}
+
+static void autosave_rehash(autosave_t *save, const uint8_t *data)
+{
+   size_t i;
+   size_t blocks = AUTOSAVE_BLOCKS(save->bufsize);
+
+   for (i = 0; i < blocks; i++)
+      save->hashes[i] = autosave_hash(data + i * AUTOSAVE_BLOCK_SIZE,
+            autosave_block_len(save, i));
+}
+
+/**
+ * autosave_scan:
+ * @save            : pointer to autosave object
+ * @full            : set if all of SRAM has to be written
+ *
+ * Finds the blocks that changed since the last autosave and
+ * copies them to the buffer, one per AUTOSAVE_BLOCK_SIZE. All
+ * of SRAM is copied instead if it has not been written yet, or
+ * if the journal would grow larger than SRAM itself.
+ * Called with @save locked.
+ *
+ * @return Number of changed blocks.
+ **/
+static size_t autosave_scan(autosave_t *save, bool *full)
+{
+   size_t i;
+   size_t count         = 0;
+   size_t blocks        = AUTOSAVE_BLOCKS(save->bufsize);
+   size_t journal_size  = save->journal_size + SRAM_JOURNAL_RECORD_SIZE;
+   const uint8_t *sram  = (const uint8_t*)save->retro_buffer;
+   uint8_t *buf         = (uint8_t*)save->buffer;
+
+   for (i = 0; i < blocks; i++)
+   {
+      size_t len    = autosave_block_len(save, i);
+      uint64_t hash = autosave_hash(sram + i * AUTOSAVE_BLOCK_SIZE, len);
+
+      if (hash == save->hashes[i])
+         continue;
+
+      save->hashes[i]      = hash;
+      save->dirty[count++] = (uint32_t)i;
+      journal_size        += SRAM_JOURNAL_RECORD_SIZE + len;
+   }
+
+   *full = count && (!save->journal_size || journal_size > save->bufsize);
+
+   if (*full)
+      memcpy(buf, sram, save->bufsize);
+   else
+      for (i = 0; i < count; i++)
+         memcpy(buf + i * AUTOSAVE_BLOCK_SIZE,
+               sram + save->dirty[i] * AUTOSAVE_BLOCK_SIZE,
+               autosave_block_len(save, save->dirty[i]));
+
+   return count;
+}
+
+/**
+ * autosave_write_full:
+ * @save            : pointer to autosave object
+ *
+ * Writes the SRAM copy in the buffer to the SRAM file, and
+ * starts a new, empty journal on top of it.
+ *
+ * @return true if successful, otherwise false.
+ **/
+static bool autosave_write_full(autosave_t *save)
+{
+   char journal[PATH_MAX_LENGTH];
+   uint8_t header[SRAM_JOURNAL_HEADER_SIZE];
+   int32_t file_size;
+   int64_t written;
+   intfstream_t *file = NULL;
+
+   /* Should probably deal with this more elegantly. */
+   if (save->compress_files)
+      file = intfstream_open_rzip_file(save->path,
+            RETRO_VFS_FILE_ACCESS_WRITE);
+   else
+      file = intfstream_open_file(save->path,
+            RETRO_VFS_FILE_ACCESS_WRITE, RETRO_VFS_FILE_ACCESS_HINT_NONE);
+
+   if (!file)
+      return false;
+
+   written = intfstream_write(file, save->buffer, save->bufsize);
+   intfstream_flush(file);
+   intfstream_close(file);
+   free(file);
+
+   if (written != (int64_t)save->bufsize)
+      return false;
+
+   if ((file_size = path_get_size(save->path)) > 0)
+      save->bytes_written += file_size;
+   save->full_writes++;
+
+   sram_journal_write_le32(header,      SRAM_JOURNAL_MAGIC);
+   sram_journal_write_le32(header +  4, AUTOSAVE_BLOCK_SIZE);
+   sram_journal_write_le32(header +  8, (uint32_t)save->bufsize);
+   sram_journal_write_le32(header + 12,
+         encoding_crc32(0, (const uint8_t*)save->buffer, save->bufsize));
+
+   /* Without a journal, the next autosave is a full one again */
+   sram_journal_path(journal, sizeof(journal), save->path);
+   save->journal_size = 0;
+   if (filestream_write_file(journal, header, sizeof(header)))
+   {
+      save->journal_size   = SRAM_JOURNAL_HEADER_SIZE;
+      save->bytes_written += SRAM_JOURNAL_HEADER_SIZE;
+   }
+
+   return true;
+}
+
+/**
+ * autosave_write_journal:
+ * @save            : pointer to autosave object
+ * @count           : number of changed blocks in the buffer
+ *
+ * Appends the changed blocks to the journal, followed by
+ * a commit record.
+ *
+ * @return true if successful, otherwise false.
+ **/
+static bool autosave_write_journal(autosave_t *save, size_t count)
+{
+   size_t i;
+   char journal[PATH_MAX_LENGTH];
+   uint8_t record[SRAM_JOURNAL_RECORD_SIZE];
+   size_t journal_size = save->journal_size;
+   const uint8_t *buf  = (const uint8_t*)save->buffer;
+   RFILE *file         = NULL;
+   bool ret            = true;
+
+   sram_journal_path(journal, sizeof(journal), save->path);
+
+   if (!(file = filestream_open(journal,
+         RETRO_VFS_FILE_ACCESS_WRITE
+         | RETRO_VFS_FILE_ACCESS_UPDATE_EXISTING,
+         RETRO_VFS_FILE_ACCESS_HINT_NONE)))
+      return false;
+
+   /* Starts after the last commit, overwriting anything an
+    * interrupted append left behind */
+   if (filestream_seek(file, (int64_t)journal_size,
+         RETRO_VFS_SEEK_POSITION_START) != 0)
+      ret = false;
+
+   for (i = 0; ret && i < count; i++)
+   {
+      const uint8_t *block = buf + i * AUTOSAVE_BLOCK_SIZE;
+      size_t len           = autosave_block_len(save, save->dirty[i]);
+
+      sram_journal_write_le32(record,     save->dirty[i]);
+      sram_journal_write_le32(record + 4, encoding_crc32(0, block, len));
+
+      if (     filestream_write(file, record, sizeof(record))
+                  != sizeof(record)
+            || filestream_write(file, block, len) != (int64_t)len)
+         ret = false;
+      journal_size += SRAM_JOURNAL_RECORD_SIZE + len;
+   }
+
+   if (ret)
+   {
+      sram_journal_write_le32(record,     SRAM_JOURNAL_COMMIT);
+      sram_journal_write_le32(record + 4, 0);
+      if (filestream_write(file, record, sizeof(record)) != sizeof(record))
+         ret = false;
+      journal_size += SRAM_JOURNAL_RECORD_SIZE;
+   }
+
+   if (filestream_flush(file) != 0)
+      ret = false;
+   filestream_close(file);
+
+   if (ret)
+   {
+      save->bytes_written += journal_size - save->journal_size;
+      save->journal_size   = journal_size;
+   }
+
+   return ret;
+}
+
 /**
  * autosave_thread:
  * @data            : pointer to autosave object
@@ -189,36 +526,29 @@ static void autosave_thread(void *data)
 
    for (;;)
    {
-      bool differ;
+      size_t count;
+      bool full = false;
 
       slock_lock(save->lock);
-      differ = memcmp(save->buffer, save->retro_buffer,
-            save->bufsize) != 0;
-      if (differ)
-         memcpy(save->buffer, save->retro_buffer, save->bufsize);
+      count = autosave_scan(save, &full);
       slock_unlock(save->lock);
 
-      if (differ)
+      /* The journal is gone, e.g. SRAM was saved in full
+       * in the meantime. Start over from a full write. */
+      if (count && !full && !autosave_write_journal(save, count))
       {
-         intfstream_t *file = NULL;
-
-         /* Should probably deal with this more elegantly. */
-         if (save->compress_files)
-            file = intfstream_open_rzip_file(save->path,
-                  RETRO_VFS_FILE_ACCESS_WRITE);
-         else
-            file = intfstream_open_file(save->path,
-                  RETRO_VFS_FILE_ACCESS_WRITE, RETRO_VFS_FILE_ACCESS_HINT_NONE);
-
-         if (file)
-         {
-            intfstream_write(file, save->buffer, save->bufsize);
-            intfstream_flush(file);
-            intfstream_close(file);
-            free(file);
-         }
+         slock_lock(save->lock);
+         memcpy(save->buffer, save->retro_buffer, save->bufsize);
+         slock_unlock(save->lock);
+         autosave_rehash(save, (const uint8_t*)save->buffer);
+         full = true;
       }
 
+      /* Forget the hashes, so the write is retried next time */
+      if (full && !autosave_write_full(save))
+         memset(save->hashes, 0,
+               AUTOSAVE_BLOCKS(save->bufsize) * sizeof(*save->hashes));
+
       slock_lock(save->cond_lock);
 
       if (save->quit)
@@ -256,8 +586,8 @@ static autosave_t *autosave_new(const char *path,
       const void *data, size_t size,
       unsigned interval, bool compress)
 {
-   void       *buf               = NULL;
-   autosave_t *handle            = (autosave_t*)malloc(sizeof(*handle));
+   size_t blocks                 = AUTOSAVE_BLOCKS(size);
+   autosave_t *handle            = (autosave_t*)calloc(1, sizeof(*handle));
    if (!handle)
       return NULL;
 
@@ -267,16 +597,23 @@ static autosave_t *autosave_new(const char *path,
    handle->compress_files        = compress;
    handle->retro_buffer          = data;
    handle->path                  = path;
+   handle->start_time            = cpu_features_get_time_usec();
 
-   if (!(buf = malloc(size)))
+   if (     !(handle->buffer = malloc(size))
+         || !(handle->hashes = (uint64_t*)malloc(
+               blocks * sizeof(*handle->hashes)))
+         || !(handle->dirty  = (uint32_t*)malloc(
+               blocks * sizeof(*handle->dirty))))
    {
+      free(handle->buffer);
+      free(handle->hashes);
       free(handle);
       return NULL;
    }
 
-   handle->buffer                = buf;
-
-   memcpy(handle->buffer, handle->retro_buffer, handle->bufsize);
+   /* SRAM as loaded is already on disk. The first change
+    * is written in full, which also starts the journal. */
+   autosave_rehash(handle, (const uint8_t*)handle->retro_buffer);
 
    handle->lock                  = slock_new();
    handle->cond_lock             = slock_new();
@@ -294,6 +631,8 @@ static autosave_t *autosave_new(const char *path,
  **/
 static void autosave_free(autosave_t *handle)
 {
+   retro_time_t elapsed;
+
    slock_lock(handle->cond_lock);
    handle->quit = true;
    slock_unlock(handle->cond_lock);
@@ -304,9 +643,26 @@ static void autosave_free(autosave_t *handle)
    slock_free(handle->cond_lock);
    scond_free(handle->cond);
 
+   /* Write amplification, for comparison against the
+    * SRAM size times the number of autosaves */
+   elapsed = cpu_features_get_time_usec() - handle->start_time;
+   RARCH_LOG("[Autosave]: \"%s\": %u KB written in %u s (%u KB/h), "
+         "%u full writes.\n",
+         path_basename(handle->path),
+         (unsigned)(handle->bytes_written / 1024),
+         (unsigned)(elapsed / 1000000),
+         (unsigned)(elapsed > 0
+            ? handle->bytes_written * 3600000000ULL / elapsed / 1024
+            : 0),
+         handle->full_writes);
+
    if (handle->buffer)
       free(handle->buffer);
    handle->buffer = NULL;
+   free(handle->hashes);
+   free(handle->dirty);
+   handle->hashes = NULL;
+   handle->dirty  = NULL;
 }
 
 bool autosave_init(void)
@@ -418,6 +774,101 @@ void autosave_unlock(void)
 }
 #endif
 
+static void save_state_writes_lock_acquire(void)
+{
+#ifdef HAVE_THREADS
+   if (save_state_writes_lock)
+      slock_lock(save_state_writes_lock);
+#endif
+}
+
+static void save_state_writes_lock_release(void)
+{
+#ifdef HAVE_THREADS
+   if (save_state_writes_lock)
+      slock_unlock(save_state_writes_lock);
+#endif
+}
+
+/**
+ * save_state_buf_release:
+ * @buf : buffer to release
+ *
+ * Empties @buf. Its memory replaces the smallest spare
+ * buffer, or is freed if all spares are larger.
+ **/
+static void save_state_buf_release(struct save_state_buf *buf)
+{
+   size_t i;
+   struct save_state_buf *spare = NULL;
+
+   if (buf->data)
+   {
+      save_state_writes_lock_acquire();
+      for (i = 0; i < SAVE_STATE_SPARE_BUFS; i++)
+         if (!spare || save_state_spares[i].capacity < spare->capacity)
+            spare = &save_state_spares[i];
+      if (spare->capacity < buf->capacity)
+      {
+         void *data      = spare->data;
+         spare->data     = buf->data;
+         spare->capacity = buf->capacity;
+         buf->data       = data;
+      }
+      save_state_writes_lock_release();
+
+      free(buf->data);
+   }
+
+   buf->data     = NULL;
+   buf->size     = 0;
+   buf->capacity = 0;
+}
+
+/**
+ * save_state_buf_reserve:
+ * @buf : buffer to grow
+ * @len : size required
+ *
+ * Makes @buf hold at least @len bytes, taking a spare
+ * buffer before allocating one. Contents are not kept.
+ *
+ * @return true if successful, otherwise false.
+ **/
+static bool save_state_buf_reserve(struct save_state_buf *buf, size_t len)
+{
+   size_t i;
+
+   if (buf->data && buf->capacity >= len)
+      return true;
+
+   save_state_buf_release(buf);
+
+   save_state_writes_lock_acquire();
+   for (i = 0; i < SAVE_STATE_SPARE_BUFS; i++)
+   {
+      struct save_state_buf *spare = &save_state_spares[i];
+      if (spare->data && spare->capacity >= len)
+      {
+         buf->data       = spare->data;
+         buf->capacity   = spare->capacity;
+         spare->data     = NULL;
+         spare->capacity = 0;
+         break;
+      }
+   }
+   save_state_writes_lock_release();
+
+   if (!buf->data)
+   {
+      if (!(buf->data = malloc(len)))
+         return false;
+      buf->capacity = len;
+   }
+
+   return true;
+}
+
 /**
  * undo_load_state:
  * Revert to the state before a state was loaded.
@@ -427,10 +878,9 @@ void autosave_unlock(void)
 bool content_undo_load_state(void)
 {
    unsigned i;
-   size_t temp_data_size;
    bool ret                  = false;
    unsigned num_blocks       = 0;
-   void* temp_data           = NULL;
+   struct save_state_buf temp;
    struct sram_block *blocks = NULL;
 
    if (!core_info_current_supports_savestate())
@@ -497,20 +947,19 @@ bool content_undo_load_state(void)
       }
    }
 
-   /* We need to make a temporary copy of the buffer, to allow the swap below */
-   temp_data              = malloc(undo_load_buf.size);
-   temp_data_size         = undo_load_buf.size;
-   memcpy(temp_data, undo_load_buf.data, undo_load_buf.size);
+   /* Take the buffer over, to allow the swap below */
+   temp                   = undo_load_buf;
+   undo_load_buf.data     = NULL;
+   undo_load_buf.size     = 0;
+   undo_load_buf.capacity = 0;
 
    /* Swap the current state with the backup state. This way, we can undo
    what we're undoing */
    content_save_state("RAM", false, false);
 
-   ret = content_deserialize_state(temp_data, temp_data_size);
+   ret = content_deserialize_state(temp.data, temp.size);
 
-   /* Clean up the temporary copy */
-   free(temp_data);
-   temp_data              = NULL;
+   save_state_buf_release(&temp);
 
     /* Flush back. */
    for (i = 0; i < num_blocks; i++)
@@ -555,12 +1004,7 @@ static void undo_save_state_cb(retro_task_t *task,
 
    /* Wipe the save file buffer as it's intended to be one use only */
    undo_save_buf.path[0] = '\0';
-   undo_save_buf.size    = 0;
-   if (undo_save_buf.data)
-   {
-      free(undo_save_buf.data);
-      undo_save_buf.data = NULL;
-   }
+   save_state_buf_release(&undo_save_buf);
 
    free(state);
 }
@@ -579,8 +1023,11 @@ static void task_save_handler_finished(retro_task_t *task,
 
    task_set_finished(task, true);
 
-   intfstream_close(state->file);
-   free(state->file);
+   if (state->file)
+   {
+      intfstream_close(state->file);
+      free(state->file);
+   }
 
    if (!task_get_error(task) && task_get_cancelled(task))
       task_set_error(task, strdup("Task canceled"));
@@ -590,7 +1037,8 @@ static void task_save_handler_finished(retro_task_t *task,
 
    task_set_data(task, task_data);
 
-   if (state->data)
+   /* Pooled buffers are released by the task callback */
+   if (state->data && !state->write)
    {
       if (state->undo_save && state->data == undo_save_buf.data)
          undo_save_buf.data = NULL;
@@ -604,36 +1052,179 @@ static void task_save_handler_finished(retro_task_t *task,
 /* Align to 8-byte boundary */
 #define CONTENT_ALIGN_SIZE(size) ((((size) + 7) & ~7))
 
-static size_t content_get_rastate_size(rastate_size_info_t* size)
+/* Sizes the thumbnail block after the last frame of
+ * the core. Hardware rendered frames are not in memory
+ * and get no thumbnail. */
+static void content_get_thumbnail_size(rastate_size_info_t *size)
+{
+   const void *data = NULL;
+   unsigned width   = 0;
+   unsigned height  = 0;
+   unsigned scale   = 1;
+   size_t pitch     = 0;
+
+   video_driver_cached_frame_get(&data, &width, &height, &pitch);
+
+   if (     !data
+         || data == RETRO_HW_FRAME_BUFFER_VALID
+         || !width
+         || !height)
+      return;
+
+   while (     width  / scale > RASTATE_THUMBNAIL_MAX_WIDTH
+            || height / scale > RASTATE_THUMBNAIL_MAX_HEIGHT)
+      scale++;
+
+   size->frame            = data;
+   size->frame_pitch      = pitch;
+   size->frame_format     = video_driver_get_pixel_format();
+   size->thumbnail_scale  = scale;
+   size->thumbnail_width  = width  / scale;
+   size->thumbnail_height = height / scale;
+   size->thumbnail_size   = RASTATE_THUMBNAIL_HEADER_SIZE
+         + size->thumbnail_width * size->thumbnail_height * 2;
+}
+
+static void content_add_rastate_block(rastate_size_info_t* size,
+      size_t block_size)
+{
+   size->total_size += RASTATE_BLOCK_HEADER_SIZE(size->version)
+         + CONTENT_ALIGN_SIZE(block_size);
+}
+
+/* Sizes the core state and achievements, previews are
+ * added by content_get_rastate_previews() */
+static size_t content_get_rastate_size(rastate_size_info_t* size,
+      unsigned version)
 {
    retro_ctx_size_info_t info;
+   size_t header_size = RASTATE_BLOCK_HEADER_SIZE(version);
    core_serialize_size(&info);
    if (!info.size)
       return 0;
+   memset(size, 0, sizeof(*size));
+   size->version      = version;
    size->coremem_size = info.size;
-   /* 8-byte identifier, 8-byte block header, content, 8-byte terminator */
-   size->total_size   = 8 + 8 + CONTENT_ALIGN_SIZE(info.size) + 8;
+   /* 8-byte identifier, block header, content, end block header */
+   size->total_size   = 8 + header_size + CONTENT_ALIGN_SIZE(info.size)
+         + header_size;
 #ifdef HAVE_CHEEVOS
-   /* 8-byte block header + content */
+   /* block header + content */
    if ((size->cheevos_size = rcheevos_get_serialize_size()) > 0)
-      size->total_size += 8 + CONTENT_ALIGN_SIZE(size->cheevos_size); 
+      size->total_size += header_size + CONTENT_ALIGN_SIZE(size->cheevos_size); 
 #endif
    return size->total_size;
 }
 
+/* Adds the live SRAM and last frame of the core. Both
+ * change while the core runs: main thread only. */
+static void content_get_rastate_previews(rastate_size_info_t* size)
+{
+   retro_ctx_memory_info_t mem_info;
+
+   if (size->version < 2)
+      return;
+
+   mem_info.id = RETRO_MEMORY_SAVE_RAM;
+   core_get_memory(&mem_info);
+   if (mem_info.data && mem_info.size)
+   {
+      size->sram      = mem_info.data;
+      size->sram_size = mem_info.size;
+      content_add_rastate_block(size, mem_info.size);
+   }
+
+   content_get_thumbnail_size(size);
+   if (size->thumbnail_size)
+      content_add_rastate_block(size, size->thumbnail_size);
+}
+
 size_t content_get_serialized_size(void)
 {
    rastate_size_info_t size;
-   return content_get_rastate_size(&size);
+   return content_get_rastate_size(&size, RASTATE_VERSION_BARE);
 }
 
-static void content_write_block_header(unsigned char* output, const char* header, size_t size)
+static void content_write_le32(unsigned char* output, uint32_t val)
 {
+   output[0] = ((val) & 0xFF);
+   output[1] = ((val >> 8) & 0xFF);
+   output[2] = ((val >> 16) & 0xFF);
+   output[3] = ((val >> 24) & 0xFF);
+}
+
+static uint32_t content_read_le32(const unsigned char* input)
+{
+   return (uint32_t)input[0]         | ((uint32_t)input[1] << 8)
+        | ((uint32_t)input[2] << 16) | ((uint32_t)input[3] << 24);
+}
+
+/* Writes the header of the block whose content is already
+ * in place after it. Returns where the next block starts. */
+static unsigned char* content_write_block_header(unsigned char* output,
+      unsigned version, const char* header, size_t size)
+{
+   size_t header_size = RASTATE_BLOCK_HEADER_SIZE(version);
+
    memcpy(output, header, 4);
-   output[4] = ((size) & 0xFF);
-   output[5] = ((size >> 8) & 0xFF);
-   output[6] = ((size >> 16) & 0xFF);
-   output[7] = ((size >> 24) & 0xFF);
+   content_write_le32(output + 4, (uint32_t)size);
+
+   if (version >= 2)
+   {
+      XXH64_hash_t hash = XXH3_64bits(output + header_size, size);
+      content_write_le32(output +  8, (uint32_t)hash);
+      content_write_le32(output + 12, (uint32_t)(hash >> 32));
+   }
+
+   return output + header_size + CONTENT_ALIGN_SIZE(size);
+}
+
+/* Scales the last frame down to RGB565, nearest neighbour */
+static void content_write_thumbnail(unsigned char* output,
+      const rastate_size_info_t* size)
+{
+   unsigned x, y;
+   const uint8_t *frame = (const uint8_t*)size->frame;
+   unsigned scale       = size->thumbnail_scale;
+
+   content_write_le32(output,     size->thumbnail_width);
+   content_write_le32(output + 4, size->thumbnail_height);
+   output += RASTATE_THUMBNAIL_HEADER_SIZE;
+
+   for (y = 0; y < size->thumbnail_height; y++)
+   {
+      const uint8_t *row = frame + y * scale * size->frame_pitch;
+
+      for (x = 0; x < size->thumbnail_width; x++)
+      {
+         uint16_t pixel;
+
+         switch (size->frame_format)
+         {
+            case RETRO_PIXEL_FORMAT_XRGB8888:
+            {
+               uint32_t col = ((const uint32_t*)row)[x * scale];
+               pixel        = (uint16_t)(((col >> 8) & 0xF800)
+                     | ((col >> 5) & 0x07E0) | ((col >> 3) & 0x001F));
+               break;
+            }
+            case RETRO_PIXEL_FORMAT_0RGB1555:
+            {
+               uint16_t col = ((const uint16_t*)row)[x * scale];
+               pixel        = (uint16_t)(((col << 1) & 0xFFC0)
+                     | ((col >> 4) & 0x0020) | (col & 0x001F));
+               break;
+            }
+            default:
+               pixel        = ((const uint16_t*)row)[x * scale];
+               break;
+         }
+
+         output[0] = (unsigned char)(pixel & 0xFF);
+         output[1] = (unsigned char)(pixel >> 8);
+         output   += 2;
+      }
+   }
 }
 
 static bool content_write_serialized_state(void* buffer,
@@ -641,35 +1232,52 @@ static bool content_write_serialized_state(void* buffer,
 {
    retro_ctx_serialize_info_t serial_info;
    unsigned char* output = (unsigned char*)buffer;
+   size_t header_size    = RASTATE_BLOCK_HEADER_SIZE(size->version);
 
-   /* 8-byte identifier "RASTATE1" where 1 is the version */
+   /* 8-byte identifier "RASTATE2" where 2 is the version */
    memcpy(output, "RASTATE", 7);
-   output[7] = RASTATE_VERSION;
+   output[7] = size->version;
    output   += 8;
 
-   /* important - write the unaligned size - some cores fail if they aren't passed the exact right size. */
-   content_write_block_header(output, RASTATE_MEM_BLOCK, size->coremem_size);
-   output += 8;
+   /* Previews first, readers can stop before the core state */
+   if (size->thumbnail_size)
+   {
+      if (size->thumbnail)
+         memcpy(output + header_size, size->thumbnail,
+               size->thumbnail_size);
+      else
+         content_write_thumbnail(output + header_size, size);
+      output = content_write_block_header(output, size->version,
+            RASTATE_THUMBNAIL_BLOCK, size->thumbnail_size);
+   }
+
+   if (size->sram_size)
+   {
+      memcpy(output + header_size, size->sram, size->sram_size);
+      output = content_write_block_header(output, size->version,
+            RASTATE_SRAM_BLOCK, size->sram_size);
+   }
 
    /* important - pass the unaligned size to the core. some fail if it isn't exactly what they're expecting. */
    serial_info.size = size->coremem_size;
-   serial_info.data = (void*)output;
+   serial_info.data = (void*)(output + header_size);
    if (!core_serialize(&serial_info))
       return false;
 
-   output += CONTENT_ALIGN_SIZE(size->coremem_size);
+   /* important - write the unaligned size - some cores fail if they aren't passed the exact right size. */
+   output = content_write_block_header(output, size->version,
+         RASTATE_MEM_BLOCK, size->coremem_size);
 
 #ifdef HAVE_CHEEVOS
    if (size->cheevos_size)
    {
-      content_write_block_header(output,
-            RASTATE_CHEEVOS_BLOCK, size->cheevos_size);
-      if (rcheevos_get_serialized_data(output + 8))
-         output += CONTENT_ALIGN_SIZE(size->cheevos_size) + 8;
+      if (rcheevos_get_serialized_data(output + header_size))
+         output = content_write_block_header(output, size->version,
+               RASTATE_CHEEVOS_BLOCK, size->cheevos_size);
    }
 #endif
 
-   content_write_block_header(output, RASTATE_END_BLOCK, 0);
+   content_write_block_header(output, size->version, RASTATE_END_BLOCK, 0);
 
    return true;
 }
@@ -677,36 +1285,298 @@ static bool content_write_serialized_state(void* buffer,
 bool content_serialize_state(void* buffer, size_t buffer_size)
 {
    rastate_size_info_t size;
-   size_t len = content_get_rastate_size(&size);
+   size_t len = content_get_rastate_size(&size, RASTATE_VERSION_BARE);
    if (len == 0 || len > buffer_size)
       return false;
    return content_write_serialized_state(buffer, &size);
 }
 
-static void *content_get_serialized_data(size_t* serial_size)
+/**
+ * content_serialize_to_buf:
+ * @buf : buffer to serialize into
+ *
+ * Serializes the current state into @buf, reusing
+ * its memory if it is large enough.
+ *
+ * @return true if successful, otherwise false.
+ **/
+static bool content_serialize_to_buf(struct save_state_buf *buf)
 {
-   size_t len;
-   void* data;
    rastate_size_info_t size;
-   if ((len = content_get_rastate_size(&size)) == 0)
-      return NULL;
+   size_t len = content_get_rastate_size(&size, RASTATE_VERSION);
+
+   buf->size  = 0;
+
+   if (!len)
+      return false;
+
+   content_get_rastate_previews(&size);
+   len        = size.total_size;
+
+   if (!save_state_buf_reserve(buf, len))
+      return false;
 
    /* Ensure buffer is initialised to zero
     * > Prevents inconsistent compressed state file
     *   sizes when core requests a larger buffer
     *   than it needs (and leaves the excess
     *   as uninitialised garbage) */
-   if (!(data = calloc(len, 1)))
-      return NULL;
+   memset(buf->data, 0, len);
 
-   if (!content_write_serialized_state(data, &size))
+   if (!content_write_serialized_state(buf->data, &size))
+      return false;
+
+   buf->size = size.total_size;
+   return true;
+}
+
+/* Returns the write of 'path' that has not been started
+ * yet. There is at most one, later saves replace its data. */
+static struct save_state_write *save_state_write_find_queued(
+      const char *path)
+{
+   size_t i;
+   for (i = 0; i < SAVE_STATE_WRITES; i++)
    {
-      free(data);
-      return NULL;
+      struct save_state_write *write = &save_state_writes[i];
+      if (     write->busy
+            && !write->started
+            && string_is_equal(write->path, path))
+         return write;
+   }
+   return NULL;
+}
+
+static struct save_state_write *save_state_write_acquire(
+      const char *path)
+{
+   size_t i;
+   struct save_state_write *write = NULL;
+
+   save_state_writes_lock_acquire();
+   for (i = 0; i < SAVE_STATE_WRITES; i++)
+   {
+      if (!save_state_writes[i].busy)
+      {
+         write          = &save_state_writes[i];
+         write->busy    = true;
+         write->started = false;
+         write->size    = 0;
+         strlcpy(write->path, path, sizeof(write->path));
+         break;
+      }
+   }
+   save_state_writes_lock_release();
+
+   return write;
+}
+
+static void save_state_write_free(struct save_state_write *write)
+{
+   free(write->data);
+   free(write->preview);
+   write->data                   = NULL;
+   write->capacity               = 0;
+   write->preview                = NULL;
+   write->preview_capacity       = 0;
+   write->preview_thumbnail_size = 0;
+   write->preview_sram_size      = 0;
+}
+
+static void save_state_write_release(struct save_state_write *write)
+{
+   save_state_writes_lock_acquire();
+   write->busy    = false;
+   write->started = false;
+   if (write->discard)
+   {
+      save_state_write_free(write);
+      write->discard  = false;
    }
+   save_state_writes_lock_release();
+}
+
+/* Called by the save task before it touches the file.
+ * Fails while another write of the same file is still
+ * in progress, the task retries on its next iteration. */
+static bool save_state_write_begin(struct save_state_write *write)
+{
+   size_t i;
+   bool ret = true;
 
-   *serial_size = size.total_size;
-   return data;
+   save_state_writes_lock_acquire();
+   for (i = 0; i < SAVE_STATE_WRITES; i++)
+   {
+      struct save_state_write *other = &save_state_writes[i];
+      if (     other != write
+            && other->busy
+            && other->started
+            && string_is_equal(other->path, write->path))
+         ret = false;
+   }
+   if (ret)
+      write->started = true;
+   save_state_writes_lock_release();
+
+   return ret;
+}
+
+/* Copies the previews of the next state of 'write' for
+ * the save task, which serializes it while the core keeps
+ * running. Main thread only. Without memory for them, the
+ * state is saved without previews. */
+static void save_state_write_capture(struct save_state_write *write)
+{
+   rastate_size_info_t size;
+   size_t len;
+
+   memset(&size, 0, sizeof(size));
+   size.version = RASTATE_VERSION;
+   content_get_rastate_previews(&size);
+
+   write->preview_thumbnail_size = 0;
+   write->preview_sram_size      = 0;
+
+   if (!(len = size.thumbnail_size + size.sram_size))
+      return;
+
+   if (len > write->preview_capacity)
+   {
+      free(write->preview);
+      write->preview_capacity = 0;
+      if (!(write->preview = malloc(len)))
+         return;
+      write->preview_capacity = len;
+   }
+
+   if (size.thumbnail_size)
+      content_write_thumbnail((unsigned char*)write->preview, &size);
+   if (size.sram_size)
+      memcpy((unsigned char*)write->preview + size.thumbnail_size,
+            size.sram, size.sram_size);
+
+   write->preview_thumbnail_size = size.thumbnail_size;
+   write->preview_sram_size      = size.sram_size;
+}
+
+/* Serializes the current state into the buffer of 'write',
+ * which must not be started, or be owned by the caller.
+ * In the background, the previews are those captured by
+ * save_state_write_capture(). */
+static bool save_state_write_serialize(struct save_state_write *write)
+{
+   rastate_size_info_t size;
+   size_t len  = content_get_rastate_size(&size, RASTATE_VERSION);
+
+   write->size = 0;
+
+   if (!len)
+      return false;
+
+   if (save_state_in_background)
+   {
+      if ((size.thumbnail_size = write->preview_thumbnail_size))
+      {
+         size.thumbnail = write->preview;
+         content_add_rastate_block(&size, size.thumbnail_size);
+      }
+      if ((size.sram_size = write->preview_sram_size))
+      {
+         size.sram = (const unsigned char*)write->preview
+               + write->preview_thumbnail_size;
+         content_add_rastate_block(&size, size.sram_size);
+      }
+   }
+   else
+      content_get_rastate_previews(&size);
+
+   len         = size.total_size;
+
+   if (len > write->capacity)
+   {
+      free(write->data);
+      write->capacity = 0;
+      if (!(write->data = malloc(len)))
+         return false;
+      write->capacity = len;
+   }
+
+   /* Zeroed for the same reason as in
+    * content_serialize_to_buf() */
+   memset(write->data, 0, len);
+
+   if (!content_write_serialized_state(write->data, &size))
+      return false;
+
+   write->size = size.total_size;
+   return true;
+}
+
+static bool save_state_writes_full(void *data)
+{
+   size_t i;
+   for (i = 0; i < SAVE_STATE_WRITES; i++)
+      if (!save_state_writes[i].busy)
+         return false;
+   return true;
+}
+
+static bool save_state_write_pending(void *data)
+{
+   size_t i;
+   const char *path = (const char*)data;
+   for (i = 0; i < SAVE_STATE_WRITES; i++)
+      if (     save_state_writes[i].busy
+            && string_is_equal(save_state_writes[i].path, path))
+         return true;
+   return false;
+}
+
+/* Waits for the writes of 'path' to finish, before it
+ * is read or replaced by something other than a save */
+static void save_state_write_wait(const char *path)
+{
+   if (save_state_write_pending((void*)path))
+      task_queue_wait(save_state_write_pending, (void*)path);
+}
+
+/**
+ * task_save_read_backup:
+ * @state : the save task state
+ *
+ * Reads the state file about to be overwritten,
+ * so that content_undo_save_state() can restore it.
+ **/
+static void task_save_read_backup(save_task_state_t *state)
+{
+   int64_t size;
+#if defined(HAVE_ZLIB)
+   /* Handles uncompressed files as well */
+   intfstream_t *file = intfstream_open_rzip_file(state->path,
+         RETRO_VFS_FILE_ACCESS_READ);
+#else
+   intfstream_t *file = intfstream_open_file(state->path,
+         RETRO_VFS_FILE_ACCESS_READ,
+         RETRO_VFS_FILE_ACCESS_HINT_NONE);
+#endif
+
+   if (!file)
+      return;
+
+   if (     (size = intfstream_get_size(file)) > 0
+         && (state->undo_data = malloc((size_t)size)))
+   {
+      if (intfstream_read(file, state->undo_data, size) == size)
+         state->undo_size = (ssize_t)size;
+      else
+      {
+         free(state->undo_data);
+         state->undo_data = NULL;
+      }
+   }
+
+   intfstream_close(file);
+   free(file);
 }
 
 /**
@@ -721,30 +1591,39 @@ static void task_save_handler(retro_task_t *task)
    int written              = 0;
    save_task_state_t *state = (save_task_state_t*)task->state;
 
-   if (!state->file)
+   if (!state->file && !state->data && state->write)
+   {
+      if (!save_state_write_begin(state->write))
+         return;
+
+      /* The buffer belongs to this task from here on. Cores
+       * that save in the background are serialized here. */
+      if (     !save_state_in_background
+            || save_state_write_serialize(state->write))
+      {
+         state->data = state->write->size ? state->write->data : NULL;
+         state->size = (ssize_t)state->write->size;
+      }
+
+      if (state->data && state->load_to_backup_buffer)
+         task_save_read_backup(state);
+   }
+
+   if (!state->file && state->data)
    {
       if (state->compress_files)
-         state->file   = intfstream_open_rzip_file(
-               state->path, RETRO_VFS_FILE_ACCESS_WRITE);
+         state->file   = intfstream_open_rzip_file_codec(
+               state->path, RETRO_VFS_FILE_ACCESS_WRITE,
+               state->compress_lz4 ? RZIP_CODEC_LZ4 : RZIP_CODEC_ZLIB);
       else
          state->file   = intfstream_open_file(
                state->path, RETRO_VFS_FILE_ACCESS_WRITE,
                RETRO_VFS_FILE_ACCESS_HINT_NONE);
-
-      if (!state->file)
-         return;
-   }
-
-   if (!state->data)
-   {
-      size_t size = 0;
-      state->data = content_get_serialized_data(&size);
-      state->size = (ssize_t)size;
    }
 
    remaining       = MIN(state->size - state->written, SAVE_STATE_CHUNK);
 
-   if (state->data)
+   if (state->file)
    {
       written         = (int)intfstream_write(state->file,
          (uint8_t*)state->data + state->written, remaining);
@@ -753,7 +1632,9 @@ static void task_save_handler(retro_task_t *task)
 
    task_set_progress(task, (state->written / (float)state->size) * 100);
 
-   if (task_get_cancelled(task) || written != remaining)
+   if (     task_get_cancelled(task)
+         || !state->file
+         || written != remaining)
    {
       size_t err_size = 8192 * sizeof(char);
       char *err       = (char*)malloc(err_size);
@@ -845,8 +1726,10 @@ static bool task_push_undo_save_state(const char *path, void *data, size_t size)
    state->has_valid_framebuffer  = video_driver_cached_frame_has_valid_framebuffer();
 #if defined(HAVE_ZLIB)
    state->compress_files         = settings->bools.savestate_file_compression;
+   state->compress_lz4           = settings->bools.savestate_file_compression_lz4;
 #else
    state->compress_files         = false;
+   state->compress_lz4           = false;
 #endif
    task->type                    = TASK_TYPE_BLOCKING;
    task->state                   = state;
@@ -878,10 +1761,13 @@ error:
 bool content_undo_save_state(void)
 {
    if (core_info_current_supports_savestate())
+   {
+      save_state_write_wait(undo_save_buf.path);
       return task_push_undo_save_state(
             undo_save_buf.path,
             undo_save_buf.data,
             undo_save_buf.size);
+   }
    RARCH_LOG("[State]: %s\n",
          msg_hash_to_str(MSG_CORE_DOES_NOT_SUPPORT_SAVESTATES));
    return false;
@@ -1036,9 +1922,11 @@ end:
    task_load_handler_finished(task, state);
 }
 
-static bool content_load_rastate1(unsigned char* input, size_t size)
+static bool content_load_rastate(unsigned char* input, size_t size)
 {
    unsigned char *stop = input + size;
+   unsigned version    = input[7];
+   size_t header_size  = RASTATE_BLOCK_HEADER_SIZE(version);
    bool seen_core      = false;
 #ifdef HAVE_CHEEVOS
    bool seen_cheevos   = false;
@@ -1046,13 +1934,39 @@ static bool content_load_rastate1(unsigned char* input, size_t size)
 
    input += 8;
 
-   while (input < stop)
+   while ((size_t)(stop - input) >= header_size)
    {
-      size_t     block_size = ( input[7] << 24 
-            | input[6] << 16 |  input[5] << 8 | input[4]);
+      size_t     block_size = content_read_le32(input + 4);
       unsigned char *marker = input;
 
-      input += 8;
+      input += header_size;
+
+      if (version >= 2)
+      {
+         XXH64_hash_t hash;
+
+         if (block_size > (size_t)(stop - input))
+         {
+            RARCH_ERR("[State]: Block \"%.4s\" is truncated.\n", marker);
+            return false;
+         }
+
+         hash = (XXH64_hash_t)content_read_le32(marker + 8)
+              | ((XXH64_hash_t)content_read_le32(marker + 12) << 32);
+         if (XXH3_64bits(input, block_size) != hash)
+         {
+            /* Previews are not needed to restore the state */
+            if (     memcmp(marker, RASTATE_THUMBNAIL_BLOCK, 4) == 0
+                  || memcmp(marker, RASTATE_SRAM_BLOCK, 4) == 0)
+            {
+               RARCH_WARN("[State]: Block \"%.4s\" is corrupt, skipping.\n",
+                     marker);
+               goto next;
+            }
+            RARCH_ERR("[State]: Block \"%.4s\" is corrupt.\n", marker);
+            return false;
+         }
+      }
 
       if (memcmp(marker, RASTATE_MEM_BLOCK, 4) == 0)
       {
@@ -1074,6 +1988,9 @@ static bool content_load_rastate1(unsigned char* input, size_t size)
       else if (memcmp(marker, RASTATE_END_BLOCK, 4) == 0)
          break;
 
+next:
+      if (CONTENT_ALIGN_SIZE(block_size) > (size_t)(stop - input))
+         break;
       input += CONTENT_ALIGN_SIZE(block_size);
    }
 
@@ -1106,18 +2023,220 @@ bool content_deserialize_state(
    }
    else
    {
-      unsigned char* input = (unsigned char*)serialized_data;
-      switch (input[7]) /* version */
-      {
-         case 1:
-            if (content_load_rastate1(input, serialized_size))
-               break;
-            /* fall-through intentional */
-         default:
-            return false;
-      }
+      unsigned char* input = (unsigned char*)serialized_data;
+      switch (input[7]) /* version */
+      {
+         case 1:
+         case 2:
+            if (content_load_rastate(input, serialized_size))
+               break;
+            /* fall-through intentional */
+         default:
+            return false;
+      }
+   }
+
+   return true;
+}
+
+/* Reads and discards 'len' bytes of 'stream' */
+static bool content_state_skip(rzipstream_t *stream, size_t len)
+{
+   uint8_t tmp[4096];
+
+   while (len)
+   {
+      size_t chunk = len > sizeof(tmp) ? sizeof(tmp) : len;
+      if (rzipstream_read(stream, tmp, chunk) != (int64_t)chunk)
+         return false;
+      len -= chunk;
+   }
+
+   return true;
+}
+
+/**
+ * content_load_state_thumbnail:
+ * @path          : path of the state.
+ * @image         : where to load the thumbnail, may be NULL.
+ * @supports_rgba : if true, pixels are ABGR8888 instead of ARGB8888.
+ *
+ * Loads the thumbnail block of a RASTATE2 state. The blocks
+ * before it are skipped, the core state is never read.
+ *
+ * @return true if the state has a valid thumbnail, otherwise false.
+ **/
+bool content_load_state_thumbnail(const char *path,
+      struct texture_image *image, bool supports_rgba)
+{
+   unsigned char header[16];
+   rzipstream_t *stream   = NULL;
+   unsigned char *data    = NULL;
+   bool ret               = false;
+
+   if (!(stream = rzipstream_open(path, RETRO_VFS_FILE_ACCESS_READ)))
+      return false;
+
+   /* Only a few KB are read, workers would not pay off */
+   rzipstream_set_threads(stream, 1);
+
+   if (     rzipstream_read(stream, header, 8) != 8
+         || memcmp(header, "RASTATE", 7) != 0
+         || header[7] < 2)
+      goto end;
+
+   for (;;)
+   {
+      size_t size, i;
+      uint32_t width, height;
+      XXH64_hash_t hash;
+
+      if (rzipstream_read(stream, header, 16) != 16)
+         goto end;
+
+      size = content_read_le32(header + 4);
+
+      if (memcmp(header, RASTATE_THUMBNAIL_BLOCK, 4) != 0)
+      {
+         /* The thumbnail is written first, give up at the core state */
+         if (     memcmp(header, RASTATE_MEM_BLOCK, 4) == 0
+               || memcmp(header, RASTATE_END_BLOCK, 4) == 0
+               || !content_state_skip(stream, CONTENT_ALIGN_SIZE(size)))
+            goto end;
+         continue;
+      }
+
+      if (     size < RASTATE_THUMBNAIL_HEADER_SIZE
+            || !(data = (unsigned char*)malloc(size))
+            || rzipstream_read(stream, data, size) != (int64_t)size)
+         goto end;
+
+      hash = (XXH64_hash_t)content_read_le32(header + 8)
+           | ((XXH64_hash_t)content_read_le32(header + 12) << 32);
+      width  = content_read_le32(data);
+      height = content_read_le32(data + 4);
+
+      if (     XXH3_64bits(data, size) != hash
+            || !width
+            || !height
+            || width  > RASTATE_THUMBNAIL_MAX_WIDTH
+            || height > RASTATE_THUMBNAIL_MAX_HEIGHT
+            || size < RASTATE_THUMBNAIL_HEADER_SIZE
+                  + (size_t)width * height * 2)
+         goto end;
+
+      ret = true;
+
+      if (!image)
+         goto end;
+
+      if (!(image->pixels = (uint32_t*)malloc(
+               (size_t)width * height * sizeof(uint32_t))))
+      {
+         ret = false;
+         goto end;
+      }
+
+      image->width         = width;
+      image->height        = height;
+      image->supports_rgba = supports_rgba;
+
+      /* RGB565 to ARGB8888 */
+      for (i = 0; i < (size_t)width * height; i++)
+      {
+         const unsigned char *src = data
+               + RASTATE_THUMBNAIL_HEADER_SIZE + i * 2;
+         uint16_t col = (uint16_t)(src[0] | (src[1] << 8));
+         uint32_t r   = ((col >> 11) & 0x1F) << 3;
+         uint32_t g   = ((col >>  5) & 0x3F) << 2;
+         uint32_t b   = ( col        & 0x1F) << 3;
+
+         r |= r >> 5;
+         g |= g >> 6;
+         b |= b >> 5;
+
+         if (supports_rgba)
+            image->pixels[i] = 0xFF000000 | (b << 16) | (g << 8) | r;
+         else
+            image->pixels[i] = 0xFF000000 | (r << 16) | (g << 8) | b;
+      }
+
+      goto end;
+   }
+
+end:
+   free(data);
+   rzipstream_close(stream);
+   return ret;
+}
+
+typedef struct
+{
+   bool supports_rgba;
+   char path[PATH_MAX_LENGTH];
+} state_thumbnail_task_state_t;
+
+static void task_load_state_thumbnail_handler(retro_task_t *task)
+{
+   state_thumbnail_task_state_t *state =
+      (state_thumbnail_task_state_t*)task->state;
+   struct texture_image *img           = (struct texture_image*)
+      calloc(1, sizeof(*img));
+
+   if (img && content_load_state_thumbnail(
+            state->path, img, state->supports_rgba))
+      task_set_data(task, img);
+   else
+      free(img);
+
+   task_set_finished(task, true);
+}
+
+static void task_load_state_thumbnail_free(retro_task_t *task)
+{
+   free(task->state);
+   task->state = NULL;
+}
+
+/**
+ * task_push_load_state_thumbnail:
+ * @path          : path of the state.
+ * @supports_rgba : if true, pixels are ABGR8888 instead of ARGB8888.
+ * @cb            : called with the struct texture_image, or NULL
+ *                  if the state has no thumbnail.
+ * @user_data     : passed to @cb.
+ *
+ * Loads the thumbnail of a state in the background, the
+ * counterpart of task_push_image_load() for states saved
+ * without a .png screenshot.
+ *
+ * @return true if the task was queued, otherwise false.
+ **/
+bool task_push_load_state_thumbnail(const char *path,
+      bool supports_rgba, retro_task_callback_t cb, void *user_data)
+{
+   retro_task_t *task                  = task_init();
+   state_thumbnail_task_state_t *state = (state_thumbnail_task_state_t*)
+      calloc(1, sizeof(*state));
+
+   if (!task || !state)
+   {
+      free(state);
+      free(task);
+      return false;
    }
 
+   strlcpy(state->path, path, sizeof(state->path));
+   state->supports_rgba = supports_rgba;
+
+   task->state          = state;
+   task->handler        = task_load_state_thumbnail_handler;
+   task->cleanup        = task_load_state_thumbnail_free;
+   task->callback       = cb;
+   task->user_data      = user_data;
+
+   task_queue_push(task);
+
    return true;
 }
 
@@ -1161,20 +2280,14 @@ static void content_load_state_cb(retro_task_t *task,
    if (load_data->load_to_backup_buffer)
    {
       /* If we were previously backing up a file, let go of it first */
-      if (undo_save_buf.data)
-      {
-         free(undo_save_buf.data);
-         undo_save_buf.data = NULL;
-      }
+      save_state_buf_release(&undo_save_buf);
 
-      if (!(undo_save_buf.data = malloc(size)))
-         goto error;
-
-      memcpy(undo_save_buf.data, buf, size);
-      undo_save_buf.size = size;
+      /* Keep the loaded buffer instead of copying it */
+      undo_save_buf.data     = buf;
+      undo_save_buf.size     = size;
+      undo_save_buf.capacity = size;
       strlcpy(undo_save_buf.path, load_data->path, sizeof(undo_save_buf.path));
 
-      free(buf);
       free(load_data);
       return;
    }
@@ -1289,29 +2402,99 @@ static void save_state_cb(retro_task_t *task,
    free(path);
 #endif
 
+   if (state->write)
+      save_state_write_release(state->write);
+
+   /* Keep what was overwritten, for content_undo_save_state() */
+   if (state->undo_data)
+   {
+      save_state_buf_release(&undo_save_buf);
+      undo_save_buf.data     = state->undo_data;
+      undo_save_buf.size     = state->undo_size;
+      undo_save_buf.capacity = state->undo_size;
+      strlcpy(undo_save_buf.path, state->path,
+            sizeof(undo_save_buf.path));
+   }
+
    free(state);
 }
 
 /**
  * task_push_save_state:
- * @path : file path of the save state
- * @data : the save state data to write
- * @size : the total size of the save state
+ * @path     : file path of the save state
+ * @autosave : true if this is an automatic save
+ *
+ * Serialize the content state and create a new task to save it.
+ *
+ * The state is serialized into one of the SAVE_STATE_WRITES
+ * buffers, so a save can be made while the previous one is
+ * still being compressed and written. A save of a file that
+ * is still waiting to be written replaces the state waiting
+ * for it instead of adding a task. The main thread only
+ * waits when every buffer is in use.
  *
- * Create a new task to save the content state.
+ * Returns: true if successful, false otherwise.
  **/
-static void task_push_save_state(const char *path, void *data, size_t size, bool autosave)
+static bool task_push_save_state(const char *path, bool autosave)
 {
    settings_t     *settings        = config_get_ptr();
-   retro_task_t       *task        = task_init();
-   save_task_state_t *state        = (save_task_state_t*)calloc(1, sizeof(*state));
+   retro_task_t       *task        = NULL;
+   save_task_state_t *state        = NULL;
+   struct save_state_write *write  = NULL;
+   bool ret                        = true;
+
+   save_state_writes_lock_acquire();
+   if ((write = save_state_write_find_queued(path)))
+   {
+      /* Cores that save in the background are serialized
+       * by the task, which will pick up the newer state */
+      if (!save_state_in_background)
+         ret = save_state_write_serialize(write);
+      else
+         save_state_write_capture(write);
+   }
+   save_state_writes_lock_release();
+
+   if (write)
+   {
+      if (ret)
+         RARCH_LOG("[State]: %s \"%s\", %u %s.\n",
+               msg_hash_to_str(MSG_SAVING_STATE),
+               path,
+               (unsigned)write->size,
+               msg_hash_to_str(MSG_BYTES));
+      return ret;
+   }
+
+   if (!(write = save_state_write_acquire(path)))
+   {
+      task_queue_wait(save_state_writes_full, NULL);
+      if (!(write = save_state_write_acquire(path)))
+         return false;
+   }
+
+   if (!save_state_in_background)
+   {
+      if (!save_state_write_serialize(write))
+         goto error;
+
+      RARCH_LOG("[State]: %s \"%s\", %u %s.\n",
+            msg_hash_to_str(MSG_SAVING_STATE),
+            path,
+            (unsigned)write->size,
+            msg_hash_to_str(MSG_BYTES));
+   }
+   else
+      save_state_write_capture(write);
+
+   task                          = task_init();
+   state                         = (save_task_state_t*)calloc(1, sizeof(*state));
 
    if (!task || !state)
       goto error;
 
    strlcpy(state->path, path, sizeof(state->path));
-   state->data                   = data;
-   state->size                   = size;
+   state->write                  = write;
    state->autosave               = autosave;
    state->mute                   = autosave; /* don't show OSD messages if we are auto-saving */
    state->thumbnail_enable       = settings->bools.savestate_thumbnail_enable;
@@ -1319,129 +2502,45 @@ static void task_push_save_state(const char *path, void *data, size_t size, bool
    state->has_valid_framebuffer  = video_driver_cached_frame_has_valid_framebuffer();
 #if defined(HAVE_ZLIB)
    state->compress_files         = settings->bools.savestate_file_compression;
+   state->compress_lz4           = settings->bools.savestate_file_compression_lz4;
 #else
    state->compress_files         = false;
+   state->compress_lz4           = false;
 #endif
 
-   task->type                    = TASK_TYPE_BLOCKING;
+   /* Before overwriting the savestate file, load it into a buffer
+    * to allow undo_save_state() to work */
+   if (!autosave && path_is_valid(path))
+   {
+      RARCH_LOG("[State]: %s ...\n",
+            msg_hash_to_str(MSG_FILE_ALREADY_EXISTS_SAVING_TO_BACKUP_BUFFER));
+      state->load_to_backup_buffer = true;
+   }
+
+   /* Not blocking: saves must never be dropped because another
+    * task is running, save_state_write_begin() orders the
+    * writes of each file */
+   task->type                    = TASK_TYPE_NONE;
    task->state                   = state;
    task->handler                 = task_save_handler;
    task->callback                = save_state_cb;
    task->title                   = strdup(msg_hash_to_str(MSG_SAVING_STATE));
    task->mute                    = state->mute;
 
-   if (!task_queue_push(task))
-   {
-      /* Another blocking task is already active. */
-      if (data)
-         free(data);
-      if (task->title)
-         task_free_title(task);
-      free(task);
-      free(state);
-   }
+   task_queue_push(task);
 
-   return;
+   return true;
 
 error:
-   if (data)
-      free(data);
+   RARCH_ERR("[State]: %s \"%s\".\n",
+         msg_hash_to_str(MSG_FAILED_TO_SAVE_STATE_TO),
+         path);
+   save_state_write_release(write);
    if (state)
       free(state);
    if (task)
-   {
-      if (task->title)
-         task_free_title(task);
-      free(task);
-   }
-}
-
-/**
- * content_load_and_save_state_cb:
- * @path      : path that state will be loaded from.
- * Load then save a state.
- *
- **/
-static void content_load_and_save_state_cb(retro_task_t *task,
-      void *task_data,
-      void *user_data, const char *error)
-{
-   load_task_data_t *load_data = (load_task_data_t*)task_data;
-   char                  *path = strdup(load_data->path);
-   void                  *data = load_data->undo_data;
-   size_t                 size = load_data->undo_size;
-   bool               autosave = load_data->autosave;
-
-   content_load_state_cb(task, task_data, user_data, error);
-
-   task_push_save_state(path, data, size, autosave);
-
-   free(path);
-}
-
-/**
- * task_push_load_and_save_state:
- * @path : file path of the save state
- * @data : the save state data to write
- * @size : the total size of the save state
- * @load_to_backup_buffer : If true, the state will be loaded into undo_save_buf.
- *
- * Create a new task to load current state first into a backup buffer (for undo)
- * and then save the content state.
- **/
-static void task_push_load_and_save_state(const char *path, void *data,
-      size_t size, bool load_to_backup_buffer, bool autosave)
-{
-   retro_task_t      *task     = NULL;
-   settings_t        *settings = config_get_ptr();
-   save_task_state_t *state    = (save_task_state_t*)
-      calloc(1, sizeof(*state));
-
-   if (!state)
-      return;
-
-   if (!(task = task_init()))
-   {
-      free(state);
-      return;
-   }
-
-
-   strlcpy(state->path, path, sizeof(state->path));
-   state->load_to_backup_buffer  = load_to_backup_buffer;
-   state->undo_size              = size;
-   state->undo_data              = data;
-   state->autosave               = autosave;
-   state->mute                   = autosave; /* don't show OSD messages if we 
-                                    are auto-saving */
-   if (load_to_backup_buffer)
-      state->mute                = true;
-   state->state_slot             = settings->ints.state_slot;
-   state->has_valid_framebuffer  = 
-      video_driver_cached_frame_has_valid_framebuffer();
-#if defined(HAVE_ZLIB)
-   state->compress_files         = settings->bools.savestate_file_compression;
-#else
-   state->compress_files         = false;
-#endif
-
-   task->state                   = state;
-   task->type                    = TASK_TYPE_BLOCKING;
-   task->handler                 = task_load_handler;
-   task->callback                = content_load_and_save_state_cb;
-   task->title                   = strdup(msg_hash_to_str(MSG_LOADING_STATE));
-   task->mute                    = state->mute;
-
-   if (!task_queue_push(task))
-   {
-      /* Another blocking task is already active. */
-      if (data)
-         free(data);
-      if (task->title)
-         task_free_title(task);
       free(task);
-      free(state);
-   }
+   return false;
 }
 
 /**
@@ -1454,9 +2553,7 @@ static void task_push_load_and_save_state(const char *path, void *data,
  **/
 bool content_save_state(const char *path, bool save_to_disk, bool autosave)
 {
-   size_t serial_size;
    retro_ctx_size_info_t info;
-   void *data  = NULL;
 
    if (!core_info_current_supports_savestate())
    {
@@ -1469,75 +2566,23 @@ bool content_save_state(const char *path, bool save_to_disk, bool autosave)
 
    if (info.size == 0)
       return false;
-   serial_size = info.size;
-
-   if (!save_state_in_background)
-   {
-      if (!(data = content_get_serialized_data(&serial_size)))
-      {
-         RARCH_ERR("[State]: %s \"%s\".\n",
-               msg_hash_to_str(MSG_FAILED_TO_SAVE_STATE_TO),
-               path);
-         return false;
-      }
-
-      RARCH_LOG("[State]: %s \"%s\", %u %s.\n",
-            msg_hash_to_str(MSG_SAVING_STATE),
-            path,
-            (unsigned)serial_size,
-            msg_hash_to_str(MSG_BYTES));
-   }
 
    if (save_to_disk)
-   {
-      if (path_is_valid(path) && !autosave)
-      {
-         /* Before overwriting the savestate file, load it into a buffer
-         to allow undo_save_state() to work */
-         /* TODO/FIXME - Use msg_hash_to_str here */
-         RARCH_LOG("[State]: %s ...\n",
-               msg_hash_to_str(MSG_FILE_ALREADY_EXISTS_SAVING_TO_BACKUP_BUFFER));
+      return task_push_save_state(path, autosave);
 
-         task_push_load_and_save_state(path, data, serial_size, true, autosave);
-      }
-      else
-         task_push_save_state(path, data, serial_size, autosave);
-   }
-   else
+   /* save_to_disk is false, which means we are saving the state
+   in undo_load_buf to allow content_undo_load_state() to restore it.
+   An old state held there is overwritten in place. */
+   if (!content_serialize_to_buf(&undo_load_buf))
    {
-      if (!data)
-      {
-         if (!(data = content_get_serialized_data(&serial_size)))
-         {
-            RARCH_ERR("[State]: %s \"%s\".\n",
-                  msg_hash_to_str(MSG_FAILED_TO_SAVE_STATE_TO),
-                  path);
-            return false;
-         }
-      }
-
-      /* save_to_disk is false, which means we are saving the state
-      in undo_load_buf to allow content_undo_load_state() to restore it */
-
-      /* If we were holding onto an old state already, clean it up first */
-      if (undo_load_buf.data)
-      {
-         free(undo_load_buf.data);
-         undo_load_buf.data = NULL;
-      }
-
-      if (!(undo_load_buf.data = malloc(serial_size)))
-      {
-         free(data);
-         return false;
-      }
-
-      memcpy(undo_load_buf.data, data, serial_size);
-      free(data);
-      undo_load_buf.size = serial_size;
-      strlcpy(undo_load_buf.path, path, sizeof(undo_load_buf.path));
+      RARCH_ERR("[State]: %s \"%s\".\n",
+            msg_hash_to_str(MSG_FAILED_TO_SAVE_STATE_TO),
+            path);
+      return false;
    }
 
+   strlcpy(undo_load_buf.path, path, sizeof(undo_load_buf.path));
+
    return true;
 }
 
@@ -1595,6 +2640,9 @@ bool content_load_state(const char *path,
       goto error;
    }
 
+   /* The state may still be on its way to this file */
+   save_state_write_wait(path);
+
    task  = task_init();
    state = (save_task_state_t*)calloc(1, sizeof(*state));
 
@@ -1634,6 +2682,9 @@ error:
 
 bool content_rename_state(const char *origin, const char *dest)
 {
+   save_state_write_wait(origin);
+   save_state_write_wait(dest);
+
    if (filestream_exists(dest))
       filestream_delete(dest);
 
@@ -1652,6 +2703,8 @@ bool content_rename_state(const char *origin, const char *dest)
 */
 void content_reset_savestate_backups(void)
 {
+   size_t i;
+
    if (undo_save_buf.data)
    {
       free(undo_save_buf.data);
@@ -1661,24 +2714,65 @@ void content_reset_savestate_backups(void)
    undo_save_buf.path[0] = '\0';
    undo_save_buf.size    = 0;
 
-   if (undo_load_buf.data)
+   save_state_buf_release(&undo_load_buf);
+   undo_load_buf.path[0] = '\0';
+
+   save_state_buf_release(&ram_buf.state_buf);
+   ram_buf.state_buf.path[0] = '\0';
+   ram_buf.to_write_file     = false;
+
+   save_state_writes_lock_acquire();
+   for (i = 0; i < SAVE_STATE_SPARE_BUFS; i++)
    {
-      free(undo_load_buf.data);
-      undo_load_buf.data = NULL;
+      free(save_state_spares[i].data);
+      save_state_spares[i].data     = NULL;
+      save_state_spares[i].capacity = 0;
    }
+   save_state_writes_lock_release();
 
-   undo_load_buf.path[0] = '\0';
-   undo_load_buf.size    = 0;
+   /* Buffers of writes still in progress are
+    * freed when their task is done */
+   save_state_writes_lock_acquire();
+   for (i = 0; i < SAVE_STATE_WRITES; i++)
+   {
+      struct save_state_write *write = &save_state_writes[i];
+      if (write->busy)
+         write->discard  = true;
+      else
+         save_state_write_free(write);
+   }
+   save_state_writes_lock_release();
+}
 
-   if (ram_buf.state_buf.data)
+void content_save_state_init(void)
+{
+#ifdef HAVE_THREADS
+   if (!save_state_writes_lock)
+      save_state_writes_lock = slock_new();
+#endif
+}
+
+void content_save_state_deinit(void)
+{
+   size_t i;
+
+   for (i = 0; i < SAVE_STATE_WRITES; i++)
    {
-      free(ram_buf.state_buf.data);
-      ram_buf.state_buf.data = NULL;
+      save_state_write_free(&save_state_writes[i]);
+      memset(&save_state_writes[i], 0, sizeof(save_state_writes[i]));
    }
 
-   ram_buf.state_buf.path[0] = '\0';
-   ram_buf.state_buf.size    = 0;
-   ram_buf.to_write_file     = false;
+   for (i = 0; i < SAVE_STATE_SPARE_BUFS; i++)
+   {
+      free(save_state_spares[i].data);
+      memset(&save_state_spares[i], 0, sizeof(save_state_spares[i]));
+   }
+
+#ifdef HAVE_THREADS
+   if (save_state_writes_lock)
+      slock_free(save_state_writes_lock);
+   save_state_writes_lock = NULL;
+#endif
 }
 
 bool content_undo_load_buf_is_empty(void)
@@ -1706,6 +2800,95 @@ static bool content_get_memory(retro_ctx_memory_info_t *mem_info,
    return true;
 }
 
+/**
+ * content_load_ram_journal:
+ * @path             : path of the SRAM file
+ * @data             : SRAM, as loaded from @path
+ * @size             : size of @data
+ *
+ * Applies the blocks that were autosaved to the journal since
+ * @path was last written in full, e.g. before a crash.
+ * The journal is skipped if it was started on top of a
+ * different SRAM file.
+ */
+static void content_load_ram_journal(const char *path,
+      uint8_t *data, size_t size)
+{
+   char journal[PATH_MAX_LENGTH];
+   int64_t len;
+   size_t pos, committed;
+   void *buf           = NULL;
+   const uint8_t *jnl  = NULL;
+   unsigned applied    = 0;
+
+   sram_journal_path(journal, sizeof(journal), path);
+
+   if (    !path_is_valid(journal)
+       || !filestream_read_file(journal, &buf, &len))
+      return;
+
+   jnl = (const uint8_t*)buf;
+
+   if (     len < SRAM_JOURNAL_HEADER_SIZE
+         || sram_journal_read_le32(jnl)     != SRAM_JOURNAL_MAGIC
+         || sram_journal_read_le32(jnl + 4) != AUTOSAVE_BLOCK_SIZE
+         || sram_journal_read_le32(jnl + 8) != (uint32_t)size
+         || sram_journal_read_le32(jnl + 12)
+               != encoding_crc32(0, data, size))
+   {
+      free(buf);
+      return;
+   }
+
+   /* Only autosaves that were completely written count */
+   committed = 0;
+   for (pos = SRAM_JOURNAL_HEADER_SIZE;
+         pos + SRAM_JOURNAL_RECORD_SIZE <= (size_t)len; )
+   {
+      uint32_t block = sram_journal_read_le32(jnl + pos);
+      size_t offset  = (size_t)block * AUTOSAVE_BLOCK_SIZE;
+
+      pos += SRAM_JOURNAL_RECORD_SIZE;
+      if (block == SRAM_JOURNAL_COMMIT)
+      {
+         committed = pos;
+         continue;
+      }
+      if (     offset >= size
+            || pos + MIN(AUTOSAVE_BLOCK_SIZE, size - offset) > (size_t)len)
+         break;
+      pos += MIN(AUTOSAVE_BLOCK_SIZE, size - offset);
+   }
+
+   for (pos = SRAM_JOURNAL_HEADER_SIZE; pos < committed; )
+   {
+      uint32_t block = sram_journal_read_le32(jnl + pos);
+      uint32_t crc   = sram_journal_read_le32(jnl + pos + 4);
+      size_t offset  = (size_t)block * AUTOSAVE_BLOCK_SIZE;
+      size_t blen;
+
+      pos += SRAM_JOURNAL_RECORD_SIZE;
+      if (block == SRAM_JOURNAL_COMMIT)
+         continue;
+
+      blen = MIN(AUTOSAVE_BLOCK_SIZE, size - offset);
+      if (encoding_crc32(0, jnl + pos, blen) != crc)
+      {
+         RARCH_WARN("[SRAM]: Journal \"%s\" is corrupt.\n", journal);
+         break;
+      }
+      memcpy(data + offset, jnl + pos, blen);
+      pos += blen;
+      applied++;
+   }
+
+   if (applied)
+      RARCH_LOG("[SRAM]: Applied %u autosaved blocks from \"%s\".\n",
+            applied, journal);
+
+   free(buf);
+}
+
 /**
  * content_load_ram_file:
  * @path             : path of RAM state that will be loaded from.
@@ -1754,6 +2937,10 @@ bool content_load_ram_file(unsigned slot)
          rc = mem_info.size;
       }
       memcpy(mem_info.data, buf, (size_t)rc);
+
+      if (rc == (int64_t)mem_info.size)
+         content_load_ram_journal(ram.path,
+               (uint8_t*)mem_info.data, mem_info.size);
    }
 
    if (buf)
@@ -1824,9 +3011,7 @@ static bool dump_to_file_desperate(const void *data,
  **/
 bool content_load_state_from_ram(void)
 {
-   size_t temp_data_size;
    bool ret        = false;
-   void* temp_data = NULL;
 
    if (!core_info_current_supports_savestate())
    {
@@ -1843,20 +3028,13 @@ bool content_load_state_from_ram(void)
          (unsigned)ram_buf.state_buf.size,
          msg_hash_to_str(MSG_BYTES));
 
-   /* We need to make a temporary copy of the buffer, to allow the swap below */
-   temp_data       = malloc(ram_buf.state_buf.size);
-   temp_data_size  = ram_buf.state_buf.size;
-   memcpy(temp_data, ram_buf.state_buf.data, ram_buf.state_buf.size);
-
    /* Swap the current state with the backup state. This way, we can undo
-   what we're undoing */
+   what we're undoing. The backup goes to undo_load_buf, so
+   the RAM state needs no temporary copy. */
    content_save_state("RAM", false, false);
 
-   ret             = content_deserialize_state(temp_data, temp_data_size);
-
-   /* Clean up the temporary copy */
-   free(temp_data);
-   temp_data       = NULL;
+   ret             = content_deserialize_state(
+         ram_buf.state_buf.data, ram_buf.state_buf.size);
 
    if (!ret)
    {
@@ -1877,8 +3055,6 @@ bool content_load_state_from_ram(void)
 bool content_save_state_to_ram(void)
 {
    retro_ctx_size_info_t info;
-   void *data  = NULL;
-   size_t serial_size;
 
    if (!core_info_current_supports_savestate())
    {
@@ -1891,49 +3067,21 @@ bool content_save_state_to_ram(void)
 
    if (info.size == 0)
       return false;
-   serial_size = info.size;
 
-   if (!save_state_in_background)
+   /* An old state held already is overwritten in place */
+   if (!content_serialize_to_buf(&ram_buf.state_buf))
    {
-      if (!(data = content_get_serialized_data(&serial_size)))
-      {
-         RARCH_ERR("[State]: %s.\n",
-               msg_hash_to_str(MSG_FAILED_TO_SAVE_SRAM));
-         return false;
-      }
+      RARCH_ERR("[State]: %s.\n",
+            msg_hash_to_str(MSG_FAILED_TO_SAVE_SRAM));
+      return false;
+   }
 
+   if (!save_state_in_background)
       RARCH_LOG("[State]: %s, %u %s.\n",
             msg_hash_to_str(MSG_SAVING_STATE),
-            (unsigned)serial_size,
+            (unsigned)ram_buf.state_buf.size,
             msg_hash_to_str(MSG_BYTES));
-   }
-
-   if (!data)
-   {
-      if (!(data = content_get_serialized_data(&serial_size)))
-      {
-         RARCH_ERR("[State]: %s.\n",
-               msg_hash_to_str(MSG_FAILED_TO_SAVE_SRAM));
-         return false;
-      }
-   }
-
-   /* If we were holding onto an old state already, clean it up first */
-   if (ram_buf.state_buf.data)
-   {
-      free(ram_buf.state_buf.data);
-      ram_buf.state_buf.data = NULL;
-   }
-
-   if (!(ram_buf.state_buf.data = malloc(serial_size)))
-   {
-      free(data);
-      return false;
-   }
 
-   memcpy(ram_buf.state_buf.data, data, serial_size);
-   free(data);
-   ram_buf.state_buf.size = serial_size;
    ram_buf.to_write_file  = true;
 
    return true;
@@ -2018,6 +3166,15 @@ bool content_save_ram_file(unsigned slot, bool compress)
          msg_hash_to_str(MSG_SAVED_SUCCESSFULLY_TO),
          ram.path);
 
+   /* The file is complete, autosaves journaled
+    * on top of the previous one no longer apply */
+   {
+      char journal[PATH_MAX_LENGTH];
+      sram_journal_path(journal, sizeof(journal), ram.path);
+      if (path_is_valid(journal))
+         filestream_delete(journal);
+   }
+
    return true;
 
 fail:
@@ -168,6 +168,10 @@ bool task_push_image_load(const char *fullpath,
       bool supports_rgba, unsigned upscale_threshold,
       retro_task_callback_t cb, void *userdata);
 
+/* Loads the thumbnail stored in a savestate */
+bool task_push_load_state_thumbnail(const char *path,
+      bool supports_rgba, retro_task_callback_t cb, void *user_data);
+
 #ifdef HAVE_LIBRETRODB
 bool task_push_dbscan(
       const char *playlist_directory,
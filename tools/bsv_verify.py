@@ -0,0 +1,187 @@
+#!/usr/bin/env python3
+
+"""
+Python 3 script which replays BSV movies headlessly and checks that the
+core still reaches the states stored in their keyframes.
+
+Movies recorded with a keyframe interval (replay_keyframe_interval) store
+a checksum of the core state every few frames. Each movie, or each
+segment of a long movie, is replayed by its own RetroArch process with
+--bsvverify, as a core can only be loaded once per process. The processes
+run in parallel and the first keyframe that differs is reported.
+
+License: Public domain
+"""
+
+import argparse
+import os
+import re
+import struct
+import subprocess
+import sys
+import tempfile
+from concurrent.futures import ThreadPoolExecutor
+
+if sys.version_info < (3, 2, 0):
+    sys.stderr.write("You need python 3.2 or later to run this script\n")
+    exit(1)
+
+BSV_MAGIC  = 0x42535631
+BSV2_MAGIC = 0x42535632
+
+# Settings layered on top of the user's config, so nothing is displayed
+# and the replay runs as fast as the core allows.
+HEADLESS_CONFIG = """video_driver = "null"
+audio_driver = "null"
+input_driver = "null"
+menu_driver = "null"
+audio_enable = "false"
+audio_sync = "false"
+video_vsync = "false"
+rewind_enable = "false"
+run_ahead_enabled = "false"
+savestate_auto_load = "false"
+"""
+
+KEYFRAME_RE = re.compile(r"\[BSV\]: Keyframe (\d+) (matches|differs)")
+
+
+def read_header(path):
+    """Returns (keyframe interval, frame count), both 0 for BSV1 movies."""
+    with open(path, "rb") as f:
+        header = f.read(32)
+    if len(header) < 16:
+        raise ValueError("not a BSV movie")
+    magic = struct.unpack(">I", header[0:4])[0]
+    if magic == BSV_MAGIC:
+        return 0, 0
+    if magic != BSV2_MAGIC or len(header) < 32:
+        raise ValueError("not a BSV movie")
+    return struct.unpack("<II", header[16:24])
+
+
+def segments(interval, frames, length):
+    """Splits a movie at keyframes into (first frame, last frame) pairs
+    of about 'length' frames. The last one runs to the end of the movie."""
+    if not interval or not frames or not length:
+        return [(0, None)]
+    step  = max(1, length // interval) * interval
+    start = 0
+    ret   = []
+    while start + step < frames:
+        ret.append((start, start + step))
+        start += step
+    ret.append((start, None))
+    return ret
+
+
+def replay(args, config, movie, start, end):
+    cmd = [args.retroarch, "--appendconfig", config, "-L", args.libretro,
+           "--bsvplay", movie, "--bsvverify", "--eof-exit", "-v"]
+    if args.config:
+        cmd += ["--config", args.config]
+    if start:
+        cmd += ["--bsvseek", str(start)]
+    if end is not None:
+        cmd += ["--max-frames", str(end - start + 1)]
+    if args.content:
+        cmd.append(args.content)
+
+    proc = subprocess.run(cmd, stdout=subprocess.PIPE,
+                          stderr=subprocess.STDOUT,
+                          universal_newlines=True, errors="replace")
+    results = {}
+    for match in KEYFRAME_RE.finditer(proc.stdout):
+        frame = int(match.group(1))
+        # A segment starts from the state stored in its first keyframe,
+        # that one is checked by the segment before it.
+        if start and frame == start:
+            continue
+        results[frame] = match.group(2) == "matches"
+    return proc.returncode, results
+
+
+def main():
+    parser = argparse.ArgumentParser(
+        description="Replay BSV movies and check them against their keyframes.")
+    parser.add_argument("-L", "--libretro", required=True,
+                        help="Core to replay the movies with")
+    parser.add_argument("-r", "--retroarch", default="retroarch",
+                        help="RetroArch binary (default: retroarch)")
+    parser.add_argument("-c", "--config",
+                        help="Config file to use instead of the default one")
+    parser.add_argument("-j", "--jobs", type=int, default=os.cpu_count() or 1,
+                        help="Number of RetroArch processes to run at once")
+    parser.add_argument("-s", "--segment", type=int, default=0,
+                        help="Split movies into segments of about SEGMENT "
+                             "frames, replayed in parallel")
+    parser.add_argument("--content", help="Content the movies were recorded with")
+    parser.add_argument("movies", nargs="+", help="BSV movies")
+    args = parser.parse_args()
+
+    jobs   = []
+    failed = False
+
+    for movie in args.movies:
+        try:
+            interval, frames = read_header(movie)
+        except (OSError, ValueError) as e:
+            print("FAILED    {}: {}".format(movie, e))
+            failed = True
+            continue
+        if not interval:
+            print("SKIPPED   {}: no keyframes, record with "
+                  "replay_keyframe_interval set".format(movie))
+            continue
+        for start, end in segments(interval, frames, args.segment):
+            jobs.append((movie, interval, frames, start, end))
+
+    with tempfile.NamedTemporaryFile("w", suffix=".cfg", delete=False) as f:
+        f.write(HEADLESS_CONFIG)
+        config = f.name
+
+    try:
+        with ThreadPoolExecutor(max_workers=max(1, args.jobs)) as pool:
+            futures = [pool.submit(replay, args, config, job[0], job[3], job[4])
+                       for job in jobs]
+            outcomes = [future.result() for future in futures]
+    finally:
+        os.unlink(config)
+
+    for movie in dict.fromkeys(job[0] for job in jobs):
+        results  = {}
+        errors   = []
+        interval = frames = 0
+        for job, (code, res) in zip(jobs, outcomes):
+            if job[0] != movie:
+                continue
+            interval, frames = job[1], job[2]
+            # Never let one segment hide another one's divergence
+            for frame, ok in res.items():
+                results[frame] = results.get(frame, True) and ok
+            if code != 0:
+                errors.append("RetroArch exited with {} from frame {}".format(
+                    code, job[3]))
+
+        differs  = sorted(k for k, ok in results.items() if not ok)
+        # Keyframes are written at the start of a frame, so the one at
+        # the very end of the movie may be missing.
+        expected = (frames - 1) // interval if frames else 0
+
+        if differs:
+            print("DIVERGED  {}: after frame {}, {} of {} keyframes differ".format(
+                movie, differs[0] - interval, len(differs), len(results)))
+            failed = True
+        elif errors or len(results) < expected:
+            print("FAILED    {}: checked {} of {} keyframes{}".format(
+                movie, len(results), expected,
+                "".join(", " + e for e in errors)))
+            failed = True
+        else:
+            print("OK        {}: {} keyframes match".format(movie, len(results)))
+
+    return 1 if failed else 0
+
+
+if __name__ == "__main__":
+    sys.exit(main())
@@ -0,0 +1,84 @@
+#!/usr/bin/env python3
+
+"""
+Python 3 regression tests for bsv_verify.py.
+
+A stand-in for the RetroArch binary replays a fake movie with a core
+that diverges at a given frame and logs the keyframe results the way
+--bsvverify does, including the keyframe a segment was seeked to.
+
+Run with: python3 tools/bsv_verify_test.py
+
+License: Public domain
+"""
+
+import os
+import stat
+import struct
+import subprocess
+import sys
+import tempfile
+import unittest
+
+TOOLS_DIR = os.path.dirname(os.path.abspath(__file__))
+
+INTERVAL = 100
+FRAMES   = 1050
+DIVERGE  = 650
+
+# Logs "Keyframe N matches/differs" for every keyframe replayed. The
+# keyframe at the seek target is reported as matching, as a frontend
+# restored from that keyframe would.
+FAKE_RETROARCH = """#!{python}
+import struct, sys
+args   = sys.argv[1:]
+movie  = args[args.index("--bsvplay") + 1]
+start  = int(args[args.index("--bsvseek") + 1]) if "--bsvseek" in args else 0
+with open(movie, "rb") as f:
+    interval, frames = struct.unpack("<II", f.read(32)[16:24])
+end    = frames
+if "--max-frames" in args:
+    end = min(frames, start + int(args[args.index("--max-frames") + 1]))
+for k in range(start, end):
+    if k and not k % interval:
+        ok = not (start <= {diverge} < k)
+        print("[BSV]: Keyframe %u %s." % (k, "matches" if ok else "differs"))
+"""
+
+
+class SegmentedVerifyTest(unittest.TestCase):
+    def setUp(self):
+        self.dir   = tempfile.TemporaryDirectory()
+        self.movie = os.path.join(self.dir.name, "m.bsv")
+        with open(self.movie, "wb") as f:
+            f.write(struct.pack(">I", 0x42535632) + bytes(12)
+                    + struct.pack("<II", INTERVAL, FRAMES) + bytes(8))
+
+        self.retroarch = os.path.join(self.dir.name, "retroarch")
+        with open(self.retroarch, "w") as f:
+            f.write(FAKE_RETROARCH.format(python=sys.executable,
+                                          diverge=DIVERGE))
+        os.chmod(self.retroarch, os.stat(self.retroarch).st_mode | stat.S_IXUSR)
+
+    def tearDown(self):
+        self.dir.cleanup()
+
+    def verify(self, segment):
+        return subprocess.run(
+            [sys.executable, os.path.join(TOOLS_DIR, "bsv_verify.py"),
+             "-r", self.retroarch, "-L", "core.so", "-j", "2",
+             "-s", str(segment), self.movie],
+            stdout=subprocess.PIPE, universal_newlines=True)
+
+    def test_divergence_reported_for_every_segment_length(self):
+        for segment in (0, 100, 200, 300, 500):
+            with self.subTest(segment=segment):
+                proc = self.verify(segment)
+                self.assertEqual(proc.returncode, 1, proc.stdout)
+                self.assertIn("DIVERGED", proc.stdout)
+                self.assertIn("after frame 600", proc.stdout)
+                self.assertIn("of 10 keyframes", proc.stdout)
+
+
+if __name__ == "__main__":
+    unittest.main()
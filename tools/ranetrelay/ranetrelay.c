@@ -0,0 +1,931 @@
+/*
+ * Copyright (c) 2026 The RetroArch team
+ *
+ * Permission to use, copy, modify, and/or distribute this software for any
+ * purpose with or without fee is hereby granted, provided that the above
+ * copyright notice and this permission notice appear in all copies.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS" AND THE AUTHOR DISCLAIMS ALL WARRANTIES
+ * WITH REGARD TO THIS SOFTWARE INCLUDING ALL IMPLIED WARRANTIES OF
+ * MERCHANTABILITY AND FITNESS. IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR ANY
+ * SPECIAL, DIRECT, INDIRECT, OR CONSEQUENTIAL DAMAGES OR ANY DAMAGES
+ * WHATSOEVER RESULTING FROM LOSS OF USE, DATA OR PROFITS, WHETHER IN AN ACTION
+ * OF CONTRACT, NEGLIGENCE OR OTHER TORTIOUS ACTION, ARISING OUT OF OR IN
+ * CONNECTION WITH THE USE OR PERFORMANCE OF THIS SOFTWARE.
+ */
+
+/* ranetrelay joins a netplay host as a single spectator and serves any
+ * number of spectators itself, forwarding the host's stream to them. The
+ * host encodes and sends each frame and savestate once, whatever the
+ * number of spectators behind the relay. */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/types.h>
+
+#include "compat/getopt.h"
+#include "compat/strl.h"
+#include "net/net_socket.h"
+
+/* Only for #defines */
+#include "../../network/netplay/netplay_private.h"
+#include "../../version.h"
+
+/* From netplay_frontend.c */
+#define NETPLAY_MAGIC 0x52414E50 /* RANP */
+#define POKE_MAGIC    0x504F4B45 /* POKE */
+
+#define RELAY_MAX_PEERS     128
+/* Input commands kept to catch a joining spectator up from its savestate */
+#define RELAY_BACKLOG       512
+/* A spectator that falls this far behind is dropped */
+#define RELAY_MAX_PENDING   (32*1024*1024)
+/* Largest command accepted from a spectator */
+#define RELAY_MAX_PEER_CMD  4096
+
+/* SYNC payload without the SRAM */
+#define RELAY_SYNC_SIZE \
+   (2*sizeof(uint32_t) \
+   /* Controller devices */ \
+   + MAX_INPUT_DEVICES*sizeof(uint32_t) \
+   /* Share modes */ \
+   + MAX_INPUT_DEVICES*sizeof(uint8_t) \
+   /* Device-client mapping */ \
+   + MAX_INPUT_DEVICES*sizeof(uint32_t) \
+   /* Client nick */ \
+   + NETPLAY_NICK_LEN)
+
+/* frame, mode, devices, share modes, nick */
+#define RELAY_MODE_SIZE \
+   (3*sizeof(uint32_t) + MAX_INPUT_DEVICES + NETPLAY_NICK_LEN)
+
+enum relay_peer_state
+{
+   RELAY_PEER_NONE = 0,
+   RELAY_PEER_HEADER,
+   RELAY_PEER_NICK,
+   RELAY_PEER_INFO,
+   /* Handshake done, waiting for the next savestate to SYNC on */
+   RELAY_PEER_WAITING,
+   RELAY_PEER_SPECTATING
+};
+
+struct relay_buffer
+{
+   uint8_t *data;
+   size_t len;
+   size_t cap;
+};
+
+struct relay_peer
+{
+   struct relay_buffer in;
+   struct relay_buffer out;
+   enum relay_peer_state state;
+   int fd;
+   /* Close once everything queued has been sent */
+   bool closing;
+   char nick[NETPLAY_NICK_LEN];
+};
+
+struct relay_backlog_entry
+{
+   uint32_t frame;
+   uint32_t size;
+   uint32_t words[2 + NETPLAY_INPUT_CMD_WORDS];
+};
+
+/* The host connection */
+static int host_fd = -1;
+static uint32_t host_header[6];
+static uint32_t protocol;
+static char host_nick[NETPLAY_NICK_LEN];
+static uint32_t info[2 + (sizeof(uint32_t) + 2*NETPLAY_NICK_LEN)/sizeof(uint32_t)];
+static size_t info_size;
+
+/* Space for commands from the host */
+static uint32_t cmd, cmd_size, *payload;
+static size_t payload_size;
+
+/* What a new spectator needs to know, as of the last command forwarded */
+static uint32_t self_client_num;
+static bool paused;
+static uint32_t config_devices[MAX_INPUT_DEVICES];
+static uint8_t share_modes[MAX_INPUT_DEVICES];
+static uint32_t device_clients[MAX_INPUT_DEVICES];
+static uint8_t *sram;
+static uint32_t sram_size;
+static uint32_t allow_pausing;
+static int32_t latency_frames[2];
+static bool have_settings;
+static bool savestate_requested;
+
+static struct relay_backlog_entry backlog[RELAY_BACKLOG];
+static size_t backlog_next, backlog_count;
+
+static struct relay_peer peers[RELAY_MAX_PEERS];
+static int listen_fd = -1;
+
+/* Usage statement */
+static void usage(void)
+{
+   fprintf(stderr,
+      "Use: ranetrelay [options]\n"
+      "Options:\n"
+      "    -H|--host <address>:  Netplay host. Defaults to localhost.\n"
+      "    -P|--port <port>:     Netplay port. Defaults to 55435.\n"
+      "    -l|--listen <port>:   Port to serve spectators on. Defaults to\n"
+      "                          55436.\n"
+      "    -n|--nick <nick>:     Nickname to join the host with. Defaults to\n"
+      "                          RANetRelay.\n"
+      "\n");
+}
+
+/* As netplay_impl_magic and netplay_platform_magic in netplay_frontend.c */
+static uint32_t relay_impl_magic(void)
+{
+   size_t i;
+   uint32_t res   = 0;
+   const char *ver = PACKAGE_VERSION;
+   size_t len     = strlen(ver);
+
+   for (i = 0; i < len; i++)
+      res ^= ver[i] << (i & 0xf);
+
+   res ^= NETPLAY_PROTOCOL_VERSION << (i & 0xf);
+
+   return res;
+}
+
+static uint32_t relay_platform_magic(void)
+{
+   return ((1 == htonl(1)) << 30)
+      | (sizeof(size_t) << 15)
+      | (sizeof(long));
+}
+
+static bool buffer_append(struct relay_buffer *buf,
+      const void *data, size_t len)
+{
+   if (buf->len + len > buf->cap)
+   {
+      size_t cap    = buf->cap ? buf->cap : 4096;
+      uint8_t *tmp;
+
+      while (cap < buf->len + len)
+         cap *= 2;
+      if (!(tmp = (uint8_t*)realloc(buf->data, cap)))
+         return false;
+      buf->data = tmp;
+      buf->cap  = cap;
+   }
+
+   memcpy(buf->data + buf->len, data, len);
+   buf->len += len;
+   return true;
+}
+
+static void buffer_consume(struct relay_buffer *buf, size_t len)
+{
+   memmove(buf->data, buf->data + len, buf->len - len);
+   buf->len -= len;
+}
+
+static void peer_close(struct relay_peer *peer)
+{
+   if (peer->state == RELAY_PEER_NONE)
+      return;
+
+   fprintf(stderr, "Spectator \"%s\" disconnected.\n", peer->nick);
+   socket_close(peer->fd);
+   free(peer->in.data);
+   free(peer->out.data);
+   memset(peer, 0, sizeof(*peer));
+   peer->fd = -1;
+}
+
+static void peer_send(struct relay_peer *peer, const void *data, size_t len)
+{
+   if (peer->state == RELAY_PEER_NONE || peer->closing)
+      return;
+
+   if (peer->out.len + len > RELAY_MAX_PENDING)
+   {
+      fprintf(stderr, "Spectator \"%s\" is too far behind.\n", peer->nick);
+      peer_close(peer);
+      return;
+   }
+
+   if (!buffer_append(&peer->out, data, len))
+      peer_close(peer);
+}
+
+static void peer_send_cmd(struct relay_peer *peer, uint32_t pcmd,
+      const void *data, size_t len)
+{
+   uint32_t cmdbuf[2];
+
+   cmdbuf[0] = htonl(pcmd);
+   cmdbuf[1] = htonl((uint32_t)len);
+   peer_send(peer, cmdbuf, sizeof(cmdbuf));
+   if (len)
+      peer_send(peer, data, len);
+}
+
+static void peer_flush(struct relay_peer *peer)
+{
+   ssize_t sent;
+
+   if (peer->state == RELAY_PEER_NONE || !peer->out.len)
+      return;
+
+   sent = socket_send_all_nonblocking(peer->fd, peer->out.data,
+         peer->out.len, true);
+   if (sent < 0)
+   {
+      peer_close(peer);
+      return;
+   }
+
+   buffer_consume(&peer->out, (size_t)sent);
+   if (peer->closing && !peer->out.len)
+      peer_close(peer);
+}
+
+/* Queue the current command from the host for every synced spectator */
+static void forward(void)
+{
+   size_t i;
+
+   for (i = 0; i < RELAY_MAX_PEERS; i++)
+      if (peers[i].state == RELAY_PEER_SPECTATING)
+         peer_send_cmd(&peers[i], cmd, payload, cmd_size);
+}
+
+static bool host_send_cmd(uint32_t hcmd, const void *data, size_t len)
+{
+   uint32_t cmdbuf[2];
+
+   cmdbuf[0] = htonl(hcmd);
+   cmdbuf[1] = htonl((uint32_t)len);
+   return socket_send_all_blocking(host_fd, cmdbuf, sizeof(cmdbuf), true)
+      && (!len || socket_send_all_blocking(host_fd, data, len, true));
+}
+
+static bool host_recv_cmd(void)
+{
+   if (!socket_receive_all_blocking(host_fd, &cmd, sizeof(cmd)) ||
+       !socket_receive_all_blocking(host_fd, &cmd_size, sizeof(cmd_size)))
+      return false;
+   cmd      = ntohl(cmd);
+   cmd_size = ntohl(cmd_size);
+
+   if (cmd_size > payload_size)
+   {
+      uint32_t *tmp = (uint32_t*)realloc(payload, cmd_size);
+      if (!tmp)
+         return false;
+      payload      = tmp;
+      payload_size = cmd_size;
+   }
+
+   return socket_receive_all_blocking(host_fd, payload, cmd_size);
+}
+
+static void request_savestate(void)
+{
+   if (savestate_requested)
+      return;
+   if (!host_send_cmd(NETPLAY_CMD_REQUEST_SAVESTATE, NULL, 0))
+      return;
+   savestate_requested = true;
+}
+
+static void send_header(struct relay_peer *peer, uint32_t peer_protocol)
+{
+   uint32_t header[6];
+
+   /* The host's platform and version, as savestates come from it */
+   header[0] = htonl(NETPLAY_MAGIC);
+   header[1] = host_header[1];
+   header[2] = htonl(NETPLAY_COMPRESSION_LZ4);
+   header[3] = 0;
+   header[4] = htonl(peer_protocol);
+   header[5] = host_header[5];
+   peer_send(peer, header, sizeof(header));
+}
+
+/* Bring a waiting spectator in at the savestate for this frame */
+static void peer_sync(struct relay_peer *peer, uint32_t frame)
+{
+   size_t i;
+   uint32_t words[2 + 2 + MAX_INPUT_DEVICES];
+
+   words[0] = htonl(NETPLAY_CMD_SYNC);
+   words[1] = htonl((uint32_t)(RELAY_SYNC_SIZE + sram_size));
+   words[2] = htonl(frame);
+   /* Spectators share our client number, the host gives it to no one
+    * else and we never play */
+   words[3] = htonl(self_client_num |
+         (paused ? NETPLAY_CMD_SYNC_BIT_PAUSED : 0));
+   for (i = 0; i < MAX_INPUT_DEVICES; i++)
+      words[4 + i] = htonl(config_devices[i]);
+   peer_send(peer, words, sizeof(words));
+   peer_send(peer, share_modes, sizeof(share_modes));
+   for (i = 0; i < MAX_INPUT_DEVICES; i++)
+      words[i] = htonl(device_clients[i]);
+   peer_send(peer, words, MAX_INPUT_DEVICES*sizeof(uint32_t));
+   peer_send(peer, peer->nick, sizeof(peer->nick));
+   if (sram_size)
+      peer_send(peer, sram, sram_size);
+
+   if (have_settings && protocol >= 6)
+   {
+      uint32_t setting = htonl(allow_pausing);
+      int32_t frames[2];
+
+      frames[0] = htonl(latency_frames[0]);
+      frames[1] = htonl(latency_frames[1]);
+      peer_send_cmd(peer, NETPLAY_CMD_SETTING_ALLOW_PAUSING,
+            &setting, sizeof(setting));
+      peer_send_cmd(peer, NETPLAY_CMD_SETTING_INPUT_LATENCY_FRAMES,
+            frames, sizeof(frames));
+   }
+
+   peer->state = RELAY_PEER_SPECTATING;
+   fprintf(stderr, "Spectator \"%s\" synced at frame %u.\n",
+         peer->nick, (unsigned)frame);
+}
+
+/* Replay the input of this frame and later, which may have come from the
+ * host before the savestate did */
+static void peer_catch_up(struct relay_peer *peer, uint32_t frame)
+{
+   size_t i;
+   size_t j = (backlog_next + RELAY_BACKLOG - backlog_count) % RELAY_BACKLOG;
+
+   for (i = 0; i < backlog_count; i++, j = (j + 1) % RELAY_BACKLOG)
+      if (backlog[j].frame >= frame)
+         peer_send(peer, backlog[j].words, backlog[j].size);
+}
+
+static void backlog_push(void)
+{
+   struct relay_backlog_entry *entry = &backlog[backlog_next];
+
+   if (cmd_size < sizeof(uint32_t) ||
+         cmd_size > NETPLAY_INPUT_CMD_WORDS*sizeof(uint32_t))
+      return;
+
+   entry->frame    = ntohl(payload[0]);
+   entry->size     = 2*sizeof(uint32_t) + cmd_size;
+   entry->words[0] = htonl(cmd);
+   entry->words[1] = htonl(cmd_size);
+   memcpy(entry->words + 2, payload, cmd_size);
+
+   backlog_next = (backlog_next + 1) % RELAY_BACKLOG;
+   if (backlog_count < RELAY_BACKLOG)
+      backlog_count++;
+}
+
+/* Handle a command from the host. Returns false to disconnect. */
+static bool host_cmd(void)
+{
+   size_t i;
+
+   switch (cmd)
+   {
+      case NETPLAY_CMD_INPUT:
+      case NETPLAY_CMD_NOINPUT:
+         backlog_push();
+         forward();
+         break;
+
+      case NETPLAY_CMD_MODE:
+         {
+            uint32_t mode, client_num, devices;
+
+            if (cmd_size != RELAY_MODE_SIZE)
+               return false;
+
+            mode       = ntohl(payload[1]);
+            client_num = mode & 0xFFFF;
+            devices    = ntohl(payload[2]);
+
+            /* About us, never asked for */
+            if ((mode & NETPLAY_CMD_MODE_BIT_YOU) || client_num >= MAX_CLIENTS)
+               break;
+
+            memcpy(share_modes, &payload[3], sizeof(share_modes));
+            for (i = 0; i < MAX_INPUT_DEVICES; i++)
+            {
+               if ((mode & NETPLAY_CMD_MODE_BIT_PLAYING) &&
+                     (devices & (1 << i)))
+                  device_clients[i] |=  (1 << client_num);
+               else if (!(mode & NETPLAY_CMD_MODE_BIT_PLAYING))
+                  device_clients[i] &= ~(1 << client_num);
+            }
+            forward();
+         }
+         break;
+
+      case NETPLAY_CMD_LOAD_SAVESTATE:
+         {
+            uint32_t frame;
+
+            if (cmd_size < 2*sizeof(uint32_t))
+               return false;
+            frame               = ntohl(payload[0]);
+            savestate_requested = false;
+
+            for (i = 0; i < RELAY_MAX_PEERS; i++)
+               if (peers[i].state == RELAY_PEER_WAITING)
+               {
+                  peer_sync(&peers[i], frame);
+                  peer_send_cmd(&peers[i], cmd, payload, cmd_size);
+                  peer_catch_up(&peers[i], frame);
+               }
+               else if (peers[i].state == RELAY_PEER_SPECTATING)
+                  peer_send_cmd(&peers[i], cmd, payload, cmd_size);
+         }
+         break;
+
+      case NETPLAY_CMD_PAUSE:
+         paused = true;
+         forward();
+         break;
+
+      case NETPLAY_CMD_RESUME:
+         paused = false;
+         forward();
+         break;
+
+      case NETPLAY_CMD_SETTING_ALLOW_PAUSING:
+         if (cmd_size != sizeof(uint32_t))
+            return false;
+         allow_pausing = ntohl(payload[0]);
+         forward();
+         break;
+
+      case NETPLAY_CMD_SETTING_INPUT_LATENCY_FRAMES:
+         if (cmd_size != 2*sizeof(int32_t))
+            return false;
+         latency_frames[0] = (int32_t)ntohl(payload[0]);
+         latency_frames[1] = (int32_t)ntohl(payload[1]);
+         have_settings     = true;
+         forward();
+         break;
+
+      case NETPLAY_CMD_CRC:
+      case NETPLAY_CMD_RESET:
+      case NETPLAY_CMD_PLAYER_CHAT:
+         forward();
+         break;
+
+      case NETPLAY_CMD_PING_REQUEST:
+         return host_send_cmd(NETPLAY_CMD_PING_RESPONSE, NULL, 0);
+
+      case NETPLAY_CMD_NAK:
+      case NETPLAY_CMD_DISCONNECT:
+         return false;
+
+      default:
+         /* STALL is for this connection, the rest needs no forwarding */
+         break;
+   }
+
+   return true;
+}
+
+/* Join the host as a spectator and record what new spectators need */
+static bool host_connect(const char *host, int port, const char *nick)
+{
+   size_t i;
+   int on = 1;
+   uint32_t header[6];
+   struct addrinfo *addr = NULL;
+   struct
+   {
+      uint32_t cmd[2];
+      char nick[NETPLAY_NICK_LEN];
+   } nick_buf;
+
+   if ((host_fd = socket_init((void**)&addr, port, host,
+         SOCKET_TYPE_STREAM, 0)) < 0)
+   {
+      perror("socket");
+      return false;
+   }
+
+   if (socket_connect(host_fd, addr) < 0)
+   {
+      perror("connect");
+      return false;
+   }
+   setsockopt(host_fd, IPPROTO_TCP, TCP_NODELAY, (const char*)&on,
+         sizeof(on));
+
+   /* Only LZ4 and full savestates: anything the host sends must be
+    * loadable by every spectator as is. Our highest protocol goes in the
+    * salt field, as RetroArch clients do. */
+   header[0] = htonl(NETPLAY_MAGIC);
+   header[1] = htonl(relay_platform_magic());
+   header[2] = htonl(NETPLAY_COMPRESSION_LZ4);
+   header[3] = htonl(HIGH_NETPLAY_PROTOCOL_VERSION);
+   header[4] = htonl(LOW_NETPLAY_PROTOCOL_VERSION);
+   header[5] = htonl(relay_impl_magic());
+   if (!socket_send_all_blocking(host_fd, header, sizeof(header), true) ||
+       !socket_receive_all_blocking(host_fd, host_header,
+          sizeof(host_header)))
+   {
+      fprintf(stderr, "Failed to receive connection header.\n");
+      return false;
+   }
+
+   if (ntohl(host_header[0]) != NETPLAY_MAGIC)
+   {
+      fprintf(stderr, "Not a netplay host, or it is full.\n");
+      return false;
+   }
+
+   protocol = ntohl(host_header[4]);
+   if (protocol < LOW_NETPLAY_PROTOCOL_VERSION ||
+         protocol > HIGH_NETPLAY_PROTOCOL_VERSION)
+   {
+      fprintf(stderr, "Unsupported netplay protocol %u.\n",
+            (unsigned)protocol);
+      return false;
+   }
+
+   if (host_header[3])
+   {
+      fprintf(stderr, "Password required but unsupported.\n");
+      return false;
+   }
+
+   memset(&nick_buf, 0, sizeof(nick_buf));
+   nick_buf.cmd[0] = htonl(NETPLAY_CMD_NICK);
+   nick_buf.cmd[1] = htonl(sizeof(nick_buf.nick));
+   strlcpy(nick_buf.nick, nick, sizeof(nick_buf.nick));
+   if (!socket_send_all_blocking(host_fd, &nick_buf, sizeof(nick_buf), true))
+      return false;
+
+   /* Their nick, then INFO, which we echo back as ours */
+   if (!host_recv_cmd() || cmd != NETPLAY_CMD_NICK ||
+         cmd_size != NETPLAY_NICK_LEN)
+      return false;
+   memcpy(host_nick, payload, sizeof(host_nick));
+   host_nick[sizeof(host_nick) - 1] = '\0';
+
+   if (!host_recv_cmd() || cmd != NETPLAY_CMD_INFO ||
+         cmd_size + 2*sizeof(uint32_t) > sizeof(info))
+   {
+      fprintf(stderr, "Failed to receive INFO.\n");
+      return false;
+   }
+   info[0]   = htonl(cmd);
+   info[1]   = htonl(cmd_size);
+   memcpy(info + 2, payload, cmd_size);
+   info_size = 2*sizeof(uint32_t) + cmd_size;
+   if (!socket_send_all_blocking(host_fd, info, info_size, true))
+      return false;
+
+   if (!host_recv_cmd() || cmd != NETPLAY_CMD_SYNC ||
+         cmd_size < RELAY_SYNC_SIZE)
+   {
+      fprintf(stderr, "Failed to receive SYNC.\n");
+      return false;
+   }
+
+   self_client_num = ntohl(payload[1]);
+   paused          = !!(self_client_num & NETPLAY_CMD_SYNC_BIT_PAUSED);
+   self_client_num &= ~NETPLAY_CMD_SYNC_BIT_PAUSED;
+   for (i = 0; i < MAX_INPUT_DEVICES; i++)
+      config_devices[i] = ntohl(payload[2 + i]);
+   memcpy(share_modes, &payload[2 + MAX_INPUT_DEVICES], sizeof(share_modes));
+   for (i = 0; i < MAX_INPUT_DEVICES; i++)
+      device_clients[i] = ntohl(
+         payload[2 + MAX_INPUT_DEVICES
+            + sizeof(share_modes)/sizeof(uint32_t) + i]);
+
+   sram_size = cmd_size - (uint32_t)RELAY_SYNC_SIZE;
+   if (sram_size)
+   {
+      if (!(sram = (uint8_t*)malloc(sram_size)))
+         return false;
+      memcpy(sram, (uint8_t*)payload + RELAY_SYNC_SIZE, sram_size);
+   }
+
+   fprintf(stderr, "Relaying \"%s\" as client %u.\n",
+         host_nick, (unsigned)self_client_num);
+   return true;
+}
+
+static bool listen_init(int port)
+{
+   int on = 1;
+   struct addrinfo *addr = NULL;
+
+   if ((listen_fd = socket_init((void**)&addr, port, NULL,
+         SOCKET_TYPE_STREAM, AF_INET)) < 0)
+   {
+      perror("socket");
+      return false;
+   }
+
+   setsockopt(listen_fd, SOL_SOCKET, SO_REUSEADDR, (const char*)&on,
+         sizeof(on));
+   if (!socket_bind(listen_fd, addr) || listen(listen_fd, 64) < 0 ||
+         !socket_nonblock(listen_fd))
+   {
+      perror("bind");
+      return false;
+   }
+
+   return true;
+}
+
+static void peer_accept(void)
+{
+   size_t i;
+   int on = 1;
+   int fd = accept(listen_fd, NULL, NULL);
+
+   if (fd < 0)
+      return;
+
+   for (i = 0; i < RELAY_MAX_PEERS; i++)
+      if (peers[i].state == RELAY_PEER_NONE)
+         break;
+
+   if (i == RELAY_MAX_PEERS || fd >= FD_SETSIZE || !socket_nonblock(fd))
+   {
+      socket_close(fd);
+      return;
+   }
+
+   setsockopt(fd, IPPROTO_TCP, TCP_NODELAY, (const char*)&on, sizeof(on));
+   memset(&peers[i], 0, sizeof(peers[i]));
+   peers[i].fd    = fd;
+   peers[i].state = RELAY_PEER_HEADER;
+}
+
+/* Act on what a spectator sent, as far as it is complete */
+static void peer_recv(struct relay_peer *peer)
+{
+   uint8_t buf[4096];
+   bool error  = false;
+   ssize_t got = socket_receive_all_nonblocking(peer->fd, &error,
+         buf, sizeof(buf));
+
+   if (got < 0 || error)
+   {
+      peer_close(peer);
+      return;
+   }
+   if (!buffer_append(&peer->in, buf, (size_t)got))
+   {
+      peer_close(peer);
+      return;
+   }
+
+   while (peer->state != RELAY_PEER_NONE && !peer->closing)
+   {
+      uint32_t pcmd, psize;
+      const uint32_t *words = (const uint32_t*)peer->in.data;
+
+      if (peer->state == RELAY_PEER_HEADER)
+      {
+         uint32_t lo, hi, compression;
+
+         if (peer->in.len < 6*sizeof(uint32_t))
+            return;
+
+         if (ntohl(words[0]) == POKE_MAGIC)
+         {
+            send_header(peer, protocol);
+            peer->closing = true;
+            return;
+         }
+         if (ntohl(words[0]) != NETPLAY_MAGIC)
+         {
+            peer_close(peer);
+            return;
+         }
+
+         /* They have to speak the protocol the host does */
+         compression = ntohl(words[2]);
+         lo          = ntohl(words[4]);
+         hi          = ntohl(words[3]);
+         if (!hi)
+            hi = lo;
+         if (lo > protocol || hi < protocol ||
+               !(compression & NETPLAY_COMPRESSION_LZ4))
+         {
+            send_header(peer, 0);
+            peer->closing = true;
+            return;
+         }
+
+         send_header(peer, protocol);
+         buffer_consume(&peer->in, 6*sizeof(uint32_t));
+         peer->state = RELAY_PEER_NICK;
+         continue;
+      }
+
+      if (peer->in.len < 2*sizeof(uint32_t))
+         return;
+      pcmd  = ntohl(words[0]);
+      psize = ntohl(words[1]);
+      if (psize > RELAY_MAX_PEER_CMD)
+      {
+         peer_close(peer);
+         return;
+      }
+      if (peer->in.len < 2*sizeof(uint32_t) + psize)
+         return;
+
+      switch (peer->state)
+      {
+         case RELAY_PEER_NICK:
+            if (pcmd != NETPLAY_CMD_NICK || psize != NETPLAY_NICK_LEN)
+            {
+               peer_close(peer);
+               return;
+            }
+            memcpy(peer->nick, words + 2, sizeof(peer->nick));
+            peer->nick[sizeof(peer->nick) - 1] = '\0';
+
+            /* The host's nick and INFO, it's who they are watching */
+            peer_send_cmd(peer, NETPLAY_CMD_NICK, host_nick,
+                  sizeof(host_nick));
+            peer_send(peer, info, info_size);
+            peer->state = RELAY_PEER_INFO;
+            break;
+
+         case RELAY_PEER_INFO:
+            if (pcmd != NETPLAY_CMD_INFO)
+            {
+               peer_close(peer);
+               return;
+            }
+            fprintf(stderr, "Spectator \"%s\" connected.\n", peer->nick);
+            peer->state = RELAY_PEER_WAITING;
+            request_savestate();
+            break;
+
+         default:
+            switch (pcmd)
+            {
+               case NETPLAY_CMD_PLAY:
+                  {
+                     uint32_t reason = htonl(
+                           NETPLAY_CMD_MODE_REFUSED_REASON_UNPRIVILEGED);
+                     peer_send_cmd(peer, NETPLAY_CMD_MODE_REFUSED,
+                           &reason, sizeof(reason));
+                  }
+                  break;
+               case NETPLAY_CMD_PING_REQUEST:
+                  peer_send_cmd(peer, NETPLAY_CMD_PING_RESPONSE, NULL, 0);
+                  break;
+               case NETPLAY_CMD_REQUEST_SAVESTATE:
+                  /* Desynced, everyone gets the one the host sends */
+                  request_savestate();
+                  break;
+               case NETPLAY_CMD_NAK:
+               case NETPLAY_CMD_DISCONNECT:
+                  peer_close(peer);
+                  return;
+               default:
+                  /* Spectators can't pause, chat or send input */
+                  break;
+            }
+            break;
+      }
+
+      buffer_consume(&peer->in, 2*sizeof(uint32_t) + psize);
+   }
+}
+
+int main(int argc, char **argv)
+{
+   size_t i;
+   const char *host = "localhost",
+      *nick = "RANetRelay";
+   int port = RARCH_DEFAULT_PORT,
+      listen_port = RARCH_DEFAULT_PORT + 1;
+
+   const struct option opt[] = {
+      {"host",       1, NULL, 'H'},
+      {"port",       1, NULL, 'P'},
+      {"listen",     1, NULL, 'l'},
+      {"nick",       1, NULL, 'n'},
+      {NULL,         0, NULL, 0}
+   };
+
+   for (;;)
+   {
+      int c = getopt_long(argc, argv, "H:P:l:n:", opt, NULL);
+      if (c == -1)
+         break;
+
+      switch (c)
+      {
+         case 'H':
+            host = optarg;
+            break;
+
+         case 'P':
+            port = atoi(optarg);
+            break;
+
+         case 'l':
+            listen_port = atoi(optarg);
+            break;
+
+         case 'n':
+            nick = optarg;
+            break;
+
+         default:
+            usage();
+            return 1;
+      }
+   }
+
+   for (i = 0; i < RELAY_MAX_PEERS; i++)
+      peers[i].fd = -1;
+
+   payload_size = 4096;
+   if (!(payload = (uint32_t*)malloc(payload_size)))
+   {
+      perror("malloc");
+      return 1;
+   }
+
+   if (!listen_init(listen_port) || !host_connect(host, port, nick))
+      return 1;
+
+   for (;;)
+   {
+      fd_set rfds, wfds;
+      int nfds = (host_fd > listen_fd ? host_fd : listen_fd) + 1;
+
+      FD_ZERO(&rfds);
+      FD_ZERO(&wfds);
+      FD_SET(host_fd, &rfds);
+      FD_SET(listen_fd, &rfds);
+      for (i = 0; i < RELAY_MAX_PEERS; i++)
+      {
+         if (peers[i].state == RELAY_PEER_NONE)
+            continue;
+         if (!peers[i].closing)
+            FD_SET(peers[i].fd, &rfds);
+         if (peers[i].out.len)
+            FD_SET(peers[i].fd, &wfds);
+         if (peers[i].fd >= nfds)
+            nfds = peers[i].fd + 1;
+      }
+
+      if (socket_select(nfds, &rfds, &wfds, NULL, NULL) < 0)
+      {
+         perror("select");
+         return 1;
+      }
+
+      if (FD_ISSET(host_fd, &rfds))
+      {
+         if (!host_recv_cmd() || !host_cmd())
+         {
+            fprintf(stderr, "Netplay disconnected.\n");
+            break;
+         }
+      }
+
+      if (FD_ISSET(listen_fd, &rfds))
+         peer_accept();
+
+      for (i = 0; i < RELAY_MAX_PEERS; i++)
+      {
+         if (peers[i].state == RELAY_PEER_NONE)
+            continue;
+         if (!peers[i].closing && FD_ISSET(peers[i].fd, &rfds))
+            peer_recv(&peers[i]);
+         peer_flush(&peers[i]);
+      }
+   }
+
+   for (i = 0; i < RELAY_MAX_PEERS; i++)
+   {
+      if (peers[i].state == RELAY_PEER_NONE)
+         continue;
+      peer_send_cmd(&peers[i], NETPLAY_CMD_DISCONNECT, NULL, 0);
+      peer_flush(&peers[i]);
+      peer_close(&peers[i]);
+   }
+   socket_close(host_fd);
+   socket_close(listen_fd);
+
+   return 0;
+}
@@ -0,0 +1,370 @@
+/*  RetroArch - A frontend for libretro.
+ *  Copyright (C) 2010-2014 - Hans-Kristian Arntzen
+ *  Copyright (C) 2011-2021 - Daniel De Matteis
+ *
+ *  RetroArch is free software: you can redistribute it and/or modify it under the terms
+ *  of the GNU General Public License as published by the Free Software Found-
+ *  ation, either version 3 of the License, or (at your option) any later version.
+ *
+ *  RetroArch is distributed in the hope that it will be useful, but WITHOUT ANY WARRANTY;
+ *  without even the implied warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR
+ *  PURPOSE.  See the GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License along with RetroArch.
+ *  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+/* Unpacks an .rcap capture into raw video and raw PCM, and prints
+ * the ffmpeg command line that encodes them. */
+
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/types.h>
+
+#include <streams/trans_stream.h>
+
+#include "../../record/drivers/record_rcap.h"
+
+/* enum ffemu_pix_format */
+#define RCAP_PIX_RGB565   0
+#define RCAP_PIX_BGR24    1
+#define RCAP_PIX_ARGB8888 2
+
+struct rcap_file
+{
+   FILE *f;
+   uint64_t fps;
+   uint64_t samplerate;
+   uint64_t index_offset;
+   uint64_t frames;
+   uint32_t flags;
+   uint32_t pix_fmt;
+   uint32_t channels;
+   unsigned pix_size;
+};
+
+static uint32_t get32(const uint8_t *p)
+{
+   return  (uint32_t)p[0]        | ((uint32_t)p[1] <<  8)
+         | ((uint32_t)p[2] << 16) | ((uint32_t)p[3] << 24);
+}
+
+static uint64_t get64(const uint8_t *p)
+{
+   return get32(p) | ((uint64_t)get32(p + 4) << 32);
+}
+
+static int read_header(struct rcap_file *rc)
+{
+   uint8_t hdr[RCAP_HEADER_SIZE];
+
+   if (fread(hdr, 1, sizeof(hdr), rc->f) != sizeof(hdr)
+         || get32(hdr) != RCAP_MAGIC)
+   {
+      fprintf(stderr, "Not an RCAP file.\n");
+      return 0;
+   }
+   if (get32(hdr + 4) != RCAP_VERSION)
+   {
+      fprintf(stderr, "Unsupported RCAP version %u.\n",
+            (unsigned)get32(hdr + 4));
+      return 0;
+   }
+
+   rc->flags        = get32(hdr +  8);
+   rc->pix_fmt      = get32(hdr + 12);
+   rc->channels     = get32(hdr + 24);
+   rc->fps          = get64(hdr + 32);
+   rc->samplerate   = get64(hdr + 40);
+   rc->index_offset = get64(hdr + 48);
+   rc->frames       = get64(hdr + 56);
+
+   switch (rc->pix_fmt)
+   {
+      case RCAP_PIX_RGB565:
+         rc->pix_size = 2;
+         break;
+      case RCAP_PIX_BGR24:
+         rc->pix_size = 3;
+         break;
+      case RCAP_PIX_ARGB8888:
+         rc->pix_size = 4;
+         break;
+      default:
+         fprintf(stderr, "Unknown pixel format %u.\n",
+               (unsigned)rc->pix_fmt);
+         return 0;
+   }
+
+   return 1;
+}
+
+/* Reads the next chunk header, returns 0 at the end of the file */
+static int next_chunk(struct rcap_file *rc, uint32_t *type, uint32_t *size)
+{
+   uint8_t hdr[RCAP_CHUNK_HEADER_SIZE];
+   if (fread(hdr, 1, sizeof(hdr), rc->f) != sizeof(hdr))
+      return 0;
+   *type = get32(hdr);
+   *size = get32(hdr + 4);
+   return 1;
+}
+
+/* Offset of the last keyframe at or before 'frame', so
+ * decoding can start there instead of at the beginning. */
+static off_t find_keyframe(struct rcap_file *rc, uint32_t frame)
+{
+   uint32_t type, size, i;
+   off_t offset = RCAP_HEADER_SIZE;
+
+   if (!rc->index_offset)
+      return offset;
+
+   if (     fseeko(rc->f, (off_t)rc->index_offset, SEEK_SET)
+         || !next_chunk(rc, &type, &size)
+         || type != RCAP_CHUNK_INDEX)
+      return offset;
+
+   for (i = 0; i < size / RCAP_INDEX_ENTRY_SIZE; i++)
+   {
+      uint8_t entry[RCAP_INDEX_ENTRY_SIZE];
+      if (fread(entry, 1, sizeof(entry), rc->f) != sizeof(entry)
+            || get32(entry) > frame)
+         break;
+      offset = (off_t)get64(entry + 8);
+   }
+
+   return offset;
+}
+
+static const char *pix_fmt_name(const struct rcap_file *rc)
+{
+   int be = (rc->flags & RCAP_FLAG_BIG_ENDIAN) != 0;
+   switch (rc->pix_fmt)
+   {
+      case RCAP_PIX_RGB565:
+         return be ? "rgb565be" : "rgb565le";
+      case RCAP_PIX_BGR24:
+         return "bgr24";
+      default:
+         break;
+   }
+   /* 0xXXRRGGBB in native order */
+   return be ? "0rgb" : "bgr0";
+}
+
+int main(int argc, char *argv[])
+{
+   struct rcap_file rc;
+   uint32_t type, size;
+   const struct trans_stream_backend *backend = NULL;
+   void *stream         = NULL;
+   uint8_t *cur         = NULL;
+   uint8_t *delta       = NULL;
+   uint8_t *packed      = NULL;
+   uint8_t *line        = NULL;
+   FILE *video          = NULL;
+   FILE *audio          = NULL;
+   uint32_t start       = 0;
+   uint32_t count       = 0xffffffff;
+   uint32_t max_width   = 0;
+   uint32_t max_height  = 0;
+   uint32_t width       = 0;
+   uint32_t height      = 0;
+   uint32_t frame       = 0;
+   uint32_t written     = 0;
+   uint32_t packed_cap  = 0;
+   int have_frame       = 0;
+   int ret              = 1;
+   int argi             = 1;
+
+   memset(&rc, 0, sizeof(rc));
+
+   while (argi + 1 < argc && argv[argi][0] == '-')
+   {
+      if (!strcmp(argv[argi], "-s"))
+         start = (uint32_t)strtoul(argv[argi + 1], NULL, 0);
+      else if (!strcmp(argv[argi], "-n"))
+         count = (uint32_t)strtoul(argv[argi + 1], NULL, 0);
+      else
+         break;
+      argi += 2;
+   }
+
+   if (argc - argi < 2)
+   {
+      fprintf(stderr, "Usage: %s [-s first frame] [-n frames] "
+            "<capture.rcap> <video.raw> [audio.raw]\n", argv[0]);
+      return 1;
+   }
+
+   if (!(rc.f = fopen(argv[argi], "rb")))
+   {
+      fprintf(stderr, "Failed to open \"%s\".\n", argv[argi]);
+      return 1;
+   }
+   if (!read_header(&rc))
+      goto end;
+
+   /* First pass: the output size is that of the largest frame,
+    * smaller ones are padded */
+   while (next_chunk(&rc, &type, &size))
+   {
+      if (type == RCAP_CHUNK_VIDEO && size >= RCAP_VIDEO_HEADER_SIZE)
+      {
+         uint8_t hdr[RCAP_VIDEO_HEADER_SIZE];
+         if (fread(hdr, 1, sizeof(hdr), rc.f) != sizeof(hdr))
+            break;
+         if (get32(hdr + 4) > max_width)
+            max_width  = get32(hdr + 4);
+         if (get32(hdr + 8) > max_height)
+            max_height = get32(hdr + 8);
+         size -= RCAP_VIDEO_HEADER_SIZE;
+      }
+      if (fseeko(rc.f, (off_t)size, SEEK_CUR))
+         break;
+   }
+
+   if (!max_width || !max_height)
+   {
+      fprintf(stderr, "No video in capture.\n");
+      goto end;
+   }
+
+   backend = trans_stream_get_lz4_decompress_backend();
+   if (     !(stream = backend->stream_new())
+         || !(cur    = (uint8_t*)calloc(1,
+               (size_t)max_width * max_height * rc.pix_size))
+         || !(delta  = (uint8_t*)malloc(
+               (size_t)max_width * max_height * rc.pix_size))
+         || !(line   = (uint8_t*)calloc(1,
+               (size_t)max_width * rc.pix_size)))
+      goto end;
+
+   if (!(video = fopen(argv[argi + 1], "wb")))
+   {
+      fprintf(stderr, "Failed to open \"%s\".\n", argv[argi + 1]);
+      goto end;
+   }
+   if (argc - argi > 2 && !(audio = fopen(argv[argi + 2], "wb")))
+   {
+      fprintf(stderr, "Failed to open \"%s\".\n", argv[argi + 2]);
+      goto end;
+   }
+
+   /* Second pass, from the keyframe closest to the first frame */
+   if (fseeko(rc.f, find_keyframe(&rc, start), SEEK_SET))
+      goto end;
+
+   while (written < count && next_chunk(&rc, &type, &size))
+   {
+      if (size > packed_cap)
+      {
+         uint8_t *tmp = (uint8_t*)realloc(packed, size);
+         if (!tmp)
+            goto end;
+         packed     = tmp;
+         packed_cap = size;
+      }
+      if (size && fread(packed, 1, size, rc.f) != size)
+      {
+         fprintf(stderr, "Capture is truncated.\n");
+         break;
+      }
+
+      if (type == RCAP_CHUNK_AUDIO)
+      {
+         if (audio && (!start || frame > start))
+            fwrite(packed, 1, size, audio);
+      }
+      else if (type == RCAP_CHUNK_VIDEO && size >= RCAP_VIDEO_HEADER_SIZE)
+      {
+         uint32_t y;
+         uint32_t flags = get32(packed + 12);
+         size_t row;
+
+         frame  = get32(packed);
+         width  = get32(packed + 4);
+         height = get32(packed + 8);
+         row    = (size_t)width * rc.pix_size;
+
+         if (!(flags & RCAP_VIDEO_DUPE))
+         {
+            uint32_t rd = 0, wn = 0;
+            uint8_t *dst;
+            size_t len  = row * height;
+
+            if (!(flags & RCAP_VIDEO_KEY) && !have_frame)
+               continue;
+
+            dst = (flags & RCAP_VIDEO_KEY) ? cur : delta;
+            backend->set_in(stream, packed + RCAP_VIDEO_HEADER_SIZE,
+                  size - RCAP_VIDEO_HEADER_SIZE);
+            backend->set_out(stream, dst, (uint32_t)len);
+            if (!backend->trans(stream, true, &rd, &wn, NULL)
+                  || wn != len)
+            {
+               fprintf(stderr, "Frame %u is corrupt.\n", (unsigned)frame);
+               goto end;
+            }
+
+            if (!(flags & RCAP_VIDEO_KEY))
+            {
+               size_t i;
+               for (i = 0; i < len; i++)
+                  cur[i] ^= delta[i];
+            }
+            have_frame = 1;
+         }
+
+         frame++;
+         if (!have_frame || frame <= start)
+            continue;
+
+         for (y = 0; y < max_height; y++)
+         {
+            if (y < height)
+            {
+               memcpy(line, cur + y * row, row);
+               memset(line + row, 0, (max_width - width) * rc.pix_size);
+            }
+            else if (y == height)
+               memset(line, 0, (size_t)max_width * rc.pix_size);
+            fwrite(line, 1, (size_t)max_width * rc.pix_size, video);
+         }
+         written++;
+      }
+   }
+
+   fprintf(stderr, "Wrote %u frames of %ux%u.\n",
+         (unsigned)written, (unsigned)max_width, (unsigned)max_height);
+
+   printf("ffmpeg -f rawvideo -pixel_format %s -video_size %ux%u "
+         "-framerate %.6f -i %s",
+         pix_fmt_name(&rc), (unsigned)max_width, (unsigned)max_height,
+         rc.fps / 1000000.0, argv[argi + 1]);
+   if (audio)
+      printf(" -f %s -ar %u -ac %u -i %s",
+            (rc.flags & RCAP_FLAG_BIG_ENDIAN) ? "s16be" : "s16le",
+            (unsigned)((rc.samplerate + 500000) / 1000000),
+            (unsigned)rc.channels, argv[argi + 2]);
+   printf(" -c:v libx264rgb -crf 0 output.mkv\n");
+
+   ret = 0;
+
+end:
+   if (stream)
+      backend->stream_free(stream);
+   if (video)
+      fclose(video);
+   if (audio)
+      fclose(audio);
+   fclose(rc.f);
+   free(cur);
+   free(delta);
+   free(packed);
+   free(line);
+   return ret;
+}